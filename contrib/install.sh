@@ -148,6 +148,20 @@ else
     echo "WARNING: jack-connection-manager not found (run 'make manager' to build it)"
 fi
 
+# Install bridge host (all USB/HDMI output bridges in one JACK client)
+if [ -f "contrib/bin/jack-bridge-host" ]; then
+    install -m 0755 contrib/bin/jack-bridge-host /usr/local/bin/jack-bridge-host
+    echo "Installed bridge host to /usr/local/bin/jack-bridge-host"
+else
+    echo "WARNING: jack-bridge-host not found (run 'make bridge' to build it); falling back to alsa_out bridges"
+fi
+
+# Install trace reader (JACK_BRIDGE_TRACE=1..3, see README)
+if [ -f "contrib/bin/jack-bridge-trace" ]; then
+    install -m 0755 contrib/bin/jack-bridge-trace /usr/local/bin/jack-bridge-trace
+    echo "Installed trace reader to /usr/local/bin/jack-bridge-trace"
+fi
+
 # Install autoconnect helper (from contrib; force overwrite)
 if [ -f "contrib/usr/lib/jack-bridge/jack-autoconnect" ]; then
     install -m 0755 contrib/usr/lib/jack-bridge/jack-autoconnect "${USR_LIB_DIR}/jack-autoconnect"
@@ -850,6 +864,22 @@ BT_PERIOD="256"
 BT_NPERIODS="3"
 # Initial preferred output
 PREFERRED_OUTPUT="internal"
+# Extra outputs for jack-connection-manager: SINK_<NAME>="<JACK port prefix>", selected
+# with PREFERRED_OUTPUT="<name>" (built in: internal, usb, hdmi, bluetooth)
+#SINK_AGGREGATE="aggregate:playback_"
+# Play to several outputs at once through the manager's mixer, with optional
+# per-output gain (dB) and delay (ms, up to 500) to line up e.g. HDMI with Bluetooth
+#FANOUT_OUTPUTS="hdmi bluetooth"
+#FANOUT_GAIN_HDMI="-3"
+#FANOUT_DELAY_HDMI="150"
+# Client placed in front of the output while its in_1/2 and out_1/2 ports exist
+# (mxeq's equalizer by default); empty disables it
+#ROUTE_INSERT="mxeq_eq"
+# Channel mapping by short port name ("x" exact, "x*" prefix, "*x" suffix; longest wins)
+#CHANNEL_RULES="out_0=1 out_000=1 out_1=1 left*=1 L*=1 *playback_1=1 out_2=2 out_001=2 right*=2 R*=2 *playback_2=2"
+#IGNORE_PORTS="*:capture_* *:midi_* Midi-Through:* jack_bridge_latency:*"
+# USB/HDMI bridges run in one jack-bridge-host client; 0 spawns one alsa_out per device
+#BRIDGE_HOST="1"
 DEVCONF
 chmod 0644 /etc/jack-bridge/devices.conf
 echo "Installed (replaced) /etc/jack-bridge/devices.conf with BT_PERIOD=256"
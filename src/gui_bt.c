@@ -14,6 +14,11 @@
  *    convert it to the object path assuming hci0 adapter.
  *  - These helpers are synchronous and return 0 on success, -1 on failure.
  *  - Integrate with your GUI main loop and present user-visible dialogs on errors.
+ *  - Adapter/device state comes from a GDBusObjectManagerClient for org.bluez,
+ *    filled once by gui_bt_init() and kept current by InterfacesAdded/Removed
+ *    and PropertiesChanged. Lookups (default adapter, Paired/Trusted/Connected,
+ *    Powered/Discovering/Discoverable, device labels) are memory reads on the
+ *    GTK thread; only user-initiated method calls go to the bus.
  */
 
 #include <stdio.h>
@@ -73,6 +78,8 @@ int gui_bt_unregister_discovery_listeners(void);
 
 /* Cached system bus connection used by GUI helpers (non-owning) */
 static GDBusConnection *gui_system_bus = NULL;
+/* Client-side mirror of BlueZ objects (NULL until gui_bt_init) */
+static GDBusObjectManager *bluez_manager = NULL;
 static gboolean agent_registered = FALSE;
 /* Added: flag to prevent races during shutdown for outstanding async ops */
 static gboolean g_shutting_down = FALSE;
@@ -80,6 +87,11 @@ static gboolean g_shutting_down = FALSE;
 /* Bound GTK model for device list (explicit binding from GUI) */
 static GtkTreeView *s_tree = NULL;
 static GtkListStore *s_store = NULL;
+/* object path -> GtkTreeRowReference for rows in s_store */
+static GHashTable *s_row_index = NULL;
+/* Object paths whose row label is stale, flushed once per frame */
+static GHashTable *s_dirty_rows = NULL;
+static guint s_flush_tick_id = 0;
 
 /* Idempotent listener registration guard */
 static gboolean s_listeners_registered = FALSE;
@@ -87,8 +99,9 @@ static gboolean s_listeners_registered = FALSE;
 /* Forward declarations for internal helpers defined later in this file */
 static gchar *get_default_adapter_path(void);
 static void update_device_row_state(const char *object_path);
-static gboolean __gui_bt_update_device_idle(gpointer data);
-static gboolean __gui_bt_refresh_selection_idle(gpointer data);
+static void queue_device_row_update(const char *object_path);
+static void reset_row_index(void);
+static void schedule_selection_refresh(void);
 /* Forward decl so Start/Stop discovery can refresh Scan/Stop sensitivity immediately */
 static void refresh_adapter_state(void);
 
@@ -115,69 +128,37 @@ static gboolean ensure_system_bus(GError **error) {
     if (!gui_system_bus) return FALSE;
     return TRUE;
 }
-/* Resolve default adapter path dynamically via ObjectManager (no hard-coded hci0) */
+/* Cached interface proxy for object_path, or NULL; unref when done */
+static GDBusProxy *bluez_proxy(const char *object_path, const char *interface_name) {
+    if (!bluez_manager || !object_path) return NULL;
+    GDBusInterface *iface = g_dbus_object_manager_get_interface(bluez_manager, object_path, interface_name);
+    return iface ? G_DBUS_PROXY(iface) : NULL;
+}
+
+/* Cached boolean property (fallback if missing or of another type) */
+static gboolean proxy_bool(GDBusProxy *proxy, const char *name, gboolean fallback) {
+    GVariant *v = proxy ? g_dbus_proxy_get_cached_property(proxy, name) : NULL;
+    gboolean out = fallback;
+    if (v && g_variant_is_of_type(v, G_VARIANT_TYPE_BOOLEAN))
+        out = g_variant_get_boolean(v);
+    if (v) g_variant_unref(v);
+    return out;
+}
+
+/* Resolve default adapter path from the ObjectManager cache (no hard-coded hci0) */
 static gchar *get_default_adapter_path(void) {
-    GError *err = NULL;
-    if (!ensure_system_bus(&err)) {
-        if (err) { g_error_free(err); }
-        return NULL;
-    }
-    g_message("DBG: get_default_adapter_path: calling GetManagedObjects with type '(a{oa{sa{sv}}})'");
-    GVariant *managed = g_dbus_connection_call_sync(
-        gui_system_bus,
-        "org.bluez",
-        "/",
-        "org.freedesktop.DBus.ObjectManager",
-        "GetManagedObjects",
-        NULL,
-        G_VARIANT_TYPE("(a{oa{sa{sv}}})"),
-        G_DBUS_CALL_FLAGS_NONE,
-        -1,
-        NULL,
-        &err
-    );
-    if (!managed) {
-        if (err) {
-            g_warning("get_default_adapter_path: GetManagedObjects failed: %s", err->message);
-            g_error_free(err);
-        }
-        return NULL;
-    }
+    if (!bluez_manager) return NULL;
 
-    GVariantIter *outer = NULL;
-    g_variant_get(managed, "(a{oa{sa{sv}}})", &outer);
-    gchar *path = NULL;
-    GVariant *ifaces = NULL;
     gchar *adapter_path = NULL;
- 
-    while (g_variant_iter_next(outer, "{o@a{sa{sv}}}", &path, &ifaces)) {
-        gchar *iface_name = NULL;
-        GVariant *props = NULL;
-        gboolean is_adapter = FALSE;
-        
-        GVariantIter iiter;
-        g_variant_iter_init(&iiter, ifaces);
-
-        while (g_variant_iter_next(&iiter, "{s@a{sv}}", &iface_name, &props)) {
-            if (g_strcmp0(iface_name, "org.bluez.Adapter1") == 0) {
-                is_adapter = TRUE;
-            }
-            if (props) g_variant_unref(props);
-            g_free(iface_name);
-            if (is_adapter) break;
-        }
-
-        if (is_adapter) {
-            adapter_path = g_strdup(path);
-            if (ifaces) g_variant_unref(ifaces);
-            g_free(path);
-            break;
+    GList *objects = g_dbus_object_manager_get_objects(bluez_manager);
+    for (GList *l = objects; l && !adapter_path; l = l->next) {
+        GDBusInterface *iface = g_dbus_object_get_interface(G_DBUS_OBJECT(l->data), "org.bluez.Adapter1");
+        if (iface) {
+            adapter_path = g_strdup(g_dbus_object_get_object_path(G_DBUS_OBJECT(l->data)));
+            g_object_unref(iface);
         }
-        if (ifaces) g_variant_unref(ifaces);
-        g_free(path);
     }
-    if (outer) g_variant_iter_free(outer);
-    g_variant_unref(managed);
+    g_list_free_full(objects, g_object_unref);
 
     if (!adapter_path) {
         g_warning("get_default_adapter_path: no org.bluez.Adapter1 found");
@@ -190,35 +171,10 @@ static int ensure_adapter_powered(const char *adapter_path) {
     if (!adapter_path) return -1;
     GError *err = NULL;
 
-    /* Get current Powered state */
-    g_message("DBG: ensure_adapter_powered Get Powered on %s", adapter_path);
-    GVariant *res = g_dbus_connection_call_sync(
-        gui_system_bus,
-        "org.bluez",
-        adapter_path,
-        "org.freedesktop.DBus.Properties",
-        "Get",
-        g_variant_new("(ss)", "org.bluez.Adapter1", "Powered"),
-        G_VARIANT_TYPE("(v)"),
-        G_DBUS_CALL_FLAGS_NONE,
-        -1,
-        NULL,
-        &err
-    );
-    if (!res) {
-        if (err) {
-            g_warning("ensure_adapter_powered(Get): %s", err->message);
-            g_error_free(err);
-        }
-        return -1;
-    }
-    GVariant *v = NULL;
-    g_variant_get(res, "(v)", &v);
-    gboolean powered = FALSE;
-    if (v && g_variant_is_of_type(v, G_VARIANT_TYPE_BOOLEAN))
-        powered = g_variant_get_boolean(v);
-    if (v) g_variant_unref(v);
-    g_variant_unref(res);
+    /* Current Powered state from the cache */
+    GDBusProxy *adapter = bluez_proxy(adapter_path, "org.bluez.Adapter1");
+    gboolean powered = proxy_bool(adapter, "Powered", FALSE);
+    if (adapter) g_object_unref(adapter);
 
     if (powered) return 0;
 
@@ -227,7 +183,7 @@ static int ensure_adapter_powered(const char *adapter_path) {
      * some GLib/BlueZ combinations that can cause "invalid signature". */
     GVariant *params = g_variant_new("(ssv)", "org.bluez.Adapter1", "Powered", g_variant_new_boolean(TRUE));
     g_message("DBG: ensure_adapter_powered Set Powered=true on %s (params type=%s)", adapter_path, g_variant_get_type_string(params));
-    res = g_dbus_connection_call_sync(
+    GVariant *res = g_dbus_connection_call_sync(
         gui_system_bus,
         "org.bluez",
         adapter_path,
@@ -335,51 +291,16 @@ int gui_bt_set_adapter_discoverable(gboolean discoverable) {
 
 /* Query adapter Discoverable property for UI state */
 gboolean gui_bt_get_adapter_discoverable(void) {
-    GError *err = NULL;
-    if (!ensure_system_bus(&err)) {
-        if (err) g_error_free(err);
-        return TRUE; /* Default to discoverable on error */
-    }
-    
-    gchar *adapter = get_default_adapter_path();
-    if (!adapter) {
+    gchar *adapter_path = get_default_adapter_path();
+    if (!adapter_path) {
         return TRUE; /* Default to discoverable */
     }
-    
-    /* Get current Discoverable state */
-    g_message("DBG: gui_bt_get_adapter_discoverable: Get Discoverable on %s", adapter);
-    GVariant *res = g_dbus_connection_call_sync(
-        gui_system_bus,
-        "org.bluez",
-        adapter,
-        "org.freedesktop.DBus.Properties",
-        "Get",
-        g_variant_new("(ss)", "org.bluez.Adapter1", "Discoverable"),
-        G_VARIANT_TYPE("(v)"),
-        G_DBUS_CALL_FLAGS_NONE,
-        -1,
-        NULL,
-        &err
-    );
-    
-    if (!res) {
-        if (err) {
-            g_warning("gui_bt_get_adapter_discoverable(Get): %s", err->message);
-            g_error_free(err);
-        }
-        g_free(adapter);
-        return TRUE; /* Default to discoverable on error */
-    }
-    
-    GVariant *v = NULL;
-    g_variant_get(res, "(v)", &v);
-    gboolean discoverable = TRUE; /* Default */
-    if (v && g_variant_is_of_type(v, G_VARIANT_TYPE_BOOLEAN))
-        discoverable = g_variant_get_boolean(v);
-    if (v) g_variant_unref(v);
-    g_variant_unref(res);
-    g_free(adapter);
-    
+
+    GDBusProxy *adapter = bluez_proxy(adapter_path, "org.bluez.Adapter1");
+    gboolean discoverable = proxy_bool(adapter, "Discoverable", TRUE);
+    if (adapter) g_object_unref(adapter);
+    g_free(adapter_path);
+
     return discoverable;
 }
 
@@ -406,6 +327,23 @@ int gui_bt_init(void) {
         return -1;
     }
 
+    /* One GetManagedObjects here; signals keep the cache current afterwards.
+     * Succeeds without bluetoothd too and fills in once org.bluez appears. */
+    if (!bluez_manager) {
+        bluez_manager = g_dbus_object_manager_client_new_sync(gui_system_bus,
+                                                              G_DBUS_OBJECT_MANAGER_CLIENT_FLAGS_DO_NOT_AUTO_START,
+                                                              "org.bluez",
+                                                              "/",
+                                                              NULL, NULL, NULL,
+                                                              NULL,
+                                                              &err);
+        if (!bluez_manager) {
+            fprintf(stderr, "gui_bt_init: BlueZ object manager unavailable: %s\n", err ? err->message : "(unknown)");
+            if (err) g_error_free(err);
+            err = NULL;
+        }
+    }
+
     if (!bt_agent_register(gui_system_bus, &err)) {
         fprintf(stderr, "gui_bt_init: bt_agent_register failed: %s\n", err ? err->message : "(unknown)");
         if (err) g_error_free(err);
@@ -425,9 +363,15 @@ void gui_bt_shutdown(void) {
     gui_bt_unregister_discovery_listeners();
 
     /* Drop strong refs to bound store/tree */
+    reset_row_index();
     if (s_store) { g_object_unref(s_store); s_store = NULL; }
     if (s_tree)  { g_object_unref(s_tree);  s_tree  = NULL; }
 
+    if (bluez_manager) {
+        g_object_unref(bluez_manager);
+        bluez_manager = NULL;
+    }
+
     if (agent_registered && gui_system_bus) {
         bt_agent_unregister(gui_system_bus);
         agent_registered = FALSE;
@@ -734,7 +678,7 @@ static void pair_call_done(GObject *source_object, GAsyncResult *res, gpointer u
     g_variant_unref(r);
     /* Refresh row state and selection after success */
     update_device_row_state(ctx->device_path);
-    g_idle_add(__gui_bt_refresh_selection_idle, NULL);
+    schedule_selection_refresh();
     invoke_cb_main(ctx->cb, TRUE, NULL, ctx->ud);
     bt_op_ctx_free(ctx);
 }
@@ -854,7 +798,7 @@ static void connect_call_done(GObject *source_object, GAsyncResult *res, gpointe
     g_variant_unref(r);
     /* Refresh row state and selection after success */
     update_device_row_state(ctx->device_path);
-    g_idle_add(__gui_bt_refresh_selection_idle, NULL);
+    schedule_selection_refresh();
     invoke_cb_main(ctx->cb, TRUE, NULL, ctx->ud);
     bt_op_ctx_free(ctx);
 }
@@ -928,7 +872,7 @@ static void trust_call_done(GObject *source_object, GAsyncResult *res, gpointer
     g_variant_unref(r);
     /* Refresh row state and selection after success */
     update_device_row_state(ctx->device_path);
-    g_idle_add(__gui_bt_refresh_selection_idle, NULL);
+    schedule_selection_refresh();
     invoke_cb_main(ctx->cb, TRUE, NULL, ctx->ud);
     bt_op_ctx_free(ctx);
 }
@@ -982,52 +926,15 @@ int gui_bt_trust_device_async(const char *device_path_or_mac, gboolean trusted,
     return 0;
 }
 
-/* ---------- Existing sync helper (used by selection gating) ---------- */
-/* Query Device1 booleans for gating UI buttons; returns 0 on success, -1 on error */
+/* ---------- Cached state lookup (used by selection gating) ---------- */
+/* Query Device1 booleans for gating UI buttons; returns 0 on success, -1 if the device is unknown */
 int gui_bt_get_device_state(const char *object_path, gboolean *paired, gboolean *trusted, gboolean *connected) {
-    GError *err = NULL;
-    if (!object_path) return -1;
-    if (!ensure_system_bus(&err)) {
-        if (err) g_error_free(err);
-        return -1;
-    }
-    GVariant *res = g_dbus_connection_call_sync(
-        gui_system_bus,
-        "org.bluez",
-        object_path,
-        "org.freedesktop.DBus.Properties",
-        "GetAll",
-        g_variant_new("(s)", "org.bluez.Device1"),
-        G_VARIANT_TYPE("(a{sv})"),
-        G_DBUS_CALL_FLAGS_NONE,
-        2000,
-        NULL,
-        &err
-    );
-    if (!res) {
-        if (err) { g_debug("gui_bt_get_device_state(GetAll): %s", err->message); g_error_free(err); }
-        return -1;
-    }
-    gboolean p = FALSE, t = FALSE, c = FALSE;
-    GVariantIter *iter = NULL;
-    g_variant_get(res, "(a{sv})", &iter);
-    gchar *key = NULL;
-    GVariant *val = NULL;
-    while (g_variant_iter_next(iter, "{sv}", &key, &val)) {
-        if (g_strcmp0(key, "Paired") == 0 && g_variant_is_of_type(val, G_VARIANT_TYPE_BOOLEAN))
-            p = g_variant_get_boolean(val);
-        else if (g_strcmp0(key, "Trusted") == 0 && g_variant_is_of_type(val, G_VARIANT_TYPE_BOOLEAN))
-            t = g_variant_get_boolean(val);
-        else if (g_strcmp0(key, "Connected") == 0 && g_variant_is_of_type(val, G_VARIANT_TYPE_BOOLEAN))
-            c = g_variant_get_boolean(val);
-        g_free(key);
-        g_variant_unref(val);
-    }
-    if (iter) g_variant_iter_free(iter);
-    g_variant_unref(res);
-    if (paired)   *paired = p;
-    if (trusted)  *trusted = t;
-    if (connected)*connected = c;
+    GDBusProxy *dev = bluez_proxy(object_path, "org.bluez.Device1");
+    if (!dev) return -1;
+    if (paired)   *paired = proxy_bool(dev, "Paired", FALSE);
+    if (trusted)  *trusted = proxy_bool(dev, "Trusted", FALSE);
+    if (connected)*connected = proxy_bool(dev, "Connected", FALSE);
+    g_object_unref(dev);
     return 0;
 }
 
@@ -1109,6 +1016,7 @@ int gui_bt_attach_device_store_widget(GtkWidget *treeview) {
 int gui_bt_set_device_store_widget(GtkWidget *treeview, GtkListStore *store) {
     if (!GTK_IS_TREE_VIEW(treeview) || !GTK_IS_LIST_STORE(store)) return -1;
 
+    reset_row_index();
     if (s_store) { g_object_unref(s_store); s_store = NULL; }
     if (s_tree)  { g_object_unref(s_tree);  s_tree  = NULL; }
 
@@ -1117,8 +1025,40 @@ int gui_bt_set_device_store_widget(GtkWidget *treeview, GtkListStore *store) {
     return 0;
 }
 
-/* Append or update a device row (display, object_path) on any attached tree.
-   This looks for a tree widget that exposes "device_store" data (set by mxeq.c).
+/* Drop the row index and pending updates (store rebound or shutting down) */
+static void reset_row_index(void) {
+    if (s_flush_tick_id && s_tree) gtk_widget_remove_tick_callback(GTK_WIDGET(s_tree), s_flush_tick_id);
+    s_flush_tick_id = 0;
+    if (s_dirty_rows) { g_hash_table_destroy(s_dirty_rows); s_dirty_rows = NULL; }
+    if (s_row_index) { g_hash_table_destroy(s_row_index); s_row_index = NULL; }
+}
+
+/* Row for object_path without walking the store; FALSE if there is none */
+static gboolean find_device_row(const char *object_path, GtkTreeIter *iter) {
+    if (!s_store || !s_row_index || !object_path) return FALSE;
+    GtkTreeRowReference *ref = g_hash_table_lookup(s_row_index, object_path);
+    if (!ref) return FALSE;
+    GtkTreePath *path = gtk_tree_row_reference_get_path(ref);
+    if (!path) {
+        /* Row vanished behind our back */
+        g_hash_table_remove(s_row_index, object_path);
+        return FALSE;
+    }
+    gboolean ok = gtk_tree_model_get_iter(GTK_TREE_MODEL(s_store), iter, path);
+    gtk_tree_path_free(path);
+    return ok;
+}
+
+/* Set a row label unless it already reads the same (avoids a redraw) */
+static void set_row_label(GtkTreeIter *iter, const char *label) {
+    gchar *current = NULL;
+    gtk_tree_model_get(GTK_TREE_MODEL(s_store), iter, 0, &current, -1);
+    if (g_strcmp0(current, label) != 0)
+        gtk_list_store_set(s_store, iter, 0, label, -1);
+    g_free(current);
+}
+
+/* Append or update a device row (display, object_path) in the bound store.
    Returns 0 on success, -1 on failure.
 */
 int gui_bt_add_device(const char *display, const char *object_path) {
@@ -1127,51 +1067,41 @@ int gui_bt_add_device(const char *display, const char *object_path) {
 
     /* Update if exists */
     GtkTreeIter iter;
-    gboolean valid = gtk_tree_model_get_iter_first(GTK_TREE_MODEL(s_store), &iter);
-    while (valid) {
-        gchar *obj = NULL;
-        gtk_tree_model_get(GTK_TREE_MODEL(s_store), &iter, 1, &obj, -1);
-        if (obj && g_strcmp0(obj, object_path) == 0) {
-            gtk_list_store_set(s_store, &iter, 0, display, -1);
-            g_free(obj);
-            return 0;
-        }
-        if (obj) g_free(obj);
-        valid = gtk_tree_model_iter_next(GTK_TREE_MODEL(s_store), &iter);
+    if (find_device_row(object_path, &iter)) {
+        set_row_label(&iter, display);
+        return 0;
     }
 
     /* Append new */
-    GtkTreeIter newiter;
-    gtk_list_store_append(s_store, &newiter);
-    gtk_list_store_set(s_store, &newiter, 0, display, 1, object_path, -1);
+    gtk_list_store_append(s_store, &iter);
+    gtk_list_store_set(s_store, &iter, 0, display, 1, object_path, -1);
+
+    if (!s_row_index)
+        s_row_index = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                            (GDestroyNotify)gtk_tree_row_reference_free);
+    GtkTreePath *path = gtk_tree_model_get_path(GTK_TREE_MODEL(s_store), &iter);
+    g_hash_table_replace(s_row_index, g_strdup(object_path),
+                         gtk_tree_row_reference_new(GTK_TREE_MODEL(s_store), path));
+    gtk_tree_path_free(path);
     return 0;
 }
 
-/* Remove device row(s) matching object_path */
+/* Remove the device row matching object_path */
 int gui_bt_remove_device_by_object(const char *object_path) {
     if (!object_path) return -1;
     if (!s_store) return -1;
 
     GtkTreeIter iter;
-    gboolean valid = gtk_tree_model_get_iter_first(GTK_TREE_MODEL(s_store), &iter);
-    while (valid) {
-        gchar *obj = NULL;
-        gtk_tree_model_get(GTK_TREE_MODEL(s_store), &iter, 1, &obj, -1);
-        if (obj && g_strcmp0(obj, object_path) == 0) {
-            gtk_list_store_remove(s_store, &iter);
-            if (obj) g_free(obj);
-            return 0;
-        }
-        if (obj) g_free(obj);
-        valid = gtk_tree_model_iter_next(GTK_TREE_MODEL(s_store), &iter);
-    }
-    return -1;
+    if (s_dirty_rows) g_hash_table_remove(s_dirty_rows, object_path);
+    if (!find_device_row(object_path, &iter)) return -1;
+    gtk_list_store_remove(s_store, &iter);
+    g_hash_table_remove(s_row_index, object_path);
+    return 0;
 }
 
-/* GUI-side discovery callbacks: subscribe to org.bluez ObjectManager signals and forward
+/* GUI-side discovery callbacks: follow the org.bluez ObjectManager cache and forward
    discovered devices into the GUI list via gui_bt_add_device / gui_bt_remove_device.
-   This code runs in the main thread context when possible; signal handlers schedule
-   g_idle_add to ensure GTK updates happen on the main loop.
+   The manager emits its signals on the main loop, so GTK is updated directly.
 */
 
 #include <gio/gio.h>
@@ -1180,10 +1110,15 @@ int gui_bt_remove_device_by_object(const char *object_path) {
 int gui_bt_add_device(const char *display, const char *object_path);
 int gui_bt_remove_device_by_object(const char *object_path);
 
-static guint bluez_interfaces_added_sub = 0;
-static guint bluez_interfaces_removed_sub = 0;
-static guint bluez_device_props_changed_sub = 0;
-static guint bluez_adapter_props_changed_sub = 0;
+/* ObjectManager signal handlers (0 = not connected) */
+static gulong bluez_object_added_id = 0;
+static gulong bluez_object_removed_id = 0;
+static gulong bluez_interface_added_id = 0;
+static gulong bluez_interface_removed_id = 0;
+static gulong bluez_props_changed_id = 0;
+
+/* Pending coalesced selection refresh (0 = none) */
+static guint s_selection_refresh_id = 0;
 
 /* Scan/Stop buttons bound from GUI for Adapter state updates */
 static GtkWidget *s_scan_btn = NULL;
@@ -1191,48 +1126,6 @@ static GtkWidget *s_stop_btn = NULL;
 static gboolean s_adapter_discovering = FALSE;
 static gboolean s_adapter_powered = FALSE;
 
-/* Handler invoked on the GLib main loop to add a device */
-static gboolean __gui_bt_add_device_idle(gpointer data) {
-    char **parts = data;
-    gui_bt_add_device(parts[0], parts[1]);
-    /* After adding, refresh row label with Paired/Trusted/Connected state */
-    /* parts[1] is object_path */
-    update_device_row_state(parts[1]);
-    g_free(parts[0]);
-    g_free(parts[1]);
-    g_free(parts);
-    return G_SOURCE_REMOVE;
-}
-
-/* Handler invoked on the GLib main loop to remove a device from GUI list only */
-static gboolean __gui_bt_remove_device_idle(gpointer data) {
-    char *obj = data;
-    gui_bt_remove_device_by_object(obj);
-    g_free(obj);
-    return G_SOURCE_REMOVE;
-}
-
-/* Device1 PropertiesChanged handler (runs in D-Bus thread; schedule UI update on main loop) */
-static void bluez_device_properties_changed_cb(GDBusConnection *c, const gchar *sender, const gchar *object_path,
-                                               const gchar *interface_name, const gchar *signal_name,
-                                               GVariant *parameters, gpointer user_data) {
-    (void)c; (void)sender; (void)interface_name; (void)signal_name; (void)parameters; (void)user_data;
-    if (object_path) {
-        /* Update the device row label (Paired/Trusted/Connected) */
-        g_idle_add(__gui_bt_update_device_idle, g_strdup(object_path));
-        /* Also refresh any selection-driven buttons in the GUI (e.g. Pair/Connect gating) */
-        g_idle_add(__gui_bt_refresh_selection_idle, NULL);
-    }
-}
-
-/* Idle updater to refresh a device row display based on latest properties */
-static gboolean __gui_bt_update_device_idle(gpointer data) {
-    char *obj = data;
-    update_device_row_state(obj);
-    g_free(obj);
-    return G_SOURCE_REMOVE;
-}
-
 /* Idle updater to refresh Scan/Stop button sensitivity from Adapter state */
 static gboolean __gui_bt_update_scan_buttons_idle(gpointer data) {
     (void)data;
@@ -1250,6 +1143,7 @@ static gboolean __gui_bt_update_scan_buttons_idle(gpointer data) {
 /* Idle updater to refresh selection-driven buttons (emits 'changed' on selection) */
 static gboolean __gui_bt_refresh_selection_idle(gpointer data) {
     (void)data;
+    s_selection_refresh_id = 0;
     if (!s_tree) return G_SOURCE_REMOVE;
     GtkTreeSelection *sel = gtk_tree_view_get_selection(GTK_TREE_VIEW(s_tree));
     if (!sel) return G_SOURCE_REMOVE;
@@ -1258,68 +1152,29 @@ static gboolean __gui_bt_refresh_selection_idle(gpointer data) {
     return G_SOURCE_REMOVE;
 }
 
-/* refresh_selection_buttons removed — no longer used. The GUI now triggers
-   selection-driven updates via the idle callback __gui_bt_refresh_selection_idle
-   directly where needed. */
+/* Refresh selection-driven buttons once per main loop iteration, however many
+   devices changed in between (a scan reports dozens of devices at once) */
+static void schedule_selection_refresh(void) {
+    if (s_selection_refresh_id == 0)
+        s_selection_refresh_id = g_idle_add(__gui_bt_refresh_selection_idle, NULL);
+}
 
-/* Query Adapter1 state (Powered, Discovering) and update globals */
+/* Read Adapter1 state (Powered, Discovering) from the cache and update buttons */
 static void refresh_adapter_state(void) {
-    GError *err = NULL;
-    gchar *adapter = get_default_adapter_path();
-    if (!adapter) return;
+    gchar *adapter_path = get_default_adapter_path();
+    if (!adapter_path) return;
 
-    g_message("DBG: refresh_adapter_state GetAll on %s", adapter);
-    GVariant *res = g_dbus_connection_call_sync(
-        gui_system_bus,
-        "org.bluez",
-        adapter,
-        "org.freedesktop.DBus.Properties",
-        "GetAll",
-        g_variant_new("(s)", "org.bluez.Adapter1"),
-        G_VARIANT_TYPE("(a{sv})"),
-        G_DBUS_CALL_FLAGS_NONE,
-        2000,
-        NULL,
-        &err
-    );
-    if (!res) {
-        if (err) g_error_free(err);
-        g_free(adapter);
-        return;
-    }
+    GDBusProxy *adapter = bluez_proxy(adapter_path, "org.bluez.Adapter1");
+    g_free(adapter_path);
+    if (!adapter) return;
+    gboolean powered = proxy_bool(adapter, "Powered", FALSE);
+    gboolean discovering = proxy_bool(adapter, "Discovering", FALSE);
+    g_object_unref(adapter);
 
-    gboolean powered = FALSE, discovering = FALSE;
-    GVariantIter *iter = NULL;
-    g_variant_get(res, "(a{sv})", &iter);
-    gchar *key = NULL;
-    GVariant *val = NULL;
-    while (g_variant_iter_next(iter, "{sv}", &key, &val)) {
-        if (g_strcmp0(key, "Powered") == 0 && g_variant_is_of_type(val, G_VARIANT_TYPE_BOOLEAN))
-            powered = g_variant_get_boolean(val);
-        else if (g_strcmp0(key, "Discovering") == 0 && g_variant_is_of_type(val, G_VARIANT_TYPE_BOOLEAN))
-            discovering = g_variant_get_boolean(val);
-        g_free(key);
-        g_variant_unref(val);
-    }
-    if (iter) g_variant_iter_free(iter);
-    g_variant_unref(res);
-    g_free(adapter);
- 
     g_message("DBG: refresh_adapter_state Powered=%d Discovering=%d", powered ? 1 : 0, discovering ? 1 : 0);
     s_adapter_powered = powered;
     s_adapter_discovering = discovering;
-    g_idle_add(__gui_bt_update_scan_buttons_idle, NULL);
-}
-
-/* Duplicate Device1 PropertiesChanged handler removed (handled by the primary
-   bluez_device_properties_changed_cb defined earlier). */
-
-/* Adapter1 PropertiesChanged handler: refresh scan/stop buttons */
-static void bluez_adapter_properties_changed_cb(GDBusConnection *c, const gchar *sender, const gchar *object_path,
-                                                const gchar *interface_name, const gchar *signal_name,
-                                                GVariant *parameters, gpointer user_data) {
-    (void)c; (void)sender; (void)object_path; (void)interface_name; (void)signal_name; (void)parameters; (void)user_data;
-    refresh_adapter_state();
+    __gui_bt_update_scan_buttons_idle(NULL);
 }
 
 /* Bind Scan/Stop buttons so gui_bt can toggle sensitivity when Adapter Discovering changes */
@@ -1331,365 +1186,210 @@ int gui_bt_bind_scan_buttons(GtkWidget *scan_btn, GtkWidget *stop_btn) {
     return 0;
 }
 
-/* Query Device1 properties and update the GUI label for the given object_path.
+/* Cached Alias (or Name) of a device, UTF-8 safe; NULL if unknown */
+static char *device_display_name(GDBusProxy *dev) {
+    const char *keys[] = { "Alias", "Name" };
+    for (int i = 0; i < 2; i++) {
+        GVariant *v = g_dbus_proxy_get_cached_property(dev, keys[i]);
+        char *out = NULL;
+        if (v && g_variant_is_of_type(v, G_VARIANT_TYPE_STRING))
+            out = safe_utf8(g_variant_get_string(v, NULL));
+        if (v) g_variant_unref(v);
+        if (out) return out;
+    }
+    return NULL;
+}
+
+/* Update the GUI label for the given object_path from cached Device1 properties.
    Appends state markers [Paired], [Trusted], [Connected]. Preserves a leading
    "★ " prefix (used to tag Known devices populated at startup). */
-/* ---- Asynchronous properties fetch + UI updater to avoid blocking GTK main loop ----
- *
- * We fetch Device1 GetAll via g_dbus_connection_call (async) and then schedule a
- * main-loop idle callback to update the GtkListStore. This prevents bursts of
- * PropertiesChanged signals from freezing or crashing the GUI.
- */
+static void update_device_row_state(const char *object_path) {
+    if (!object_path || !s_store) return;
 
-/* Data passed from async result into the idle updater */
-typedef struct {
-    char *object_path;
-    gboolean paired;
-    gboolean trusted;
-    gboolean connected;
-    char *name_or_alias; /* UTF-8 safe, newly allocated or NULL */
-} DevProps;
-
-/* Idle callback that applies parsed device properties into the device list */
-static gboolean __gui_bt_apply_device_props_idle(gpointer ud) {
-    DevProps *p = ud;
-    if (!p) return G_SOURCE_REMOVE;
-    if (!s_store) {
-        if (p->object_path) g_free(p->object_path);
-        if (p->name_or_alias) g_free(p->name_or_alias);
-        g_free(p);
-        return G_SOURCE_REMOVE;
-    }
-
-    /* Find current row and update label (preserve star prefix) */
+    GDBusProxy *dev = bluez_proxy(object_path, "org.bluez.Device1");
+    if (!dev) return;
+    gboolean paired = proxy_bool(dev, "Paired", FALSE);
+    gboolean trusted = proxy_bool(dev, "Trusted", FALSE);
+    gboolean connected = proxy_bool(dev, "Connected", FALSE);
+    char *name_or_alias = device_display_name(dev);
+    g_object_unref(dev);
+
+    /* Update label in place (preserve star prefix) */
     GtkTreeIter row;
-    gboolean valid = gtk_tree_model_get_iter_first(GTK_TREE_MODEL(s_store), &row);
-    while (valid) {
-        gchar *obj = NULL;
+    if (find_device_row(object_path, &row)) {
         gchar *current = NULL;
-        gtk_tree_model_get(GTK_TREE_MODEL(s_store), &row, 0, &current, 1, &obj, -1);
-        gboolean match = (obj && g_strcmp0(obj, p->object_path) == 0);
-        if (match) {
-            const gchar *prefix = (current && g_str_has_prefix(current, "★ ")) ? "★ " : "";
-            const gchar *raw_base = p->name_or_alias ? p->name_or_alias
-                                  : (current ? (g_str_has_prefix(current, "★ ") ? current + 2 : current)
-                                             : p->object_path);
-            char *base = strip_state_markers(raw_base);
-            GString *label = g_string_new(NULL);
-            g_string_append_printf(label, "%s%s", prefix, base ? base : "");
-            if (p->paired)   g_string_append(label, " [Paired]");
-            if (p->trusted)  g_string_append(label, " [Trusted]");
-            if (p->connected)g_string_append(label, " [Connected]");
-            gtk_list_store_set(s_store, &row, 0, label->str, -1);
-            g_string_free(label, TRUE);
-            if (current) g_free(current);
-            if (obj) g_free(obj);
-            if (base) g_free(base);
-            break;
-        }
+        gtk_tree_model_get(GTK_TREE_MODEL(s_store), &row, 0, &current, -1);
+        const gchar *prefix = (current && g_str_has_prefix(current, "★ ")) ? "★ " : "";
+        const gchar *raw_base = name_or_alias ? name_or_alias
+                              : (current ? (g_str_has_prefix(current, "★ ") ? current + 2 : current)
+                                         : object_path);
+        char *base = strip_state_markers(raw_base);
+        GString *label = g_string_new(NULL);
+        g_string_append_printf(label, "%s%s", prefix, base ? base : "");
+        if (paired)   g_string_append(label, " [Paired]");
+        if (trusted)  g_string_append(label, " [Trusted]");
+        if (connected)g_string_append(label, " [Connected]");
+        set_row_label(&row, label->str);
+        g_string_free(label, TRUE);
         if (current) g_free(current);
-        if (obj) g_free(obj);
-        valid = gtk_tree_model_iter_next(GTK_TREE_MODEL(s_store), &row);
+        if (base) g_free(base);
     }
 
-    if (p->object_path) g_free(p->object_path);
-    if (p->name_or_alias) g_free(p->name_or_alias);
-    g_free(p);
+    if (name_or_alias) g_free(name_or_alias);
+}
+
+/* Frame clock callback: relabel every row that changed since the last frame */
+static gboolean flush_device_rows(GtkWidget *widget, GdkFrameClock *clock, gpointer user_data) {
+    (void)widget; (void)clock; (void)user_data;
+    s_flush_tick_id = 0;
+    if (s_dirty_rows) {
+        GHashTable *dirty = s_dirty_rows;
+        s_dirty_rows = NULL;
+        GHashTableIter it;
+        gpointer key;
+        g_hash_table_iter_init(&it, dirty);
+        while (g_hash_table_iter_next(&it, &key, NULL))
+            update_device_row_state(key);
+        g_hash_table_destroy(dirty);
+    }
     return G_SOURCE_REMOVE;
 }
 
-/* Async result handler: parse properties and schedule UI update on main loop */
-static void get_device_props_done(GObject *source_object, GAsyncResult *res, gpointer user_data) {
-    /* GAsyncReadyCallback signature uses GObject* as first param; convert to GDBusConnection below */
-    char *obj = user_data; /* ownership transferred here */
-    if (!obj) return;
+/* Mark a row stale; bursts of PropertiesChanged collapse into one update per
+   row per frame (the tree view is only redrawn once per frame anyway) */
+static void queue_device_row_update(const char *object_path) {
+    if (!object_path || !s_store || !s_tree) return;
+    if (!s_dirty_rows)
+        s_dirty_rows = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    if (!g_hash_table_contains(s_dirty_rows, object_path))
+        g_hash_table_add(s_dirty_rows, g_strdup(object_path));
+    if (s_flush_tick_id == 0)
+        s_flush_tick_id = gtk_widget_add_tick_callback(GTK_WIDGET(s_tree), flush_device_rows, NULL, NULL);
+}
 
-    if (g_shutting_down) {
-        g_free(obj);
+/* Add a row for a Device1 object (label filled from the cache) */
+static void add_device_row(GDBusObject *object, gboolean known) {
+    const gchar *path = g_dbus_object_get_object_path(object);
+    GtkTreeIter iter;
+    if (find_device_row(path, &iter)) {
+        /* Already listed (e.g. Device1 re-added): keep its label and star */
+        queue_device_row_update(path);
         return;
     }
+    GDBusProxy *dev = bluez_proxy(path, "org.bluez.Device1");
+    if (!dev) return;
 
-    GError *err = NULL;
-    GDBusConnection *conn = G_DBUS_CONNECTION(source_object);
-    GVariant *r = g_dbus_connection_call_finish(conn, res, &err);
-    if (!r) {
-        if (err) {
-            g_debug("get_device_props_done: GetAll failed for %s: %s", obj, err->message);
-            g_error_free(err);
-        }
-        g_free(obj);
-        return;
+    char *display = device_display_name(dev);
+    g_object_unref(dev);
+    if (!display) {
+        const gchar *last = strrchr(path, '/');
+        display = last ? safe_utf8(last + 1) : safe_utf8(path);
     }
-
-    DevProps *p = g_new0(DevProps, 1);
-    p->object_path = obj;
-    p->paired = FALSE;
-    p->trusted = FALSE;
-    p->connected = FALSE;
-    p->name_or_alias = NULL;
-
-    GVariantIter *iter = NULL;
-    g_variant_get(r, "(a{sv})", &iter);
-    gchar *key = NULL;
-    GVariant *val = NULL;
-    while (g_variant_iter_next(iter, "{sv}", &key, &val)) {
-        if (g_strcmp0(key, "Paired") == 0 && g_variant_is_of_type(val, G_VARIANT_TYPE_BOOLEAN))
-            p->paired = g_variant_get_boolean(val);
-        else if (g_strcmp0(key, "Trusted") == 0 && g_variant_is_of_type(val, G_VARIANT_TYPE_BOOLEAN))
-            p->trusted = g_variant_get_boolean(val);
-        else if (g_strcmp0(key, "Connected") == 0 && g_variant_is_of_type(val, G_VARIANT_TYPE_BOOLEAN))
-            p->connected = g_variant_get_boolean(val);
-        else if (!p->name_or_alias && (g_strcmp0(key, "Alias") == 0 || g_strcmp0(key, "Name") == 0) &&
-                 g_variant_is_of_type(val, G_VARIANT_TYPE_STRING)) {
-            p->name_or_alias = safe_utf8(g_variant_get_string(val, NULL));
-        }
-        if (val) g_variant_unref(val);
-        g_free(key);
+    if (known) {
+        /* Tag pre-existing devices as Known with a star prefix */
+        gchar *disp2 = g_strdup_printf("★ %s", display);
+        gui_bt_add_device(disp2, path);
+        g_free(disp2);
+    } else {
+        gui_bt_add_device(display, path);
     }
-    if (iter) g_variant_iter_free(iter);
-    g_variant_unref(r);
-
-    /* Schedule main-loop UI update */
-    g_idle_add(__gui_bt_apply_device_props_idle, p);
+    g_free(display);
+    /* Refresh row label with Paired/Trusted/Connected state */
+    update_device_row_state(path);
 }
 
-/* Asynchronous update starter: initiates GetAll and returns immediately */
-void update_device_row_state(const char *object_path) {
-    if (!object_path || !s_store) return;
-
-    GError *err = NULL;
-    if (!ensure_system_bus(&err)) {
-        if (err) g_error_free(err);
-        return;
-    }
+/* ObjectManager signals are delivered on the main loop (the manager was created
+ * there), so the handlers below update the store directly. */
 
-    /* Duplicate path for ownership transfer into async callback */
-    char *dup = g_strdup(object_path);
-    g_dbus_connection_call(gui_system_bus,
-                           "org.bluez",
-                           dup,
-                           "org.freedesktop.DBus.Properties",
-                           "GetAll",
-                           g_variant_new("(s)", "org.bluez.Device1"),
-                           G_VARIANT_TYPE("(a{sv})"),
-                           G_DBUS_CALL_FLAGS_NONE,
-                           -1, /* timeout: let GLib manage */
-                           NULL,
-                           get_device_props_done,
-                           dup);
+/* A new BlueZ object: add it if it is a device (e.g. found by a scan) */
+static void bluez_object_added(GDBusObjectManager *manager, GDBusObject *object, gpointer user_data) {
+    (void)manager; (void)user_data;
+    add_device_row(object, FALSE);
 }
 
-/* D-Bus InterfacesAdded callback for BlueZ (ObjectManager)
- *
- * Keep this handler extremely conservative to avoid any GVariant parsing bugs on
- * older GLib builds. We do NOT parse Device1 properties here. We only extract the
- * object path and schedule a UI add with a placeholder label derived from the path.
- * The detailed label (Name/Alias + flags) will be filled by update_device_row_state()
- * asynchronously on the main loop.
- */
-static void bluez_interfaces_added_for_gui(GDBusConnection *connection,
-                                          const gchar *sender_name,
-                                          const gchar *object_path,
-                                          const gchar *interface_name,
-                                          const gchar *signal_name,
-                                          GVariant *parameters,
-                                          gpointer user_data)
-{
-    (void)connection; (void)sender_name; (void)object_path; (void)interface_name; (void)user_data; (void)signal_name;
-
-    /* Expect (o a{sa{sv}}); borrow the path pointer from parameters */
-    const gchar *path = NULL;
-    GVariantIter *interfaces = NULL;
-
-    if (!g_variant_is_of_type(parameters, G_VARIANT_TYPE("(oa{sa{sv}})")))
-        return;
-
-    g_variant_get(parameters, "(oa{sa{sv}})", &path, &interfaces);
-    if (interfaces) g_variant_iter_free(interfaces);
-    if (!path) return;
+/* A BlueZ object went away: remove its row (no-op for adapters and others) */
+static void bluez_object_removed(GDBusObjectManager *manager, GDBusObject *object, gpointer user_data) {
+    (void)manager; (void)user_data;
+    gui_bt_remove_device_by_object(g_dbus_object_get_object_path(object));
+    schedule_selection_refresh();
+}
 
-    /* Derive a safe display label from the object path; row will be updated later */
-    const gchar *last = strrchr(path, '/');
-    char *display = last ? safe_utf8(last + 1) : safe_utf8(path);
+/* An interface added to an existing object (Device1 or Adapter1 appearing late) */
+static void bluez_interface_added(GDBusObjectManager *manager, GDBusObject *object,
+                                  GDBusInterface *interface, gpointer user_data) {
+    (void)manager; (void)user_data;
+    const gchar *name = g_dbus_proxy_get_interface_name(G_DBUS_PROXY(interface));
+    if (g_strcmp0(name, "org.bluez.Device1") == 0) add_device_row(object, FALSE);
+    else if (g_strcmp0(name, "org.bluez.Adapter1") == 0) refresh_adapter_state();
+}
 
-    char **pair = g_new0(char*, 3);
-    pair[0] = display;
-    pair[1] = g_strdup(path);
-    g_idle_add(__gui_bt_add_device_idle, pair);
-    /* Do NOT free 'path'; it is borrowed from parameters */
+static void bluez_interface_removed(GDBusObjectManager *manager, GDBusObject *object,
+                                    GDBusInterface *interface, gpointer user_data) {
+    (void)manager; (void)user_data;
+    const gchar *name = g_dbus_proxy_get_interface_name(G_DBUS_PROXY(interface));
+    if (g_strcmp0(name, "org.bluez.Device1") == 0) {
+        gui_bt_remove_device_by_object(g_dbus_object_get_object_path(object));
+        schedule_selection_refresh();
+    }
 }
 
-/* D-Bus InterfacesRemoved callback for BlueZ (ObjectManager) */
-static void bluez_interfaces_removed_for_gui(GDBusConnection *connection,
-                                            const gchar *sender_name,
-                                            const gchar *object_path,
-                                            const gchar *interface_name,
-                                            const gchar *signal_name,
-                                            GVariant *parameters,
-                                            gpointer user_data)
-{
-    (void)connection; (void)sender_name; (void)object_path; (void)interface_name; (void)user_data; (void)signal_name;
-
-    /* Prefer (oas) signature */
-    const gchar *path = NULL;     /* borrowed if coming from "(oas)" */
-    char *owned_path = NULL;      /* duplicated string we can pass to idle handler */
-    GVariantIter *ifaces = NULL;
-
-    if (g_variant_is_of_type(parameters, G_VARIANT_TYPE("(oas)"))) {
-        g_variant_get(parameters, "(oas)", &path, &ifaces);
-        if (path) owned_path = g_strdup(path);
-        if (ifaces) g_variant_iter_free(ifaces);
-    } else if (g_variant_n_children(parameters) > 0) {
-        /* Fallback: support (o@as) and other variant shapes by extracting first child.
-         * Avoid using '(@...)' style GVariant type strings which may be unsupported
-         * on older GLib versions (they can trigger g_variant_type_info_check failures). */
-        GVariant *child = g_variant_get_child_value(parameters, 0);
-        if (child && g_variant_is_of_type(child, G_VARIANT_TYPE_STRING)) {
-            owned_path = g_strdup(g_variant_get_string(child, NULL));
+/* TRUE if a PropertiesChanged touches anything shown in a device row. RSSI,
+ * ManufacturerData etc. change constantly during a scan and are ignored. */
+static gboolean device_label_props_changed(GVariant *changed, const gchar *const *invalidated) {
+    const char *keys[] = { "Paired", "Trusted", "Connected", "Alias", "Name" };
+    for (int i = 0; i < 5; i++) {
+        GVariant *v = g_variant_lookup_value(changed, keys[i], NULL);
+        if (v) {
+            g_variant_unref(v);
+            return TRUE;
         }
-        if (child) g_variant_unref(child);
+        if (invalidated && g_strv_contains(invalidated, keys[i])) return TRUE;
     }
+    return FALSE;
+}
 
-    if (owned_path) {
-        g_idle_add(__gui_bt_remove_device_idle, owned_path);
-        /* owned_path will be freed in __gui_bt_remove_device_idle */
+/* Cached properties changed: Device1 rows and selection gating, Adapter1 Scan/Stop */
+static void bluez_props_changed(GDBusObjectManagerClient *manager, GDBusObjectProxy *object_proxy,
+                                GDBusProxy *interface_proxy, GVariant *changed_properties,
+                                const gchar *const *invalidated_properties, gpointer user_data) {
+    (void)manager; (void)object_proxy; (void)user_data;
+    const gchar *name = g_dbus_proxy_get_interface_name(interface_proxy);
+    if (g_strcmp0(name, "org.bluez.Device1") == 0) {
+        if (!device_label_props_changed(changed_properties, invalidated_properties)) return;
+        queue_device_row_update(g_dbus_proxy_get_object_path(interface_proxy));
+        schedule_selection_refresh();
+    } else if (g_strcmp0(name, "org.bluez.Adapter1") == 0) {
+        refresh_adapter_state();
     }
 }
 
 /* Populate existing BlueZ devices (Device1) into the bound store */
 void gui_bt_populate_existing_devices(void) {
-    if (!s_store) return;
-
-    GError *err = NULL;
-    if (!ensure_system_bus(&err)) {
-        if (err) g_error_free(err);
-        return;
-    }
+    if (!s_store || !bluez_manager) return;
 
-    GVariant *managed = g_dbus_connection_call_sync(gui_system_bus,
-                                                    "org.bluez",
-                                                    "/",
-                                                    "org.freedesktop.DBus.ObjectManager",
-                                                    "GetManagedObjects",
-                                                    NULL,
-                                                    G_VARIANT_TYPE("(a{oa{sa{sv}}})"),
-                                                    G_DBUS_CALL_FLAGS_NONE,
-                                                    -1,
-                                                    NULL,
-                                                    &err);
-    if (!managed) {
-        if (err) {
-            g_warning("GetManagedObjects failed: %s", err->message);
-            g_error_free(err);
-        }
-        return;
-    }
-
-    GVariantIter *outer = NULL;
-    g_variant_get(managed, "(a{oa{sa{sv}}})", &outer);
-    gchar *path = NULL;
-    GVariant *ifaces = NULL;
-
-    while (g_variant_iter_next(outer, "{o@a{sa{sv}}}", &path, &ifaces)) {
-        gchar *iface_name = NULL;
-        GVariant *props = NULL;
-        
-        GVariantIter iiter;
-        g_variant_iter_init(&iiter, ifaces);
-
-        while (g_variant_iter_next(&iiter, "{s@a{sv}}", &iface_name, &props)) {
-            if (g_strcmp0(iface_name, "org.bluez.Device1") == 0) {
-                /* Extract iterator from the a{sv} variant to traverse properties */
-                GVariantIter *piter = NULL;
-                g_variant_get(props, "a{sv}", &piter);
-                gchar *pkey = NULL;
-                GVariant *pval = NULL;
-                char *display = NULL;
-                while (g_variant_iter_next(piter, "{sv}", &pkey, &pval)) {
-                    if (!display && g_strcmp0(pkey, "Name") == 0 && pval && g_variant_is_of_type(pval, G_VARIANT_TYPE_STRING)) {
-                        display = safe_utf8(g_variant_get_string(pval, NULL));
-                    } else if (!display && g_strcmp0(pkey, "Alias") == 0 && pval && g_variant_is_of_type(pval, G_VARIANT_TYPE_STRING)) {
-                        display = safe_utf8(g_variant_get_string(pval, NULL));
-                    }
-                    if (pval) g_variant_unref(pval);
-                    g_free(pkey);
-                }
-                if (piter) g_variant_iter_free(piter);
-                if (!display) {
-                    const gchar *last = strrchr(path, '/');
-                    display = last ? safe_utf8(last + 1) : safe_utf8(path);
-                }
-                /* Tag pre-existing devices as Known with a star prefix */
-                gchar *disp2 = g_strdup_printf("★ %s", display);
-                gui_bt_add_device(disp2, path);
-                g_free(disp2);
-                g_free(display);
-            }
-            if (props) g_variant_unref(props);
-            g_free(iface_name);
-        }
-        if (ifaces) g_variant_unref(ifaces);
-        g_free(path);
+    GList *objects = g_dbus_object_manager_get_objects(bluez_manager);
+    for (GList *l = objects; l; l = l->next) {
+        add_device_row(G_DBUS_OBJECT(l->data), TRUE);
     }
-    g_variant_iter_free(outer);
-    g_variant_unref(managed);
+    g_list_free_full(objects, g_object_unref);
 }
 
 /* Start listening for BlueZ ObjectManager signals to populate GUI list (idempotent) */
 int gui_bt_register_discovery_listeners(void) {
     if (s_listeners_registered) return 0;
-
-    GError *err = NULL;
-    if (!ensure_system_bus(&err)) {
-        if (err) g_error_free(err);
-        return -1;
-    }
-
-    bluez_interfaces_added_sub = g_dbus_connection_signal_subscribe(gui_system_bus,
-        "org.bluez",
-        "org.freedesktop.DBus.ObjectManager",
-        "InterfacesAdded",
-        NULL,
-        NULL,
-        G_DBUS_SIGNAL_FLAGS_NONE,
-        bluez_interfaces_added_for_gui,
-        NULL,
-        NULL);
-
-    bluez_interfaces_removed_sub = g_dbus_connection_signal_subscribe(gui_system_bus,
-        "org.bluez",
-        "org.freedesktop.DBus.ObjectManager",
-        "InterfacesRemoved",
-        NULL,
-        NULL,
-        G_DBUS_SIGNAL_FLAGS_NONE,
-        bluez_interfaces_removed_for_gui,
-        NULL,
-        NULL);
-
-    /* Subscribe to Device1 PropertiesChanged to track Paired/Trusted/Connected */
-    bluez_device_props_changed_sub = g_dbus_connection_signal_subscribe(gui_system_bus,
-        "org.bluez",
-        "org.freedesktop.DBus.Properties",
-        "PropertiesChanged",
-        NULL,
-        "org.bluez.Device1",
-        G_DBUS_SIGNAL_FLAGS_NONE,
-        bluez_device_properties_changed_cb,
-        NULL,
-        NULL);
-
-    /* Subscribe to Adapter1 PropertiesChanged to drive Scan/Stop sensitivity */
-    bluez_adapter_props_changed_sub = g_dbus_connection_signal_subscribe(gui_system_bus,
-        "org.bluez",
-        "org.freedesktop.DBus.Properties",
-        "PropertiesChanged",
-        NULL,
-        "org.bluez.Adapter1",
-        G_DBUS_SIGNAL_FLAGS_NONE,
-        bluez_adapter_properties_changed_cb,
-        NULL,
-        NULL);
+    if (!bluez_manager) return -1;
+
+    bluez_object_added_id = g_signal_connect(bluez_manager, "object-added",
+                                             G_CALLBACK(bluez_object_added), NULL);
+    bluez_object_removed_id = g_signal_connect(bluez_manager, "object-removed",
+                                               G_CALLBACK(bluez_object_removed), NULL);
+    bluez_interface_added_id = g_signal_connect(bluez_manager, "interface-added",
+                                                G_CALLBACK(bluez_interface_added), NULL);
+    bluez_interface_removed_id = g_signal_connect(bluez_manager, "interface-removed",
+                                                  G_CALLBACK(bluez_interface_removed), NULL);
+    /* Track Paired/Trusted/Connected and Adapter Discovering without extra calls */
+    bluez_props_changed_id = g_signal_connect(bluez_manager, "interface-proxy-properties-changed",
+                                              G_CALLBACK(bluez_props_changed), NULL);
 
     s_listeners_registered = TRUE;
     return 0;
@@ -1697,21 +1397,15 @@ int gui_bt_register_discovery_listeners(void) {
 
 /* Unregister listeners */
 int gui_bt_unregister_discovery_listeners(void) {
-    if (bluez_interfaces_added_sub) {
-        g_dbus_connection_signal_unsubscribe(gui_system_bus, bluez_interfaces_added_sub);
-        bluez_interfaces_added_sub = 0;
-    }
-    if (bluez_interfaces_removed_sub) {
-        g_dbus_connection_signal_unsubscribe(gui_system_bus, bluez_interfaces_removed_sub);
-        bluez_interfaces_removed_sub = 0;
-    }
-    if (bluez_device_props_changed_sub) {
-        g_dbus_connection_signal_unsubscribe(gui_system_bus, bluez_device_props_changed_sub);
-        bluez_device_props_changed_sub = 0;
-    }
-    if (bluez_adapter_props_changed_sub) {
-        g_dbus_connection_signal_unsubscribe(gui_system_bus, bluez_adapter_props_changed_sub);
-        bluez_adapter_props_changed_sub = 0;
+    gulong *ids[] = { &bluez_object_added_id, &bluez_object_removed_id, &bluez_interface_added_id,
+                      &bluez_interface_removed_id, &bluez_props_changed_id };
+    for (int i = 0; i < 5; i++) {
+        if (*ids[i] && bluez_manager) g_signal_handler_disconnect(bluez_manager, *ids[i]);
+        *ids[i] = 0;
+    }
+    if (s_selection_refresh_id) {
+        g_source_remove(s_selection_refresh_id);
+        s_selection_refresh_id = 0;
     }
     s_listeners_registered = FALSE;
     return 0;
@@ -0,0 +1,117 @@
+/*
+ * jack_bridge_bench.c
+ * Statistics and JSON output shared by the benchmark tools
+ *
+ * Every tool prints one JSON object per result line on stdout, e.g.
+ *   {"bench":"latency","output":"usb",...,"latency_p50_ms":11.3,...}
+ * and its progress on stderr, so results can be appended to a file and
+ * compared between builds. Plain C (no GLib).
+ */
+
+#include "jack_bridge_bench.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+uint64_t bench_now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted samples */
+static double percentile(const double *sorted, size_t n, double pct) {
+    size_t rank = (size_t)ceil(pct / 100.0 * (double)n);
+
+    if (rank < 1) rank = 1;
+    if (rank > n) rank = n;
+    return sorted[rank - 1];
+}
+
+void bench_stats(double *samples, size_t n, BenchStats *stats) {
+    double sum = 0.0;
+    double var = 0.0;
+
+    memset(stats, 0, sizeof(*stats));
+    if (n == 0) return;
+
+    qsort(samples, n, sizeof(double), compare_doubles);
+    for (size_t i = 0; i < n; i++) sum += samples[i];
+    stats->mean = sum / (double)n;
+    for (size_t i = 0; i < n; i++) var += (samples[i] - stats->mean) * (samples[i] - stats->mean);
+
+    stats->n = n;
+    stats->min = samples[0];
+    stats->max = samples[n - 1];
+    stats->p50 = percentile(samples, n, 50.0);
+    stats->p95 = percentile(samples, n, 95.0);
+    stats->p99 = percentile(samples, n, 99.0);
+    stats->stddev = n > 1 ? sqrt(var / (double)(n - 1)) : 0.0;
+}
+
+static void put_json_string(const char *s) {
+    putchar('"');
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+
+        if (c == '"' || c == '\\') printf("\\%c", c);
+        else if (c < 0x20) printf("\\u%04x", c);
+        else putchar(c);
+    }
+    putchar('"');
+}
+
+void bench_begin(const char *bench) {
+    printf("{\"bench\":");
+    put_json_string(bench);
+}
+
+void bench_string(const char *key, const char *value) {
+    printf(",");
+    put_json_string(key);
+    printf(":");
+    put_json_string(value);
+}
+
+void bench_number(const char *key, double value) {
+    printf(",");
+    put_json_string(key);
+    if (isfinite(value)) printf(":%.6g", value);
+    else printf(":null");
+}
+
+void bench_integer(const char *key, long long value) {
+    printf(",");
+    put_json_string(key);
+    printf(":%lld", value);
+}
+
+void bench_stats_members(const char *prefix, const char *unit, const BenchStats *stats) {
+    static const char *const names[] = { "min", "p50", "p95", "p99", "max", "mean", "stddev" };
+    const double values[] = {
+        stats->min, stats->p50, stats->p95, stats->p99, stats->max, stats->mean, stats->stddev
+    };
+    char key[96];
+
+    snprintf(key, sizeof(key), "%s_samples", prefix);
+    bench_integer(key, (long long)stats->n);
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        snprintf(key, sizeof(key), "%s_%s_%s", prefix, names[i], unit);
+        if (stats->n) bench_number(key, values[i]);
+        else bench_number(key, NAN);
+    }
+}
+
+void bench_end(void) {
+    printf("}\n");
+    fflush(stdout);
+}
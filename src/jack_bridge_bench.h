@@ -0,0 +1,41 @@
+/*
+ * jack_bridge_bench.h
+ * Statistics and JSON output shared by the benchmark tools (make bench)
+ */
+
+#ifndef JACK_BRIDGE_BENCH_H
+#define JACK_BRIDGE_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef struct {
+    size_t n;
+    double min;
+    double p50;
+    double p95;
+    double p99;
+    double max;
+    double mean;
+    double stddev;
+} BenchStats;
+
+/* CLOCK_MONOTONIC in nanoseconds */
+uint64_t bench_now_ns(void);
+
+/* Summarize n samples (sorted in place); all zero if n is 0 */
+void bench_stats(double *samples, size_t n, BenchStats *stats);
+
+/* Results are one JSON object per line on stdout. These print members
+ * with a leading comma, after bench_begin() has printed the first one. */
+void bench_begin(const char *bench);
+void bench_string(const char *key, const char *value);
+void bench_number(const char *key, double value);
+void bench_integer(const char *key, long long value);
+/* "<prefix>_min_<unit>", "_p50_", "_p95_", "_p99_", "_max_", "_mean_"
+ * and "_stddev_", plus "<prefix>_samples" */
+void bench_stats_members(const char *prefix, const char *unit, const BenchStats *stats);
+void bench_end(void);
+
+#endif /* JACK_BRIDGE_BENCH_H */
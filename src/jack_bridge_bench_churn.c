@@ -0,0 +1,264 @@
+/*
+ * jack_bridge_bench_churn.c
+ * Port churn generator for jack-connection-manager (make bench)
+ *
+ * Registers and unregisters hundreds of output ports, the way players and
+ * browsers do, and measures how long the connection manager takes to route
+ * each one (registration to its first connection) and how much CPU time the
+ * manager spends per port event, from /proc/PID/stat.
+ *
+ * Ports are registered in bursts from one client, so the measured latency
+ * includes the manager's per-client batching (ROUTE_BATCH_QUIET_MS and
+ * ROUTE_BATCH_MAX_MS), just as a real client sees it. The manager must be
+ * running and the selected output up.
+ *
+ * Usage: jack-bridge-bench-churn [-n ports] [-b burst] [-i interval_ms] [-r rounds] [-p manager_pid]
+ *        jack-bridge-bench-churn -n 400 -b 2 -i 5
+ */
+
+#include "jack_bridge_bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <stdatomic.h>
+#include <jack/jack.h>
+#include <jack/uuid.h>
+
+#define CLIENT_NAME "jack_bridge_churn"
+#define MANAGER_NAME "jack-connection-manager"
+#define DEFAULT_PORTS 200
+#define DEFAULT_BURST 4
+#define DEFAULT_INTERVAL_MS 10
+#define DEFAULT_ROUNDS 3
+#define MAX_PORTS 1000
+#define MAX_PORT_ID 65536           /* JACK port IDs are small and dense */
+#define ROUTE_TIMEOUT_MS 5000
+#define QUIET_MS 300                /* Between rounds, for the manager to settle */
+
+static jack_client_t *client = NULL;
+static atomic_int server_gone = 0;
+/* First connection time per port ID (written by the notification thread) */
+static _Atomic uint64_t connected_ns[MAX_PORT_ID];
+
+static void port_connect_callback(jack_port_id_t a, jack_port_id_t b, int connect, void *arg) {
+    jack_port_t *port;
+    uint64_t expected = 0;
+
+    (void)b;
+    (void)arg;
+    if (!connect || a >= MAX_PORT_ID) return;
+    port = jack_port_by_id(client, a);
+    if (!port || !jack_port_is_mine(client, port)) return;
+    atomic_compare_exchange_strong(&connected_ns[a], &expected, bench_now_ns());
+}
+
+static void jack_shutdown_callback(void *arg) {
+    (void)arg;
+    atomic_store(&server_gone, 1);
+}
+
+static void sleep_ms(long ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+
+    nanosleep(&ts, NULL);
+}
+
+/* PID of the running connection manager, by its command line, or -1 */
+static long find_manager_pid(void) {
+    DIR *dir = opendir("/proc");
+    struct dirent *de;
+    long pid = -1;
+
+    if (!dir) return -1;
+    while (pid < 0 && (de = readdir(dir)) != NULL) {
+        char path[64];
+        char cmd[256];
+        const char *base;
+        FILE *f;
+        size_t len;
+
+        if (de->d_name[0] < '1' || de->d_name[0] > '9') continue;
+        snprintf(path, sizeof(path), "/proc/%s/cmdline", de->d_name);
+        f = fopen(path, "r");
+        if (!f) continue;
+        len = fread(cmd, 1, sizeof(cmd) - 1, f);
+        fclose(f);
+        cmd[len] = '\0'; /* First argument only */
+        base = strrchr(cmd, '/');
+        base = base ? base + 1 : cmd;
+        if (strcmp(base, MANAGER_NAME) == 0) pid = atol(de->d_name);
+    }
+    closedir(dir);
+    return pid;
+}
+
+/* utime + stime of pid in milliseconds, or -1 */
+static double process_cpu_ms(long pid) {
+    char path[64];
+    char buf[1024];
+    unsigned long long utime, stime;
+    const char *p;
+    FILE *f;
+    size_t len;
+
+    if (pid <= 0) return -1.0;
+    snprintf(path, sizeof(path), "/proc/%ld/stat", pid);
+    f = fopen(path, "r");
+    if (!f) return -1.0;
+    len = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[len] = '\0';
+
+    /* Fields after the command name, which may contain spaces: state is
+     * field 3, utime and stime are fields 14 and 15 */
+    p = strrchr(buf, ')');
+    if (!p || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime, &stime) != 2) {
+        return -1.0;
+    }
+    return 1000.0 * (double)(utime + stime) / (double)sysconf(_SC_CLK_TCK);
+}
+
+/*
+ * run_round()
+ * Register n ports in bursts, wait for all of them to be routed, then
+ * unregister them. Route latencies (ms) are appended to samples.
+ */
+static void run_round(int round, int n, int burst, int interval_ms,
+                      double *samples, size_t *n_samples, double *register_us, int *unrouted) {
+    jack_port_t *ports[MAX_PORTS];
+    jack_port_id_t ids[MAX_PORTS];
+    uint64_t registered[MAX_PORTS];
+    uint64_t deadline;
+    int registered_n = 0;
+    int routed = 0;
+
+    for (int i = 0; i < n && !atomic_load(&server_gone); i++) {
+        char name[32];
+        uint64_t t0;
+
+        snprintf(name, sizeof(name), "churn_%d_%d", round, i);
+        t0 = bench_now_ns();
+        ports[i] = jack_port_register(client, name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
+        registered[i] = bench_now_ns();
+        if (!ports[i]) break;
+        *register_us += (double)(registered[i] - t0) / 1000.0;
+        ids[i] = (jack_port_id_t)jack_uuid_to_index(jack_port_uuid(ports[i]));
+        registered_n++;
+        if ((i + 1) % burst == 0 && interval_ms > 0) sleep_ms(interval_ms);
+    }
+    if (registered_n < n) fprintf(stderr, "jack-bridge-bench-churn: Registered only %d ports\n", registered_n);
+
+    deadline = bench_now_ns() + (uint64_t)ROUTE_TIMEOUT_MS * 1000000ull;
+    while (routed < registered_n && bench_now_ns() < deadline && !atomic_load(&server_gone)) {
+        routed = 0;
+        for (int i = 0; i < registered_n; i++) {
+            if (ids[i] < MAX_PORT_ID && atomic_load(&connected_ns[ids[i]])) routed++;
+        }
+        if (routed < registered_n) sleep_ms(5);
+    }
+
+    for (int i = 0; i < registered_n; i++) {
+        uint64_t t = ids[i] < MAX_PORT_ID ? atomic_load(&connected_ns[ids[i]]) : 0;
+
+        if (t) samples[(*n_samples)++] = (double)(t - registered[i]) / 1e6;
+        else (*unrouted)++;
+        jack_port_unregister(client, ports[i]);
+        if (ids[i] < MAX_PORT_ID) atomic_store(&connected_ns[ids[i]], 0);
+        if ((i + 1) % burst == 0 && interval_ms > 0) sleep_ms(interval_ms);
+    }
+    fprintf(stderr, "jack-bridge-bench-churn: Round %d: %d/%d ports routed\n", round + 1, routed, registered_n);
+}
+
+static void usage(void) {
+    fprintf(stderr, "Usage: jack-bridge-bench-churn [-n ports] [-b burst] [-i interval_ms] [-r rounds] [-p manager_pid]\n"
+                    "  Registers ports bursts at a time, interval_ms apart, and times their routing\n");
+}
+
+int main(int argc, char *argv[]) {
+    int n = DEFAULT_PORTS;
+    int burst = DEFAULT_BURST;
+    int interval_ms = DEFAULT_INTERVAL_MS;
+    int rounds = DEFAULT_ROUNDS;
+    long pid = -1;
+    double *samples;
+    size_t n_samples = 0;
+    double register_us = 0.0;
+    int unrouted = 0;
+    double cpu_before, cpu_after;
+    uint64_t start_ns, wall_ns;
+    long events;
+    jack_status_t status;
+    BenchStats stats;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:b:i:r:p:h")) != -1) {
+        switch (opt) {
+        case 'n': n = atoi(optarg); break;
+        case 'b': burst = atoi(optarg); break;
+        case 'i': interval_ms = atoi(optarg); break;
+        case 'r': rounds = atoi(optarg); break;
+        case 'p': pid = atol(optarg); break;
+        default: usage(); return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (n <= 0 || n > MAX_PORTS || burst <= 0 || interval_ms < 0 || rounds <= 0) {
+        usage();
+        return 1;
+    }
+    if (pid < 0) pid = find_manager_pid();
+    if (pid < 0) fprintf(stderr, "jack-bridge-bench-churn: %s not found, not measuring its CPU time\n", MANAGER_NAME);
+
+    samples = calloc((size_t)n * (size_t)rounds, sizeof(double));
+    if (!samples) return 1;
+
+    client = jack_client_open(CLIENT_NAME, JackNoStartServer, &status);
+    if (!client) {
+        fprintf(stderr, "jack-bridge-bench-churn: JACK is not running\n");
+        free(samples);
+        return 1;
+    }
+    jack_set_port_connect_callback(client, port_connect_callback, NULL);
+    jack_on_shutdown(client, jack_shutdown_callback, NULL);
+    if (jack_activate(client) != 0) {
+        fprintf(stderr, "jack-bridge-bench-churn: Cannot activate client\n");
+        jack_client_close(client);
+        free(samples);
+        return 1;
+    }
+
+    cpu_before = process_cpu_ms(pid);
+    start_ns = bench_now_ns();
+    for (int r = 0; r < rounds && !atomic_load(&server_gone); r++) {
+        run_round(r, n, burst, interval_ms, samples, &n_samples, &register_us, &unrouted);
+        sleep_ms(QUIET_MS);
+    }
+    wall_ns = bench_now_ns() - start_ns;
+    cpu_after = process_cpu_ms(pid);
+    jack_client_close(client);
+
+    /* A registration and an unregistration per port (connection events come on top) */
+    events = 2L * n * rounds;
+    bench_stats(samples, n_samples, &stats);
+    bench_begin("churn");
+    bench_integer("ports", n);
+    bench_integer("burst", burst);
+    bench_integer("interval_ms", interval_ms);
+    bench_integer("rounds", rounds);
+    bench_integer("unrouted", unrouted);
+    bench_number("wall_s", (double)wall_ns / 1e9);
+    bench_number("register_mean_us", (double)register_us / (double)(n * rounds));
+    bench_stats_members("route", "ms", &stats);
+    if (cpu_before >= 0.0 && cpu_after >= 0.0) {
+        bench_integer("manager_pid", pid);
+        bench_number("manager_cpu_ms", cpu_after - cpu_before);
+        bench_number("manager_cpu_us_per_event", 1000.0 * (cpu_after - cpu_before) / (double)events);
+    }
+    bench_end();
+
+    free(samples);
+    return atomic_load(&server_gone) ? 1 : 0;
+}
@@ -0,0 +1,173 @@
+/*
+ * jack_bridge_bench_dbus.c
+ * D-Bus method-call throughput against jack-bridge-dbus (make bench)
+ *
+ * Calls one read-only org.jackaudio.JackControl method many times, first one
+ * call at a time (per-call latency, as qjackctl's status polling sees it),
+ * then with a window of calls in flight (service throughput). Errors are
+ * counted, not fatal, so a degraded service still yields a result line.
+ *
+ * Usage: jack-bridge-bench-dbus [-m method] [-n calls] [-w window] [-s]
+ *        jack-bridge-bench-dbus -m GetLoad -n 5000 -w 32
+ */
+
+#include "jack_bridge_bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <gio/gio.h>
+
+#define DBUS_SERVICE_NAME "org.jackaudio.service"
+#define DBUS_OBJECT_PATH "/org/jackaudio/Controller"
+#define DBUS_INTERFACE "org.jackaudio.JackControl"
+#define DEFAULT_METHOD "IsStarted"
+#define DEFAULT_CALLS 2000
+#define DEFAULT_WINDOW 16
+#define CALL_TIMEOUT_MS 5000
+
+/* Methods without arguments or side effects */
+static const char *const bench_methods[] = {
+    "IsStarted", "GetBufferSize", "GetSampleRate", "GetLoad", "GetXruns", "GetLatency", "GetStartTimings", NULL
+};
+
+typedef struct {
+    GDBusConnection *bus;
+    const char *method;
+    int total;                  /* Calls to make */
+    int issued;
+    int done;
+    int errors;
+    GMainLoop *loop;
+} AsyncRun;
+
+static gboolean known_method(const char *method) {
+    for (int i = 0; bench_methods[i]; i++) {
+        if (strcmp(bench_methods[i], method) == 0) return TRUE;
+    }
+    return FALSE;
+}
+
+static void issue_call(AsyncRun *run);
+
+static void on_call_done(GObject *source, GAsyncResult *res, gpointer user_data) {
+    AsyncRun *run = user_data;
+    GError *error = NULL;
+    GVariant *reply = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), res, &error);
+
+    if (reply) {
+        g_variant_unref(reply);
+    } else {
+        run->errors++;
+        g_error_free(error);
+    }
+    run->done++;
+    if (run->issued < run->total) issue_call(run);
+    else if (run->done == run->total) g_main_loop_quit(run->loop);
+}
+
+static void issue_call(AsyncRun *run) {
+    run->issued++;
+    g_dbus_connection_call(run->bus, DBUS_SERVICE_NAME, DBUS_OBJECT_PATH, DBUS_INTERFACE, run->method,
+                           NULL, NULL, G_DBUS_CALL_FLAGS_NONE, CALL_TIMEOUT_MS, NULL, on_call_done, run);
+}
+
+/* One call at a time: per-call round trips in microseconds */
+static int run_sync(GDBusConnection *bus, const char *method, int calls, double *samples, double *wall_s) {
+    int errors = 0;
+    uint64_t start = bench_now_ns();
+
+    for (int i = 0; i < calls; i++) {
+        uint64_t t0 = bench_now_ns();
+        GError *error = NULL;
+        GVariant *reply = g_dbus_connection_call_sync(bus, DBUS_SERVICE_NAME, DBUS_OBJECT_PATH, DBUS_INTERFACE,
+                                                      method, NULL, NULL, G_DBUS_CALL_FLAGS_NONE,
+                                                      CALL_TIMEOUT_MS, NULL, &error);
+
+        samples[i] = (double)(bench_now_ns() - t0) / 1000.0;
+        if (reply) {
+            g_variant_unref(reply);
+        } else {
+            if (errors == 0) g_printerr("jack-bridge-bench-dbus: %s: %s\n", method, error->message);
+            errors++;
+            g_error_free(error);
+        }
+    }
+    *wall_s = (double)(bench_now_ns() - start) / 1e9;
+    return errors;
+}
+
+static void usage(void) {
+    fprintf(stderr, "Usage: jack-bridge-bench-dbus [-m method] [-n calls] [-w window] [-s]\n"
+                    "  method: IsStarted (default), GetBufferSize, GetSampleRate, GetLoad, GetXruns,\n"
+                    "          GetLatency or GetStartTimings\n"
+                    "  -w: calls in flight for the throughput run; -s: use the session bus\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *method = DEFAULT_METHOD;
+    int calls = DEFAULT_CALLS;
+    int window = DEFAULT_WINDOW;
+    GBusType bus_type = G_BUS_TYPE_SYSTEM;
+    GDBusConnection *bus;
+    GError *error = NULL;
+    AsyncRun run;
+    double *samples;
+    double sync_wall_s, async_wall_s;
+    int sync_errors;
+    uint64_t start;
+    BenchStats stats;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "m:n:w:sh")) != -1) {
+        switch (opt) {
+        case 'm': method = optarg; break;
+        case 'n': calls = atoi(optarg); break;
+        case 'w': window = atoi(optarg); break;
+        case 's': bus_type = G_BUS_TYPE_SESSION; break;
+        default: usage(); return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (!known_method(method) || calls <= 0 || window <= 0) {
+        usage();
+        return 1;
+    }
+
+    bus = g_bus_get_sync(bus_type, NULL, &error);
+    if (!bus) {
+        g_printerr("jack-bridge-bench-dbus: Cannot connect to the bus: %s\n", error->message);
+        g_error_free(error);
+        return 1;
+    }
+    samples = g_new(double, calls);
+
+    sync_errors = run_sync(bus, method, calls, samples, &sync_wall_s);
+
+    memset(&run, 0, sizeof(run));
+    run.bus = bus;
+    run.method = method;
+    run.total = calls;
+    run.loop = g_main_loop_new(NULL, FALSE);
+    start = bench_now_ns();
+    for (int i = 0; i < window && run.issued < run.total; i++) issue_call(&run);
+    g_main_loop_run(run.loop);
+    async_wall_s = (double)(bench_now_ns() - start) / 1e9;
+    g_main_loop_unref(run.loop);
+
+    bench_stats(samples, (size_t)calls, &stats);
+    bench_begin("dbus");
+    bench_string("method", method);
+    bench_string("bus", bus_type == G_BUS_TYPE_SYSTEM ? "system" : "session");
+    bench_integer("calls", calls);
+    bench_integer("sync_errors", sync_errors);
+    bench_number("sync_calls_per_s", (double)calls / sync_wall_s);
+    bench_stats_members("sync_call", "us", &stats);
+    bench_integer("async_window", window);
+    bench_integer("async_errors", run.errors);
+    bench_number("async_calls_per_s", (double)calls / async_wall_s);
+    bench_end();
+
+    g_free(samples);
+    g_object_unref(bus);
+    return sync_errors == calls ? 1 : 0;
+}
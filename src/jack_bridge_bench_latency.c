@@ -0,0 +1,282 @@
+/*
+ * jack_bridge_bench_latency.c
+ * Loopback round-trip latency per output (make bench)
+ *
+ * Plays a short click into an output's playback_1 port and times it coming
+ * back on a capture port, so the output has to be looped back to the capture
+ * port: a cable for wired outputs, speaker and microphone for Bluetooth.
+ * The result is what a user hears: the JACK graph, the bridge (ring buffer,
+ * resampler, ALSA or BlueALSA) and the device, in both directions.
+ *
+ * Both ends are timed in the process callback in JACK frames. Each run
+ * measures one click; the capture noise floor is measured first so the
+ * detection threshold sits well above it. The client name is in the
+ * connection manager's default IGNORE_PORTS, so nothing re-routes the
+ * click while it is measured.
+ *
+ * Usage: jack-bridge-bench-latency [-c capture_port] [-n runs] [-t threshold] [OUTPUT ...]
+ *        jack-bridge-bench-latency -c system:capture_1 internal usb
+ */
+
+#include "jack_bridge_bench.h"
+#include "jack_bridge_route.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <jack/jack.h>
+
+#define CLIENT_NAME "jack_bridge_latency"
+#define DEFAULT_CAPTURE "system:capture_1"
+#define DEFAULT_RUNS 20
+#define DEFAULT_THRESHOLD 0.02f     /* Lower bound, raised above the noise floor */
+#define CLICK_LEVEL 0.9f
+#define CLICK_FRAMES 4              /* +, +, -, -: survives AC-coupled paths */
+#define SETTLE_MS 300               /* After (re)connecting, before measuring */
+#define NOISE_MS 300
+#define RUN_TIMEOUT_MS 2000
+#define MAX_RUNS 1000
+
+enum {
+    STATE_IDLE,
+    STATE_NOISE,                    /* Track the capture noise floor */
+    STATE_ARMED,                    /* Main thread: send a click next cycle */
+    STATE_SENT,                     /* JACK thread: click out, looking for it */
+    STATE_DONE                      /* JACK thread: click found */
+};
+
+static jack_client_t *client = NULL;
+static jack_port_t *out_port = NULL;
+static jack_port_t *in_port = NULL;
+static atomic_int state = STATE_IDLE;
+static atomic_int server_gone = 0;
+static _Atomic float noise_peak;
+static _Atomic float threshold;
+static jack_nframes_t sent_frame;   /* Published by STATE_SENT */
+static jack_nframes_t found_frame;  /* Published by STATE_DONE */
+
+static int process_callback(jack_nframes_t nframes, void *arg) {
+    float *out = jack_port_get_buffer(out_port, nframes);
+    const float *in = jack_port_get_buffer(in_port, nframes);
+    int s = atomic_load_explicit(&state, memory_order_acquire);
+
+    (void)arg;
+    memset(out, 0, nframes * sizeof(float));
+
+    if (s == STATE_NOISE) {
+        float peak = atomic_load_explicit(&noise_peak, memory_order_relaxed);
+
+        for (jack_nframes_t i = 0; i < nframes; i++) {
+            if (fabsf(in[i]) > peak) peak = fabsf(in[i]);
+        }
+        atomic_store_explicit(&noise_peak, peak, memory_order_relaxed);
+    } else if (s == STATE_ARMED && nframes >= CLICK_FRAMES) {
+        for (int i = 0; i < CLICK_FRAMES; i++) out[i] = i < CLICK_FRAMES / 2 ? CLICK_LEVEL : -CLICK_LEVEL;
+        sent_frame = jack_last_frame_time(client);
+        atomic_store_explicit(&state, STATE_SENT, memory_order_release);
+    } else if (s == STATE_SENT) {
+        float level = atomic_load_explicit(&threshold, memory_order_relaxed);
+
+        for (jack_nframes_t i = 0; i < nframes; i++) {
+            if (fabsf(in[i]) > level) {
+                found_frame = jack_last_frame_time(client) + i;
+                atomic_store_explicit(&state, STATE_DONE, memory_order_release);
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+static void jack_shutdown_callback(void *arg) {
+    (void)arg;
+    atomic_store(&server_gone, 1);
+}
+
+static void sleep_ms(long ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+
+    nanosleep(&ts, NULL);
+}
+
+/* Wait for the JACK thread to reach want. Returns 0, or -1 on timeout. */
+static int wait_state(int want, long timeout_ms) {
+    for (long waited = 0; waited < timeout_ms; waited++) {
+        if (atomic_load_explicit(&state, memory_order_acquire) == want) return 0;
+        if (atomic_load(&server_gone)) return -1;
+        sleep_ms(1);
+    }
+    return -1;
+}
+
+/* Latency JACK reports for the path, for comparison with the measurement */
+static jack_nframes_t reported_latency(const char *sink, const char *capture) {
+    jack_port_t *p = jack_port_by_name(client, sink);
+    jack_port_t *c = jack_port_by_name(client, capture);
+    jack_latency_range_t play = { 0, 0 }, rec = { 0, 0 };
+
+    if (p) jack_port_get_latency_range(p, JackPlaybackLatency, &play);
+    if (c) jack_port_get_latency_range(c, JackCaptureLatency, &rec);
+    return play.max + rec.max;
+}
+
+static void report_error(const char *output, const char *sink, const char *message) {
+    bench_begin("latency");
+    bench_string("output", output);
+    bench_string("sink", sink);
+    bench_string("error", message);
+    bench_end();
+}
+
+/*
+ * measure_output()
+ * Route the click to one output, measure the noise floor, then time runs
+ * clicks. Prints one result line.
+ */
+static void measure_output(const RouteTarget *target, const char *capture, int runs, float min_threshold) {
+    char sink[128];
+    double samples[MAX_RUNS];
+    size_t n = 0;
+    int timeouts = 0;
+    jack_nframes_t rate = jack_get_sample_rate(client);
+    float level;
+    BenchStats stats;
+
+    snprintf(sink, sizeof(sink), "%s1", target->sink_prefix);
+    if (!jack_port_by_name(client, sink)) {
+        report_error(target->name, sink, "sink ports not registered");
+        return;
+    }
+
+    jack_port_disconnect(client, out_port);
+    if (jack_connect(client, jack_port_name(out_port), sink) != 0) {
+        report_error(target->name, sink, "cannot connect to the sink");
+        return;
+    }
+    sleep_ms(SETTLE_MS);
+
+    atomic_store(&noise_peak, 0.0f);
+    atomic_store(&state, STATE_NOISE);
+    sleep_ms(NOISE_MS);
+    atomic_store(&state, STATE_IDLE);
+    sleep_ms(50); /* Let the last noise cycle finish */
+
+    level = 4.0f * atomic_load(&noise_peak);
+    if (level < min_threshold) level = min_threshold;
+    if (level >= CLICK_LEVEL / 2) {
+        report_error(target->name, sink, "capture too noisy");
+        return;
+    }
+    atomic_store(&threshold, level);
+    fprintf(stderr, "jack-bridge-bench-latency: %s: noise %.4f, threshold %.4f\n",
+            target->name, atomic_load(&noise_peak), level);
+
+    for (int r = 0; r < runs && !atomic_load(&server_gone); r++) {
+        int expected = STATE_SENT;
+
+        atomic_store_explicit(&state, STATE_ARMED, memory_order_release);
+        if (wait_state(STATE_DONE, RUN_TIMEOUT_MS) == 0) {
+            samples[n++] = 1000.0 * (double)(found_frame - sent_frame) / (double)rate;
+        } else {
+            /* The JACK thread may be between states: make sure it stops looking */
+            if (!atomic_compare_exchange_strong(&state, &expected, STATE_IDLE)) {
+                expected = STATE_ARMED;
+                atomic_compare_exchange_strong(&state, &expected, STATE_IDLE);
+            }
+            timeouts++;
+        }
+        atomic_store(&state, STATE_IDLE);
+        sleep_ms(100 + rand() % 100); /* Let the echo die down, decorrelate from the period */
+    }
+    jack_port_disconnect(client, out_port);
+
+    bench_stats(samples, n, &stats);
+    bench_begin("latency");
+    bench_string("output", target->name);
+    bench_string("sink", sink);
+    bench_string("capture", capture);
+    bench_integer("rate", rate);
+    bench_integer("period", jack_get_buffer_size(client));
+    bench_integer("runs", runs);
+    bench_integer("timeouts", timeouts);
+    bench_number("threshold", level);
+    bench_number("reported_ms", 1000.0 * (double)reported_latency(sink, capture) / (double)rate);
+    bench_stats_members("latency", "ms", &stats);
+    bench_end();
+}
+
+static void usage(void) {
+    fprintf(stderr, "Usage: jack-bridge-bench-latency [-c capture_port] [-n runs] [-t threshold] [OUTPUT ...]\n"
+                    "  OUTPUT is internal, usb, hdmi or bluetooth (default: every output that is up)\n"
+                    "  and must be looped back to capture_port (default " DEFAULT_CAPTURE ")\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *capture = DEFAULT_CAPTURE;
+    int runs = DEFAULT_RUNS;
+    float min_threshold = DEFAULT_THRESHOLD;
+    jack_status_t status;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:n:t:h")) != -1) {
+        switch (opt) {
+        case 'c': capture = optarg; break;
+        case 'n': runs = atoi(optarg); break;
+        case 't': min_threshold = (float)atof(optarg); break;
+        default: usage(); return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (runs <= 0 || runs > MAX_RUNS || min_threshold <= 0.0f) {
+        usage();
+        return 1;
+    }
+    for (int i = optind; i < argc; i++) {
+        if (!route_find_target(argv[i])) {
+            fprintf(stderr, "jack-bridge-bench-latency: Unknown output '%s'\n", argv[i]);
+            return 1;
+        }
+    }
+
+    client = jack_client_open(CLIENT_NAME, JackNoStartServer, &status);
+    if (!client) {
+        fprintf(stderr, "jack-bridge-bench-latency: JACK is not running\n");
+        return 1;
+    }
+    out_port = jack_port_register(client, "click", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
+    in_port = jack_port_register(client, "loop", JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0);
+    if (!out_port || !in_port) {
+        fprintf(stderr, "jack-bridge-bench-latency: Cannot register ports\n");
+        jack_client_close(client);
+        return 1;
+    }
+    jack_set_process_callback(client, process_callback, NULL);
+    jack_on_shutdown(client, jack_shutdown_callback, NULL);
+    if (jack_activate(client) != 0) {
+        fprintf(stderr, "jack-bridge-bench-latency: Cannot activate client\n");
+        jack_client_close(client);
+        return 1;
+    }
+    if (jack_connect(client, capture, jack_port_name(in_port)) != 0) {
+        fprintf(stderr, "jack-bridge-bench-latency: Cannot connect %s\n", capture);
+        jack_client_close(client);
+        return 1;
+    }
+
+    srand((unsigned int)bench_now_ns());
+    if (optind < argc) {
+        for (int i = optind; i < argc && !atomic_load(&server_gone); i++) {
+            measure_output(route_find_target(argv[i]), capture, runs, min_threshold);
+        }
+    } else {
+        for (int i = 0; i < route_n_targets && !atomic_load(&server_gone); i++) {
+            measure_output(&route_targets[i], capture, runs, min_threshold);
+        }
+    }
+
+    jack_client_close(client);
+    return atomic_load(&server_gone) ? 1 : 0;
+}
@@ -21,19 +21,22 @@
 #include "jack_bridge_dbus_config.h"
 #include "jack_bridge_settings_sync.h"
 #include "jack_bridge_dbus.h"
+#include "jack_bridge_dbus_client.h"
+#include "jack_bridge_dbus_live.h"
+#include "jack_bridge_dbus_autotune.h"
+#include "jack_bridge_dbus_route.h"
+#include "jack_bridge_dbus_start.h"
+#include "jack_bridge_dbus_graph.h"
+#include "jack_bridge_trace.h"
 
 /* Service configuration */
 #define DBUS_SERVICE_NAME "org.jackaudio.service"
 #define DBUS_OBJECT_PATH "/org/jackaudio/Controller"
-#define JACKD_RT_PIDFILE "/var/run/jackd-rt.pid"
-#define JACKD_RT_SERVICE "jackd-rt"
 
 /* Global state */
 static GMainLoop *main_loop = NULL;
 static GDBusConnection *bus_connection = NULL;
 static guint service_name_id = 0;
-static guint monitor_timeout_id = 0;
-static gboolean last_known_state = FALSE;
 GMutex config_access_mutex;
 
 /* Forward declarations */
@@ -44,7 +47,7 @@ static void emit_server_stopped(void);
  * check_jack_running()
  * Check if jackd-rt service is running by examining pidfile
  */
-static gboolean check_jack_running(void) {
+gboolean check_jack_running(void) {
     FILE *f;
     pid_t pid;
     
@@ -68,25 +71,21 @@ static gboolean check_jack_running(void) {
 }
 
 /*
- * monitor_jackd_state()
- * Periodic callback to monitor JACK state and emit signals
- * Runs every second (low overhead)
+ * on_jack_state_changed()
+ * Server state transition reported by the persistent JACK client
  */
-static gboolean monitor_jackd_state(gpointer user_data) {
+static void on_jack_state_changed(gboolean running, gpointer user_data) {
     (void)user_data;
-    gboolean is_running = check_jack_running();
     
-    /* Emit signals on state transitions */
-    if (is_running && !last_known_state) {
+    start_pipeline_server_state(running);
+    
+    if (running) {
         g_print("jack-bridge-dbus: JACK started (emitting ServerStarted)\n");
         emit_server_started();
-    } else if (!is_running && last_known_state) {
+    } else {
         g_print("jack-bridge-dbus: JACK stopped (emitting ServerStopped)\n");
         emit_server_stopped();
     }
-    
-    last_known_state = is_running;
-    return G_SOURCE_CONTINUE; /* Keep polling */
 }
 
 /*
@@ -101,80 +100,11 @@ static void handle_is_started(GDBusConnection *connection,
     (void)sender;
     (void)parameters;
     
-    gboolean running = check_jack_running();
-    g_print("jack-bridge-dbus: IsStarted() → %s\n", running ? "true" : "false");
+    gboolean running = bridge_client_is_running();
     g_dbus_method_invocation_return_value(invocation, 
                                           g_variant_new("(b)", running));
 }
 
-/*
- * handle_start_server()
- * D-Bus method: StartServer() → void
- * Calls: service jackd-rt start
- */
-static void handle_start_server(GDBusConnection *connection,
-                                 const gchar *sender,
-                                 GVariant *parameters,
-                                 GDBusMethodInvocation *invocation) {
-    (void)connection;
-    (void)sender;
-    (void)parameters;
-    
-    gint exit_status;
-    GError *error = NULL;
-    
-    g_print("jack-bridge-dbus: StartServer() called\n");
-    
-    /* Check if already running */
-    if (check_jack_running()) {
-        g_print("jack-bridge-dbus: JACK already running\n");
-        g_dbus_method_invocation_return_value(invocation, NULL);
-        return;
-    }
-    
-    /* Execute: service jackd-rt start */
-    if (!g_spawn_command_line_sync("service jackd-rt start",
-                                   NULL, NULL, &exit_status, &error)) {
-        g_printerr("jack-bridge-dbus: Failed to start jackd-rt: %s\n",
-                   error->message);
-        g_dbus_method_invocation_return_error(invocation,
-                                              G_DBUS_ERROR,
-                                              G_DBUS_ERROR_FAILED,
-                                              "Failed to start JACK: %s",
-                                              error->message);
-        g_error_free(error);
-        return;
-    }
-    
-    /* Give JACK a brief moment to initialize before restarting dependent services */
-    g_usleep(1500000); /* 1.5 second delay - much shorter than previous 8s attempt */
-    
-    /* Restart jack-bridge-ports first to spawn USB/HDMI ports */
-    g_spawn_command_line_async("service jack-bridge-ports restart", NULL);
-    g_print("jack-bridge-dbus: Restarted jack-bridge-ports for USB/HDMI ports\n");
-    
-    /* Small delay between service restarts to avoid resource contention */
-    g_usleep(500000); /* 0.5 second delay */
-    
-    /* Restart jack-connection-manager to ensure audio routing is restored */
-    g_spawn_command_line_async("service jack-connection-manager restart", NULL);
-    g_print("jack-bridge-dbus: Restarted jack-connection-manager for proper audio routing\n");
-    
-    if (exit_status != 0) {
-        g_printerr("jack-bridge-dbus: service jackd-rt start exited with %d\n",
-                   exit_status);
-        g_dbus_method_invocation_return_error(invocation,
-                                              G_DBUS_ERROR,
-                                              G_DBUS_ERROR_FAILED,
-                                              "JACK service start failed (exit %d)",
-                                              exit_status);
-        return;
-    }
-    
-    g_print("jack-bridge-dbus: JACK service started successfully\n");
-    g_dbus_method_invocation_return_value(invocation, NULL);
-}
-
 /*
  * handle_stop_server()
  * D-Bus method: StopServer() → void
@@ -235,7 +165,9 @@ static void handle_stop_server(GDBusConnection *connection,
 /*
  * handle_switch_master()
  * D-Bus method: SwitchMaster() → void
- * No-op for init service (qjackctl compatibility)
+ * Graph-preserving restart with the current settings. Named after jackdbus,
+ * but jackd-rt cannot switch its driver in place: clients are disconnected
+ * and the call takes as long as a restart.
  */
 static void handle_switch_master(GDBusConnection *connection,
                                   const gchar *sender,
@@ -245,10 +177,232 @@ static void handle_switch_master(GDBusConnection *connection,
     (void)sender;
     (void)parameters;
     
-    g_print("jack-bridge-dbus: SwitchMaster() called (no-op for init service)\n");
+    g_print("jack-bridge-dbus: SwitchMaster() called\n");
+    start_pipeline_graph_restart(invocation);
+}
+
+/*
+ * handle_get_buffer_size()
+ * D-Bus method: GetBufferSize() → uint32
+ * Live value from the running server
+ */
+static void handle_get_buffer_size(GDBusConnection *connection,
+                                    const gchar *sender,
+                                    GVariant *parameters,
+                                    GDBusMethodInvocation *invocation) {
+    (void)connection;
+    (void)sender;
+    (void)parameters;
+    
+    guint32 frames;
+    
+    if (!bridge_client_get_buffer_size(&frames)) {
+        g_dbus_method_invocation_return_error(invocation,
+                                              G_DBUS_ERROR,
+                                              G_DBUS_ERROR_FAILED,
+                                              "JACK is not running");
+        return;
+    }
+    
+    g_dbus_method_invocation_return_value(invocation, g_variant_new("(u)", frames));
+}
+
+/*
+ * handle_set_buffer_size()
+ * D-Bus method: SetBufferSize(uint32) → void
+ * Live change through the persistent client (same path as driver.period)
+ */
+static void handle_set_buffer_size(GDBusConnection *connection,
+                                    const gchar *sender,
+                                    GVariant *parameters,
+                                    GDBusMethodInvocation *invocation) {
+    (void)connection;
+    (void)sender;
+    
+    guint32 frames;
+    gint result;
+    
+    g_variant_get(parameters, "(u)", &frames);
+    
+    /* Same validation as SetParameterValue(driver.period) */
+    if (!validate_period(frames)) {
+        g_dbus_method_invocation_return_error(invocation,
+                                              G_DBUS_ERROR,
+                                              G_DBUS_ERROR_INVALID_ARGS,
+                                              "Invalid buffer size: %u", frames);
+        return;
+    }
+    
+    g_mutex_lock(&config_access_mutex);
+    result = try_live_buffer_size_change(frames);
+    g_mutex_unlock(&config_access_mutex);
+    
+    if (result == 1) {
+        g_dbus_method_invocation_return_error(invocation,
+                                              G_DBUS_ERROR,
+                                              G_DBUS_ERROR_FAILED,
+                                              "%s", get_restart_message("JACKD_PERIOD"));
+        return;
+    }
+    if (result < 0) {
+        g_dbus_method_invocation_return_error(invocation,
+                                              G_DBUS_ERROR,
+                                              G_DBUS_ERROR_FAILED,
+                                              "Failed to write configuration");
+        return;
+    }
+    
+    g_dbus_method_invocation_return_value(invocation, NULL);
+}
+
+/*
+ * handle_get_sample_rate()
+ * D-Bus method: GetSampleRate() → double
+ */
+static void handle_get_sample_rate(GDBusConnection *connection,
+                                    const gchar *sender,
+                                    GVariant *parameters,
+                                    GDBusMethodInvocation *invocation) {
+    (void)connection;
+    (void)sender;
+    (void)parameters;
+    
+    guint32 rate;
+    
+    if (!bridge_client_get_sample_rate(&rate)) {
+        g_dbus_method_invocation_return_error(invocation,
+                                              G_DBUS_ERROR,
+                                              G_DBUS_ERROR_FAILED,
+                                              "JACK is not running");
+        return;
+    }
+    
+    g_dbus_method_invocation_return_value(invocation, g_variant_new("(d)", (gdouble)rate));
+}
+
+/*
+ * handle_get_load()
+ * D-Bus method: GetLoad() → double (DSP load, percent)
+ */
+static void handle_get_load(GDBusConnection *connection,
+                             const gchar *sender,
+                             GVariant *parameters,
+                             GDBusMethodInvocation *invocation) {
+    (void)connection;
+    (void)sender;
+    (void)parameters;
+    
+    gdouble load;
+    
+    if (!bridge_client_get_load(&load)) {
+        g_dbus_method_invocation_return_error(invocation,
+                                              G_DBUS_ERROR,
+                                              G_DBUS_ERROR_FAILED,
+                                              "JACK is not running");
+        return;
+    }
+    
+    g_dbus_method_invocation_return_value(invocation, g_variant_new("(d)", load));
+}
+
+/*
+ * handle_get_xruns()
+ * D-Bus method: GetXruns() → uint32 (since this service connected or ResetXruns)
+ */
+static void handle_get_xruns(GDBusConnection *connection,
+                              const gchar *sender,
+                              GVariant *parameters,
+                              GDBusMethodInvocation *invocation) {
+    (void)connection;
+    (void)sender;
+    (void)parameters;
+    
+    guint32 count;
+    
+    if (!bridge_client_get_xruns(&count)) {
+        g_dbus_method_invocation_return_error(invocation,
+                                              G_DBUS_ERROR,
+                                              G_DBUS_ERROR_FAILED,
+                                              "JACK is not running");
+        return;
+    }
+    
+    g_dbus_method_invocation_return_value(invocation, g_variant_new("(u)", count));
+}
+
+/*
+ * handle_reset_xruns()
+ * D-Bus method: ResetXruns() → void
+ */
+static void handle_reset_xruns(GDBusConnection *connection,
+                                const gchar *sender,
+                                GVariant *parameters,
+                                GDBusMethodInvocation *invocation) {
+    (void)connection;
+    (void)sender;
+    (void)parameters;
+    
+    bridge_client_reset_xruns();
     g_dbus_method_invocation_return_value(invocation, NULL);
 }
 
+/*
+ * handle_get_latency()
+ * D-Bus method: GetLatency() → double (ms)
+ * Live period and rate; nperiods comes from config (not queryable from a client)
+ */
+static void handle_get_latency(GDBusConnection *connection,
+                                const gchar *sender,
+                                GVariant *parameters,
+                                GDBusMethodInvocation *invocation) {
+    (void)connection;
+    (void)sender;
+    (void)parameters;
+    
+    guint32 frames, rate;
+    gint nperiods;
+    
+    if (!bridge_client_get_buffer_size(&frames) || !bridge_client_get_sample_rate(&rate)) {
+        g_dbus_method_invocation_return_error(invocation,
+                                              G_DBUS_ERROR,
+                                              G_DBUS_ERROR_FAILED,
+                                              "JACK is not running");
+        return;
+    }
+    
+    nperiods = get_config_int("JACKD_NPERIODS", 3);
+    if (nperiods < 2) nperiods = 2;
+    
+    g_dbus_method_invocation_return_value(invocation,
+        g_variant_new("(d)", calculate_latency_ms(frames, (guint)nperiods, rate)));
+}
+
+/*
+ * on_xruns()
+ * Rate-limited xrun notification from the persistent client
+ */
+static void on_xruns(guint32 total, guint32 new_xruns, gpointer user_data) {
+    (void)user_data;
+    
+    GError *error = NULL;
+    
+    g_print("jack-bridge-dbus: %u xrun(s) (total %u)\n", new_xruns, total);
+    
+    if (!bus_connection) return;
+    
+    if (!g_dbus_connection_emit_signal(bus_connection,
+                                       NULL, /* destination */
+                                       DBUS_OBJECT_PATH,
+                                       "org.jackaudio.JackControl",
+                                       "XrunOccurred",
+                                       g_variant_new("(uu)", total, new_xruns),
+                                       &error)) {
+        g_printerr("jack-bridge-dbus: Failed to emit XrunOccurred: %s\n",
+                   error->message);
+        g_error_free(error);
+    }
+}
+
 /*
  * emit_server_started()
  * Emit ServerStarted signal
@@ -308,18 +462,42 @@ static void handle_method_call(GDBusConnection *connection,
     (void)object_path;
     (void)user_data;
     
-    g_print("jack-bridge-dbus: Method call: %s.%s from %s\n",
-            interface_name, method_name, sender);
+    /* Every call goes to the trace ring; stderr only gets the ones that change state */
+    TRACE(TRACE_EVENT, TRACE_EV_DBUS_CALL, 0, method_name);
     
     if (g_strcmp0(interface_name, "org.jackaudio.JackControl") == 0) {
         if (g_strcmp0(method_name, "IsStarted") == 0) {
             handle_is_started(connection, sender, parameters, invocation);
         } else if (g_strcmp0(method_name, "StartServer") == 0) {
             handle_start_server(connection, sender, parameters, invocation);
+        } else if (g_strcmp0(method_name, "GetStartTimings") == 0) {
+            handle_get_start_timings(connection, sender, parameters, invocation);
         } else if (g_strcmp0(method_name, "StopServer") == 0) {
             handle_stop_server(connection, sender, parameters, invocation);
         } else if (g_strcmp0(method_name, "SwitchMaster") == 0) {
             handle_switch_master(connection, sender, parameters, invocation);
+        } else if (g_strcmp0(method_name, "GetBufferSize") == 0) {
+            handle_get_buffer_size(connection, sender, parameters, invocation);
+        } else if (g_strcmp0(method_name, "SetBufferSize") == 0) {
+            handle_set_buffer_size(connection, sender, parameters, invocation);
+        } else if (g_strcmp0(method_name, "GetSampleRate") == 0) {
+            handle_get_sample_rate(connection, sender, parameters, invocation);
+        } else if (g_strcmp0(method_name, "GetLoad") == 0) {
+            handle_get_load(connection, sender, parameters, invocation);
+        } else if (g_strcmp0(method_name, "GetXruns") == 0) {
+            handle_get_xruns(connection, sender, parameters, invocation);
+        } else if (g_strcmp0(method_name, "ResetXruns") == 0) {
+            handle_reset_xruns(connection, sender, parameters, invocation);
+        } else if (g_strcmp0(method_name, "GetLatency") == 0) {
+            handle_get_latency(connection, sender, parameters, invocation);
+        } else if (g_strcmp0(method_name, "AutoTune") == 0) {
+            handle_auto_tune(connection, sender, parameters, invocation);
+        } else if (g_strcmp0(method_name, "SelectOutput") == 0) {
+            handle_select_output(connection, sender, parameters, invocation);
+        } else if (g_strcmp0(method_name, "SaveGraph") == 0) {
+            handle_save_graph(connection, sender, parameters, invocation);
+        } else if (g_strcmp0(method_name, "RestoreGraph") == 0) {
+            handle_restore_graph(connection, sender, parameters, invocation);
         } else {
             g_dbus_method_invocation_return_error(invocation,
                                                   G_DBUS_ERROR,
@@ -332,6 +510,8 @@ static void handle_method_call(GDBusConnection *connection,
             handle_get_parameter_value(connection, sender, parameters, invocation);
         } else if (g_strcmp0(method_name, "SetParameterValue") == 0) {
             handle_set_parameter_value(connection, sender, parameters, invocation);
+        } else if (g_strcmp0(method_name, "SetParameterValues") == 0) {
+            handle_set_parameter_values(connection, sender, parameters, invocation);
         } else if (g_strcmp0(method_name, "ResetParameterValue") == 0) {
             handle_reset_parameter_value(connection, sender, parameters, invocation);
         } else if (g_strcmp0(method_name, "GetParameterConstraint") == 0) {
@@ -360,10 +540,60 @@ static const gchar introspection_xml[] =
     "      <arg type='b' name='started' direction='out'/>"
     "    </method>"
     "    <method name='StartServer'/>"
+    "    <method name='GetStartTimings'>"
+    "      <arg type='a{sd}' name='stage_ms' direction='out'/>"
+    "    </method>"
     "    <method name='StopServer'/>"
     "    <method name='SwitchMaster'/>"
+    "    <method name='GetBufferSize'>"
+    "      <arg type='u' name='buffer_size_frames' direction='out'/>"
+    "    </method>"
+    "    <method name='SetBufferSize'>"
+    "      <arg type='u' name='buffer_size_frames' direction='in'/>"
+    "    </method>"
+    "    <method name='GetSampleRate'>"
+    "      <arg type='d' name='sample_rate' direction='out'/>"
+    "    </method>"
+    "    <method name='GetLoad'>"
+    "      <arg type='d' name='load' direction='out'/>"
+    "    </method>"
+    "    <method name='GetXruns'>"
+    "      <arg type='u' name='xruns_count' direction='out'/>"
+    "    </method>"
+    "    <method name='ResetXruns'/>"
+    "    <method name='GetLatency'>"
+    "      <arg type='d' name='latency_ms' direction='out'/>"
+    "    </method>"
+    "    <method name='AutoTune'>"
+    "      <arg type='u' name='min_period' direction='in'/>"
+    "      <arg type='u' name='soak_seconds' direction='in'/>"
+    "      <arg type='u' name='synthetic_load' direction='in'/>"
+    "      <arg type='d' name='max_load' direction='in'/>"
+    "      <arg type='u' name='period' direction='out'/>"
+    "      <arg type='d' name='latency_ms' direction='out'/>"
+    "    </method>"
+    "    <method name='SelectOutput'>"
+    "      <arg type='s' name='target' direction='in'/>"
+    "      <arg type='s' name='bt_device' direction='in'/>"
+    "    </method>"
+    "    <method name='SaveGraph'>"
+    "      <arg type='s' name='name' direction='in'/>"
+    "      <arg type='u' name='connections' direction='out'/>"
+    "    </method>"
+    "    <method name='RestoreGraph'>"
+    "      <arg type='s' name='name' direction='in'/>"
+    "      <arg type='u' name='connected' direction='out'/>"
+    "      <arg type='u' name='disconnected' direction='out'/>"
+    "      <arg type='u' name='unchanged' direction='out'/>"
+    "      <arg type='u' name='missing' direction='out'/>"
+    "      <arg type='d' name='ms' direction='out'/>"
+    "    </method>"
     "    <signal name='ServerStarted'/>"
     "    <signal name='ServerStopped'/>"
+    "    <signal name='XrunOccurred'>"
+    "      <arg type='u' name='total'/>"
+    "      <arg type='u' name='new_xruns'/>"
+    "    </signal>"
     "  </interface>"
     "  <interface name='org.jackaudio.Configure'>"
     "    <method name='GetParameterValue'>"
@@ -376,6 +606,10 @@ static const gchar introspection_xml[] =
     "      <arg type='as' name='path' direction='in'/>"
     "      <arg type='v' name='value' direction='in'/>"
     "    </method>"
+    "    <method name='SetParameterValues'>"
+    "      <arg type='a{sv}' name='values' direction='in'/>"
+    "      <arg type='b' name='restarted' direction='out'/>"
+    "    </method>"
     "    <method name='ResetParameterValue'>"
     "      <arg type='as' name='path' direction='in'/>"
     "    </method>"
@@ -466,10 +700,10 @@ static void on_bus_acquired(GDBusConnection *connection,
     g_print("jack-bridge-dbus: Object fully registered at %s\n", DBUS_OBJECT_PATH);
     
     /* Start state monitoring */
-    last_known_state = check_jack_running();
-    monitor_timeout_id = g_timeout_add_seconds(1, monitor_jackd_state, NULL);
+    bridge_client_set_xrun_func(on_xruns, NULL);
+    bridge_client_start(on_jack_state_changed, NULL);
     
-    g_print("jack-bridge-dbus: State monitoring started (poll interval: 1s)\n");
+    g_print("jack-bridge-dbus: State monitoring started (JACK client + pidfile watch)\n");
 }
 
 /*
@@ -529,6 +763,8 @@ int main(int argc, char *argv[]) {
     g_print("jack-bridge-dbus: Service: %s\n", DBUS_SERVICE_NAME);
     g_print("jack-bridge-dbus: Object: %s\n", DBUS_OBJECT_PATH);
     
+    trace_init("dbus");
+    
     /* Initialize configuration cache */
     init_config_cache();
     g_print("jack-bridge-dbus: Configuration cache initialized\n");
@@ -560,9 +796,10 @@ int main(int argc, char *argv[]) {
     /* Cleanup */
     g_print("jack-bridge-dbus: Cleaning up\n");
     
-    if (monitor_timeout_id > 0) {
-        g_source_remove(monitor_timeout_id);
-    }
+    autotune_cancel();
+    start_pipeline_cancel();
+    bridge_client_stop();
+    shutdown_config_cache();
     
     if (service_name_id > 0) {
         g_bus_unown_name(service_name_id);
@@ -572,6 +809,7 @@ int main(int argc, char *argv[]) {
         g_main_loop_unref(main_loop);
     }
     
+    trace_shutdown();
     g_print("jack-bridge-dbus: Exited\n");
     return 0;
 }
\ No newline at end of file
@@ -15,7 +15,13 @@
 
 #include <glib.h>
 
+#define JACKD_RT_PIDFILE "/var/run/jackd-rt.pid"
+#define JACKD_RT_SERVICE "jackd-rt"
+
 /* External mutex for config access synchronization */
 extern GMutex config_access_mutex;
 
+/* Check if jackd-rt is running (pidfile + process check) */
+gboolean check_jack_running(void);
+
 #endif /* JACK_BRIDGE_DBUS_H */
\ No newline at end of file
@@ -0,0 +1,296 @@
+/*
+ * jack_bridge_dbus_autotune.c
+ * Opt-in search for the smallest stable JACKD_PERIOD
+ *
+ * Starting at the current buffer size, each step halves the period through
+ * try_live_buffer_size_change(), lets the graph settle, then soaks while a
+ * helper client burns a fixed share of every cycle. A step is stable if it
+ * sees no xruns and the DSP load stays under the limit. The lowest stable
+ * period is applied and persisted; the first unstable step ends the search.
+ *
+ * Everything runs from a main loop timer: the D-Bus call is answered when
+ * the search ends, and other methods keep working meanwhile.
+ */
+
+#include "jack_bridge_dbus_autotune.h"
+#include "jack_bridge_dbus_client.h"
+#include "jack_bridge_dbus_live.h"
+#include "jack_bridge_settings_sync.h"
+#include "jack_bridge_dbus.h"
+#include <stdio.h>
+#include <jack/jack.h>
+#include <glib.h>
+
+#define SAMPLE_INTERVAL_MS 250      /* Load/xrun sampling while soaking */
+#define SETTLE_MS 1000              /* Ignore xruns caused by the buffer size change itself */
+#define DEFAULT_MIN_PERIOD 32
+#define DEFAULT_SOAK_SECONDS 10
+#define DEFAULT_SYNTHETIC_LOAD 25   /* Percent of each cycle burnt by the load client */
+#define DEFAULT_MAX_LOAD 70.0       /* DSP load limit (percent) for a stable step */
+
+typedef struct {
+    GDBusMethodInvocation *invocation;
+    guint32 min_period;
+    guint32 soak_ms;
+    gdouble max_load;
+    guint32 start_period;
+    guint32 best_period;        /* Lowest period that passed its soak, 0 if none yet */
+    guint32 current_period;     /* Period under test */
+    guint32 xrun_baseline;
+    gboolean baseline_taken;
+    gint64 step_start_us;
+    gdouble peak_load;
+    guint timer_id;
+    jack_client_t *load_client;
+} AutoTuneState;
+
+static AutoTuneState *tune = NULL;
+static gint burn_percent = 0;       /* Read by the load client's process thread */
+static jack_nframes_t burn_rate = 48000;
+
+/*
+ * burn_process()
+ * Synthetic load: spin for burn_percent of the cycle
+ */
+static int burn_process(jack_nframes_t nframes, void *arg) {
+    (void)arg;
+    
+    jack_time_t start = jack_get_time();
+    jack_time_t budget = (jack_time_t)nframes * 10000u *
+                         (jack_time_t)g_atomic_int_get(&burn_percent) / burn_rate;
+    volatile guint64 spins = 0;
+    
+    while (jack_get_time() - start < budget) {
+        spins++;
+    }
+    return 0;
+}
+
+/*
+ * open_load_client()
+ */
+static jack_client_t *open_load_client(guint32 percent) {
+    jack_status_t status;
+    jack_client_t *c = jack_client_open("jack-bridge-autotune", JackNoStartServer, &status);
+    
+    if (!c) return NULL;
+    
+    burn_rate = jack_get_sample_rate(c);
+    g_atomic_int_set(&burn_percent, (gint)percent);
+    jack_set_process_callback(c, burn_process, NULL);
+    
+    if (jack_activate(c) != 0) {
+        jack_client_close(c);
+        return NULL;
+    }
+    return c;
+}
+
+/*
+ * apply_period()
+ * Live change under the config lock. Returns try_live_buffer_size_change() result.
+ */
+static gint apply_period(guint32 period) {
+    gint result;
+    
+    g_mutex_lock(&config_access_mutex);
+    result = try_live_buffer_size_change(period);
+    g_mutex_unlock(&config_access_mutex);
+    return result;
+}
+
+/*
+ * finish_tune()
+ * Restore the best period (or the starting one), persist it and reply
+ */
+static void finish_tune(const gchar *error_message) {
+    AutoTuneState *t = tune;
+    guint32 final_period = t->best_period ? t->best_period : t->start_period;
+    guint32 rate = 0;
+    
+    tune = NULL;
+    
+    if (t->timer_id > 0) {
+        g_source_remove(t->timer_id);
+    }
+    if (t->load_client) {
+        jack_client_close(t->load_client);
+    }
+    
+    /* Also rewrites JACKD_PERIOD, which intermediate steps changed */
+    if (bridge_client_is_running() ? apply_period(final_period) < 0
+                                   : !set_config_int("JACKD_PERIOD", (gint)final_period)) {
+        g_printerr("jack-bridge-dbus-autotune: Failed to restore JACKD_PERIOD\n");
+    }
+    
+    if (error_message) {
+        g_printerr("jack-bridge-dbus-autotune: %s (period left at %u)\n", error_message, final_period);
+        g_dbus_method_invocation_return_error(t->invocation,
+                                              G_DBUS_ERROR,
+                                              G_DBUS_ERROR_FAILED,
+                                              "%s", error_message);
+    } else {
+        gint nperiods = get_config_int("JACKD_NPERIODS", 3);
+        gdouble latency;
+    
+        bridge_client_get_sample_rate(&rate);
+        latency = calculate_latency_ms(final_period, (guint)MAX(nperiods, 2), rate);
+        g_print("jack-bridge-dbus-autotune: Settled on %u frames (%.2f ms)\n", final_period, latency);
+        g_dbus_method_invocation_return_value(t->invocation,
+                                              g_variant_new("(ud)", final_period, latency));
+    }
+    
+    g_free(t);
+}
+
+/*
+ * begin_step()
+ * Switch to the period under test. Returns FALSE if the server rejected it.
+ */
+static gboolean begin_step(guint32 period) {
+    if (apply_period(period) != 0) {
+        g_print("jack-bridge-dbus-autotune: %u frames rejected by the server\n", period);
+        return FALSE;
+    }
+    
+    tune->current_period = period;
+    tune->step_start_us = g_get_monotonic_time();
+    tune->baseline_taken = FALSE;
+    tune->peak_load = 0.0;
+    g_print("jack-bridge-dbus-autotune: Soaking at %u frames\n", period);
+    return TRUE;
+}
+
+/*
+ * tune_tick()
+ * Sampling timer: settle, soak, then decide on the step
+ */
+static gboolean tune_tick(gpointer user_data) {
+    (void)user_data;
+    
+    AutoTuneState *t = tune;
+    gint64 elapsed_ms = (g_get_monotonic_time() - t->step_start_us) / 1000;
+    guint32 xruns;
+    gdouble load;
+    
+    if (!bridge_client_get_xruns(&xruns) || !bridge_client_get_load(&load)) {
+        t->timer_id = 0;
+        finish_tune("JACK stopped during auto-tune");
+        return G_SOURCE_REMOVE;
+    }
+    
+    if (elapsed_ms < SETTLE_MS) {
+        return G_SOURCE_CONTINUE;
+    }
+    
+    if (!t->baseline_taken) {
+        t->xrun_baseline = xruns;
+        t->baseline_taken = TRUE;
+        return G_SOURCE_CONTINUE;
+    }
+    
+    if (load > t->peak_load) t->peak_load = load;
+    
+    if (xruns != t->xrun_baseline || t->peak_load > t->max_load) {
+        g_print("jack-bridge-dbus-autotune: %u frames unstable (%u xruns, peak load %.1f%%)\n",
+                t->current_period, xruns - t->xrun_baseline, t->peak_load);
+        t->timer_id = 0;
+        finish_tune(t->best_period ? NULL : "Current period is not stable under the test load");
+        return G_SOURCE_REMOVE;
+    }
+    
+    if (elapsed_ms < SETTLE_MS + (gint64)t->soak_ms) {
+        return G_SOURCE_CONTINUE;
+    }
+    
+    g_print("jack-bridge-dbus-autotune: %u frames stable (peak load %.1f%%)\n",
+            t->current_period, t->peak_load);
+    t->best_period = t->current_period;
+    
+    if (t->current_period / 2 < t->min_period || !begin_step(t->current_period / 2)) {
+        t->timer_id = 0;
+        finish_tune(NULL);
+        return G_SOURCE_REMOVE;
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+/*
+ * handle_auto_tune()
+ * D-Bus method: AutoTune(u min_period, u soak_seconds, u synthetic_load, d max_load)
+ * Zero arguments select the defaults. Each step takes SETTLE_MS plus the
+ * soak (about 11 s by default), so a search runs well past the default 25 s
+ * D-Bus timeout: callers must set a longer one.
+ */
+void handle_auto_tune(GDBusConnection *connection,
+                      const gchar *sender,
+                      GVariant *parameters,
+                      GDBusMethodInvocation *invocation) {
+    (void)connection;
+    (void)sender;
+    
+    guint32 min_period, soak_seconds, synthetic_load, start_period;
+    gdouble max_load;
+    
+    g_variant_get(parameters, "(uuud)", &min_period, &soak_seconds, &synthetic_load, &max_load);
+    
+    if (min_period == 0) min_period = DEFAULT_MIN_PERIOD;
+    if (soak_seconds == 0) soak_seconds = DEFAULT_SOAK_SECONDS;
+    if (synthetic_load == 0) synthetic_load = DEFAULT_SYNTHETIC_LOAD;
+    if (max_load <= 0.0) max_load = DEFAULT_MAX_LOAD;
+    
+    if (!validate_period(min_period) || synthetic_load > 90 || max_load > 100.0) {
+        g_dbus_method_invocation_return_error(invocation,
+                                              G_DBUS_ERROR,
+                                              G_DBUS_ERROR_INVALID_ARGS,
+                                              "Invalid auto-tune arguments");
+        return;
+    }
+    
+    if (tune) {
+        g_dbus_method_invocation_return_error(invocation,
+                                              G_DBUS_ERROR,
+                                              G_DBUS_ERROR_FAILED,
+                                              "Auto-tune already running");
+        return;
+    }
+    
+    if (!bridge_client_get_buffer_size(&start_period)) {
+        g_dbus_method_invocation_return_error(invocation,
+                                              G_DBUS_ERROR,
+                                              G_DBUS_ERROR_FAILED,
+                                              "JACK is not running");
+        return;
+    }
+    
+    tune = g_new0(AutoTuneState, 1);
+    tune->invocation = invocation;
+    tune->min_period = min_period;
+    tune->soak_ms = soak_seconds * 1000;
+    tune->max_load = max_load;
+    tune->start_period = start_period;
+    
+    tune->load_client = open_load_client(synthetic_load);
+    if (!tune->load_client) {
+        g_printerr("jack-bridge-dbus-autotune: Cannot open load client, tuning without synthetic load\n");
+    }
+    
+    g_print("jack-bridge-dbus-autotune: Starting at %u frames (min %u, soak %us, load %u%%, max %.0f%%)\n",
+            start_period, min_period, soak_seconds, synthetic_load, max_load);
+    
+    /* The first step re-validates the current period under load */
+    if (!begin_step(start_period)) {
+        finish_tune("Server rejected the current period");
+        return;
+    }
+    tune->timer_id = g_timeout_add(SAMPLE_INTERVAL_MS, tune_tick, NULL);
+}
+
+/*
+ * autotune_cancel()
+ */
+void autotune_cancel(void) {
+    if (tune) {
+        finish_tune("Auto-tune cancelled");
+    }
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+/*
+ * jack_bridge_dbus_autotune.h
+ * Opt-in search for the smallest stable JACKD_PERIOD
+ */
+
+#ifndef JACK_BRIDGE_DBUS_AUTOTUNE_H
+#define JACK_BRIDGE_DBUS_AUTOTUNE_H
+
+#include <gio/gio.h>
+
+/* D-Bus method: AutoTune(u min_period, u soak_seconds, u synthetic_load, d max_load)
+ *               → (u period, d latency_ms)
+ * Replies when the search has finished (runs in the main loop, non-blocking).
+ * Each step settles for 1 s and soaks for soak_seconds (about 11 s by
+ * default), and a search from 1024 down to 32 frames tests six steps, well
+ * past the default 25 s D-Bus reply timeout: callers must set a longer one
+ * (gdbus call --timeout, dbus-send --reply-timeout). */
+void handle_auto_tune(GDBusConnection *connection,
+                      const gchar *sender,
+                      GVariant *parameters,
+                      GDBusMethodInvocation *invocation);
+
+/* Abort a running search (service shutdown) */
+void autotune_cancel(void);
+
+#endif /* JACK_BRIDGE_DBUS_AUTOTUNE_H */
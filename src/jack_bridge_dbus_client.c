@@ -0,0 +1,430 @@
+/*
+ * jack_bridge_dbus_client.c
+ * Persistent JACK client used to track server state
+ *
+ * The same client serves live parameter changes and read-only queries, so a
+ * request costs one server round-trip instead of a client open/close.
+ * Server shutdown is reported by jack_on_info_shutdown(); server startup is
+ * noticed through a GFileMonitor (inotify) on the jackd-rt pidfile, followed
+ * by a bounded series of connection attempts while jackd initializes.
+ * Nothing here wakes up periodically while the server state is stable.
+ */
+
+#include "jack_bridge_dbus_client.h"
+#include "jack_bridge_dbus.h"
+#include <stdio.h>
+#include <jack/jack.h>
+#include <gio/gio.h>
+
+#define CLIENT_NAME "jack-bridge-dbus"
+#define CONNECT_FIRST_DELAY_MS 20   /* First retry after the pidfile appears */
+#define CONNECT_MAX_DELAY_MS 500    /* Backoff cap */
+#define CONNECT_MAX_ATTEMPTS 12     /* ~4s in total before giving up */
+#define XRUN_NOTIFY_INTERVAL_MS 1000 /* At most one xrun notification per second */
+
+static jack_client_t *client = NULL;
+static gboolean server_running = FALSE;
+static GFileMonitor *pidfile_monitor = NULL;
+static guint retry_source_id = 0;
+static guint connect_attempts = 0;
+static guint connect_delay_ms = 0;
+static BridgeClientStateFunc state_callback = NULL;
+static gpointer state_user_data = NULL;
+static gint xrun_count = 0; /* Updated from the JACK thread (atomic) */
+static gint xrun_notify_pending = 0; /* Set by the JACK thread, cleared by the main loop */
+static guint32 xrun_notified_count = 0; /* xrun_count at the last notification */
+static gint64 xrun_notified_time = 0;
+static guint xrun_timer_id = 0;
+static BridgeClientXrunFunc xrun_callback = NULL;
+static gpointer xrun_user_data = NULL;
+static gint ports_notify_pending = 0; /* Set by the JACK thread, cleared by the main loop */
+static BridgeClientPortsFunc ports_callback = NULL;
+static gpointer ports_user_data = NULL;
+
+static void start_connecting(void);
+
+/*
+ * set_running()
+ * Record a state transition and notify the service
+ */
+static void set_running(gboolean running) {
+    if (running == server_running) return;
+    
+    server_running = running;
+    if (state_callback) {
+        state_callback(running, state_user_data);
+    }
+}
+
+/*
+ * handle_server_shutdown()
+ * Main-loop half of the shutdown notification
+ */
+static gboolean handle_server_shutdown(gpointer user_data) {
+    gchar *reason = user_data;
+    
+    g_print("jack-bridge-dbus-client: JACK server shut down (%s)\n",
+            reason && *reason ? reason : "no reason given");
+    g_free(reason);
+    
+    if (client) {
+        jack_client_close(client);
+        client = NULL;
+    }
+    set_running(FALSE);
+    
+    /* The pidfile may already belong to a new server (restart) */
+    if (check_jack_running()) {
+        start_connecting();
+    }
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * on_info_shutdown()
+ * Runs in a JACK thread: only hand the event over to the main loop
+ */
+static void on_info_shutdown(jack_status_t code, const char *reason, void *arg) {
+    (void)code;
+    (void)arg;
+    
+    g_idle_add(handle_server_shutdown, g_strdup(reason));
+}
+
+/*
+ * dispatch_xruns()
+ * Main loop: report xruns since the last notification, at most once per
+ * XRUN_NOTIFY_INTERVAL_MS so an xrun storm cannot flood the bus
+ */
+static gboolean dispatch_xruns(gpointer user_data) {
+    (void)user_data;
+    
+    gint64 now = g_get_monotonic_time();
+    gint64 elapsed_ms = (now - xrun_notified_time) / 1000;
+    guint32 total;
+    
+    xrun_timer_id = 0;
+    
+    if (xrun_notified_time != 0 && elapsed_ms < XRUN_NOTIFY_INTERVAL_MS) {
+        xrun_timer_id = g_timeout_add((guint)(XRUN_NOTIFY_INTERVAL_MS - elapsed_ms),
+                                      dispatch_xruns, NULL);
+        return G_SOURCE_REMOVE;
+    }
+    
+    /* Clear before reading so an xrun arriving now schedules another dispatch */
+    g_atomic_int_set(&xrun_notify_pending, 0);
+    total = (guint32)g_atomic_int_get(&xrun_count);
+    
+    if (total != xrun_notified_count) {
+        guint32 new_xruns = total - xrun_notified_count;
+        
+        xrun_notified_count = total;
+        xrun_notified_time = now;
+        if (xrun_callback) {
+            xrun_callback(total, new_xruns, xrun_user_data);
+        }
+    }
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * on_xrun()
+ * Runs in a JACK thread: count, and wake the main loop once per burst
+ */
+static int on_xrun(void *arg) {
+    (void)arg;
+    
+    g_atomic_int_inc(&xrun_count);
+    if (g_atomic_int_compare_and_exchange(&xrun_notify_pending, 0, 1)) {
+        g_idle_add(dispatch_xruns, NULL);
+    }
+    return 0;
+}
+
+/*
+ * dispatch_ports()
+ * Main loop half of the port registration callback
+ */
+static gboolean dispatch_ports(gpointer user_data) {
+    (void)user_data;
+    
+    g_atomic_int_set(&ports_notify_pending, 0);
+    if (ports_callback) {
+        ports_callback(ports_user_data);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * on_port_registration()
+ * Runs in a JACK thread: wake the main loop once per burst, and only
+ * while someone is listening
+ */
+static void on_port_registration(jack_port_id_t port, int registered, void *arg) {
+    (void)port;
+    (void)registered;
+    (void)arg;
+    
+    if (ports_callback && g_atomic_int_compare_and_exchange(&ports_notify_pending, 0, 1)) {
+        g_idle_add(dispatch_ports, NULL);
+    }
+}
+
+/*
+ * try_connect()
+ * Open and activate the persistent client. Returns TRUE once connected.
+ */
+static gboolean try_connect(void) {
+    jack_status_t status;
+    
+    if (client) return TRUE;
+    
+    client = jack_client_open(CLIENT_NAME, JackNoStartServer, &status);
+    if (!client) return FALSE;
+    
+    jack_on_info_shutdown(client, on_info_shutdown, NULL);
+    jack_set_xrun_callback(client, on_xrun, NULL);
+    jack_set_port_registration_callback(client, on_port_registration, NULL);
+    g_atomic_int_set(&xrun_count, 0); /* Counts are per connection */
+    xrun_notified_count = 0;
+    
+    if (jack_activate(client) != 0) {
+        g_printerr("jack-bridge-dbus-client: Cannot activate JACK client\n");
+        jack_client_close(client);
+        client = NULL;
+        return FALSE;
+    }
+    
+    g_print("jack-bridge-dbus-client: Connected to JACK server\n");
+    set_running(TRUE);
+    return TRUE;
+}
+
+/*
+ * retry_connect()
+ * Backoff timer while jackd is starting up
+ */
+static gboolean retry_connect(gpointer user_data) {
+    (void)user_data;
+    
+    retry_source_id = 0;
+    
+    if (try_connect()) {
+        return G_SOURCE_REMOVE;
+    }
+    
+    if (!check_jack_running()) {
+        /* jackd exited during startup */
+        set_running(FALSE);
+        return G_SOURCE_REMOVE;
+    }
+    
+    if (++connect_attempts >= CONNECT_MAX_ATTEMPTS) {
+        /* Alive but refusing clients: trust the pidfile, a later pidfile
+         * change restarts the attempts */
+        g_printerr("jack-bridge-dbus-client: JACK running but not accepting clients, "
+                   "tracking pidfile only\n");
+        set_running(TRUE);
+        return G_SOURCE_REMOVE;
+    }
+    
+    connect_delay_ms = MIN(connect_delay_ms * 2, CONNECT_MAX_DELAY_MS);
+    retry_source_id = g_timeout_add(connect_delay_ms, retry_connect, NULL);
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * start_connecting()
+ * Connect now, or schedule bounded retries
+ */
+static void start_connecting(void) {
+    if (client || retry_source_id > 0) return;
+    
+    if (try_connect()) return;
+    
+    connect_attempts = 0;
+    connect_delay_ms = CONNECT_FIRST_DELAY_MS;
+    retry_source_id = g_timeout_add(connect_delay_ms, retry_connect, NULL);
+}
+
+/*
+ * on_pidfile_changed()
+ * GFileMonitor callback for JACKD_RT_PIDFILE
+ */
+static void on_pidfile_changed(GFileMonitor *monitor,
+                               GFile *file,
+                               GFile *other_file,
+                               GFileMonitorEvent event_type,
+                               gpointer user_data) {
+    (void)monitor;
+    (void)file;
+    (void)other_file;
+    (void)user_data;
+    
+    switch (event_type) {
+    case G_FILE_MONITOR_EVENT_CREATED:
+    case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+        start_connecting();
+        break;
+    case G_FILE_MONITOR_EVENT_DELETED:
+        /* With a live client, the shutdown callback reports the stop */
+        if (!client) {
+            if (retry_source_id > 0) {
+                g_source_remove(retry_source_id);
+                retry_source_id = 0;
+            }
+            set_running(FALSE);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/*
+ * bridge_client_start()
+ * Watch the pidfile and connect if jackd is already up
+ */
+void bridge_client_start(BridgeClientStateFunc state_func, gpointer user_data) {
+    GFile *pidfile;
+    GError *error = NULL;
+    
+    state_callback = state_func;
+    state_user_data = user_data;
+    
+    pidfile = g_file_new_for_path(JACKD_RT_PIDFILE);
+    pidfile_monitor = g_file_monitor_file(pidfile, G_FILE_MONITOR_NONE, NULL, &error);
+    g_object_unref(pidfile);
+    
+    if (!pidfile_monitor) {
+        g_printerr("jack-bridge-dbus-client: Cannot watch %s: %s\n",
+                   JACKD_RT_PIDFILE, error->message);
+        g_error_free(error);
+    } else {
+        g_signal_connect(pidfile_monitor, "changed", G_CALLBACK(on_pidfile_changed), NULL);
+    }
+    
+    /* Initial state comes from the pidfile; connecting only confirms it */
+    server_running = check_jack_running();
+    if (server_running) {
+        start_connecting();
+    }
+}
+
+/*
+ * bridge_client_stop()
+ */
+void bridge_client_stop(void) {
+    if (retry_source_id > 0) {
+        g_source_remove(retry_source_id);
+        retry_source_id = 0;
+    }
+    
+    if (xrun_timer_id > 0) {
+        g_source_remove(xrun_timer_id);
+        xrun_timer_id = 0;
+    }
+    
+    if (pidfile_monitor) {
+        g_file_monitor_cancel(pidfile_monitor);
+        g_object_unref(pidfile_monitor);
+        pidfile_monitor = NULL;
+    }
+    
+    if (client) {
+        jack_client_close(client);
+        client = NULL;
+    }
+    
+    state_callback = NULL;
+    xrun_callback = NULL;
+    ports_callback = NULL;
+}
+
+/*
+ * bridge_client_is_running()
+ */
+gboolean bridge_client_is_running(void) {
+    return server_running;
+}
+
+/*
+ * bridge_client_get()
+ * Connected client, reconnecting lazily if the server is up but we are not
+ * attached (e.g. after a failed startup handshake). NULL if JACK is down.
+ */
+jack_client_t *bridge_client_get(void) {
+    if (client) return client;
+    if (retry_source_id > 0 || !check_jack_running()) return NULL;
+    
+    try_connect();
+    return client;
+}
+
+/*
+ * bridge_client_get_buffer_size()
+ */
+gboolean bridge_client_get_buffer_size(guint32 *frames) {
+    jack_client_t *c = bridge_client_get();
+    
+    if (!c) return FALSE;
+    *frames = jack_get_buffer_size(c);
+    return TRUE;
+}
+
+/*
+ * bridge_client_get_sample_rate()
+ */
+gboolean bridge_client_get_sample_rate(guint32 *rate) {
+    jack_client_t *c = bridge_client_get();
+    
+    if (!c) return FALSE;
+    *rate = jack_get_sample_rate(c);
+    return TRUE;
+}
+
+/*
+ * bridge_client_get_load()
+ * DSP load in percent, as reported by the server
+ */
+gboolean bridge_client_get_load(gdouble *load) {
+    jack_client_t *c = bridge_client_get();
+    
+    if (!c) return FALSE;
+    *load = jack_cpu_load(c);
+    return TRUE;
+}
+
+/*
+ * bridge_client_get_xruns()
+ * Xruns seen since this service (re)connected to the server
+ */
+gboolean bridge_client_get_xruns(guint32 *count) {
+    if (!bridge_client_get()) return FALSE;
+    *count = (guint32)g_atomic_int_get(&xrun_count);
+    return TRUE;
+}
+
+/*
+ * bridge_client_reset_xruns()
+ */
+void bridge_client_reset_xruns(void) {
+    g_atomic_int_set(&xrun_count, 0);
+    xrun_notified_count = 0;
+}
+
+/*
+ * bridge_client_set_xrun_func()
+ */
+void bridge_client_set_xrun_func(BridgeClientXrunFunc xrun_func, gpointer user_data) {
+    xrun_callback = xrun_func;
+    xrun_user_data = user_data;
+}
+
+/*
+ * bridge_client_set_ports_func()
+ */
+void bridge_client_set_ports_func(BridgeClientPortsFunc ports_func, gpointer user_data) {
+    ports_callback = ports_func;
+    ports_user_data = user_data;
+}
@@ -0,0 +1,49 @@
+/*
+ * jack_bridge_dbus_client.h
+ * Persistent JACK client used to track server state
+ */
+
+#ifndef JACK_BRIDGE_DBUS_CLIENT_H
+#define JACK_BRIDGE_DBUS_CLIENT_H
+
+#include <glib.h>
+#include <jack/jack.h>
+
+/* Called from the main loop whenever the server starts or stops */
+typedef void (*BridgeClientStateFunc)(gboolean running, gpointer user_data);
+
+/* Called from the main loop after xruns, rate-limited to about once per second.
+ * total is the count since this service connected to the server, new_xruns the count since the last call. */
+typedef void (*BridgeClientXrunFunc)(guint32 total, guint32 new_xruns, gpointer user_data);
+
+/* Called from the main loop after ports were registered or unregistered,
+ * once per burst */
+typedef void (*BridgeClientPortsFunc)(gpointer user_data);
+
+/* Start tracking the JACK server (pidfile watch + persistent client) */
+void bridge_client_start(BridgeClientStateFunc state_func, gpointer user_data);
+
+/* Stop tracking and close the client */
+void bridge_client_stop(void);
+
+/* Last known server state (no I/O) */
+gboolean bridge_client_is_running(void);
+
+/* Shared client, reconnected on demand. NULL if JACK is not running.
+ * Owned by this module: never close it. */
+jack_client_t *bridge_client_get(void);
+
+/* Read-only queries. Return FALSE if JACK is not running. */
+gboolean bridge_client_get_buffer_size(guint32 *frames);
+gboolean bridge_client_get_sample_rate(guint32 *rate);
+gboolean bridge_client_get_load(gdouble *load);
+gboolean bridge_client_get_xruns(guint32 *count);
+void bridge_client_reset_xruns(void);
+
+/* Register the xrun notification callback */
+void bridge_client_set_xrun_func(BridgeClientXrunFunc xrun_func, gpointer user_data);
+
+/* Register (or clear, with NULL) the port registration callback */
+void bridge_client_set_ports_func(BridgeClientPortsFunc ports_func, gpointer user_data);
+
+#endif /* JACK_BRIDGE_DBUS_CLIENT_H */
@@ -9,7 +9,10 @@
 #include "jack_bridge_dbus_config.h"
 #include "jack_bridge_settings_sync.h"
 #include "jack_bridge_dbus_live.h"
+#include "jack_bridge_dbus_start.h"
+#include "jack_bridge_trace.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <glib.h>
 #include "jack_bridge_dbus.h"
@@ -106,11 +109,11 @@ void handle_get_parameter_value(GDBusConnection *connection,
     /* Extract path array from parameters */
     g_variant_get(parameters, "(^as)", &path_array);
     
-    g_print("jack-bridge-dbus: GetParameterValue([");
-    for (gint i = 0; path_array[i] != NULL; i++) {
-        g_print("%s%s", i > 0 ? ", " : "", path_array[i]);
+    /* Polled by qjackctl: traced (leaf only) rather than logged */
+    if (path_array[0]) {
+        TRACE(TRACE_DEBUG, TRACE_EV_DBUS_CALL, 0,
+              path_array[g_strv_length((gchar **)path_array) - 1]);
     }
-    g_print("])\n");
     
     /* Lock config access to prevent race conditions during setup dialog */
     g_mutex_lock(&config_access_mutex);
@@ -202,6 +205,55 @@ void handle_get_parameter_value(GDBusConnection *connection,
     g_dbus_method_invocation_return_value(invocation, result);
 }
 
+/*
+ * is_safe_config_string()
+ * String values are written unquoted into /etc/default/jackd-rt, which the
+ * init scripts source as root: only ALSA device and driver name characters
+ * (empty means auto-detect for JACKD_DEVICE)
+ */
+static gboolean is_safe_config_string(const gchar *value) {
+    return strspn(value, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_.:,-")
+           == strlen(value);
+}
+
+/* Pending D-Bus reply to a deferred config write */
+typedef struct {
+    GDBusMethodInvocation *invocation;
+    gchar *key;
+    const gchar *error;
+} ConfigReply;
+
+static ConfigReply *config_reply_new(GDBusMethodInvocation *invocation, const gchar *key,
+                                     const gchar *error) {
+    ConfigReply *reply = g_new(ConfigReply, 1);
+    
+    reply->invocation = invocation;
+    reply->key = g_strdup(key);
+    reply->error = error;
+    return reply;
+}
+
+/*
+ * on_config_written()
+ * Answer a SetParameterValue()/ResetParameterValue() call with the outcome
+ * of the write its value went out with
+ */
+static void on_config_written(gboolean ok, gpointer user_data) {
+    ConfigReply *reply = user_data;
+    
+    if (ok) {
+        g_dbus_method_invocation_return_value(reply->invocation, NULL);
+    } else {
+        g_printerr("jack-bridge-dbus: Set %s → FAILED (cannot write config)\n", reply->key);
+        g_dbus_method_invocation_return_error(reply->invocation,
+                                              G_DBUS_ERROR,
+                                              G_DBUS_ERROR_FAILED,
+                                              "%s", reply->error);
+    }
+    g_free(reply->key);
+    g_free(reply);
+}
+
 /*
  * handle_set_parameter_value()
  * D-Bus method: SetParameterValue(path: as, value: v) → void
@@ -217,6 +269,7 @@ void handle_set_parameter_value(GDBusConnection *connection,
     GVariant *value_variant;
     const ParamMapping *mapping;
     gboolean success = FALSE;
+    gchar *str_val = NULL;      /* Value to write, deferred */
     
     /* Extract parameters */
     g_variant_get(parameters, "(^asv)", &path_array, &value_variant);
@@ -320,40 +373,49 @@ void handle_set_parameter_value(GDBusConnection *connection,
                 g_print("jack-bridge-dbus: Set %s=%u → OK (JACK not running, saved to config)\n",
                         mapping->shell_var, int_val);
                 success = TRUE;
-            } else {
+            } else if (live_result == 1) {
                 /* Live change failed, config saved for restart */
                 g_print("jack-bridge-dbus: Set %s=%u → Saved (restart required for change to take effect)\n",
                         mapping->shell_var, int_val);
                 success = TRUE; /* Config was saved successfully */
+            } else {
+                g_print("jack-bridge-dbus: Set %s=%u → FAILED (config not written)\n",
+                        mapping->shell_var, int_val);
             }
         } else {
             /* Other integer parameters - just write to config */
-            success = set_config_int(mapping->shell_var, int_val);
-            g_print("jack-bridge-dbus: Set %s=%u → %s\n",
-                    mapping->shell_var, int_val, success ? "OK" : "FAILED");
+            str_val = g_strdup_printf("%u", int_val);
         }
         
     } else if (mapping->type == TYPE_STRING) {
-        const gchar *str_val = g_variant_get_string(value_variant, NULL);
+        const gchar *str = g_variant_get_string(value_variant, NULL);
         
-        /* Special handling for device (preserve auto-detection) */
-        if (g_strcmp0(mapping->shell_var, "JACKD_DEVICE") == 0) {
-            /* Empty string means auto-detect */
-            success = set_config_value(mapping->shell_var, str_val);
-        } else {
-            success = set_config_value(mapping->shell_var, str_val);
+        if (!is_safe_config_string(str)) {
+            g_variant_unref(value_variant);
+            g_strfreev((gchar **)path_array);
+            g_mutex_unlock(&config_access_mutex);
+            g_dbus_method_invocation_return_error(invocation,
+                                                  G_DBUS_ERROR,
+                                                  G_DBUS_ERROR_INVALID_ARGS,
+                                                  "Invalid characters in %s (allowed: A-Z a-z 0-9 _ . : , -)",
+                                                  mapping->shell_var);
+            return;
         }
         
-        g_print("jack-bridge-dbus: Set %s=\"%s\" → %s\n",
-                mapping->shell_var, str_val, success ? "OK" : "FAILED");
+        /* Empty JACKD_DEVICE means auto-detect */
+        str_val = g_strdup(str);
         
     } else { /* TYPE_BOOL */
         gboolean bool_val = g_variant_get_boolean(value_variant);
-        const gchar *str_val = bool_val ? "1" : "0";
-        success = set_config_value(mapping->shell_var, str_val);
-        
-        g_print("jack-bridge-dbus: Set %s=%s → %s\n",
-                mapping->shell_var, str_val, success ? "OK" : "FAILED");
+        str_val = g_strdup(bool_val ? "1" : "0");
+    }
+    
+    /* Answered once the burst this value belongs to is written */
+    if (str_val) {
+        g_print("jack-bridge-dbus: Set %s=\"%s\"\n", mapping->shell_var, str_val);
+        set_config_value_deferred(mapping->shell_var, str_val, on_config_written,
+                                  config_reply_new(invocation, mapping->shell_var,
+                                                   "Failed to write configuration"));
     }
     
     g_variant_unref(value_variant);
@@ -362,6 +424,11 @@ void handle_set_parameter_value(GDBusConnection *connection,
     /* Unlock config access */
     g_mutex_unlock(&config_access_mutex);
     
+    if (str_val) {
+        g_free(str_val);
+        return;
+    }
+    
     if (success) {
         g_dbus_method_invocation_return_value(invocation, NULL);
     } else {
@@ -372,6 +439,174 @@ void handle_set_parameter_value(GDBusConnection *connection,
     }
 }
 
+/*
+ * format_param_value()
+ * Validate a value for a writable parameter and format it for the config file.
+ * Returns a newly allocated string, or NULL with *error_msg set.
+ */
+static gchar *format_param_value(const ParamMapping *mapping, GVariant *value, gchar **error_msg) {
+    if (mapping->type == TYPE_INT) {
+        guint32 int_val;
+        
+        if (!g_variant_is_of_type(value, G_VARIANT_TYPE_UINT32)) {
+            *error_msg = g_strdup_printf("%s expects a uint32", mapping->shell_var);
+            return NULL;
+        }
+        int_val = g_variant_get_uint32(value);
+        
+        if (g_strcmp0(mapping->shell_var, "JACKD_SR") == 0 && !validate_sample_rate(int_val)) {
+            *error_msg = g_strdup_printf("Invalid sample rate: %u", int_val);
+            return NULL;
+        } else if (g_strcmp0(mapping->shell_var, "JACKD_PERIOD") == 0 && !validate_period(int_val)) {
+            *error_msg = g_strdup_printf("Invalid period (must be power of 2, 16-4096): %u", int_val);
+            return NULL;
+        } else if (g_strcmp0(mapping->shell_var, "JACKD_NPERIODS") == 0 && !validate_nperiods(int_val)) {
+            *error_msg = g_strdup_printf("Invalid nperiods (must be 2-8): %u", int_val);
+            return NULL;
+        } else if (g_strcmp0(mapping->shell_var, "JACKD_PRIORITY") == 0 && !validate_priority(int_val)) {
+            *error_msg = g_strdup_printf("Invalid priority (0 or 10-89): %u", int_val);
+            return NULL;
+        }
+        return g_strdup_printf("%u", int_val);
+    } else if (mapping->type == TYPE_STRING) {
+        if (!g_variant_is_of_type(value, G_VARIANT_TYPE_STRING)) {
+            *error_msg = g_strdup_printf("%s expects a string", mapping->shell_var);
+            return NULL;
+        }
+        if (!is_safe_config_string(g_variant_get_string(value, NULL))) {
+            *error_msg = g_strdup_printf("Invalid characters in %s (allowed: A-Z a-z 0-9 _ . : , -)",
+                                         mapping->shell_var);
+            return NULL;
+        }
+        return g_variant_dup_string(value, NULL);
+    }
+    
+    /* TYPE_BOOL */
+    if (!g_variant_is_of_type(value, G_VARIANT_TYPE_BOOLEAN)) {
+        *error_msg = g_strdup_printf("%s expects a boolean", mapping->shell_var);
+        return NULL;
+    }
+    return g_strdup(g_variant_get_boolean(value) ? "1" : "0");
+}
+
+/*
+ * restart_jack_services()
+ * Restart jackd-rt and its dependents once without blocking the main loop,
+ * keeping the connection graph (same path as SwitchMaster())
+ */
+static gboolean restart_jack_services(void) {
+    /* The init scripts read the file, not our cache */
+    if (!flush_config_cache()) {
+        g_printerr("jack-bridge-dbus: Not restarting JACK: settings could not be written\n");
+        return FALSE;
+    }
+    
+    return start_pipeline_graph_restart(NULL);
+}
+
+/*
+ * handle_set_parameter_values()
+ * D-Bus method: SetParameterValues(values: a{sv}) → (restarted: b)
+ *
+ * Keys are dotted parameter paths ("driver.rate"). All values are validated
+ * before anything is written; the config file is rewritten once and JACK
+ * (with jack-bridge-ports and jack-connection-manager) restarts at most once.
+ * A batch that only changes driver.period is applied live instead.
+ */
+void handle_set_parameter_values(GDBusConnection *connection,
+                                  const gchar *sender,
+                                  GVariant *parameters,
+                                  GDBusMethodInvocation *invocation) {
+    (void)connection;
+    (void)sender;
+    
+    GVariantIter *iter;
+    const gchar *path;
+    GVariant *value;
+    GHashTable *updates;
+    gboolean needs_restart = FALSE;
+    gboolean restarted = FALSE;
+    gboolean success;
+    gchar *error_msg = NULL;
+    const gchar *period_str;
+    
+    g_variant_get(parameters, "(a{sv})", &iter);
+    
+    /* Shell variable → formatted value (keys are static strings from PARAM_MAP) */
+    updates = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+    
+    /* Pass 1: validate everything, touch nothing */
+    while (!error_msg && g_variant_iter_next(iter, "{&sv}", &path, &value)) {
+        gchar **path_array = g_strsplit(path, ".", 3);
+        const ParamMapping *mapping = find_mapping((const gchar **)path_array);
+        
+        if (!mapping) {
+            error_msg = g_strdup_printf("Unknown parameter path: %s", path);
+        } else if (mapping->shell_var == NULL) {
+            error_msg = g_strdup_printf("Parameter is read-only: %s", path);
+        } else {
+            gchar *str_val = format_param_value(mapping, value, &error_msg);
+            if (str_val) {
+                g_hash_table_insert(updates, (gpointer)mapping->shell_var, str_val);
+                if (check_needs_restart(mapping->shell_var)) {
+                    needs_restart = TRUE;
+                }
+            }
+        }
+        
+        g_strfreev(path_array);
+        g_variant_unref(value);
+    }
+    g_variant_iter_free(iter);
+    
+    if (error_msg) {
+        g_printerr("jack-bridge-dbus: SetParameterValues rejected: %s\n", error_msg);
+        g_dbus_method_invocation_return_error(invocation,
+                                              G_DBUS_ERROR,
+                                              G_DBUS_ERROR_INVALID_ARGS,
+                                              "%s", error_msg);
+        g_free(error_msg);
+        g_hash_table_destroy(updates);
+        return;
+    }
+    
+    g_print("jack-bridge-dbus: SetParameterValues(%u values, restart %s)\n",
+            g_hash_table_size(updates), needs_restart ? "required" : "not required");
+    
+    /* Pass 2: apply */
+    g_mutex_lock(&config_access_mutex);
+    
+    period_str = g_hash_table_lookup(updates, "JACKD_PERIOD");
+    if (!needs_restart && period_str && g_hash_table_size(updates) == 1) {
+        /* Buffer size only: live change (also persists the value) */
+        gint live_result = try_live_buffer_size_change((guint32)atoi(period_str));
+        success = live_result >= 0;
+        needs_restart = (live_result == 1);
+    } else {
+        success = set_config_values(updates);
+    }
+    
+    g_mutex_unlock(&config_access_mutex);
+    
+    if (success && needs_restart && check_jack_running()) {
+        g_print("jack-bridge-dbus: Restarting JACK once for %u changed values\n",
+                g_hash_table_size(updates));
+        restarted = restart_jack_services();
+    }
+    
+    g_hash_table_destroy(updates);
+    
+    if (!success) {
+        g_dbus_method_invocation_return_error(invocation,
+                                              G_DBUS_ERROR,
+                                              G_DBUS_ERROR_FAILED,
+                                              "Failed to write configuration");
+        return;
+    }
+    
+    g_dbus_method_invocation_return_value(invocation, g_variant_new("(b)", restarted));
+}
+
 /*
  * handle_reset_parameter_value()
  * D-Bus method: ResetParameterValue(path: as) → void
@@ -408,23 +643,16 @@ void handle_reset_parameter_value(GDBusConnection *connection,
         return;
     }
     
-    /* Reset to default value */
-    gboolean success = set_config_value(mapping->shell_var, mapping->default_val);
+    /* Reset to default value, answered once it is written */
+    g_print("jack-bridge-dbus: Reset %s to default\n", mapping->shell_var);
+    set_config_value_deferred(mapping->shell_var, mapping->default_val, on_config_written,
+                              config_reply_new(invocation, mapping->shell_var,
+                                               "Failed to reset parameter"));
     
     g_strfreev((gchar **)path_array);
     
     /* Unlock config access */
     g_mutex_unlock(&config_access_mutex);
-    
-    if (success) {
-        g_print("jack-bridge-dbus: Reset %s to default\n", mapping->shell_var);
-        g_dbus_method_invocation_return_value(invocation, NULL);
-    } else {
-        g_dbus_method_invocation_return_error(invocation,
-                                              G_DBUS_ERROR,
-                                              G_DBUS_ERROR_FAILED,
-                                              "Failed to reset parameter");
-    }
 }
 
 /*
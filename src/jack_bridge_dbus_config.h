@@ -26,6 +26,11 @@ void handle_set_parameter_value(GDBusConnection *connection,
                                  GVariant *parameters,
                                  GDBusMethodInvocation *invocation);
 
+void handle_set_parameter_values(GDBusConnection *connection,
+                                  const gchar *sender,
+                                  GVariant *parameters,
+                                  GDBusMethodInvocation *invocation);
+
 void handle_reset_parameter_value(GDBusConnection *connection,
                                    const gchar *sender,
                                    GVariant *parameters,
@@ -0,0 +1,272 @@
+/*
+ * jack_bridge_dbus_graph.c
+ * Connection graph snapshots over D-Bus
+ *
+ * Snapshots belong to the user whose jack-connection-manager takes them, so
+ * the service only forwards: the caller's uid comes from the bus daemon, and
+ * a worker thread sends one request line to that user's manager control
+ * socket and reads one reply line. The method call is answered from the main
+ * loop. The graph-preserving restart uses the same channel to hand its graph
+ * to the manager.
+ */
+
+#include "jack_bridge_dbus_graph.h"
+#include "jack_bridge_graph.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <glib.h>
+
+#define CONTROL_TIMEOUT_MS 5000
+
+typedef struct {
+    GDBusMethodInvocation *invocation;
+    gboolean restore;           /* RestoreGraph(), else SaveGraph() */
+    gchar *name;
+} GraphRequest;
+
+typedef struct {
+    guint32 uid;
+    gchar *line;                /* Request line, newline included */
+    gchar *reply;               /* Manager reply line, NULL on failure */
+    gint error;
+    GraphControlFunc done;
+    gpointer user_data;
+} ControlRequest;
+
+static void graph_request_free(GraphRequest *req) {
+    g_free(req->name);
+    g_free(req);
+}
+
+/*
+ * valid_name()
+ * Same rule as the manager, checked here for a clear INVALID_ARGS error
+ */
+static gboolean valid_name(const gchar *name) {
+    size_t len = strlen(name);
+    
+    if (len == 0 || len > GRAPH_NAME_MAX) return FALSE;
+    for (size_t i = 0; i < len; i++) {
+        if (!g_ascii_isalnum(name[i]) && name[i] != '_' && name[i] != '-') return FALSE;
+    }
+    return TRUE;
+}
+
+/*
+ * on_graph_reply()
+ * Parse the manager's reply and answer the method call
+ */
+static void on_graph_reply(const gchar *reply, gint error, gpointer user_data) {
+    GraphRequest *req = user_data;
+    guint connected, disconnected, unchanged, missing, count;
+    guint64 usec;
+    
+    if (!reply) {
+        g_printerr("jack-bridge-dbus-graph: Connection manager not reachable: %s\n",
+                   g_strerror(error));
+        g_dbus_method_invocation_return_error(req->invocation,
+                                              G_DBUS_ERROR,
+                                              error == EAGAIN ? G_DBUS_ERROR_TIMEOUT : G_DBUS_ERROR_FAILED,
+                                              "Connection manager not reachable: %s",
+                                              g_strerror(error));
+    } else if (g_str_has_prefix(reply, "error ")) {
+        g_dbus_method_invocation_return_error(req->invocation,
+                                              G_DBUS_ERROR,
+                                              G_DBUS_ERROR_FAILED,
+                                              "%s: %s", req->name, reply + 6);
+    } else if (req->restore &&
+               sscanf(reply, "ok %u %u %u %u %" G_GUINT64_FORMAT,
+                      &connected, &disconnected, &unchanged, &missing, &usec) == 5) {
+        g_print("jack-bridge-dbus-graph: Restored '%s' (%u connected, %u disconnected, %u missing)\n",
+                req->name, connected, disconnected, missing);
+        g_dbus_method_invocation_return_value(req->invocation,
+                                              g_variant_new("(uuuud)", connected, disconnected,
+                                                            unchanged, missing, usec / 1000.0));
+    } else if (!req->restore && sscanf(reply, "ok %u", &count) == 1) {
+        g_print("jack-bridge-dbus-graph: Saved '%s' (%u connections)\n", req->name, count);
+        g_dbus_method_invocation_return_value(req->invocation, g_variant_new("(u)", count));
+    } else {
+        g_dbus_method_invocation_return_error(req->invocation,
+                                              G_DBUS_ERROR,
+                                              G_DBUS_ERROR_FAILED,
+                                              "Unexpected reply from connection manager");
+    }
+    
+    graph_request_free(req);
+}
+
+/*
+ * control_idle()
+ * Hand the reply to the requester in the main loop
+ */
+static gboolean control_idle(gpointer user_data) {
+    ControlRequest *req = user_data;
+    
+    req->done(req->reply, req->error, req->user_data);
+    g_free(req->line);
+    g_free(req->reply);
+    g_free(req);
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * control_thread()
+ * Worker: one request/reply exchange on the manager's control socket
+ */
+static gpointer control_thread(gpointer user_data) {
+    ControlRequest *req = user_data;
+    struct timeval tv = { CONTROL_TIMEOUT_MS / 1000, (CONTROL_TIMEOUT_MS % 1000) * 1000 };
+    struct sockaddr_un addr;
+    char buf[256];
+    size_t len = 0;
+    int fd;
+    
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), GRAPH_CONTROL_SOCKET_FMT, (unsigned int)req->uid);
+    
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        req->error = errno;
+        g_idle_add(control_idle, req);
+        return NULL;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        send(fd, req->line, strlen(req->line), MSG_NOSIGNAL) < 0) {
+        req->error = errno;
+    } else {
+        while (len < sizeof(buf) - 1) {
+            ssize_t r = recv(fd, buf + len, sizeof(buf) - 1 - len, 0);
+            if (r <= 0) {
+                req->error = r < 0 ? errno : ECONNRESET;
+                break;
+            }
+            len += (size_t)r;
+            buf[len] = '\0';
+            if (strchr(buf, '\n')) {
+                *strchr(buf, '\n') = '\0';
+                req->reply = g_strdup(buf);
+                break;
+            }
+        }
+        if (!req->reply && req->error == 0) req->error = EPROTO;
+    }
+    close(fd);
+    
+    g_idle_add(control_idle, req);
+    return NULL;
+}
+
+/*
+ * graph_control_request()
+ * Start one exchange with uid's connection manager
+ */
+void graph_control_request(guint32 uid, const gchar *request, GraphControlFunc done, gpointer user_data) {
+    ControlRequest *req = g_new0(ControlRequest, 1);
+    
+    req->uid = uid;
+    req->line = g_strconcat(request, "\n", NULL);
+    req->done = done;
+    req->user_data = user_data;
+    g_thread_unref(g_thread_new("graph-control", control_thread, req));
+}
+
+/*
+ * on_caller_uid()
+ * GetConnectionUnixUser reply: talk to that user's connection manager
+ */
+static void on_caller_uid(GObject *source, GAsyncResult *res, gpointer user_data) {
+    GraphRequest *req = user_data;
+    GError *error = NULL;
+    GVariant *result = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), res, &error);
+    gchar *line;
+    guint32 uid;
+    
+    if (!result) {
+        g_dbus_method_invocation_return_error(req->invocation,
+                                              G_DBUS_ERROR,
+                                              G_DBUS_ERROR_FAILED,
+                                              "Cannot identify caller: %s",
+                                              error->message);
+        g_error_free(error);
+        graph_request_free(req);
+        return;
+    }
+    g_variant_get(result, "(u)", &uid);
+    g_variant_unref(result);
+    
+    line = g_strdup_printf("%s %s", req->restore ? "restore" : "save", req->name);
+    graph_control_request(uid, line, on_graph_reply, req);
+    g_free(line);
+}
+
+/*
+ * start_request()
+ * Validate the snapshot name and look up the caller
+ */
+static void start_request(GDBusConnection *connection,
+                          const gchar *sender,
+                          GVariant *parameters,
+                          GDBusMethodInvocation *invocation,
+                          gboolean restore) {
+    const gchar *name;
+    GraphRequest *req;
+    
+    g_variant_get(parameters, "(&s)", &name);
+    
+    if (!valid_name(name)) {
+        g_dbus_method_invocation_return_error(invocation,
+                                              G_DBUS_ERROR,
+                                              G_DBUS_ERROR_INVALID_ARGS,
+                                              "Invalid snapshot name: %s", name);
+        return;
+    }
+    
+    req = g_new0(GraphRequest, 1);
+    req->invocation = invocation;
+    req->restore = restore;
+    req->name = g_strdup(name);
+    
+    g_dbus_connection_call(connection,
+                           "org.freedesktop.DBus",
+                           "/org/freedesktop/DBus",
+                           "org.freedesktop.DBus",
+                           "GetConnectionUnixUser",
+                           g_variant_new("(s)", sender),
+                           G_VARIANT_TYPE("(u)"),
+                           G_DBUS_CALL_FLAGS_NONE,
+                           -1,
+                           NULL,
+                           on_caller_uid,
+                           req);
+}
+
+/*
+ * handle_save_graph()
+ * SaveGraph(s name) → u connections
+ */
+void handle_save_graph(GDBusConnection *connection,
+                       const gchar *sender,
+                       GVariant *parameters,
+                       GDBusMethodInvocation *invocation) {
+    start_request(connection, sender, parameters, invocation, FALSE);
+}
+
+/*
+ * handle_restore_graph()
+ * RestoreGraph(s name) → (u connected, u disconnected, u unchanged, u missing, d ms)
+ */
+void handle_restore_graph(GDBusConnection *connection,
+                          const gchar *sender,
+                          GVariant *parameters,
+                          GDBusMethodInvocation *invocation) {
+    start_request(connection, sender, parameters, invocation, TRUE);
+}
\ No newline at end of file
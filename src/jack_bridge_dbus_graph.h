@@ -0,0 +1,36 @@
+/*
+ * jack_bridge_dbus_graph.h
+ * Connection graph snapshots over D-Bus
+ */
+
+#ifndef JACK_BRIDGE_DBUS_GRAPH_H
+#define JACK_BRIDGE_DBUS_GRAPH_H
+
+#include <gio/gio.h>
+
+/* Called in the main loop with the manager's reply line (without the
+ * newline), or with NULL and an errno value if it could not be reached */
+typedef void (*GraphControlFunc)(const gchar *reply, gint error, gpointer user_data);
+
+/* Send one control request line (without the newline) to the connection
+ * manager of uid from a worker thread */
+void graph_control_request(guint32 uid, const gchar *request, GraphControlFunc done, gpointer user_data);
+
+/* D-Bus method: SaveGraph(s name) → u connections
+ * Saves the calling user's live JACK connection graph as snapshot name
+ * (letters, digits, '-' and '_'). Handled by jack-connection-manager. */
+void handle_save_graph(GDBusConnection *connection,
+                       const gchar *sender,
+                       GVariant *parameters,
+                       GDBusMethodInvocation *invocation);
+
+/* D-Bus method: RestoreGraph(s name) → (u connected, u disconnected,
+ *                                       u unchanged, u missing, d ms)
+ * Applies snapshot name as a diff against the live graph. Missing
+ * connections are made as their ports register. */
+void handle_restore_graph(GDBusConnection *connection,
+                          const gchar *sender,
+                          GVariant *parameters,
+                          GDBusMethodInvocation *invocation);
+
+#endif /* JACK_BRIDGE_DBUS_GRAPH_H */
@@ -3,10 +3,12 @@
  * Live JACK parameter updates without full restart
  * 
  * Implements live buffer size changes via jack_set_buffer_size() API
+ * on the service's persistent client (jack_bridge_dbus_client.c)
  * Falls back to full restart if live update fails
  */
 
 #include "jack_bridge_dbus_live.h"
+#include "jack_bridge_dbus_client.h"
 #include "jack_bridge_settings_sync.h"
 #include <stdio.h>
 #include <jack/jack.h>
@@ -20,18 +22,16 @@
  *   0 = Success (live change applied)
  *   1 = Failed (restart required)
  *   2 = JACK not running (change saved to config only)
+ *  -1 = Config could not be written (a live change may still have applied)
  */
 gint try_live_buffer_size_change(guint32 new_period) {
     jack_client_t *client;
-    jack_status_t status;
     gint result;
     
     g_print("jack-bridge-dbus-live: Attempting live buffer size change: %u frames\n", new_period);
     
-    /* Try to connect to JACK */
-    client = jack_client_open("jack-bridge-dbus-bufsize",
-                              JackNoStartServer,
-                              &status);
+    /* Shared client: no handshake unless we have to reconnect */
+    client = bridge_client_get();
     
     if (!client) {
         g_print("jack-bridge-dbus-live: JACK not running, saving to config only\n");
@@ -39,13 +39,23 @@ gint try_live_buffer_size_change(guint32 new_period) {
         /* Write to config file for next restart */
         if (!set_config_int("JACKD_PERIOD", (gint)new_period)) {
             g_printerr("jack-bridge-dbus-live: Failed to write config\n");
-            return 1;
+            return -1;
         }
         
         return 2; /* JACK not running */
     }
     
-    g_print("jack-bridge-dbus-live: Connected to JACK, attempting jack_set_buffer_size()\n");
+    /* Nothing to ask the server if the period is already in effect */
+    if (jack_get_buffer_size(client) == new_period) {
+        g_print("jack-bridge-dbus-live: Buffer size already %u frames\n", new_period);
+        if (!set_config_int("JACKD_PERIOD", (gint)new_period)) {
+            g_printerr("jack-bridge-dbus-live: Failed to write config\n");
+            return -1;
+        }
+        return 0;
+    }
+    
+    g_print("jack-bridge-dbus-live: Attempting jack_set_buffer_size()\n");
     
     /* Try live buffer size change */
     if (jack_set_buffer_size(client, new_period) == 0) {
@@ -53,7 +63,8 @@ gint try_live_buffer_size_change(guint32 new_period) {
         
         /* Update config file to match */
         if (!set_config_int("JACKD_PERIOD", (gint)new_period)) {
-            g_printerr("jack-bridge-dbus-live: WARNING: Failed to write config (live change succeeded but config not saved)\n");
+            g_printerr("jack-bridge-dbus-live: Failed to write config (live change succeeded but config not saved)\n");
+            return -1;
         }
         
         result = 0; /* Success */
@@ -63,12 +74,12 @@ gint try_live_buffer_size_change(guint32 new_period) {
         /* Save to config for restart */
         if (!set_config_int("JACKD_PERIOD", (gint)new_period)) {
             g_printerr("jack-bridge-dbus-live: Failed to write config\n");
+            return -1;
         }
         
         result = 1; /* Failed - restart required */
     }
     
-    jack_client_close(client);
     return result;
 }
 
@@ -84,7 +95,9 @@ gboolean check_needs_restart(const gchar *param_name) {
         return FALSE; /* Try live update first */
     }
     
-    /* All other parameters require full restart */
+    /* All other parameters need a new server: a graph-preserving restart
+     * (clients are disconnected, their connections put back afterwards, see
+     * jack_bridge_dbus_start.c) */
     if (g_strcmp0(param_name, "JACKD_NPERIODS") == 0 ||
         g_strcmp0(param_name, "JACKD_SR") == 0 ||
         g_strcmp0(param_name, "JACKD_DEVICE") == 0 ||
@@ -9,7 +9,8 @@
 #include <glib.h>
 
 /* Try to change buffer size live (without restart)
- * Returns: 0=success, 1=failed (restart needed), 2=JACK not running */
+ * Returns: 0=success, 1=failed (restart needed), 2=JACK not running,
+ * -1=config could not be written */
 gint try_live_buffer_size_change(guint32 new_period);
 
 /* Check if parameter change requires restart */
@@ -0,0 +1,155 @@
+/*
+ * jack_bridge_dbus_route.c
+ * Output selection over D-Bus
+ *
+ * The service runs as root on the system bus, so a selection is applied to
+ * the caller's own ~/.config/jack-bridge: the caller's uid comes from the bus
+ * daemon, route_select() writes the files and starts bridges as that user.
+ * Both the uid lookup and the selection are asynchronous; the method call is
+ * answered from the main loop when the output's ports exist.
+ */
+
+#include "jack_bridge_dbus_route.h"
+#include "jack_bridge_route.h"
+#include <stdio.h>
+#include <errno.h>
+#include <pwd.h>
+#include <unistd.h>
+#include <glib.h>
+
+typedef struct {
+    GDBusMethodInvocation *invocation;
+    gchar *target;
+    gchar *bt_device;           /* NULL if not given */
+    gint error;
+    gchar *message;
+} SelectRequest;
+
+static void select_request_free(SelectRequest *req) {
+    g_free(req->target);
+    g_free(req->bt_device);
+    g_free(req->message);
+    g_free(req);
+}
+
+/*
+ * reply_idle()
+ * Answer the method call in the main loop
+ */
+static gboolean reply_idle(gpointer user_data) {
+    SelectRequest *req = user_data;
+    
+    if (req->error == 0) {
+        g_print("jack-bridge-dbus-route: Output set to %s\n", req->target);
+        g_dbus_method_invocation_return_value(req->invocation, NULL);
+    } else {
+        g_printerr("jack-bridge-dbus-route: %s\n", req->message);
+        g_dbus_method_invocation_return_error(req->invocation,
+                                              G_DBUS_ERROR,
+                                              req->error == ETIMEDOUT ? G_DBUS_ERROR_TIMEOUT : G_DBUS_ERROR_FAILED,
+                                              "%s", req->message);
+    }
+    
+    select_request_free(req);
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * on_route_done()
+ * Routing thread: hand the result to the main loop
+ */
+static void on_route_done(int error, const char *message, void *user_data) {
+    SelectRequest *req = user_data;
+    
+    req->error = error;
+    req->message = g_strdup(message ? message : "Output selection failed");
+    g_idle_add(reply_idle, req);
+}
+
+/*
+ * on_caller_uid()
+ * GetConnectionUnixUser reply: resolve the caller's home and start the selection
+ */
+static void on_caller_uid(GObject *source, GAsyncResult *res, gpointer user_data) {
+    SelectRequest *req = user_data;
+    GError *error = NULL;
+    GVariant *result = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), res, &error);
+    struct passwd pw, *found = NULL;
+    char buf[1024];
+    RouteUser user;
+    guint32 uid;
+    
+    if (!result) {
+        g_dbus_method_invocation_return_error(req->invocation,
+                                              G_DBUS_ERROR,
+                                              G_DBUS_ERROR_FAILED,
+                                              "Cannot identify caller: %s",
+                                              error->message);
+        g_error_free(error);
+        select_request_free(req);
+        return;
+    }
+    g_variant_get(result, "(u)", &uid);
+    g_variant_unref(result);
+    
+    if (getpwuid_r((uid_t)uid, &pw, buf, sizeof(buf), &found) != 0 || !found) {
+        g_dbus_method_invocation_return_error(req->invocation,
+                                              G_DBUS_ERROR,
+                                              G_DBUS_ERROR_FAILED,
+                                              "No home directory for uid %u", uid);
+        select_request_free(req);
+        return;
+    }
+    
+    user.home = pw.pw_dir;
+    user.uid = pw.pw_uid;
+    user.gid = pw.pw_gid;
+    if (route_select(req->target, req->bt_device, &user, on_route_done, req) != 0) {
+        g_dbus_method_invocation_return_error(req->invocation,
+                                              G_DBUS_ERROR,
+                                              G_DBUS_ERROR_FAILED,
+                                              "Cannot select %s: %s",
+                                              req->target, g_strerror(errno));
+        select_request_free(req);
+    }
+}
+
+/*
+ * handle_select_output()
+ * SelectOutput(s target, s bt_device)
+ */
+void handle_select_output(GDBusConnection *connection,
+                          const gchar *sender,
+                          GVariant *parameters,
+                          GDBusMethodInvocation *invocation) {
+    const gchar *target, *bt_device;
+    SelectRequest *req;
+    
+    g_variant_get(parameters, "(&s&s)", &target, &bt_device);
+    
+    if (!route_find_target(target)) {
+        g_dbus_method_invocation_return_error(invocation,
+                                              G_DBUS_ERROR,
+                                              G_DBUS_ERROR_INVALID_ARGS,
+                                              "Unknown output: %s", target);
+        return;
+    }
+    
+    req = g_new0(SelectRequest, 1);
+    req->invocation = invocation;
+    req->target = g_strdup(target);
+    req->bt_device = bt_device[0] ? g_strdup(bt_device) : NULL;
+    
+    g_dbus_connection_call(connection,
+                           "org.freedesktop.DBus",
+                           "/org/freedesktop/DBus",
+                           "org.freedesktop.DBus",
+                           "GetConnectionUnixUser",
+                           g_variant_new("(s)", sender),
+                           G_VARIANT_TYPE("(u)"),
+                           G_DBUS_CALL_FLAGS_NONE,
+                           -1,
+                           NULL,
+                           on_caller_uid,
+                           req);
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+/*
+ * jack_bridge_dbus_route.h
+ * Output selection over D-Bus
+ */
+
+#ifndef JACK_BRIDGE_DBUS_ROUTE_H
+#define JACK_BRIDGE_DBUS_ROUTE_H
+
+#include <gio/gio.h>
+
+/* D-Bus method: SelectOutput(s target, s bt_device)
+ * target is "internal", "usb", "hdmi" or "bluetooth"; bt_device is a MAC
+ * address or empty. Applied to the calling user's configuration; replies once
+ * the output's ports exist in JACK (non-blocking for the service). */
+void handle_select_output(GDBusConnection *connection,
+                          const gchar *sender,
+                          GVariant *parameters,
+                          GDBusMethodInvocation *invocation);
+
+#endif /* JACK_BRIDGE_DBUS_ROUTE_H */
@@ -0,0 +1,684 @@
+/*
+ * jack_bridge_dbus_start.c
+ * Asynchronous StartServer pipeline
+ *
+ * StartServer() used to run "service jackd-rt start" synchronously, sleep,
+ * then restart the dependent services one after another, blocking the main
+ * loop for several seconds. The start is now a small state machine:
+ *   1. "service jackd-rt start" is spawned with a child watch.
+ *   2. Readiness comes from the persistent JACK client: it connects as soon
+ *      as jackd accepts clients and reports it through
+ *      start_pipeline_server_state(). No fixed delay is involved; the init
+ *      script exiting non-zero first, or the timeout, fails the start.
+ *   3. jack-bridge-ports and jack-connection-manager are restarted in
+ *      parallel (the manager routes on port registration events, so it does
+ *      not need the bridges first).
+ * The D-Bus reply is sent when both restarts have finished. Stage end times
+ * are logged and kept for GetStartTimings().
+ *
+ * A graph-preserving restart (SwitchMaster(), or settings that only a new
+ * server can apply) runs the same pipeline with "service jackd-rt restart".
+ * This is not a driver hot-swap: jackd, as started by the init script,
+ * cannot change its driver in place, so every client is disconnected and
+ * the restart takes as long as a stop and start. The connection graph is
+ * snapshotted first. Once the dependents are back it is handed to
+ * jack-connection-manager, which pins the restored sources and finishes
+ * connections as their ports register: the manager routes every new port,
+ * so a restore made from here would fight it over the same sources. Only
+ * if no manager takes it does the persistent client put it back itself.
+ * Clients that do not reconnect to the new server stay gone.
+ */
+
+#include "jack_bridge_dbus_start.h"
+#include "jack_bridge_dbus_client.h"
+#include "jack_bridge_settings_sync.h"
+#include "jack_bridge_dbus.h"
+#include "jack_bridge_dbus_graph.h"
+#include "jack_bridge_graph.h"
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <glib.h>
+
+#define READY_TIMEOUT_MS 10000      /* jackd spawn to first client connection */
+#define DEPENDENTS_TIMEOUT_MS 15000 /* Reply anyway if a dependent init script hangs */
+#define GRAPH_RESTORE_MS 3000       /* Wait this long after the dependents for snapshot ports */
+#define MANAGER_PIDFILE "/var/run/jack-connection-manager.pid"
+
+typedef enum {
+    DEP_BRIDGE_PORTS,
+    DEP_CONNECTION_MANAGER,
+    N_DEPENDENTS
+} Dependent;
+
+static const gchar *const dependent_services[N_DEPENDENTS] = {
+    "jack-bridge-ports",
+    "jack-connection-manager"
+};
+
+/* Stage names reported by GetStartTimings() */
+static const gchar *const dependent_stages[N_DEPENDENTS] = {
+    "bridge_ports",
+    "connection_manager"
+};
+
+typedef struct {
+    guint id;                       /* Matches late replies to their pipeline */
+    GSList *invocations;            /* Callers waiting for this start */
+    gboolean keep_graph;            /* Restart of a running server, graph kept */
+    gboolean saw_stop;              /* Restart: the old server is gone */
+    GPid jackd_pid;                 /* "service jackd-rt start", 0 once reaped */
+    GPid dependent_pids[N_DEPENDENTS];
+    gint pending;                   /* Dependent restarts still running */
+    gboolean server_ready;
+    guint timeout_id;
+    gint64 start_us;
+    gdouble jackd_script_ms;        /* < 0 until the init script exits */
+    gdouble server_ready_ms;
+    gdouble dependent_ms[N_DEPENDENTS];
+    gboolean restore_started;
+    gboolean restoring;             /* Waiting for ports of snapshot connections */
+    gboolean handed_off;            /* The connection manager is restoring it */
+    guint restore_timeout_id;
+    gsize restore_total;
+    gdouble graph_ms;               /* < 0 unless a restart restored its graph */
+} StartPipeline;
+
+static StartPipeline *pipeline = NULL;
+static guint last_pipeline_id = 0;
+static JackGraph snapshot = JACK_GRAPH_INIT;   /* Connections to restore after a restart */
+
+/* Last completed start, for GetStartTimings() */
+static gboolean have_timings = FALSE;
+static gdouble last_jackd_script_ms = -1.0;
+static gdouble last_server_ready_ms = 0.0;
+static gdouble last_dependent_ms[N_DEPENDENTS];
+static gdouble last_graph_ms = -1.0;
+static gdouble last_total_ms = 0.0;
+
+static void start_dependents(StartPipeline *p);
+
+/*
+ * elapsed_ms()
+ */
+static gdouble elapsed_ms(const StartPipeline *p) {
+    return (gdouble)(g_get_monotonic_time() - p->start_us) / 1000.0;
+}
+
+/*
+ * exit_code()
+ * Exit code from a child watch status, -1 if the child was killed
+ */
+static gint exit_code(gint status) {
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/*
+ * finish_pipeline()
+ * Answer every waiting caller and drop the pipeline. Children that are
+ * still running are reaped by their watches afterwards.
+ */
+static void finish_pipeline(const gchar *error_message) {
+    StartPipeline *p = pipeline;
+    GSList *l;
+    int i;
+    
+    pipeline = NULL;
+    
+    if (p->timeout_id > 0) {
+        g_source_remove(p->timeout_id);
+    }
+    if (p->restore_timeout_id > 0) {
+        g_source_remove(p->restore_timeout_id);
+    }
+    if (p->handed_off) {
+        unlink(GRAPH_RESTART_PATH);
+    } else if (p->restoring) {
+        bridge_client_set_ports_func(NULL, NULL);
+        g_printerr("jack-bridge-dbus-start: %zu of %zu connections not restored "
+                   "(their clients did not come back)\n", snapshot.n, p->restore_total);
+    }
+    graph_clear(&snapshot);
+    
+    if (error_message) {
+        g_printerr("jack-bridge-dbus-start: Start failed after %.1f ms: %s\n",
+                   elapsed_ms(p), error_message);
+    } else {
+        have_timings = TRUE;
+        last_jackd_script_ms = p->jackd_script_ms;
+        last_server_ready_ms = p->server_ready_ms;
+        last_graph_ms = p->graph_ms;
+        for (i = 0; i < N_DEPENDENTS; i++) {
+            last_dependent_ms[i] = p->dependent_ms[i];
+        }
+        last_total_ms = elapsed_ms(p);
+        g_print("jack-bridge-dbus-start: Started in %.1f ms (server ready %.1f ms, "
+                "%s %.1f ms, %s %.1f ms)\n",
+                last_total_ms, last_server_ready_ms,
+                dependent_stages[DEP_BRIDGE_PORTS], last_dependent_ms[DEP_BRIDGE_PORTS],
+                dependent_stages[DEP_CONNECTION_MANAGER], last_dependent_ms[DEP_CONNECTION_MANAGER]);
+    }
+    
+    for (l = p->invocations; l; l = l->next) {
+        GDBusMethodInvocation *invocation = l->data;
+    
+        if (error_message) {
+            g_dbus_method_invocation_return_error(invocation,
+                                                  G_DBUS_ERROR,
+                                                  G_DBUS_ERROR_FAILED,
+                                                  "Failed to start JACK: %s",
+                                                  error_message);
+        } else {
+            g_dbus_method_invocation_return_value(invocation, NULL);
+        }
+    }
+    g_slist_free(p->invocations);
+    g_free(p);
+}
+
+/*
+ * restore_graph()
+ * Put back every snapshot connection whose ports exist. Returns TRUE when
+ * nothing is left to restore.
+ */
+static gboolean restore_graph(StartPipeline *p) {
+    jack_client_t *client = bridge_client_get();
+    
+    if (!client || graph_restore(client, &snapshot) > 0) {
+        return FALSE;
+    }
+    
+    p->graph_ms = elapsed_ms(p);
+    g_print("jack-bridge-dbus-start: Restored %zu connections after %.1f ms\n",
+            p->restore_total - snapshot.n, p->graph_ms);
+    return TRUE;
+}
+
+/*
+ * end_restore()
+ */
+static void end_restore(StartPipeline *p) {
+    p->restoring = FALSE;
+    bridge_client_set_ports_func(NULL, NULL);
+    if (p->restore_timeout_id > 0) {
+        g_source_remove(p->restore_timeout_id);
+        p->restore_timeout_id = 0;
+    }
+}
+
+static void check_done(StartPipeline *p);
+
+/*
+ * on_ports_changed()
+ * Port registrations while restoring: retry the remaining connections
+ */
+static void on_ports_changed(gpointer user_data) {
+    (void)user_data;
+    
+    if (!pipeline || !pipeline->restoring) return;
+    
+    if (restore_graph(pipeline)) {
+        end_restore(pipeline);
+        check_done(pipeline);
+    }
+}
+
+/*
+ * on_restore_timeout()
+ * Stop waiting for clients that did not come back
+ */
+static gboolean on_restore_timeout(gpointer user_data) {
+    (void)user_data;
+    
+    pipeline->restore_timeout_id = 0;
+    end_restore(pipeline);
+    g_printerr("jack-bridge-dbus-start: %zu of %zu connections not restored after %d ms\n",
+               snapshot.n, pipeline->restore_total, GRAPH_RESTORE_MS);
+    graph_clear(&snapshot);
+    check_done(pipeline);
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * restore_here()
+ * Restore what can be restored now, the rest on port registration
+ */
+static void restore_here(StartPipeline *p) {
+    if (restore_graph(p)) return;
+    
+    p->restoring = TRUE;
+    bridge_client_set_ports_func(on_ports_changed, NULL);
+    p->restore_timeout_id = g_timeout_add(GRAPH_RESTORE_MS, on_restore_timeout, NULL);
+}
+
+/*
+ * on_manager_restored()
+ * Reply to the connection manager's "restart" request
+ */
+static void on_manager_restored(const gchar *reply, gint error, gpointer user_data) {
+    guint connected, disconnected, unchanged, missing;
+    guint64 usec;
+    
+    /* A timed out, already answered restart */
+    if (!pipeline || pipeline->id != GPOINTER_TO_UINT(user_data)) return;
+    
+    unlink(GRAPH_RESTART_PATH);
+    pipeline->handed_off = FALSE;
+    pipeline->restoring = FALSE;
+    
+    if (reply && sscanf(reply, "ok %u %u %u %u %" G_GUINT64_FORMAT,
+                        &connected, &disconnected, &unchanged, &missing, &usec) == 5) {
+        pipeline->graph_ms = elapsed_ms(pipeline);
+        g_print("jack-bridge-dbus-start: Connection manager restored %u connections after %.1f ms "
+                "(%u disconnected, %u waiting for their ports)\n",
+                connected + unchanged, pipeline->graph_ms, disconnected, missing);
+        graph_clear(&snapshot);
+    } else {
+        g_printerr("jack-bridge-dbus-start: Connection manager did not restore the graph (%s), "
+                   "restoring it here\n", reply ? reply : g_strerror(error));
+        restore_here(pipeline);
+    }
+    check_done(pipeline);
+}
+
+/*
+ * manager_uid()
+ * Owner of the running connection manager, from its init script's pidfile
+ */
+static gboolean manager_uid(guint32 *uid) {
+    gchar *contents = NULL;
+    gchar *proc;
+    struct stat st;
+    gint64 pid;
+    gboolean ok;
+    
+    if (!g_file_get_contents(MANAGER_PIDFILE, &contents, NULL, NULL)) return FALSE;
+    pid = g_ascii_strtoll(contents, NULL, 10);
+    g_free(contents);
+    if (pid <= 0) return FALSE;
+    
+    proc = g_strdup_printf("/proc/%" G_GINT64_FORMAT, pid);
+    ok = stat(proc, &st) == 0;
+    g_free(proc);
+    if (ok) *uid = (guint32)st.st_uid;
+    return ok;
+}
+
+/*
+ * hand_off_graph()
+ * Save the snapshot where the connection manager reads it and ask it to
+ * restore. Returns FALSE if there is no manager to ask.
+ */
+static gboolean hand_off_graph(StartPipeline *p) {
+    guint32 uid;
+    
+    if (!manager_uid(&uid)) return FALSE;
+    
+    /* graph_save() creates the file 0600; the manager runs as the user */
+    if (graph_save(&snapshot, GRAPH_RESTART_PATH) != 0 || chmod(GRAPH_RESTART_PATH, 0644) != 0) {
+        g_printerr("jack-bridge-dbus-start: Cannot save the graph for the connection manager: %s\n",
+                   g_strerror(errno));
+        unlink(GRAPH_RESTART_PATH);
+        return FALSE;
+    }
+    
+    p->restoring = TRUE;
+    p->handed_off = TRUE;
+    graph_control_request(uid, "restart", on_manager_restored, GUINT_TO_POINTER(p->id));
+    return TRUE;
+}
+
+/*
+ * start_restore()
+ * Restart: put the snapshot back, through the connection manager if it runs
+ */
+static void start_restore(StartPipeline *p) {
+    p->restore_total = snapshot.n;
+    if (snapshot.n == 0) return;
+    
+    if (hand_off_graph(p)) return;
+    
+    restore_here(p);
+}
+
+/*
+ * check_done()
+ * Finish once the dependents have restarted and, after a restart that keeps
+ * the graph, the graph
+ * is back. The graph is restored only after the bridges were restarted, as
+ * restarting them drops their connections again.
+ */
+static void check_done(StartPipeline *p) {
+    if (p->pending > 0) return;
+    
+    if (p->keep_graph && !p->restore_started) {
+        p->restore_started = TRUE;
+        start_restore(p);
+    }
+    if (!p->restoring) {
+        finish_pipeline(NULL);
+    }
+}
+
+/*
+ * on_timeout()
+ * Readiness or dependent restart took too long
+ */
+static gboolean on_timeout(gpointer user_data) {
+    (void)user_data;
+    
+    pipeline->timeout_id = 0;
+    
+    if (!pipeline->server_ready) {
+        finish_pipeline("JACK did not accept clients in time");
+    } else {
+        /* JACK itself is up, which is what the caller asked for */
+        g_printerr("jack-bridge-dbus-start: Dependent services still restarting after %d ms, "
+                   "replying anyway\n", DEPENDENTS_TIMEOUT_MS);
+        finish_pipeline(NULL);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * spawn_service()
+ * Run "service <name> <action>" with a child watch. Returns the pid, or 0.
+ */
+static GPid spawn_service(const gchar *name, const gchar *action, GChildWatchFunc func) {
+    gchar *argv[] = { "service", (gchar *)name, (gchar *)action, NULL };
+    GError *error = NULL;
+    GPid pid = 0;
+    
+    if (!g_spawn_async(NULL, argv, NULL,
+                       G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD,
+                       NULL, NULL, &pid, &error)) {
+        g_printerr("jack-bridge-dbus-start: Failed to run service %s %s: %s\n",
+                   name, action, error->message);
+        g_error_free(error);
+        return 0;
+    }
+    
+    g_child_watch_add(pid, func, NULL);
+    return pid;
+}
+
+/*
+ * mark_server_ready()
+ * Stage 2 done: JACK accepts clients
+ */
+static void mark_server_ready(StartPipeline *p) {
+    if (p->server_ready) return;
+    
+    p->server_ready = TRUE;
+    p->server_ready_ms = elapsed_ms(p);
+    g_print("jack-bridge-dbus-start: JACK ready after %.1f ms\n", p->server_ready_ms);
+    
+    start_dependents(p);
+}
+
+/*
+ * on_jackd_script_exited()
+ * Child watch for "service jackd-rt start"
+ */
+static void on_jackd_script_exited(GPid pid, gint status, gpointer user_data) {
+    (void)user_data;
+    
+    gint code = exit_code(status);
+    
+    g_spawn_close_pid(pid);
+    
+    /* A previous, already answered start */
+    if (!pipeline || pipeline->jackd_pid != pid) return;
+    
+    pipeline->jackd_pid = 0;
+    pipeline->jackd_script_ms = elapsed_ms(pipeline);
+    
+    if (pipeline->server_ready) return;
+    
+    if (code != 0) {
+        gchar *message = g_strdup_printf("service jackd-rt %s exited with %d",
+                                         pipeline->keep_graph ? "restart" : "start", code);
+    
+        finish_pipeline(message);
+        g_free(message);
+        return;
+    }
+    
+    /* The script only exits 0 once jack_wait succeeded; connect now in case
+     * the pidfile event was missed. A restart must have seen the old server
+     * go first, or this could still be its client. */
+    if ((!pipeline->keep_graph || pipeline->saw_stop) && bridge_client_get()) {
+        mark_server_ready(pipeline);
+    }
+}
+
+/*
+ * on_dependent_exited()
+ * Child watch for the dependent service restarts
+ */
+static void on_dependent_exited(GPid pid, gint status, gpointer user_data) {
+    (void)user_data;
+    
+    gint code = exit_code(status);
+    int i;
+    
+    g_spawn_close_pid(pid);
+    
+    if (!pipeline) return;
+    
+    for (i = 0; i < N_DEPENDENTS; i++) {
+        if (pipeline->dependent_pids[i] == pid) break;
+    }
+    if (i == N_DEPENDENTS) return;
+    
+    pipeline->dependent_pids[i] = 0;
+    pipeline->dependent_ms[i] = elapsed_ms(pipeline);
+    
+    if (code != 0) {
+        /* As before, a failing dependent does not fail StartServer */
+        g_printerr("jack-bridge-dbus-start: service %s restart exited with %d\n",
+                   dependent_services[i], code);
+    }
+    
+    pipeline->pending--;
+    check_done(pipeline);
+}
+
+/*
+ * start_dependents()
+ * Stage 3: restart the bridges and the connection manager in parallel
+ */
+static void start_dependents(StartPipeline *p) {
+    int i;
+    
+    if (p->timeout_id > 0) {
+        g_source_remove(p->timeout_id);
+    }
+    p->timeout_id = g_timeout_add(DEPENDENTS_TIMEOUT_MS, on_timeout, NULL);
+    
+    for (i = 0; i < N_DEPENDENTS; i++) {
+        p->dependent_pids[i] = spawn_service(dependent_services[i], "restart", on_dependent_exited);
+        if (p->dependent_pids[i] != 0) {
+            p->pending++;
+        } else {
+            p->dependent_ms[i] = elapsed_ms(p);
+        }
+    }
+    
+    check_done(p);
+}
+
+/*
+ * begin_pipeline()
+ * Stage 1: spawn the jackd-rt init script. Returns FALSE if it could not
+ * be run (callers already answered).
+ */
+static gboolean begin_pipeline(gboolean keep_graph, GDBusMethodInvocation *invocation) {
+    StartPipeline *p;
+    const gchar *action = keep_graph ? "restart" : "start";
+    int i;
+    
+    p = g_new0(StartPipeline, 1);
+    p->id = ++last_pipeline_id;
+    if (invocation) {
+        p->invocations = g_slist_append(NULL, invocation);
+    }
+    p->keep_graph = keep_graph;
+    p->start_us = g_get_monotonic_time();
+    p->jackd_script_ms = -1.0;
+    p->graph_ms = -1.0;
+    for (i = 0; i < N_DEPENDENTS; i++) {
+        p->dependent_ms[i] = -1.0;
+    }
+    pipeline = p;
+    
+    /* jackd-rt reads its settings from the file, not from our cache */
+    if (!flush_config_cache()) {
+        g_printerr("jack-bridge-dbus-start: Starting with the settings last written to disk\n");
+    }
+    
+    p->jackd_pid = spawn_service(JACKD_RT_SERVICE, action, on_jackd_script_exited);
+    if (p->jackd_pid == 0) {
+        gchar *message = g_strdup_printf("cannot run service %s %s", JACKD_RT_SERVICE, action);
+        
+        finish_pipeline(message);
+        g_free(message);
+        return FALSE;
+    }
+    
+    p->timeout_id = g_timeout_add(READY_TIMEOUT_MS, on_timeout, NULL);
+    
+    /* The client may already be attached to a server the pidfile check missed */
+    if (!keep_graph && bridge_client_is_running() && bridge_client_get()) {
+        mark_server_ready(p);
+    }
+    return TRUE;
+}
+
+/*
+ * handle_start_server()
+ * D-Bus method: StartServer() → void
+ * Calls: service jackd-rt start, then restarts the dependent services
+ */
+void handle_start_server(GDBusConnection *connection,
+                         const gchar *sender,
+                         GVariant *parameters,
+                         GDBusMethodInvocation *invocation) {
+    (void)connection;
+    (void)sender;
+    (void)parameters;
+    
+    g_print("jack-bridge-dbus: StartServer() called\n");
+    
+    if (pipeline) {
+        g_print("jack-bridge-dbus-start: Start already in progress, waiting for it\n");
+        pipeline->invocations = g_slist_append(pipeline->invocations, invocation);
+        return;
+    }
+    
+    if (check_jack_running()) {
+        g_print("jack-bridge-dbus: JACK already running\n");
+        g_dbus_method_invocation_return_value(invocation, NULL);
+        return;
+    }
+    
+    begin_pipeline(FALSE, invocation);
+}
+
+/*
+ * start_pipeline_graph_restart()
+ * Restart a running server with the current settings, keeping the graph
+ */
+gboolean start_pipeline_graph_restart(GDBusMethodInvocation *invocation) {
+    jack_client_t *client;
+    
+    if (pipeline) {
+        g_printerr("jack-bridge-dbus-start: JACK is already (re)starting, not restarting it\n");
+        if (invocation) {
+            g_dbus_method_invocation_return_error(invocation,
+                                                  G_DBUS_ERROR,
+                                                  G_DBUS_ERROR_FAILED,
+                                                  "JACK is already (re)starting, try again");
+        }
+        return FALSE;
+    }
+    
+    client = bridge_client_get();
+    if (!client) {
+        g_print("jack-bridge-dbus-start: JACK not running, settings apply on next start\n");
+        if (invocation) {
+            g_dbus_method_invocation_return_value(invocation, NULL);
+        }
+        return FALSE;
+    }
+    
+    if (graph_capture(client, &snapshot) == 0) {
+        g_print("jack-bridge-dbus-start: Restarting server, %zu connections saved\n", snapshot.n);
+    }
+    
+    return begin_pipeline(TRUE, invocation);
+}
+
+/*
+ * handle_get_start_timings()
+ * D-Bus method: GetStartTimings() → a{sd}
+ */
+void handle_get_start_timings(GDBusConnection *connection,
+                              const gchar *sender,
+                              GVariant *parameters,
+                              GDBusMethodInvocation *invocation) {
+    (void)connection;
+    (void)sender;
+    (void)parameters;
+    
+    GVariantBuilder builder;
+    int i;
+    
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("a{sd}"));
+    
+    if (have_timings) {
+        g_variant_builder_add(&builder, "{sd}", "server_ready", last_server_ready_ms);
+        /* The init script keeps running (autoconnect) after JACK is ready */
+        if (last_jackd_script_ms >= 0) {
+            g_variant_builder_add(&builder, "{sd}", "jackd_script", last_jackd_script_ms);
+        }
+        for (i = 0; i < N_DEPENDENTS; i++) {
+            if (last_dependent_ms[i] >= 0) {
+                g_variant_builder_add(&builder, "{sd}", dependent_stages[i], last_dependent_ms[i]);
+            }
+        }
+        if (last_graph_ms >= 0) {
+            g_variant_builder_add(&builder, "{sd}", "graph_restored", last_graph_ms);
+        }
+        g_variant_builder_add(&builder, "{sd}", "total", last_total_ms);
+    }
+    
+    g_dbus_method_invocation_return_value(invocation, g_variant_new("(a{sd})", &builder));
+}
+
+/*
+ * start_pipeline_server_state()
+ * Readiness signal from the persistent client
+ */
+void start_pipeline_server_state(gboolean running) {
+    if (!pipeline) return;
+    
+    if (!running) {
+        pipeline->saw_stop = TRUE;
+        return;
+    }
+    if (pipeline->keep_graph && !pipeline->saw_stop) return;
+    
+    mark_server_ready(pipeline);
+}
+
+/*
+ * start_pipeline_cancel()
+ */
+void start_pipeline_cancel(void) {
+    if (pipeline) {
+        finish_pipeline("service shutting down");
+    }
+}
\ No newline at end of file
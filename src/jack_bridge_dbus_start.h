@@ -0,0 +1,42 @@
+/*
+ * jack_bridge_dbus_start.h
+ * Asynchronous StartServer pipeline
+ */
+
+#ifndef JACK_BRIDGE_DBUS_START_H
+#define JACK_BRIDGE_DBUS_START_H
+
+#include <gio/gio.h>
+
+/* D-Bus method: StartServer() → void
+ * Replies once JACK accepts clients and the bridge ports and connection
+ * manager have been restarted (non-blocking for the service). Calls made
+ * while a start is in progress are answered together with it. */
+void handle_start_server(GDBusConnection *connection,
+                         const gchar *sender,
+                         GVariant *parameters,
+                         GDBusMethodInvocation *invocation);
+
+/* D-Bus method: GetStartTimings() → a{sd}
+ * Milliseconds from the StartServer() call to the end of each stage of the
+ * last completed start; empty if none has completed yet. */
+void handle_get_start_timings(GDBusConnection *connection,
+                              const gchar *sender,
+                              GVariant *parameters,
+                              GDBusMethodInvocation *invocation);
+
+/* Graph-preserving restart of a running server with the current settings
+ * (SwitchMaster(), or settings only a new server can apply). Not a driver
+ * hot-swap: every client is disconnected from the old server. The
+ * connection graph is saved first and restored as its ports come back. invocation (may be NULL) is
+ * answered when done. Returns FALSE, with invocation already answered, if
+ * JACK is not running or a (re)start is already in progress. */
+gboolean start_pipeline_graph_restart(GDBusMethodInvocation *invocation);
+
+/* Server state transition from the persistent client (readiness signal) */
+void start_pipeline_server_state(gboolean running);
+
+/* Fail a start in progress (service shutdown) */
+void start_pipeline_cancel(void);
+
+#endif /* JACK_BRIDGE_DBUS_START_H */
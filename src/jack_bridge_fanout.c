@@ -0,0 +1,417 @@
+/*
+ * jack_bridge_fanout.c
+ * Multi-sink fan-out mixer hosted in the connection manager's JACK client
+ *
+ * With fan-out active the manager routes every source to the mixer inputs
+ * ("connection_manager:fanout_in_N"), where JACK sums them. The process
+ * callback then feeds one output pair per sink ("fanout_<name>_N"), each with
+ * its own gain and delay, so e.g. HDMI can be held back to line up with the
+ * much later A2DP path without extra clients or duplicate connections.
+ *
+ * All sinks read from one shared delay line written once per cycle. The
+ * scale kernel is SSE or NEON where available; gain changes are ramped over
+ * one period. Parameters are double-buffered: the main thread fills the
+ * block the process thread is not using and publishes it with one atomic
+ * store, so the process callback never locks or allocates.
+ *
+ * Plain C (no GLib), linked into jack-connection-manager.
+ */
+
+#include "jack_bridge_fanout.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <jack/jack.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define DELAY_HEADROOM_FRAMES 16384 /* Largest period the delay line can serve */
+#define PUBLISH_PERIODS 3           /* Cycles to wait for the process thread to pick up parameters */
+#define PUBLISH_POLL_US 100
+
+typedef struct {
+    jack_port_t *out[FANOUT_CHANNELS];
+    float gain;                     /* Linear */
+    jack_nframes_t delay;           /* Frames */
+} SinkParams;
+
+/* One parameter block, read by the process thread */
+typedef struct {
+    int n;
+    unsigned int layout;            /* Bumped when the port set changes */
+    jack_port_t *in[FANOUT_CHANNELS];
+    SinkParams sinks[FANOUT_MAX_SINKS];
+} FanoutParams;
+
+static FanoutParams params[2];
+static atomic_uint params_seq;      /* Published block is params[seq & 1] */
+static atomic_uint params_seen;     /* Last seq the process thread picked up */
+
+/* Process thread only (and the main thread while the mixer is offline) */
+static float *delay_line[FANOUT_CHANNELS];
+static size_t delay_frames;         /* Power of two */
+static size_t delay_pos;            /* Where the next cycle's input goes */
+static unsigned int rt_layout;
+static float rt_gain[FANOUT_MAX_SINKS]; /* Gain reached at the end of the last cycle */
+
+/* Main thread only */
+static jack_client_t *fanout_client = NULL;
+static jack_nframes_t sample_rate = 48000;
+static jack_port_t *in_ports[FANOUT_CHANNELS];
+static jack_port_t *out_ports[FANOUT_MAX_SINKS][FANOUT_CHANNELS];
+static FanoutSink active[FANOUT_MAX_SINKS];
+static int n_active = 0;
+static unsigned int layout = 0;
+static char input_prefix[128];
+static int offline_pending = 0;     /* Offline block published, not yet seen: outputs kept */
+static unsigned int offline_seq;
+
+/* dst = src * gain */
+static void scale_block(float *restrict dst, const float *restrict src, float gain, size_t n) {
+    size_t i = 0;
+
+#if defined(__SSE__)
+    const __m128 g = _mm_set1_ps(gain);
+
+    for (; i + 8 <= n; i += 8) {
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(src + i), g));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_loadu_ps(src + i + 4), g));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 8 <= n; i += 8) {
+        vst1q_f32(dst + i, vmulq_n_f32(vld1q_f32(src + i), gain));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(vld1q_f32(src + i + 4), gain));
+    }
+#endif
+    for (; i < n; i++) dst[i] = src[i] * gain;
+}
+
+/* dst = src * (g0 + step * i): scalar, only runs in the cycle a gain changes */
+static void apply_gain(float *restrict dst, const float *restrict src, size_t n, float g0, float step) {
+    if (step == 0.0f) {
+        scale_block(dst, src, g0, n);
+        return;
+    }
+    for (size_t i = 0; i < n; i++) dst[i] = src[i] * (g0 + step * (float)i);
+}
+
+static int process_callback(jack_nframes_t nframes, void *arg) {
+    unsigned int seq = atomic_load_explicit(&params_seq, memory_order_acquire);
+    const FanoutParams *p = &params[seq & 1];
+    const float *in[FANOUT_CHANNELS];
+    size_t mask = delay_frames - 1;
+    size_t pos = delay_pos;
+
+    (void)arg;
+
+    if (seq != atomic_load_explicit(&params_seen, memory_order_relaxed)) {
+        if (p->layout != rt_layout) {
+            /* New outputs fade in from silence */
+            rt_layout = p->layout;
+            memset(rt_gain, 0, sizeof(rt_gain));
+        }
+        atomic_store_explicit(&params_seen, seq, memory_order_release);
+    }
+    if (p->n == 0 || nframes > DELAY_HEADROOM_FRAMES) return 0;
+
+    /* Input into the shared delay line, wrapping at most once */
+    for (int c = 0; c < FANOUT_CHANNELS; c++) {
+        size_t first = delay_frames - pos < nframes ? delay_frames - pos : nframes;
+
+        in[c] = jack_port_get_buffer(p->in[c], nframes);
+        memcpy(delay_line[c] + pos, in[c], first * sizeof(float));
+        memcpy(delay_line[c], in[c] + first, (nframes - first) * sizeof(float));
+    }
+    delay_pos = (pos + nframes) & mask;
+
+    for (int s = 0; s < p->n; s++) {
+        const SinkParams *sp = &p->sinks[s];
+        float g0 = rt_gain[s];
+        float step = (sp->gain - g0) / (float)nframes;
+
+        if (fabsf(sp->gain - g0) < 1e-6f) {
+            g0 = sp->gain;
+            step = 0.0f;
+        }
+
+        for (int c = 0; c < FANOUT_CHANNELS; c++) {
+            float *out = jack_port_get_buffer(sp->out[c], nframes);
+            size_t start, first;
+
+            if (sp->delay == 0) {
+                apply_gain(out, in[c], nframes, g0, step);
+                continue;
+            }
+            start = (pos - sp->delay) & mask;
+            first = delay_frames - start < nframes ? delay_frames - start : nframes;
+            apply_gain(out, delay_line[c] + start, first, g0, step);
+            if (first < nframes) {
+                apply_gain(out + first, delay_line[c], nframes - first, g0 + step * (float)first, step);
+            }
+        }
+        rt_gain[s] = sp->gain;
+    }
+    return 0;
+}
+
+/* Wait until the process thread runs with parameter block seq. It picks a
+ * block up at the start of its next cycle, so the wait is bounded by a few
+ * periods: this runs on the manager's routing thread. Returns 0, or -1 if
+ * the process thread is not running cycles. */
+static int wait_seen(unsigned int seq) {
+    const struct timespec tick = { 0, PUBLISH_POLL_US * 1000L };
+    jack_nframes_t period = jack_get_buffer_size(fanout_client);
+    uint64_t timeout_us = (uint64_t)period * PUBLISH_PERIODS * 1000000u / sample_rate + 1000;
+
+    for (uint64_t us = 0; us < timeout_us; us += PUBLISH_POLL_US) {
+        if (atomic_load_explicit(&params_seen, memory_order_acquire) == seq) return 0;
+        nanosleep(&tick, NULL);
+    }
+    if (atomic_load_explicit(&params_seen, memory_order_acquire) == seq) return 0;
+    fprintf(stderr, "jack-bridge-fanout: Process thread did not pick up new parameters\n");
+    return -1;
+}
+
+/* Fill the block the process thread is not reading and switch it over.
+ * Returns 0 with the new sequence number in seq, or -1 (nothing published)
+ * while the process thread may still be reading the other block. */
+static int publish(const FanoutParams *next, unsigned int *seq) {
+    unsigned int cur = atomic_load_explicit(&params_seq, memory_order_relaxed);
+
+    /* The other block is free once the current one has been picked up */
+    if (wait_seen(cur) != 0) return -1;
+    params[(cur + 1) & 1] = *next;
+    atomic_store_explicit(&params_seq, cur + 1, memory_order_release);
+    if (seq) *seq = cur + 1;
+    return 0;
+}
+
+static float gain_of(const FanoutSink *sink) {
+    float db = sink->gain_db;
+
+    if (db < FANOUT_MIN_GAIN_DB) db = FANOUT_MIN_GAIN_DB;
+    if (db > FANOUT_MAX_GAIN_DB) db = FANOUT_MAX_GAIN_DB;
+    return powf(10.0f, db / 20.0f);
+}
+
+static jack_nframes_t delay_of(const FanoutSink *sink) {
+    float ms = sink->delay_ms;
+
+    if (ms <= 0.0f) return 0;
+    if (ms > FANOUT_MAX_DELAY_MS) ms = FANOUT_MAX_DELAY_MS;
+    return (jack_nframes_t)lrintf(ms * (float)sample_rate / 1000.0f);
+}
+
+/* Parameter block for the current ports and active[] */
+static void build_params(FanoutParams *next) {
+    memset(next, 0, sizeof(*next));
+    next->n = n_active;
+    next->layout = layout;
+    for (int c = 0; c < FANOUT_CHANNELS; c++) next->in[c] = in_ports[c];
+    for (int s = 0; s < n_active; s++) {
+        for (int c = 0; c < FANOUT_CHANNELS; c++) next->sinks[s].out[c] = out_ports[s][c];
+        next->sinks[s].gain = gain_of(&active[s]);
+        next->sinks[s].delay = delay_of(&active[s]);
+    }
+}
+
+/* Publish a block without outputs and wait until the process thread runs
+ * with it; only then may their ports go. If that does not happen in time,
+ * the ports stay registered and the next call waits for the same block. */
+static int take_offline(void) {
+    FanoutParams next;
+
+    n_active = 0;
+    if (!offline_pending) {
+        build_params(&next);
+        if (publish(&next, &offline_seq) != 0) return -1;
+        offline_pending = 1;
+    }
+    if (wait_seen(offline_seq) != 0) return -1;
+    offline_pending = 0;
+    return 0;
+}
+
+static void unregister_port(jack_port_t **port) {
+    if (!*port) return;
+    jack_port_unregister(fanout_client, *port);
+    *port = NULL;
+}
+
+static jack_port_t *register_port(const char *name, unsigned long flags) {
+    jack_port_t *port = jack_port_register(fanout_client, name, JACK_DEFAULT_AUDIO_TYPE, flags, 0);
+
+    if (!port) fprintf(stderr, "jack-bridge-fanout: Cannot register port %s\n", name);
+    return port;
+}
+
+static void unregister_outputs(void) {
+    for (int s = 0; s < FANOUT_MAX_SINKS; s++) {
+        for (int c = 0; c < FANOUT_CHANNELS; c++) unregister_port(&out_ports[s][c]);
+    }
+}
+
+static void unregister_all(void) {
+    unregister_outputs();
+    for (int c = 0; c < FANOUT_CHANNELS; c++) unregister_port(&in_ports[c]);
+}
+
+/* Inputs survive set changes so routed sources stay connected; outputs are
+ * named after their sinks. Returns 0, or -1 if a port cannot be registered. */
+static int register_ports(const FanoutSink *sinks, int n) {
+    char name[64];
+
+    for (int c = 0; c < FANOUT_CHANNELS; c++) {
+        if (in_ports[c]) continue;
+        snprintf(name, sizeof(name), "fanout_in_%d", c + 1);
+        if (!(in_ports[c] = register_port(name, JackPortIsInput))) return -1;
+    }
+    for (int s = 0; s < n; s++) {
+        for (int c = 0; c < FANOUT_CHANNELS; c++) {
+            snprintf(name, sizeof(name), "fanout_%s_%d", sinks[s].name, c + 1);
+            if (!(out_ports[s][c] = register_port(name, JackPortIsOutput))) return -1;
+        }
+    }
+    return 0;
+}
+
+int fanout_init(jack_client_t *client) {
+    size_t max_delay;
+
+    fanout_client = client;
+    sample_rate = jack_get_sample_rate(client);
+    max_delay = (size_t)(FANOUT_MAX_DELAY_MS * (float)sample_rate / 1000.0f) + DELAY_HEADROOM_FRAMES;
+
+    delay_frames = 1;
+    while (delay_frames < max_delay) delay_frames <<= 1;
+    for (int c = 0; c < FANOUT_CHANNELS; c++) {
+        delay_line[c] = calloc(delay_frames, sizeof(float));
+        if (!delay_line[c]) {
+            fprintf(stderr, "jack-bridge-fanout: Out of memory for the delay line\n");
+            fanout_shutdown();
+            return -1;
+        }
+    }
+
+    atomic_init(&params_seq, 0);
+    atomic_init(&params_seen, 0);
+    memset(params, 0, sizeof(params));
+
+    if (jack_set_process_callback(client, process_callback, NULL) != 0) {
+        fprintf(stderr, "jack-bridge-fanout: Cannot set process callback\n");
+        fanout_shutdown();
+        return -1;
+    }
+    return 0;
+}
+
+int fanout_configure(const FanoutSink *sinks, int n) {
+    FanoutParams next;
+    int same_set;
+
+    if (!fanout_client || !delay_line[0]) {
+        errno = ENODEV;
+        return -1;
+    }
+    if (n < 0 || !sinks) n = 0;
+    if (n > FANOUT_MAX_SINKS) n = FANOUT_MAX_SINKS;
+
+    /* Outputs kept by a take_offline() that timed out are released first */
+    same_set = n == n_active && !offline_pending;
+    for (int s = 0; s < n && same_set; s++) {
+        same_set = strcmp(sinks[s].name, active[s].name) == 0 &&
+                   strcmp(sinks[s].prefix, active[s].prefix) == 0;
+    }
+    if (same_set) {
+        /* Gain/delay only: the ports stay as they are */
+        if (n == 0 || memcmp(active, sinks, (size_t)n * sizeof(FanoutSink)) == 0) return 0;
+        memcpy(active, sinks, (size_t)n * sizeof(FanoutSink));
+        build_params(&next);
+        if (publish(&next, NULL) != 0) return -1;
+        fprintf(stderr, "jack-bridge-fanout: Gain/delay updated\n");
+        return 0;
+    }
+
+    /* The process thread must be done with the ports before they go away */
+    if (take_offline() != 0) {
+        errno = EBUSY;
+        return -1;
+    }
+
+    unregister_outputs();
+    for (int c = 0; c < FANOUT_CHANNELS; c++) memset(delay_line[c], 0, delay_frames * sizeof(float));
+
+    if (n == 0) {
+        /* Inputs go last: their sources are routed elsewhere from now on */
+        unregister_all();
+        input_prefix[0] = '\0';
+        fprintf(stderr, "jack-bridge-fanout: Fan-out off\n");
+        return 0;
+    }
+
+    if (register_ports(sinks, n) != 0) {
+        unregister_all();
+        input_prefix[0] = '\0';
+        return -1;
+    }
+    snprintf(input_prefix, sizeof(input_prefix), "%s:fanout_in_", jack_get_client_name(fanout_client));
+
+    memcpy(active, sinks, (size_t)n * sizeof(FanoutSink));
+    n_active = n;
+    layout++;
+    build_params(&next);
+    /* Cannot fail: the offline block has just been seen */
+    publish(&next, NULL);
+
+    for (int s = 0; s < n; s++) {
+        fprintf(stderr, "jack-bridge-fanout: Output %s -> %s (%+.1f dB, %.1f ms)\n",
+                sinks[s].name, sinks[s].prefix, sinks[s].gain_db,
+                delay_of(&sinks[s]) * 1000.0 / sample_rate);
+    }
+    return 0;
+}
+
+const char *fanout_input_prefix(void) {
+    return n_active > 0 ? input_prefix : NULL;
+}
+
+int fanout_connect_outputs(void) {
+    int missing = 0;
+
+    for (int s = 0; s < n_active; s++) {
+        for (int c = 0; c < FANOUT_CHANNELS; c++) {
+            char target[96];
+            int ret;
+
+            snprintf(target, sizeof(target), "%s%d", active[s].prefix, c + 1);
+            if (!jack_port_by_name(fanout_client, target)) {
+                missing++;
+                break;
+            }
+            ret = jack_connect(fanout_client, jack_port_name(out_ports[s][c]), target);
+            if (ret != 0 && ret != EEXIST) {
+                fprintf(stderr, "jack-bridge-fanout: Failed to connect %s -> %s (error %d)\n",
+                        jack_port_name(out_ports[s][c]), target, ret);
+            }
+        }
+    }
+    return missing;
+}
+
+void fanout_shutdown(void) {
+    for (int c = 0; c < FANOUT_CHANNELS; c++) {
+        free(delay_line[c]);
+        delay_line[c] = NULL;
+    }
+    fanout_client = NULL;
+    n_active = 0;
+}
@@ -0,0 +1,48 @@
+/*
+ * jack_bridge_fanout.h
+ * Multi-sink fan-out mixer hosted in the connection manager's JACK client
+ */
+
+#ifndef JACK_BRIDGE_FANOUT_H
+#define JACK_BRIDGE_FANOUT_H
+
+#include <jack/jack.h>
+
+#define FANOUT_CHANNELS 2
+#define FANOUT_MAX_SINKS 4
+#define FANOUT_MAX_DELAY_MS 500.0f
+#define FANOUT_MIN_GAIN_DB -60.0f
+#define FANOUT_MAX_GAIN_DB 12.0f
+
+/* One output of the fan-out */
+typedef struct {
+    char name[32];      /* Output name (PREFERRED_OUTPUT style), used for port names */
+    char prefix[64];    /* Sink port prefix, e.g. "hdmi_out:playback_" */
+    float gain_db;
+    float delay_ms;     /* Added before this sink, to line up faster outputs with slower ones */
+} FanoutSink;
+
+/* Install the process callback and allocate the delay line. Call once, before
+ * jack_activate(). Returns 0, or -1 on failure. */
+int fanout_init(jack_client_t *client);
+
+/* Make sinks[0..n) the active set (main thread). The mixer's input and output
+ * ports exist only while n > 0. Gain/delay changes on an unchanged set are
+ * applied without touching ports. Returns 0, or -1 on failure (fan-out is
+ * then off). EBUSY: the process thread did not confirm within a few periods
+ * that it stopped using the old outputs, which then stay registered until a
+ * later call can confirm it. */
+int fanout_configure(const FanoutSink *sinks, int n);
+
+/* Full name prefix of the mixer inputs ("<client>:fanout_in_", channel
+ * appended), or NULL while fan-out is off */
+const char *fanout_input_prefix(void);
+
+/* Connect each active output to its sink's ports, where they exist.
+ * Returns the number of outputs still waiting for their sink. */
+int fanout_connect_outputs(void);
+
+/* Free the delay line (the ports go with the client) */
+void fanout_shutdown(void);
+
+#endif /* JACK_BRIDGE_FANOUT_H */
@@ -0,0 +1,290 @@
+/*
+ * jack_bridge_graph.c
+ * Snapshot and restore of the JACK connection graph
+ *
+ * A snapshot is a flat list of (output port, input port) names taken with
+ * one jack_get_ports() plus one connection query per connected output.
+ * Restoring connects whatever can be connected right away and keeps the
+ * rest, so a caller can finish the job as clients come back after a server
+ * restart, driven by port registration events rather than retries.
+ *
+ * Snapshots can also be saved to a file ("# jack-bridge graph 1", then one
+ * "output<TAB>input" line per connection) and applied as a diff: sort both
+ * sides once, then only the connections that differ are touched, so a
+ * restore costs one jack_connect()/jack_disconnect() per change.
+ *
+ * Plain C (no GLib) so the connection manager can link it too.
+ */
+
+#include "jack_bridge_graph.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <jack/jack.h>
+
+#define GRAPH_FILE_HEADER "# jack-bridge graph 1"
+
+static int graph_add(JackGraph *graph, const char *source, const char *destination) {
+    GraphConnection *c;
+
+    if (graph->n == graph->cap) {
+        size_t cap = graph->cap ? graph->cap * 2 : 64;
+        GraphConnection *grown = realloc(graph->conns, cap * sizeof(GraphConnection));
+
+        if (!grown) return -1;
+        graph->conns = grown;
+        graph->cap = cap;
+    }
+
+    c = &graph->conns[graph->n];
+    c->source = strdup(source);
+    c->destination = strdup(destination);
+    if (!c->source || !c->destination) {
+        free(c->source);
+        free(c->destination);
+        return -1;
+    }
+    graph->n++;
+    return 0;
+}
+
+int graph_capture(jack_client_t *client, JackGraph *graph) {
+    const char **ports;
+    int result = 0;
+
+    graph_clear(graph);
+
+    ports = jack_get_ports(client, NULL, NULL, JackPortIsOutput);
+    if (!ports) return 0; /* Nothing registered */
+
+    for (int i = 0; ports[i] && result == 0; i++) {
+        jack_port_t *port = jack_port_by_name(client, ports[i]);
+        const char **connections;
+
+        if (!port || jack_port_is_mine(client, port) || jack_port_connected(port) == 0) continue;
+
+        connections = jack_port_get_all_connections(client, port);
+        if (!connections) continue;
+        for (int j = 0; connections[j] && result == 0; j++) {
+            result = graph_add(graph, ports[i], connections[j]);
+        }
+        jack_free(connections);
+    }
+    jack_free(ports);
+
+    if (result != 0) {
+        fprintf(stderr, "jack-bridge-graph: Out of memory taking a graph snapshot\n");
+        graph_clear(graph);
+    }
+    return result;
+}
+
+size_t graph_restore(jack_client_t *client, JackGraph *graph) {
+    size_t i = 0;
+
+    while (i < graph->n) {
+        GraphConnection *c = &graph->conns[i];
+        int ret;
+
+        if (!jack_port_by_name(client, c->source) || !jack_port_by_name(client, c->destination)) {
+            i++;
+            continue;
+        }
+
+        ret = jack_connect(client, c->source, c->destination);
+        if (ret != 0 && ret != EEXIST) {
+            fprintf(stderr, "jack-bridge-graph: Failed to restore %s -> %s (error %d)\n",
+                    c->source, c->destination, ret);
+        }
+
+        /* Done either way: swap in the last entry */
+        free(c->source);
+        free(c->destination);
+        graph->conns[i] = graph->conns[--graph->n];
+    }
+    return graph->n;
+}
+
+static int compare_connections(const void *a, const void *b) {
+    const GraphConnection *x = a;
+    const GraphConnection *y = b;
+    int c = strcmp(x->source, y->source);
+
+    return c ? c : strcmp(x->destination, y->destination);
+}
+
+static int compare_source(const void *key, const void *member) {
+    return strcmp(key, ((const GraphConnection *)member)->source);
+}
+
+static void graph_sort(JackGraph *graph) {
+    if (graph->n > 1) qsort(graph->conns, graph->n, sizeof(GraphConnection), compare_connections);
+}
+
+/* Both lookups need graph sorted by graph_sort() */
+static int graph_contains(const JackGraph *graph, const GraphConnection *c) {
+    return graph->n && bsearch(c, graph->conns, graph->n, sizeof(GraphConnection),
+                               compare_connections) != NULL;
+}
+
+static int graph_has_source_sorted(const JackGraph *graph, const char *source) {
+    return graph->n && bsearch(source, graph->conns, graph->n, sizeof(GraphConnection),
+                               compare_source) != NULL;
+}
+
+int graph_apply(jack_client_t *client, JackGraph *snapshot, JackGraph *missing,
+                GraphApplyStats *stats) {
+    JackGraph live = JACK_GRAPH_INIT;
+    int result = 0;
+
+    memset(stats, 0, sizeof(*stats));
+    graph_clear(missing);
+    if (graph_capture(client, &live) != 0) return -1;
+
+    graph_sort(snapshot);
+    graph_sort(&live);
+
+    /* Drop what the snapshot routes differently; outputs it does not
+     * mention are left as they are */
+    for (size_t i = 0; i < live.n; i++) {
+        GraphConnection *c = &live.conns[i];
+
+        if (graph_contains(snapshot, c) || !graph_has_source_sorted(snapshot, c->source)) continue;
+        if (jack_disconnect(client, c->source, c->destination) == 0) {
+            stats->disconnected++;
+        } else {
+            fprintf(stderr, "jack-bridge-graph: Failed to disconnect %s -> %s\n",
+                    c->source, c->destination);
+        }
+    }
+
+    for (size_t i = 0; i < snapshot->n && result == 0; i++) {
+        GraphConnection *c = &snapshot->conns[i];
+        int ret;
+
+        if (graph_contains(&live, c)) {
+            stats->unchanged++;
+            continue;
+        }
+        if (!jack_port_by_name(client, c->source) || !jack_port_by_name(client, c->destination)) {
+            result = graph_add(missing, c->source, c->destination);
+            stats->missing++;
+            continue;
+        }
+
+        ret = jack_connect(client, c->source, c->destination);
+        if (ret == 0 || ret == EEXIST) {
+            stats->connected++;
+        } else {
+            fprintf(stderr, "jack-bridge-graph: Failed to connect %s -> %s (error %d)\n",
+                    c->source, c->destination, ret);
+        }
+    }
+
+    graph_clear(&live);
+    return result;
+}
+
+int graph_has_source(const JackGraph *graph, const char *source) {
+    for (size_t i = 0; i < graph->n; i++) {
+        if (strcmp(graph->conns[i].source, source) == 0) return 1;
+    }
+    return 0;
+}
+
+int graph_save(const JackGraph *graph, const char *path) {
+    size_t len = strlen(path);
+    char *tmp = malloc(len + 8);
+    FILE *f;
+    int fd;
+    int ok;
+
+    if (!tmp) return -1;
+    snprintf(tmp, len + 8, "%s.XXXXXX", path);
+
+    fd = mkstemp(tmp);
+    if (fd < 0) {
+        free(tmp);
+        return -1;
+    }
+    f = fdopen(fd, "w");
+    if (!f) {
+        close(fd);
+        unlink(tmp);
+        free(tmp);
+        return -1;
+    }
+
+    ok = fprintf(f, "%s\n", GRAPH_FILE_HEADER) > 0;
+    for (size_t i = 0; i < graph->n && ok; i++) {
+        ok = fprintf(f, "%s\t%s\n", graph->conns[i].source, graph->conns[i].destination) > 0;
+    }
+    /* Durable before it replaces the old snapshot */
+    ok = ok && fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = (fclose(f) == 0) && ok;
+    ok = ok && rename(tmp, path) == 0;
+
+    if (!ok) {
+        int saved = errno;
+
+        unlink(tmp);
+        errno = saved;
+    }
+    free(tmp);
+    return ok ? 0 : -1;
+}
+
+int graph_load(JackGraph *graph, const char *path) {
+    FILE *f = fopen(path, "r");
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+    int result = 0;
+    int first = 1;
+
+    graph_clear(graph);
+    if (!f) return -1;
+
+    while (result == 0 && (len = getline(&line, &size, f)) >= 0) {
+        char *tab;
+
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) line[--len] = '\0';
+        if (first) {
+            first = 0;
+            if (strcmp(line, GRAPH_FILE_HEADER) != 0) {
+                errno = EINVAL;
+                result = -1;
+            }
+            continue;
+        }
+        if (len == 0 || line[0] == '#') continue;
+
+        tab = strchr(line, '\t');
+        if (!tab || tab == line || tab[1] == '\0') continue; /* Malformed line */
+        *tab = '\0';
+        result = graph_add(graph, line, tab + 1);
+    }
+    if (first && result == 0) {
+        errno = EINVAL; /* Empty file: not a snapshot */
+        result = -1;
+    }
+
+    free(line);
+    fclose(f);
+    if (result != 0) graph_clear(graph);
+    return result;
+}
+
+void graph_clear(JackGraph *graph) {
+    for (size_t i = 0; i < graph->n; i++) {
+        free(graph->conns[i].source);
+        free(graph->conns[i].destination);
+    }
+    free(graph->conns);
+    graph->conns = NULL;
+    graph->n = 0;
+    graph->cap = 0;
+}
@@ -0,0 +1,76 @@
+/*
+ * jack_bridge_graph.h
+ * Snapshot and restore of the JACK connection graph
+ */
+
+#ifndef JACK_BRIDGE_GRAPH_H
+#define JACK_BRIDGE_GRAPH_H
+
+#include <stddef.h>
+#include <jack/jack.h>
+
+/* One connection, by full port names */
+typedef struct {
+    char *source;       /* Output port */
+    char *destination;  /* Input port */
+} GraphConnection;
+
+typedef struct {
+    GraphConnection *conns;
+    size_t n;
+    size_t cap;
+} JackGraph;
+
+#define JACK_GRAPH_INIT { NULL, 0, 0 }
+
+/* Control socket of jack-connection-manager, per user (%u = uid) */
+#define GRAPH_CONTROL_DIR_FMT "/tmp/jack-bridge-%u"
+#define GRAPH_CONTROL_SOCKET_FMT GRAPH_CONTROL_DIR_FMT "/manager.sock"
+
+/* Graph jack-bridge-dbus saved before a graph-preserving server restart,
+ * for the manager's "restart" control request */
+#define GRAPH_RESTART_PATH "/var/run/jack-bridge-restart.graph"
+
+/* Snapshot name: 1..GRAPH_NAME_MAX of [A-Za-z0-9_-] */
+#define GRAPH_NAME_MAX 64
+
+typedef struct {
+    size_t connected;     /* Made by the apply */
+    size_t disconnected;  /* Removed by the apply */
+    size_t unchanged;     /* Already in place */
+    size_t missing;       /* Ports not registered (yet) */
+} GraphApplyStats;
+
+/* Replace graph with every connection in the live graph, except those of
+ * client's own ports. Returns 0, or -1 (graph left empty) on failure. */
+int graph_capture(jack_client_t *client, JackGraph *graph);
+
+/* Make every connection whose two ports exist now, in one pass, and drop it
+ * from graph. Connections whose ports are missing stay for a later call
+ * (e.g. from a port registration callback's main-loop half).
+ * Returns the number of connections still missing. */
+size_t graph_restore(jack_client_t *client, JackGraph *graph);
+
+/* Make the live graph match snapshot: disconnect the live connections of
+ * every output the snapshot mentions that it does not contain, and connect
+ * what it has that is not live yet. Other outputs are left alone. Entries
+ * whose ports do not exist go to missing (replaced) for graph_restore().
+ * snapshot is sorted in place. Returns 0, or -1 on failure. */
+int graph_apply(jack_client_t *client, JackGraph *snapshot, JackGraph *missing,
+                GraphApplyStats *stats);
+
+/* Whether any connection in graph starts at source (linear scan) */
+int graph_has_source(const JackGraph *graph, const char *source);
+
+/* Write graph to path atomically (temporary file, fsync, rename).
+ * Returns 0, or -1 with errno set. */
+int graph_save(const JackGraph *graph, const char *path);
+
+/* Replace graph with the snapshot in path. Returns 0, or -1 with errno set
+ * (EINVAL: not a snapshot file); graph is left empty on failure. */
+int graph_load(JackGraph *graph, const char *path);
+
+/* Free all connections */
+void graph_clear(JackGraph *graph);
+
+#endif /* JACK_BRIDGE_GRAPH_H */
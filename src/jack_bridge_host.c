@@ -0,0 +1,735 @@
+/*
+ * jack_bridge_host.c
+ * In-process bridge host for jack-bridge
+ *
+ * Hosts every ALSA output bridge (usb_out, hdmi_out, ...) as ports of a single
+ * JACK client, replacing one alsa_out process per device. The JACK process
+ * callback only copies audio into a lock-free ring buffer per device; a writer
+ * thread per device feeds ALSA through an adaptive resampler that follows the
+ * drift between the JACK clock and the device clock.
+ *
+ * ALSA period and buffer sizes come from JACKD_PERIOD/JACKD_NPERIODS in
+ * /etc/default/jackd-rt. Ports keep their historic names as aliases
+ * ("usb_out:playback_1"), so connections by name keep working.
+ *
+ * Devices may be given as "@PATTERN": the first playback device whose card or
+ * PCM name contains PATTERN (e.g. "@USB"), resolved each time the device is
+ * (re)opened. Devices that are missing or unplugged are retried in the
+ * background while the JACK ports stay registered.
+ *
+ * "bt:PCM" marks a BlueALSA sink. A2DP transports accept audio in bursts, so
+ * those writers run without realtime priority, keep a deeper ring fill and
+ * steer the resampler from a slower fill average. Either way the JACK thread
+ * only touches its ring and never waits on a device or socket.
+ *
+ * Usage: jack-bridge-host [-c client] [-p period] [-n nperiods] NAME=DEVICE [NAME=DEVICE ...]
+ *        jack-bridge-host usb_out=@USB hdmi_out=@HDMI
+ *        jack-bridge-host -c jack_bridge_bt -p 256 -n 3 bluealsa=bt:jackbridge_bluealsa
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <alsa/asoundlib.h>
+#include <jack/jack.h>
+#include "jack_bridge_trace.h"
+
+#define DEFAULT_CLIENT_NAME "jack_bridge"
+#define JACKD_RT_CONFIG "/etc/default/jackd-rt"
+#define MAX_LINE 256
+#define MAX_BRIDGES 8
+#define BRIDGE_CHANNELS 2
+#define FRAME_BYTES (BRIDGE_CHANNELS * sizeof(float))
+#define CACHE_LINE 64
+#define RING_FRAMES 16384           /* Per device, power of two; ~340 ms at 48 kHz */
+#define DEFAULT_PERIOD 256
+#define DEFAULT_NPERIODS 3
+#define REOPEN_DELAY_MS 2000        /* Retry interval for missing/unplugged devices */
+
+/* Fill-level controller tuning */
+typedef struct {
+    double smoothing;               /* Weight of each new sample in the fill average */
+    double kp;                      /* Correction per JACK period of fill error */
+    double ki;
+    double max_drift;               /* Correction limit */
+    double target_periods;          /* Device periods buffered on top of one JACK period */
+} DriftTuning;
+
+static const DriftTuning wired_tuning = { 1.0 / 64.0, 0.0005, 0.000005, 0.002, 0.5 };
+
+/* A2DP drains in bursts of several periods: average over longer and react
+ * more gently, with a full device period of headroom in the ring */
+static const DriftTuning bluetooth_tuning = { 1.0 / 512.0, 0.0002, 0.000001, 0.005, 1.0 };
+
+/* Single-producer/single-consumer frame ring. The JACK process thread only
+ * advances head, the writer thread only advances tail, and each index has its
+ * own cache line so the two threads never write to the same line. */
+typedef struct {
+    alignas(CACHE_LINE) atomic_size_t head; /* Frames written (producer) */
+    alignas(CACHE_LINE) atomic_size_t tail; /* Frames consumed (consumer) */
+    alignas(CACHE_LINE) float *data;        /* RING_FRAMES interleaved frames */
+} FrameRing;
+
+/* 4-point cubic resampler with a drift-tracking ratio (writer thread only) */
+typedef struct {
+    double nominal;                 /* JACK rate / device rate */
+    double ratio;                   /* Input frames consumed per output frame */
+    double pos;                     /* Fractional position between hist[1] and hist[2] */
+    float hist[4][BRIDGE_CHANNELS];
+    double fill_avg;                /* Smoothed ring fill in frames */
+    double integral;
+} Resampler;
+
+typedef struct {
+    FrameRing ring;                 /* JACK thread -> writer */
+    char name[32];                  /* Alias client name, e.g. "usb_out" */
+    char device[64];                /* ALSA device or @PATTERN */
+    int bluetooth;                  /* BlueALSA sink ("bt:" prefix) */
+    const DriftTuning *tuning;
+    jack_port_t *ports[BRIDGE_CHANNELS];
+    atomic_int active;              /* Writer has the device open and consumes the ring */
+    atomic_uint overruns;           /* JACK cycles dropped because the ring was full */
+    atomic_uint underruns;          /* ALSA periods padded with silence */
+    pthread_t thread;
+    int thread_started;
+
+    /* Writer thread only */
+    snd_pcm_t *pcm;
+    snd_pcm_format_t format;
+    unsigned int rate;
+    snd_pcm_uframes_t period;
+    snd_pcm_uframes_t buffer;
+    float *mix;                     /* One period of resampled float frames */
+    void *out;                      /* Same period in device format */
+    Resampler rs;
+    int audible;                    /* Last period had signal (traced only) */
+} Bridge;
+
+/* Global state */
+static const char *client_name = DEFAULT_CLIENT_NAME;
+static jack_client_t *client = NULL;
+static volatile int keep_running = 1;
+static int wake_fd = -1;
+static Bridge bridges[MAX_BRIDGES];
+static int n_bridges = 0;
+static int cfg_period = DEFAULT_PERIOD;
+static int cfg_nperiods = DEFAULT_NPERIODS;
+static jack_nframes_t jack_rate = 48000;
+static atomic_uint jack_period = DEFAULT_PERIOD;
+
+/* Wake the main thread blocked in poll(). Async-signal-safe. */
+static void wake_main_thread(void) {
+    uint64_t one = 1;
+    ssize_t ret;
+
+    if (wake_fd < 0) return;
+    ret = write(wake_fd, &one, sizeof(one));
+    (void)ret;
+}
+
+/* Signal handler for clean shutdown */
+static void signal_handler(int sig) {
+    (void)sig;
+    keep_running = 0;
+    wake_main_thread();
+}
+
+/* Read JACKD_PERIOD / JACKD_NPERIODS so ALSA buffers match the server's */
+static void load_jackd_config(void) {
+    FILE *f = fopen(JACKD_RT_CONFIG, "r");
+    char line[MAX_LINE];
+
+    if (!f) return;
+    while (fgets(line, sizeof(line), f)) {
+        char *val = strchr(line, '=');
+        if (!val) continue;
+        val++;
+        if (*val == '"' || *val == '\'') val++;
+        if (strncmp(line, "JACKD_PERIOD=", 13) == 0 && atoi(val) > 0) {
+            cfg_period = atoi(val);
+        } else if (strncmp(line, "JACKD_NPERIODS=", 15) == 0 && atoi(val) >= 2) {
+            cfg_nperiods = atoi(val);
+        }
+    }
+    fclose(f);
+}
+
+static int ring_init(FrameRing *r) {
+    size_t bytes = RING_FRAMES * FRAME_BYTES;
+
+    r->data = aligned_alloc(CACHE_LINE, bytes);
+    if (!r->data) return -1;
+    memset(r->data, 0, bytes);
+    mlock(r->data, bytes); /* Best effort: avoid page faults in the RT thread */
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    return 0;
+}
+
+static void ring_free(FrameRing *r) {
+    if (!r->data) return;
+    munlock(r->data, RING_FRAMES * FRAME_BYTES);
+    free(r->data);
+    r->data = NULL;
+}
+
+/* Producer: append nframes from per-channel buffers, or drop the whole cycle (-1) */
+static int ring_write(FrameRing *r, const float *const in[BRIDGE_CHANNELS], jack_nframes_t nframes) {
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+
+    if (RING_FRAMES - (head - tail) < nframes) return -1;
+
+    for (jack_nframes_t f = 0; f < nframes; f++) {
+        float *dst = r->data + ((head + f) & (RING_FRAMES - 1)) * BRIDGE_CHANNELS;
+        for (int c = 0; c < BRIDGE_CHANNELS; c++) {
+            dst[c] = in[c][f];
+        }
+    }
+    atomic_store_explicit(&r->head, head + nframes, memory_order_release);
+    return 0;
+}
+
+/* Consumer: frames available to read */
+static size_t ring_read_space(FrameRing *r) {
+    return atomic_load_explicit(&r->head, memory_order_acquire) -
+           atomic_load_explicit(&r->tail, memory_order_relaxed);
+}
+
+/* Consumer: frame i past the read position */
+static const float *ring_frame(const FrameRing *r, size_t i) {
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    return r->data + ((tail + i) & (RING_FRAMES - 1)) * BRIDGE_CHANNELS;
+}
+
+static void ring_read_advance(FrameRing *r, size_t frames) {
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    atomic_store_explicit(&r->tail, tail + frames, memory_order_release);
+}
+
+/* Consumer: drop everything buffered (safe while the producer keeps writing) */
+static void ring_discard(FrameRing *r) {
+    atomic_store_explicit(&r->tail, atomic_load_explicit(&r->head, memory_order_acquire),
+                          memory_order_release);
+}
+
+static void sleep_ms(long ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR && keep_running) {
+    }
+}
+
+/* Resolve "@PATTERN" to the first matching playback device ("hw:C,D").
+ * Plain ALSA names are returned unchanged. Returns 0 on success. */
+static int resolve_device(const char *spec, char *out, size_t out_len) {
+    int card = -1;
+
+    if (spec[0] != '@') {
+        snprintf(out, out_len, "%s", spec);
+        return 0;
+    }
+
+    while (snd_card_next(&card) == 0 && card >= 0) {
+        char ctl_name[16];
+        snd_ctl_t *ctl;
+        snd_ctl_card_info_t *card_info;
+        snd_pcm_info_t *pcm_info;
+        int dev = -1;
+        int card_match;
+
+        snprintf(ctl_name, sizeof(ctl_name), "hw:%d", card);
+        if (snd_ctl_open(&ctl, ctl_name, 0) < 0) continue;
+
+        snd_ctl_card_info_alloca(&card_info);
+        snd_pcm_info_alloca(&pcm_info);
+        card_match = snd_ctl_card_info(ctl, card_info) == 0 &&
+                     (strcasestr(snd_ctl_card_info_get_id(card_info), spec + 1) ||
+                      strcasestr(snd_ctl_card_info_get_name(card_info), spec + 1));
+
+        while (snd_ctl_pcm_next_device(ctl, &dev) == 0 && dev >= 0) {
+            snd_pcm_info_set_device(pcm_info, (unsigned int)dev);
+            snd_pcm_info_set_subdevice(pcm_info, 0);
+            snd_pcm_info_set_stream(pcm_info, SND_PCM_STREAM_PLAYBACK);
+            if (snd_ctl_pcm_info(ctl, pcm_info) < 0) continue;
+
+            if (card_match || strcasestr(snd_pcm_info_get_id(pcm_info), spec + 1) ||
+                strcasestr(snd_pcm_info_get_name(pcm_info), spec + 1)) {
+                snprintf(out, out_len, "hw:%d,%d", card, dev);
+                snd_ctl_close(ctl);
+                return 0;
+            }
+        }
+        snd_ctl_close(ctl);
+    }
+    return -1;
+}
+
+/* Open and configure the device for a bridge. Returns 0 on success. */
+static int open_device(Bridge *b) {
+    static const snd_pcm_format_t formats[] = {
+        SND_PCM_FORMAT_FLOAT_LE, SND_PCM_FORMAT_S32_LE, SND_PCM_FORMAT_S16_LE
+    };
+    char pcm_name[64];
+    const char *spec = b->bluetooth ? b->device + 3 : b->device;
+    snd_pcm_hw_params_t *hw;
+    snd_pcm_sw_params_t *sw;
+    snd_pcm_uframes_t period = (snd_pcm_uframes_t)cfg_period;
+    unsigned int periods = (unsigned int)cfg_nperiods;
+    unsigned int rate = jack_rate;
+    size_t i;
+    int err;
+
+    if (resolve_device(spec, pcm_name, sizeof(pcm_name)) != 0) return -1;
+    if ((err = snd_pcm_open(&b->pcm, pcm_name, SND_PCM_STREAM_PLAYBACK, 0)) < 0) return -1;
+
+    snd_pcm_hw_params_alloca(&hw);
+    snd_pcm_hw_params_any(b->pcm, hw);
+    snd_pcm_hw_params_set_access(b->pcm, hw, SND_PCM_ACCESS_RW_INTERLEAVED);
+    for (i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        if (snd_pcm_hw_params_set_format(b->pcm, hw, formats[i]) == 0) break;
+    }
+    if (i == sizeof(formats) / sizeof(formats[0]) ||
+        snd_pcm_hw_params_set_channels(b->pcm, hw, BRIDGE_CHANNELS) < 0 ||
+        snd_pcm_hw_params_set_rate_near(b->pcm, hw, &rate, NULL) < 0 ||
+        snd_pcm_hw_params_set_period_size_near(b->pcm, hw, &period, NULL) < 0 ||
+        snd_pcm_hw_params_set_periods_near(b->pcm, hw, &periods, NULL) < 0 ||
+        (err = snd_pcm_hw_params(b->pcm, hw)) < 0) {
+        fprintf(stderr, "jack-bridge-host: %s: cannot configure %s\n", b->name, pcm_name);
+        snd_pcm_close(b->pcm);
+        b->pcm = NULL;
+        return -1;
+    }
+    b->format = formats[i];
+    snd_pcm_hw_params_get_period_size(hw, &b->period, NULL);
+    snd_pcm_hw_params_get_buffer_size(hw, &b->buffer);
+    b->rate = rate;
+
+    snd_pcm_sw_params_alloca(&sw);
+    snd_pcm_sw_params_current(b->pcm, sw);
+    snd_pcm_sw_params_set_start_threshold(b->pcm, sw, b->period);
+    snd_pcm_sw_params_set_avail_min(b->pcm, sw, b->period);
+    snd_pcm_sw_params(b->pcm, sw);
+
+    b->mix = calloc(b->period * BRIDGE_CHANNELS, sizeof(float));
+    b->out = calloc(b->period * BRIDGE_CHANNELS, sizeof(int32_t));
+    if (!b->mix || !b->out) {
+        free(b->mix);
+        free(b->out);
+        b->mix = NULL;
+        b->out = NULL;
+        snd_pcm_close(b->pcm);
+        b->pcm = NULL;
+        return -1;
+    }
+
+    memset(&b->rs, 0, sizeof(b->rs));
+    b->rs.nominal = (double)jack_rate / (double)b->rate;
+    b->rs.ratio = b->rs.nominal;
+
+    fprintf(stderr, "jack-bridge-host: %s: opened %s (%s, %u Hz, period %lu, buffer %lu)\n",
+            b->name, pcm_name, snd_pcm_format_name(b->format), b->rate,
+            (unsigned long)b->period, (unsigned long)b->buffer);
+    TRACE(TRACE_STAGE, TRACE_EV_BRIDGE_OPEN, b->rate, b->name);
+    return 0;
+}
+
+static void close_device(Bridge *b) {
+    atomic_store_explicit(&b->active, 0, memory_order_release);
+    if (b->pcm) {
+        snd_pcm_close(b->pcm);
+        b->pcm = NULL;
+    }
+    free(b->mix);
+    free(b->out);
+    b->mix = NULL;
+    b->out = NULL;
+}
+
+/* 4-point, 3rd-order Hermite interpolation */
+static float hermite(float xm1, float x0, float x1, float x2, float t) {
+    float c1 = 0.5f * (x1 - xm1);
+    float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+    float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+    return ((c3 * t + c2) * t + c1) * t + x0;
+}
+
+/* Produce one device period from the ring. Returns input frames consumed,
+ * or 0 if not enough input was buffered (caller pads with silence). */
+static size_t resample_period(Bridge *b, size_t avail) {
+    Resampler *rs = &b->rs;
+    size_t needed = (size_t)(rs->pos + (double)b->period * rs->ratio) + 1;
+    size_t consumed = 0;
+
+    if (avail < needed) return 0;
+
+    for (snd_pcm_uframes_t n = 0; n < b->period; n++) {
+        for (int c = 0; c < BRIDGE_CHANNELS; c++) {
+            b->mix[n * BRIDGE_CHANNELS + c] =
+                hermite(rs->hist[0][c], rs->hist[1][c], rs->hist[2][c], rs->hist[3][c], (float)rs->pos);
+        }
+        rs->pos += rs->ratio;
+        while (rs->pos >= 1.0 && consumed < avail) {
+            const float *in = ring_frame(&b->ring, consumed++);
+            memmove(rs->hist[0], rs->hist[1], sizeof(rs->hist[0]) * 3);
+            memcpy(rs->hist[3], in, sizeof(rs->hist[3]));
+            rs->pos -= 1.0;
+        }
+    }
+    return consumed;
+}
+
+/* Steer the ratio so the ring fill settles on its target (clock drift) */
+static void update_drift(Bridge *b, size_t fill, double target) {
+    Resampler *rs = &b->rs;
+    const DriftTuning *t = b->tuning;
+    double period = (double)atomic_load_explicit(&jack_period, memory_order_relaxed);
+    double err, correction;
+
+    rs->fill_avg += t->smoothing * ((double)fill - rs->fill_avg);
+    err = (rs->fill_avg - target) / period;
+
+    rs->integral += t->ki * err;
+    if (rs->integral > t->max_drift) rs->integral = t->max_drift;
+    if (rs->integral < -t->max_drift) rs->integral = -t->max_drift;
+
+    correction = t->kp * err + rs->integral;
+    if (correction > t->max_drift) correction = t->max_drift;
+    if (correction < -t->max_drift) correction = -t->max_drift;
+
+    /* More buffered than wanted: consume input faster */
+    rs->ratio = rs->nominal * (1.0 + correction);
+}
+
+/* Convert one period of float frames into the device format */
+static void convert_period(Bridge *b) {
+    size_t n = b->period * BRIDGE_CHANNELS;
+
+    if (b->format == SND_PCM_FORMAT_FLOAT_LE) {
+        memcpy(b->out, b->mix, n * sizeof(float));
+    } else if (b->format == SND_PCM_FORMAT_S32_LE) {
+        int32_t *o = b->out;
+        for (size_t i = 0; i < n; i++) {
+            float s = b->mix[i];
+            s = s > 1.0f ? 1.0f : (s < -1.0f ? -1.0f : s);
+            /* Largest float below 2^31: +1.0 must not overflow to INT32_MIN */
+            o[i] = (int32_t)(s * 2147483520.0f);
+        }
+    } else {
+        int16_t *o = b->out;
+        for (size_t i = 0; i < n; i++) {
+            float s = b->mix[i];
+            s = s > 1.0f ? 1.0f : (s < -1.0f ? -1.0f : s);
+            o[i] = (int16_t)(s * 32767.0f);
+        }
+    }
+}
+
+/* Write one period, recovering from xruns. Returns 0, or -1 if the device is gone. */
+static int write_period(Bridge *b) {
+    snd_pcm_sframes_t ret = snd_pcm_writei(b->pcm, b->out, b->period);
+
+    if (ret == -EPIPE || ret == -ESTRPIPE || ret == -EINTR) {
+        if (snd_pcm_recover(b->pcm, (int)ret, 1) < 0) return -1;
+        return 0;
+    }
+    return ret < 0 ? -1 : 0;
+}
+
+/* Prime the device with silence so the first real period does not underrun */
+static void prefill_silence(Bridge *b) {
+    memset(b->mix, 0, b->period * FRAME_BYTES);
+    convert_period(b);
+    for (snd_pcm_uframes_t done = b->period; done < b->buffer; done += b->period) {
+        if (write_period(b) < 0) break;
+    }
+}
+
+/* Trace the first period with signal after silence, with the device delay
+ * once it is queued (frames until its end plays): the end of an output switch */
+static void trace_audible(Bridge *b) {
+    size_t n = b->period * BRIDGE_CHANNELS;
+    int audible = 0;
+
+    for (size_t i = 0; i < n && !audible; i++) audible = b->mix[i] != 0.0f;
+    if (audible && !b->audible) {
+        snd_pcm_sframes_t delay = 0;
+
+        snd_pcm_delay(b->pcm, &delay);
+        TRACE(TRACE_STAGE, TRACE_EV_BRIDGE_AUDIO, delay, b->name);
+    }
+    b->audible = audible;
+}
+
+/* Writer thread: owns the device, consumes the ring at the device clock */
+static void *writer_thread(void *arg) {
+    Bridge *b = arg;
+
+    while (keep_running) {
+        double target;
+        int started = 0;
+
+        if (open_device(b) != 0) {
+            sleep_ms(REOPEN_DELAY_MS);
+            continue;
+        }
+
+        /* Start from an empty ring so latency does not include stale audio */
+        ring_discard(&b->ring);
+        b->audible = 0;
+        atomic_store_explicit(&b->active, 1, memory_order_release);
+
+        while (keep_running) {
+            size_t avail, consumed;
+
+            /* Keep one JACK period plus part of a device period buffered */
+            target = (double)atomic_load_explicit(&jack_period, memory_order_relaxed) +
+                     (double)b->period * b->rs.nominal * b->tuning->target_periods;
+
+            avail = ring_read_space(&b->ring);
+
+            if (!started) {
+                if (avail < (size_t)target) {
+                    sleep_ms(1);
+                    continue;
+                }
+                b->rs.fill_avg = (double)avail;
+                prefill_silence(b);
+                started = 1;
+            }
+
+            consumed = resample_period(b, avail);
+            if (consumed == 0) {
+                memset(b->mix, 0, b->period * FRAME_BYTES);
+                atomic_fetch_add_explicit(&b->underruns, 1, memory_order_relaxed);
+            } else {
+                ring_read_advance(&b->ring, consumed);
+            }
+            convert_period(b);
+
+            /* Blocks until the device has room: this paces the loop */
+            if (write_period(b) < 0) {
+                fprintf(stderr, "jack-bridge-host: %s: device lost, reopening\n", b->name);
+                break;
+            }
+            if (trace_level >= TRACE_STAGE) trace_audible(b); /* Skip the scan when off */
+
+            update_drift(b, ring_read_space(&b->ring), target);
+        }
+
+        close_device(b);
+    }
+    return NULL;
+}
+
+/* JACK process callback (RT): copy each bridge's ports into its ring. No locks, no allocation. */
+static int process_callback(jack_nframes_t nframes, void *arg) {
+    (void)arg;
+
+    for (int i = 0; i < n_bridges; i++) {
+        Bridge *b = &bridges[i];
+        const float *in[BRIDGE_CHANNELS];
+
+        if (!atomic_load_explicit(&b->active, memory_order_acquire)) continue;
+
+        for (int c = 0; c < BRIDGE_CHANNELS; c++) {
+            in[c] = jack_port_get_buffer(b->ports[c], nframes);
+        }
+        if (ring_write(&b->ring, in, nframes) != 0) {
+            atomic_fetch_add_explicit(&b->overruns, 1, memory_order_relaxed);
+        }
+    }
+    return 0;
+}
+
+/* Live buffer size changes only move the writers' fill target */
+static int buffer_size_callback(jack_nframes_t nframes, void *arg) {
+    (void)arg;
+    atomic_store_explicit(&jack_period, nframes, memory_order_relaxed);
+    return 0;
+}
+
+/* JACK shutdown callback */
+static void jack_shutdown_callback(void *arg) {
+    (void)arg;
+    fprintf(stderr, "jack-bridge-host: JACK server shutdown\n");
+    keep_running = 0;
+    wake_main_thread();
+}
+
+/* Register a bridge's ports: "<name>_playback_N" aliased to "<name>:playback_N" */
+static int register_bridge(Bridge *b) {
+    for (int c = 0; c < BRIDGE_CHANNELS; c++) {
+        char port_name[64], alias[96];
+
+        snprintf(port_name, sizeof(port_name), "%s_playback_%d", b->name, c + 1);
+        b->ports[c] = jack_port_register(client, port_name, JACK_DEFAULT_AUDIO_TYPE,
+                                         JackPortIsInput | JackPortIsTerminal, 0);
+        if (!b->ports[c]) {
+            fprintf(stderr, "jack-bridge-host: Cannot register port %s\n", port_name);
+            return -1;
+        }
+        snprintf(alias, sizeof(alias), "%s:playback_%d", b->name, c + 1);
+        jack_port_set_alias(b->ports[c], alias);
+    }
+
+    return ring_init(&b->ring);
+}
+
+/* Wired writers run just below the JACK RT thread when realtime is available.
+ * Bluetooth writers block on the BlueALSA socket and stay non-RT. */
+static void start_writer(Bridge *b) {
+    pthread_attr_t attr;
+    struct sched_param param;
+    int prio = b->bluetooth ? 0 : jack_client_real_time_priority(client);
+
+    pthread_attr_init(&attr);
+    if (prio > 1) {
+        param.sched_priority = prio - 1;
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+
+    if (pthread_create(&b->thread, &attr, writer_thread, b) != 0) {
+        /* No RT permission: fall back to a normal thread */
+        pthread_attr_destroy(&attr);
+        pthread_attr_init(&attr);
+        if (pthread_create(&b->thread, &attr, writer_thread, b) != 0) {
+            fprintf(stderr, "jack-bridge-host: %s: cannot start writer thread\n", b->name);
+            pthread_attr_destroy(&attr);
+            return;
+        }
+    }
+    pthread_attr_destroy(&attr);
+    b->thread_started = 1;
+}
+
+static void usage(void) {
+    fprintf(stderr, "Usage: jack-bridge-host [-c client] [-p period] [-n nperiods] NAME=DEVICE [NAME=DEVICE ...]\n"
+                    "  DEVICE is an ALSA name (hw:1,0), @PATTERN (first playback device matching)\n"
+                    "  or bt:PCM for a BlueALSA sink (bt:jackbridge_bluealsa)\n");
+}
+
+int main(int argc, char *argv[]) {
+    jack_status_t status;
+    struct pollfd pfd;
+    int opt;
+
+    load_jackd_config();
+
+    while ((opt = getopt(argc, argv, "c:p:n:h")) != -1) {
+        switch (opt) {
+        case 'c': client_name = optarg; break;
+        case 'p': cfg_period = atoi(optarg); break;
+        case 'n': cfg_nperiods = atoi(optarg); break;
+        default: usage(); return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (argc - optind > MAX_BRIDGES) {
+        fprintf(stderr, "jack-bridge-host: At most %d bridges per client (%d given)\n",
+                MAX_BRIDGES, argc - optind);
+        return 1;
+    }
+    for (int i = optind; i < argc; i++) {
+        const char *eq = strchr(argv[i], '=');
+        Bridge *b = &bridges[n_bridges];
+
+        if (!eq || eq == argv[i] || (size_t)(eq - argv[i]) >= sizeof(b->name)) {
+            usage();
+            return 1;
+        }
+        memcpy(b->name, argv[i], (size_t)(eq - argv[i]));
+        snprintf(b->device, sizeof(b->device), "%s", eq + 1);
+        b->bluetooth = strncmp(b->device, "bt:", 3) == 0;
+        b->tuning = b->bluetooth ? &bluetooth_tuning : &wired_tuning;
+        n_bridges++;
+    }
+    if (n_bridges == 0 || cfg_period <= 0 || cfg_nperiods < 2) {
+        usage();
+        return 1;
+    }
+
+    wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wake_fd < 0) {
+        fprintf(stderr, "jack-bridge-host: Failed to create eventfd: %s\n", strerror(errno));
+        return 1;
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    trace_init("bridge");
+
+    client = jack_client_open(client_name, JackNoStartServer, &status);
+    if (!client) {
+        fprintf(stderr, "jack-bridge-host: Failed to connect to JACK server\n");
+        close(wake_fd);
+        return 1;
+    }
+    jack_rate = jack_get_sample_rate(client);
+    atomic_store(&jack_period, jack_get_buffer_size(client));
+
+    for (int i = 0; i < n_bridges; i++) {
+        if (register_bridge(&bridges[i]) != 0) {
+            jack_client_close(client);
+            close(wake_fd);
+            return 1;
+        }
+    }
+
+    jack_set_process_callback(client, process_callback, NULL);
+    jack_set_buffer_size_callback(client, buffer_size_callback, NULL);
+    jack_on_shutdown(client, jack_shutdown_callback, NULL);
+
+    if (jack_activate(client)) {
+        fprintf(stderr, "jack-bridge-host: Cannot activate JACK client\n");
+        jack_client_close(client);
+        close(wake_fd);
+        return 1;
+    }
+
+    for (int i = 0; i < n_bridges; i++) {
+        start_writer(&bridges[i]);
+    }
+
+    fprintf(stderr, "jack-bridge-host: Running %d bridge(s), ALSA period %d x %d, JACK %u Hz\n",
+            n_bridges, cfg_period, cfg_nperiods, jack_rate);
+
+    /* Main thread only waits for shutdown */
+    pfd.fd = wake_fd;
+    pfd.events = POLLIN;
+    while (keep_running) {
+        if (poll(&pfd, 1, -1) < 0 && errno != EINTR) break;
+    }
+
+    /* Clean shutdown */
+    fprintf(stderr, "jack-bridge-host: Shutting down\n");
+    keep_running = 0;
+    jack_deactivate(client);
+    for (int i = 0; i < n_bridges; i++) {
+        Bridge *b = &bridges[i];
+
+        if (b->thread_started) pthread_join(b->thread, NULL);
+        fprintf(stderr, "jack-bridge-host: %s: %u overruns, %u underruns\n", b->name,
+                atomic_load(&b->overruns), atomic_load(&b->underruns));
+        ring_free(&b->ring);
+    }
+    jack_client_close(client);
+    close(wake_fd);
+    trace_shutdown();
+
+    return 0;
+}
@@ -0,0 +1,1047 @@
+/*
+ * jack_bridge_route.c
+ * Output selection shared by mxeq, jack-connection-manager and jack-bridge-dbus
+ *
+ * In-process replacement for the jack-route-select helper script. A request
+ * is handled on a routing thread so callers never block: config fragments are
+ * written with write-then-rename, on-demand bridge clients are started or
+ * stopped, and PREFERRED_OUTPUT is stored in the user devices.conf. The
+ * connection manager watches that file (inotify) and moves every source to
+ * the new sink in-process, so nothing here touches connections.
+ *
+ * Completion is event-driven: a short-lived JACK client waits on port
+ * registration callbacks until the target's playback_1 port exists (bridge
+ * host ports match through their usb_out:/hdmi_out:/bluealsa: aliases).
+ * The only timeouts are upper bounds on those waits.
+ *
+ * When selecting for another user (jack-bridge-dbus runs as root), every read,
+ * write and mkdir under that user's home runs in a forked child that has
+ * switched to the user's groups, gid and uid, so links planted there cannot
+ * reach files the user could not reach anyway.
+ *
+ * Plain C and POSIX (no GLib) so the connection manager can link it too.
+ */
+
+#define _GNU_SOURCE /* execvpe(), setgroups(), getgrouplist() */
+
+#include "jack_bridge_route.h"
+#include "jack_bridge_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <signal.h>
+#include <grp.h>
+#include <pwd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <jack/jack.h>
+
+#define CONF_DIR ".config/jack-bridge"
+#define SYS_CONF_PATH "/etc/jack-bridge/devices.conf"
+#define CLIENT_NAME "jack_bridge_route"
+#define DEFAULT_BRIDGE_HOST_BIN "/usr/local/bin/jack-bridge-host"
+#define LOG_DIR_FMT "/tmp/jack-bridge-%u" /* Per user, 0700, shared with the control socket */
+#define PORT_TIMEOUT_MS 5000        /* Upper bound for a bridge to register its ports */
+#define EXIT_TIMEOUT_MS 2000        /* Upper bound for a stopped bridge to go away */
+#define EXIT_POLL_MS 20
+#define MAX_PIDS 16
+#define MAX_GROUPS 64
+#define PATH_MAX_LEN 512
+#define LINE_MAX_LEN 512
+#define BT_DEVICE_LEN 128
+#define ANY_OWNER ((uid_t)-1)   /* find_processes(): whoever runs it */
+
+const RouteTarget route_targets[] = {
+    { "internal", "system:playback_" },
+    { "usb", "usb_out:playback_" },
+    { "hdmi", "hdmi_out:playback_" },
+    { "bluetooth", "bluealsa:playback_" },
+};
+const int route_n_targets = (int)(sizeof(route_targets) / sizeof(route_targets[0]));
+
+/* Settings read from devices.conf (system, then user overrides) */
+typedef struct {
+    char internal_device[64];
+    char usb_device[64];
+    char hdmi_device[64];
+    char bridge_host_bin[256];
+    int bridge_host;
+    int bt_period;
+    int bt_nperiods;
+} RouteConf;
+
+typedef struct {
+    const RouteTarget *target;
+    char bt_mac[18];            /* Validated MAC, empty for most-recent device */
+    char bt_device[BT_DEVICE_LEN];  /* As given, stored as BLUETOOTH_DEVICE */
+    char home[PATH_MAX_LEN];
+    char conf_dir[PATH_MAX_LEN];
+    uid_t uid;
+    gid_t gid;
+    int switch_user;            /* Spawn bridges as uid/gid */
+    gid_t groups[MAX_GROUPS];
+    int n_groups;
+    RouteConf conf;
+    RouteDoneFunc done;
+    void *user_data;
+    char message[256];
+
+    /* Port registration wakeups (JACK notification thread -> routing thread) */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int ports_changed;
+} RouteJob;
+
+/* Requests run one at a time so overlapping selections cannot interleave */
+static pthread_mutex_t route_lock = PTHREAD_MUTEX_INITIALIZER;
+
+const RouteTarget *route_find_target(const char *name) {
+    if (!name) return NULL;
+    for (int i = 0; i < route_n_targets; i++) {
+        if (strcmp(route_targets[i].name, name) == 0) return &route_targets[i];
+    }
+    return NULL;
+}
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+static int is_mac(const char *s) {
+    for (int i = 0; i < 17; i++) {
+        char c = s[i];
+        if (i % 3 == 2) {
+            if (c != ':') return 0;
+        } else if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))) {
+            return 0;
+        }
+    }
+    return s[17] == '\0';
+}
+
+/* Plain BlueALSA PCM name. BLUETOOTH_DEVICE ends up in a devices.conf that
+ * jack-bridge-ports sources as root, so nothing a shell could act on. */
+static int is_pcm_name(const char *s) {
+    size_t len = strlen(s);
+
+    if (len == 0 || len >= BT_DEVICE_LEN) return 0;
+    return strspn(s, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_.:-") == len;
+}
+
+/* Shell-style value: strip quotes and trailing whitespace */
+static char *conf_value(char *val) {
+    char *end;
+
+    while (*val == ' ' || *val == '\t' || *val == '"' || *val == '\'') val++;
+    end = val + strlen(val);
+    while (end > val && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' ||
+                         end[-1] == '\t' || end[-1] == '"' || end[-1] == '\'')) end--;
+    *end = '\0';
+    return val;
+}
+
+static void parse_conf(char *text, RouteConf *conf) {
+    char *line = text;
+
+    while (line && *line) {
+        char *nl = strchr(line, '\n');
+        char *eq;
+        char *val;
+
+        if (nl) *nl++ = '\0';
+        eq = strchr(line, '=');
+        if (!eq || line[0] == '#') {
+            line = nl;
+            continue;
+        }
+        *eq = '\0';
+        val = conf_value(eq + 1);
+        if (strcmp(line, "INTERNAL_DEVICE") == 0) {
+            snprintf(conf->internal_device, sizeof(conf->internal_device), "%s", val);
+        } else if (strcmp(line, "USB_DEVICE") == 0) {
+            snprintf(conf->usb_device, sizeof(conf->usb_device), "%s", val);
+        } else if (strcmp(line, "HDMI_DEVICE") == 0) {
+            snprintf(conf->hdmi_device, sizeof(conf->hdmi_device), "%s", val);
+        } else if (strcmp(line, "BRIDGE_HOST_BIN") == 0) {
+            snprintf(conf->bridge_host_bin, sizeof(conf->bridge_host_bin), "%s", val);
+        } else if (strcmp(line, "BRIDGE_HOST") == 0) {
+            conf->bridge_host = strcmp(val, "0") != 0;
+        } else if (strcmp(line, "BT_PERIOD") == 0) {
+            if (atoi(val) > 0) conf->bt_period = atoi(val);
+        } else if (strcmp(line, "BT_NPERIODS") == 0) {
+            if (atoi(val) > 0) conf->bt_nperiods = atoi(val);
+        }
+        line = nl;
+    }
+}
+
+/* ---- Files in the user's home ---- */
+
+typedef enum { USER_READ, USER_WRITE, USER_MKDIR } UserOpKind;
+
+/* One file operation, filled in by the parent: the child may only make
+ * async-signal-safe calls, so every string is ready-made */
+typedef struct {
+    UserOpKind kind;
+    const char *path;
+    const char *tmp;            /* USER_WRITE: written first, then renamed over path */
+    const char *content;        /* USER_WRITE */
+    int fd;                     /* USER_READ: the file is copied to this descriptor */
+} UserOp;
+
+static int write_all(int fd, const char *buf, size_t left) {
+    while (left > 0) {
+        ssize_t ret = write(fd, buf, left);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += ret;
+        left -= (size_t)ret;
+    }
+    return 0;
+}
+
+/* Returns 0 or an errno value. Async-signal-safe. */
+static int user_op_run(const UserOp *op) {
+    char buf[4096];
+    ssize_t got;
+    int fd;
+    int err;
+
+    switch (op->kind) {
+    case USER_MKDIR:
+        return mkdir(op->path, 0755) == 0 || errno == EEXIST ? 0 : errno;
+    case USER_WRITE:
+        /* Always a fresh file, never one reached through a link */
+        if (unlink(op->tmp) != 0 && errno != ENOENT) return errno;
+        fd = open(op->tmp, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0644);
+        if (fd < 0) return errno;
+        if (write_all(fd, op->content, strlen(op->content)) != 0) {
+            err = errno;
+            close(fd);
+            unlink(op->tmp);
+            return err;
+        }
+        if (close(fd) != 0 || rename(op->tmp, op->path) != 0) {
+            err = errno;
+            unlink(op->tmp);
+            return err;
+        }
+        return 0;
+    case USER_READ:
+        fd = open(op->path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return errno;
+        while ((got = read(fd, buf, sizeof(buf))) != 0) {
+            if (got < 0 && errno == EINTR) continue;
+            if (got < 0 || write_all(op->fd, buf, (size_t)got) != 0) break;
+        }
+        err = got == 0 ? 0 : errno;
+        close(fd);
+        return err;
+    }
+    return EINVAL;
+}
+
+/* fork() whose child already runs with the job's groups, gid and uid */
+static pid_t fork_as_user(const RouteJob *job) {
+    pid_t pid = fork();
+
+    if (pid == 0 && (setgroups((size_t)job->n_groups, job->groups) != 0 ||
+                     setgid(job->gid) != 0 || setuid(job->uid) != 0)) {
+        _exit(EPERM);
+    }
+    return pid;
+}
+
+/* Exit status of a fork_as_user() child: 0 or an errno value */
+static int child_result(pid_t pid) {
+    int status;
+
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) return ECHILD;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : EIO;
+}
+
+/* Run op as the job's user: in a child when selecting for another user,
+ * right here otherwise. Returns 0, or -1 with errno set. */
+static int user_op(const RouteJob *job, const UserOp *op) {
+    int err;
+
+    if (!job->switch_user) {
+        err = user_op_run(op);
+    } else {
+        pid_t pid = fork_as_user(job);
+
+        if (pid < 0) return -1;
+        if (pid == 0) _exit(user_op_run(op));
+        err = child_result(pid);
+    }
+    if (err != 0) {
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+/* Write content to path via path.tmp + rename(), as the job's user, who
+ * therefore owns the result */
+static int write_atomic(RouteJob *job, const char *path, const char *content) {
+    char tmp[PATH_MAX_LEN + 8];
+    UserOp op = { USER_WRITE, path, tmp, content, -1 };
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    return user_op(job, &op);
+}
+
+/* Both levels are created as the user, so both are owned by them */
+static int ensure_conf_dir(RouteJob *job) {
+    char parent[PATH_MAX_LEN + 16];
+    UserOp op = { USER_MKDIR, parent, NULL, NULL, -1 };
+
+    snprintf(parent, sizeof(parent), "%s/.config", job->home);
+    if (user_op(job, &op) != 0) return -1;
+    op.path = job->conf_dir;
+    return user_op(job, &op);
+}
+
+/* Everything up to EOF on fd as a NUL-terminated string; free() it */
+static char *read_all(int fd) {
+    size_t cap = 4096, len = 0;
+    char *buf = malloc(cap);
+
+    while (buf) {
+        ssize_t got;
+
+        if (len + 1 == cap) {
+            char *grown = realloc(buf, cap * 2);
+            if (!grown) break;
+            buf = grown;
+            cap *= 2;
+        }
+        got = read(fd, buf + len, cap - len - 1);
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0) break;
+        if (got == 0) {
+            buf[len] = '\0';
+            return buf;
+        }
+        len += (size_t)got;
+    }
+    free(buf);
+    return NULL;
+}
+
+/* Whole file as a NUL-terminated string, empty if it does not exist, or
+ * NULL if it cannot be read; free() it */
+static char *read_path(const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    char *buf;
+
+    if (fd < 0) return errno == ENOENT ? strdup("") : NULL;
+    buf = read_all(fd);
+    close(fd);
+    return buf;
+}
+
+/* Same for a file in the user's home, read as the job's user. NULL (not
+ * empty) for files that exist but cannot be read, so callers never replace
+ * a file they could not see. */
+static char *read_file(RouteJob *job, const char *path) {
+    UserOp op = { USER_READ, path, NULL, NULL, -1 };
+    char *buf;
+    pid_t pid;
+    int fds[2];
+    int err;
+
+    if (!job->switch_user) return read_path(path);
+
+    if (pipe(fds) != 0) return NULL;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    op.fd = fds[1];
+
+    pid = fork_as_user(job);
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return NULL;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        _exit(user_op_run(&op));
+    }
+
+    /* Drained while the child writes, so any size fits through the pipe */
+    close(fds[1]);
+    buf = read_all(fds[0]);
+    close(fds[0]);
+    err = child_result(pid);
+    if (err == ENOENT) {
+        free(buf);
+        return strdup("");
+    }
+    if (err != 0) {
+        free(buf);
+        errno = err;
+        return NULL;
+    }
+    return buf;
+}
+
+static void load_conf(RouteJob *job) {
+    char path[PATH_MAX_LEN + 32];
+    RouteConf *conf = &job->conf;
+    char *text;
+
+    memset(conf, 0, sizeof(*conf));
+    snprintf(conf->internal_device, sizeof(conf->internal_device), "hw:0");
+    snprintf(conf->usb_device, sizeof(conf->usb_device), "plughw:1,0");
+    snprintf(conf->hdmi_device, sizeof(conf->hdmi_device), "plughw:2,0");
+    snprintf(conf->bridge_host_bin, sizeof(conf->bridge_host_bin), "%s", DEFAULT_BRIDGE_HOST_BIN);
+    conf->bridge_host = 1;
+    conf->bt_period = 256;
+    conf->bt_nperiods = 3;
+
+    text = read_path(SYS_CONF_PATH);
+    if (text) parse_conf(text, conf);
+    free(text);
+    snprintf(path, sizeof(path), "%s/devices.conf", job->conf_dir);
+    text = read_file(job, path);
+    if (text) parse_conf(text, conf);
+    free(text);
+}
+
+/* Set KEY=value in the user devices.conf, keeping every other line */
+static int save_user_keys(RouteJob *job, const char *const *keys, const char *const *values, int n) {
+    char path[PATH_MAX_LEN + 32];
+    char *old, *out, *line;
+    size_t cap, len = 0;
+    int rc;
+
+    snprintf(path, sizeof(path), "%s/devices.conf", job->conf_dir);
+    old = read_file(job, path);
+    if (!old) return -1;
+
+    cap = strlen(old) + 1024;
+    out = malloc(cap);
+    if (!out) {
+        free(old);
+        return -1;
+    }
+    out[0] = '\0';
+
+    for (line = old; *line; ) {
+        char *nl = strchr(line, '\n');
+        size_t line_len = nl ? (size_t)(nl - line) + 1 : strlen(line);
+        int replaced = 0;
+
+        for (int k = 0; k < n; k++) {
+            size_t klen = strlen(keys[k]);
+            if (strncmp(line, keys[k], klen) == 0 && line[klen] == '=') replaced = 1;
+        }
+        if (!replaced) {
+            memcpy(out + len, line, line_len);
+            len += line_len;
+            if (line[line_len - 1] != '\n') out[len++] = '\n';
+        }
+        line += line_len;
+    }
+    for (int k = 0; k < n; k++) {
+        len += (size_t)snprintf(out + len, cap - len, "%s=%s\n", keys[k], values[k]);
+    }
+    out[len] = '\0';
+
+    rc = write_atomic(job, path, out);
+    free(out);
+    free(old);
+    return rc;
+}
+
+/* BlueALSA defaults for the parameterless 'jackbridge_bluealsa' PCM */
+static int write_bluealsa_defaults(RouteJob *job) {
+    char path[PATH_MAX_LEN + 32];
+    char content[512];
+
+    snprintf(path, sizeof(path), "%s/bluealsa_defaults.conf", job->conf_dir);
+    snprintf(content, sizeof(content),
+             "# Managed by jack-bridge — BlueALSA defaults for parameterless 'jackbridge_bluealsa' PCM\n"
+             "# These match the @args names in 20-jack-bridge-bluealsa.conf\n"
+             "defaults.jackbridge_bluealsa.DEV \"%s\"\n"
+             "defaults.jackbridge_bluealsa.PROFILE \"a2dp\"\n"
+             "defaults.jackbridge_bluealsa.SRV \"org.bluealsa\"\n",
+             job->bt_mac[0] ? job->bt_mac : "00:00:00:00:00:00");
+    return write_atomic(job, path, content);
+}
+
+/* current_output.conf plus the managed include block in ~/.asoundrc,
+ * preserving everything outside the markers */
+static int write_output_conf(RouteJob *job, const char *pcm) {
+    char out_path[PATH_MAX_LEN + 32], asoundrc[PATH_MAX_LEN + 16];
+    char content[512];
+    char *old, *out, *begin, *end;
+    size_t cap, len;
+    int rc;
+
+    snprintf(out_path, sizeof(out_path), "%s/current_output.conf", job->conf_dir);
+    snprintf(content, sizeof(content),
+             "# Managed user output fragment for jack-bridge\n"
+             "pcm.current_output {\n"
+             "    type plug\n"
+             "    slave.pcm \"%s\"\n"
+             "}\n", pcm);
+    if (write_atomic(job, out_path, content) != 0) return -1;
+
+    snprintf(asoundrc, sizeof(asoundrc), "%s/.asoundrc", job->home);
+    old = read_file(job, asoundrc);
+    if (!old) return -1;
+
+    /* Drop the old managed block (and the blank line in front of it) */
+    begin = strstr(old, "# BEGIN jack-bridge");
+    end = begin ? strstr(begin, "# END jack-bridge") : NULL;
+    if (begin && end) {
+        end += strlen("# END jack-bridge");
+        while (*end == '\n' || *end == '\r') end++;
+        while (begin > old && (begin[-1] == '\n' || begin[-1] == '\r')) begin--;
+        memmove(begin, end, strlen(end) + 1);
+    }
+
+    cap = strlen(old) + 3 * PATH_MAX_LEN + 512;
+    out = malloc(cap);
+    if (!out) {
+        free(old);
+        return -1;
+    }
+    len = (size_t)snprintf(out, cap, "%s", old);
+    if (len > 0 && out[len - 1] != '\n') out[len++] = '\n';
+    snprintf(out + len, cap - len,
+             "\n"
+             "# BEGIN jack-bridge\n"
+             "# Managed by jack-bridge — include per-user current_input.conf, bluealsa defaults and current_output.conf\n"
+             "# Note: Playback routing is managed system-wide via /usr/share/alsa/alsa.conf.d/50-jack.conf\n"
+             "include \"%s/current_input.conf\"\n"
+             "include \"%s/bluealsa_defaults.conf\"\n"
+             "include \"%s\"\n"
+             "# END jack-bridge\n",
+             job->conf_dir, job->conf_dir, out_path);
+
+    rc = write_atomic(job, asoundrc, out);
+    free(out);
+    free(old);
+    return rc;
+}
+
+/* ---- ALSA device lookup (proc files, so the manager needs no libasound) ---- */
+
+/* First card whose /proc/asound/cards line contains needle, or -1 */
+static int card_matching(const char *needle) {
+    FILE *f = fopen("/proc/asound/cards", "r");
+    char line[LINE_MAX_LEN];
+    int card = -1;
+
+    if (!f) return -1;
+    while (fgets(line, sizeof(line), f)) {
+        int n;
+        if (strstr(line, needle) && sscanf(line, " %d", &n) == 1) {
+            card = n;
+            break;
+        }
+    }
+    fclose(f);
+    return card;
+}
+
+/* First playback PCM as "card,device": on card (>= 0), or whose name contains
+ * needle (card < 0). Returns 0 if found. */
+static int find_playback_pcm(int card, const char *needle, int *out_card, int *out_dev) {
+    FILE *f = fopen("/proc/asound/pcm", "r");
+    char line[LINE_MAX_LEN];
+    int found = -1;
+
+    if (!f) return -1;
+    /* Lines look like "00-03: HDMI 0 : HDMI 0 : playback 1" */
+    while (fgets(line, sizeof(line), f)) {
+        int c, d;
+        if (sscanf(line, "%d-%d:", &c, &d) != 2 || !strstr(line, "playback")) continue;
+        if ((card >= 0 && c == card) || (card < 0 && needle && strstr(line, needle))) {
+            *out_card = c;
+            *out_dev = d;
+            found = 0;
+            break;
+        }
+    }
+    fclose(f);
+    return found;
+}
+
+/* ALSA device of the output for non-JACK apps (plughw) or for a bridge (hw).
+ * Returns 0 if the hardware is present. */
+static int output_hw(const RouteJob *job, const char *kind, char *buf, size_t size) {
+    int card = -1, dev = 0;
+    int present;
+
+    if (strcmp(job->target->name, "usb") == 0) {
+        int usb = card_matching("USB");
+        present = usb >= 0 && find_playback_pcm(usb, NULL, &card, &dev) == 0;
+        if (!present && usb >= 0) {
+            card = usb;
+            present = 1;
+        }
+    } else {
+        present = find_playback_pcm(-1, "HDMI", &card, &dev) == 0;
+    }
+    if (!present) return -1;
+
+    if (dev == 0 && strcmp(kind, "hw") == 0) snprintf(buf, size, "hw:%d", card);
+    else snprintf(buf, size, "%s:%d,%d", kind, card, dev);
+    return 0;
+}
+
+/* ---- Bridge processes ---- */
+
+/* Whether a NUL-separated command line runs prog (argv[0] is prog or ends in
+ * "/prog") with the argument pair "opt value", or with opt NULL, an argument
+ * starting with value */
+static int cmdline_matches(const char *cmd, size_t len, const char *prog,
+                           const char *opt, const char *value) {
+    const char *end = cmd + len;
+    const char *arg = cmd;
+    const char *base = strrchr(cmd, '/');
+
+    if (strcmp(base ? base + 1 : cmd, prog) != 0) return 0;
+    for (arg += strlen(arg) + 1; arg < end; arg += strlen(arg) + 1) {
+        if (!opt) {
+            if (strncmp(arg, value, strlen(value)) == 0) return 1;
+        } else if (strcmp(arg, opt) == 0) {
+            const char *next = arg + strlen(arg) + 1;
+            if (next < end && strcmp(next, value) == 0) return 1;
+        }
+    }
+    return 0;
+}
+
+/* Processes of owner (ANY_OWNER: anyone's), other than us, that match
+ * cmdline_matches(). Returns the number found, PIDs in pids. */
+static int find_processes(uid_t owner, const char *prog, const char *opt, const char *value,
+                          pid_t *pids, int max) {
+    DIR *proc = opendir("/proc");
+    struct dirent *de;
+    int n = 0;
+
+    if (!proc) return 0;
+    while ((de = readdir(proc)) != NULL && n < max) {
+        char path[64], cmd[1024];
+        pid_t pid = (pid_t)atoi(de->d_name);
+        struct stat st;
+        ssize_t len;
+        int dir_fd, fd;
+
+        if (pid <= 0 || pid == getpid()) continue;
+        snprintf(path, sizeof(path), "/proc/%d", (int)pid);
+        /* Owner and command line from the same /proc entry, even if the PID is reused */
+        dir_fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dir_fd < 0) continue;
+        if (fstat(dir_fd, &st) != 0 || (owner != ANY_OWNER && st.st_uid != owner)) {
+            close(dir_fd);
+            continue;
+        }
+        fd = openat(dir_fd, "cmdline", O_RDONLY | O_CLOEXEC);
+        close(dir_fd);
+        if (fd < 0) continue;
+        len = read(fd, cmd, sizeof(cmd) - 1);
+        close(fd);
+        if (len <= 0) continue;
+        cmd[len] = '\0';
+        if (cmdline_matches(cmd, (size_t)len, prog, opt, value)) pids[n++] = pid;
+    }
+    closedir(proc);
+    return n;
+}
+
+/* TERM the job user's matching bridges and wait (bounded) until they are
+ * gone, so a new bridge does not collide with the old client name or device.
+ * Bridges are started by whichever process handled the last selection
+ * (mxeq, the manager or the D-Bus service), so there is no PID list to keep:
+ * matching is by owner and exact program and argument instead. */
+static void stop_processes(const RouteJob *job, const char *prog, const char *opt, const char *value) {
+    pid_t pids[MAX_PIDS];
+    int n = find_processes(job->uid, prog, opt, value, pids, MAX_PIDS);
+    uint64_t deadline = now_ms() + EXIT_TIMEOUT_MS;
+
+    if (n == 0) return;
+    fprintf(stderr, "jack-bridge-route: Stopping %s %s %s\n", prog, opt, value);
+    for (int i = 0; i < n; i++) kill(pids[i], SIGTERM);
+
+    for (int i = 0; i < n; i++) {
+        while (kill(pids[i], 0) == 0 && now_ms() < deadline) {
+            struct timespec ts = { 0, EXIT_POLL_MS * 1000000L };
+            nanosleep(&ts, NULL);
+        }
+    }
+}
+
+/* Start a bridge detached from the caller (double fork, own session), output
+ * appended to LOG_DIR_FMT/jack-route-select-<log>.log, as the job's user.
+ * The log is opened only after the switch to the user, and only inside a
+ * directory that is the user's alone; otherwise output goes to /dev/null. */
+static int spawn_bridge(RouteJob *job, const char *log, char *const argv[]) {
+    char log_dir[64], log_name[64], log_path[128], home_env[PATH_MAX_LEN + 8];
+    char *user_env[8];
+    char **envp = environ;
+    int n_env = 0;
+    pid_t pid;
+    int status;
+
+    snprintf(log_dir, sizeof(log_dir), LOG_DIR_FMT, (unsigned)job->uid);
+    snprintf(log_name, sizeof(log_name), "jack-route-select-%s.log", log);
+    snprintf(log_path, sizeof(log_path), "%s/%s", log_dir, log_name);
+    if (job->switch_user) {
+        /* Minimal environment for the target user; JACK server selection is kept */
+        static const char *keep[] = { "JACK_DEFAULT_SERVER", "JACK_PROMISCUOUS_SERVER", "LANG" };
+        snprintf(home_env, sizeof(home_env), "HOME=%s", job->home);
+        user_env[n_env++] = home_env;
+        user_env[n_env++] = "PATH=/usr/local/bin:/usr/bin:/bin";
+        for (size_t i = 0; i < sizeof(keep) / sizeof(keep[0]); i++) {
+            for (char **e = environ; *e; e++) {
+                size_t klen = strlen(keep[i]);
+                if (strncmp(*e, keep[i], klen) == 0 && (*e)[klen] == '=') user_env[n_env++] = *e;
+            }
+        }
+        user_env[n_env] = NULL;
+        envp = user_env;
+    }
+
+    fprintf(stderr, "jack-bridge-route: Starting %s (log %s)\n", argv[0], log_path);
+    pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        /* Only async-signal-safe calls from here on: the caller may be multi-threaded */
+        struct stat st;
+        int fd, dir_fd, log_fd = -1;
+
+        if (fork() != 0) _exit(0);
+        setsid();
+        if (job->switch_user &&
+            (setgroups((size_t)job->n_groups, job->groups) != 0 ||
+             setgid(job->gid) != 0 || setuid(job->uid) != 0)) {
+            _exit(127);
+        }
+        fd = open("/dev/null", O_RDONLY);
+        if (fd >= 0) dup2(fd, STDIN_FILENO);
+        if (mkdir(log_dir, 0700) == 0 || errno == EEXIST) {
+            dir_fd = open(log_dir, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (dir_fd >= 0) {
+                if (fstat(dir_fd, &st) == 0 && st.st_uid == job->uid && !(st.st_mode & 077)) {
+                    log_fd = openat(dir_fd, log_name, O_WRONLY | O_CREAT | O_APPEND | O_NOFOLLOW | O_CLOEXEC, 0600);
+                }
+                close(dir_fd);
+            }
+        }
+        if (log_fd < 0) log_fd = open("/dev/null", O_WRONLY);
+        if (log_fd >= 0) {
+            dup2(log_fd, STDOUT_FILENO);
+            dup2(log_fd, STDERR_FILENO);
+        }
+        if (chdir(job->home) != 0 && chdir("/") != 0) _exit(127);
+        execvpe(argv[0], argv, envp);
+        _exit(127);
+    }
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    return 0;
+}
+
+static int bridge_host_usable(const RouteJob *job) {
+    return job->conf.bridge_host && access(job->conf.bridge_host_bin, X_OK) == 0;
+}
+
+/* jack-bridge-host started by jack-bridge-ports keeps usb_out/hdmi_out
+ * registered and reopens the devices on hotplug: nothing to start then */
+static int bridge_host_serves(const char *name) {
+    pid_t pid;
+    char arg[32];
+
+    snprintf(arg, sizeof(arg), "%s=", name);
+    return find_processes(ANY_OWNER, "jack-bridge-host", NULL, arg, &pid, 1) > 0;
+}
+
+static void start_alsa_bridge(RouteJob *job, const char *prog, const char *client,
+                              const char *device, jack_nframes_t rate, const char *log) {
+    char rate_arg[16];
+    char *argv[] = { (char *)prog, "-j", (char *)client, "-d", (char *)device,
+                     "-r", rate_arg, "-p", "256", "-n", "3", NULL };
+
+    stop_processes(job, prog, "-j", client);
+    snprintf(rate_arg, sizeof(rate_arg), "%u", (unsigned)rate);
+    spawn_bridge(job, log, argv);
+}
+
+static void start_bt_bridge(RouteJob *job, jack_nframes_t rate) {
+    char period[16], nperiods[16], rate_arg[16];
+
+    snprintf(period, sizeof(period), "%d", job->conf.bt_period);
+    snprintf(nperiods, sizeof(nperiods), "%d", job->conf.bt_nperiods);
+
+    /* Preferred: bridge host with the Bluetooth writer path */
+    if (bridge_host_usable(job)) {
+        char *argv[] = { job->conf.bridge_host_bin, "-c", "jack_bridge_bt", "-p", period,
+                         "-n", nperiods, "bluealsa=bt:jackbridge_bluealsa", NULL };
+        spawn_bridge(job, "bluealsa", argv);
+    } else {
+        char *argv[] = { "alsa_out", "-j", "bluealsa", "-d", "jackbridge_bluealsa",
+                         "-r", rate_arg, "-p", period, "-n", nperiods, NULL };
+        snprintf(rate_arg, sizeof(rate_arg), "%u", (unsigned)rate);
+        spawn_bridge(job, "bluealsa", argv);
+    }
+}
+
+/* Start the clients the target needs and stop the on-demand ones it does not */
+static void update_bridges(RouteJob *job, jack_nframes_t rate) {
+    const char *name = job->target->name;
+    char hw[64];
+
+    /* Bluetooth bridges are always restarted: the device may have changed */
+    stop_processes(job, "alsa_out", "-j", "bluealsa");
+    stop_processes(job, "jack-bridge-host", "-c", "jack_bridge_bt");
+    if (strcmp(name, "usb") != 0) stop_processes(job, "alsa_in", "-j", "usb_in");
+
+    if (strcmp(name, "usb") == 0 || strcmp(name, "hdmi") == 0) {
+        const char *client = strcmp(name, "usb") == 0 ? "usb_out" : "hdmi_out";
+
+        if (!bridge_host_serves(client)) {
+            /* Placeholder devices keep the ports registered until hardware shows up */
+            if (output_hw(job, "hw", hw, sizeof(hw)) != 0) {
+                snprintf(hw, sizeof(hw), "%s", strcmp(name, "usb") == 0 ? "hw:99" : "hw:98");
+            }
+            start_alsa_bridge(job, "alsa_out", client, hw, rate, strcmp(name, "usb") == 0 ? "usb-out" : "hdmi-out");
+        }
+        if (strcmp(name, "usb") == 0) {
+            /* USB capture ports for manual connection (qjackctl) */
+            int card = card_matching("USB");
+            snprintf(hw, sizeof(hw), "hw:%d", card >= 0 ? card : 1);
+            start_alsa_bridge(job, "alsa_in", "usb_in", hw, rate, "usb-in");
+        }
+    } else if (strcmp(name, "bluetooth") == 0) {
+        start_bt_bridge(job, rate);
+    }
+}
+
+/* ---- Completion ---- */
+
+/* JACK notification thread */
+static void port_registration_callback(jack_port_id_t port, int registered, void *arg) {
+    RouteJob *job = arg;
+    (void)port;
+    (void)registered;
+
+    pthread_mutex_lock(&job->lock);
+    job->ports_changed = 1;
+    pthread_cond_signal(&job->cond);
+    pthread_mutex_unlock(&job->lock);
+}
+
+/* Block until the port exists (name or alias) or the deadline passes */
+static int wait_for_port(RouteJob *job, jack_client_t *client, const char *port, uint64_t deadline) {
+    pthread_mutex_lock(&job->lock);
+    for (;;) {
+        struct timespec ts;
+        uint64_t left, now;
+
+        job->ports_changed = 0;
+        pthread_mutex_unlock(&job->lock);
+        if (jack_port_by_name(client, port)) return 0;
+        pthread_mutex_lock(&job->lock);
+
+        now = now_ms();
+        if (now >= deadline) break;
+        if (job->ports_changed) continue;
+
+        left = deadline - now;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        ts.tv_sec += (time_t)(left / 1000u);
+        ts.tv_nsec += (long)(left % 1000u) * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+        while (!job->ports_changed &&
+               pthread_cond_timedwait(&job->cond, &job->lock, &ts) != ETIMEDOUT) {
+        }
+    }
+    pthread_mutex_unlock(&job->lock);
+    return -1;
+}
+
+static int fail(RouteJob *job, int error, const char *fmt, const char *arg) {
+    snprintf(job->message, sizeof(job->message), fmt, arg);
+    fprintf(stderr, "jack-bridge-route: %s\n", job->message);
+    return error;
+}
+
+static int run_job(RouteJob *job) {
+    const char *keys[2] = { "PREFERRED_OUTPUT", "BLUETOOTH_DEVICE" };
+    const char *values[2];
+    char bt_value[160], pcm[128], port[96];
+    jack_client_t *client;
+    jack_status_t status;
+    jack_nframes_t rate = 48000;
+    int is_bt = strcmp(job->target->name, "bluetooth") == 0;
+    int err;
+
+    load_conf(job);
+    if (ensure_conf_dir(job) != 0) return fail(job, EIO, "Cannot create %s", job->conf_dir);
+
+    /* Output for non-JACK ALSA apps */
+    if (strcmp(job->target->name, "internal") == 0) {
+        snprintf(pcm, sizeof(pcm), "%s", job->conf.internal_device);
+    } else if (is_bt) {
+        if (write_bluealsa_defaults(job) != 0) return fail(job, EIO, "Cannot write %s", "bluealsa_defaults.conf");
+        snprintf(pcm, sizeof(pcm), "jackbridge_bluealsa");
+    } else if (output_hw(job, "plughw", pcm, sizeof(pcm)) != 0) {
+        snprintf(pcm, sizeof(pcm), "%s",
+                 strcmp(job->target->name, "usb") == 0 ? job->conf.usb_device : job->conf.hdmi_device);
+    }
+    if (write_output_conf(job, pcm) != 0) return fail(job, EIO, "Cannot write the ALSA output fragment for %s", pcm);
+    TRACE(TRACE_STAGE, TRACE_EV_ROUTE_CONF, 0, pcm);
+
+    /* Opened before the bridges start so no registration can be missed */
+    client = jack_client_open(CLIENT_NAME, JackNoStartServer, &status);
+    if (client) {
+        jack_set_port_registration_callback(client, port_registration_callback, job);
+        if (jack_activate(client) != 0) {
+            jack_client_close(client);
+            client = NULL;
+        } else {
+            rate = jack_get_sample_rate(client);
+        }
+    }
+
+    update_bridges(job, rate);
+    TRACE(TRACE_STAGE, TRACE_EV_ROUTE_BRIDGES, 0, job->target->name);
+
+    /* The connection manager re-routes all sources when this file changes */
+    values[0] = job->target->name;
+    if (is_bt && job->bt_device[0]) {
+        if (job->bt_mac[0]) snprintf(bt_value, sizeof(bt_value), "jackbridge_bluealsa:DEV=%s,PROFILE=a2dp", job->bt_mac);
+        else snprintf(bt_value, sizeof(bt_value), "%s", job->bt_device);
+        values[1] = bt_value;
+    }
+    if (save_user_keys(job, keys, values, is_bt && job->bt_device[0] ? 2 : 1) != 0) {
+        if (client) jack_client_close(client);
+        return fail(job, EIO, "Cannot update %s/devices.conf", job->conf_dir);
+    }
+    TRACE(TRACE_STAGE, TRACE_EV_ROUTE_SAVED, 0, job->target->name);
+
+    if (!client) return fail(job, ENOTCONN, "JACK is not running; %s is selected for its next start", job->target->name);
+
+    snprintf(port, sizeof(port), "%s1", job->target->sink_prefix);
+    err = wait_for_port(job, client, port, now_ms() + PORT_TIMEOUT_MS);
+    jack_client_close(client);
+    if (err != 0) return fail(job, ETIMEDOUT, "Timed out waiting for %s", port);
+
+    fprintf(stderr, "jack-bridge-route: Output set to %s\n", job->target->name);
+    return 0;
+}
+
+static void *route_thread(void *arg) {
+    RouteJob *job = arg;
+    int err;
+
+    pthread_mutex_lock(&route_lock);
+    err = run_job(job);
+    pthread_mutex_unlock(&route_lock);
+    TRACE(TRACE_STAGE, TRACE_EV_ROUTE_DONE, err, job->target->name);
+
+    if (job->done) job->done(err, err ? job->message : NULL, job->user_data);
+
+    pthread_cond_destroy(&job->cond);
+    pthread_mutex_destroy(&job->lock);
+    free(job);
+    return NULL;
+}
+
+int route_select(const char *target,
+                 const char *bt_device,
+                 const RouteUser *user,
+                 RouteDoneFunc done,
+                 void *user_data) {
+    const RouteTarget *t = route_find_target(target);
+    pthread_condattr_t attr;
+    pthread_attr_t thread_attr;
+    pthread_t thread;
+    RouteJob *job;
+    const char *home;
+    int err;
+
+    if (!t || (bt_device && !is_mac(bt_device) && !is_pcm_name(bt_device))) {
+        errno = EINVAL;
+        return -1;
+    }
+    TRACE(TRACE_STAGE, TRACE_EV_ROUTE_REQUEST, 0, t->name);
+
+    job = calloc(1, sizeof(*job));
+    if (!job) return -1;
+    job->target = t;
+    job->done = done;
+    job->user_data = user_data;
+    if (bt_device) {
+        snprintf(job->bt_device, sizeof(job->bt_device), "%s", bt_device);
+        if (is_mac(bt_device)) snprintf(job->bt_mac, sizeof(job->bt_mac), "%s", bt_device);
+    }
+
+    if (user) {
+        home = user->home;
+        job->uid = user->uid;
+        job->gid = user->gid;
+    } else {
+        home = getenv("HOME");
+        job->uid = getuid();
+        job->gid = getgid();
+    }
+    if (!home || !*home) {
+        free(job);
+        errno = ENOENT;
+        return -1;
+    }
+    snprintf(job->home, sizeof(job->home), "%s", home);
+    snprintf(job->conf_dir, sizeof(job->conf_dir), "%s/%s", home, CONF_DIR);
+
+    /* Supplementary groups are resolved here: the forked child may not call getgrouplist() */
+    job->switch_user = job->uid != geteuid();
+    if (job->switch_user) {
+        struct passwd *pw = getpwuid(job->uid);
+        job->n_groups = MAX_GROUPS;
+        if (!pw || getgrouplist(pw->pw_name, job->gid, job->groups, &job->n_groups) < 0) {
+            job->groups[0] = job->gid;
+            job->n_groups = 1;
+        }
+    }
+
+    pthread_mutex_init(&job->lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&job->cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_attr_init(&thread_attr);
+    pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_DETACHED);
+    err = pthread_create(&thread, &thread_attr, route_thread, job);
+    pthread_attr_destroy(&thread_attr);
+    if (err != 0) {
+        pthread_cond_destroy(&job->cond);
+        pthread_mutex_destroy(&job->lock);
+        free(job);
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,55 @@
+/*
+ * jack_bridge_route.h
+ * Output selection shared by mxeq, jack-connection-manager and jack-bridge-dbus
+ */
+
+#ifndef JACK_BRIDGE_ROUTE_H
+#define JACK_BRIDGE_ROUTE_H
+
+#include <sys/types.h>
+
+/* Selectable output: PREFERRED_OUTPUT value and the sink ports it routes to */
+typedef struct {
+    const char *name;           /* "internal", "usb", "hdmi", "bluetooth" */
+    const char *sink_prefix;    /* e.g. "usb_out:playback_" */
+} RouteTarget;
+
+extern const RouteTarget route_targets[];
+extern const int route_n_targets;
+
+/* Target by PREFERRED_OUTPUT name, or NULL */
+const RouteTarget *route_find_target(const char *name);
+
+/* Whose configuration a selection is written to. Files are created owned by
+ * uid/gid and bridges run as that user; a service running as root selects on
+ * behalf of a D-Bus caller this way. NULL means the calling process' user. */
+typedef struct {
+    const char *home;
+    uid_t uid;
+    gid_t gid;
+} RouteUser;
+
+/* Called exactly once per accepted request, from the routing thread.
+ * error is 0 once the target's playback_1 port exists in JACK, otherwise an
+ * errno value (ETIMEDOUT, ENOTCONN if JACK is down, EIO on write failures)
+ * with a readable message. */
+typedef void (*RouteDoneFunc)(int error, const char *message, void *user_data);
+
+/* Select an output without blocking the caller. In a worker thread (requests
+ * run one at a time, in order):
+ *   - writes current_output.conf, the ~/.asoundrc include block and, for
+ *     Bluetooth, bluealsa_defaults.conf, each atomically
+ *   - starts the on-demand bridges the target needs and stops the others
+ *   - stores PREFERRED_OUTPUT (and BLUETOOTH_DEVICE) in the user devices.conf,
+ *     which jack-connection-manager watches and re-routes on
+ *   - waits, on JACK port registration events, until the sink ports exist
+ * bt_device is a MAC address, a BlueALSA PCM name of [A-Za-z0-9_.:-], or NULL.
+ * Returns 0 if the request was queued, -1 with errno set otherwise (EINVAL:
+ * unknown target or malformed bt_device). */
+int route_select(const char *target,
+                 const char *bt_device,
+                 const RouteUser *user,
+                 RouteDoneFunc done,
+                 void *user_data);
+
+#endif /* JACK_BRIDGE_ROUTE_H */
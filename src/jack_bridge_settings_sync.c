@@ -4,6 +4,16 @@
  * 
  * Handles reading/writing /etc/default/jackd-rt configuration file
  * Provides atomic updates and preserves comments
+ *
+ * The file is parsed once at startup; reads are served from the in-memory
+ * cache only. A GFileMonitor re-parses it when someone else edits it (our
+ * own renames are recognized and skipped). set_config_value() writes through
+ * (temp file, fsync, rename). set_config_value_deferred() updates the cache
+ * at once and coalesces a burst of calls into one rewrite FLUSH_DELAY_MS
+ * after the first, reporting the outcome to each caller once it is on disk,
+ * so qjackctl's settings dialog costs one write instead of one per key and
+ * still learns about failures. flush_config_cache() forces the write before
+ * anything that reads the file itself (jackd-rt restarts).
  */
 
 #include "jack_bridge_settings_sync.h"
@@ -12,15 +22,36 @@
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #include <glib.h>
+#include <gio/gio.h>
 
 #define JACKD_RT_CONFIG "/etc/default/jackd-rt"
+#define JACKD_RT_CONFIG_DIR "/etc/default"
 #define MAX_LINE 512
+#define FLUSH_DELAY_MS 200  /* Collect a burst of writes for this long before rewriting the file */
 
 /* Configuration cache for thread-safe access */
 static GHashTable *config_cache = NULL;
 static GMutex config_cache_mutex;
 
+/* Values set but not yet written (key → value), protected by config_cache_mutex */
+static GHashTable *pending_writes = NULL;
+static guint flush_source_id = 0;
+
+/* Deferred callers waiting for the next write, protected by config_cache_mutex */
+typedef struct {
+    ConfigWrittenFunc done;
+    gpointer user_data;
+} WriteWaiter;
+static GSList *write_waiters = NULL;
+
+/* External edit detection */
+static GFileMonitor *config_monitor = NULL;
+static struct stat written_stat;    /* The file as our last rename left it */
+static gboolean have_written_stat = FALSE;
+
 /* Initialize mutex at startup */
 GMutex *get_config_cache_mutex(void) {
     static gsize mutex_initialized = 0;
@@ -124,19 +155,106 @@ GHashTable *parse_config_file(const char *path) {
 }
 
 /*
- * init_config_cache()
- * Initialize configuration cache at startup
+ * load_cache_locked()
+ * Parse the file into the cache; values not written yet stay on top.
+ * Caller holds config_cache_mutex.
  */
-void init_config_cache(void) {
-    GMutex *mutex = get_config_cache_mutex();
-    g_mutex_lock(mutex);
+static void load_cache_locked(void) {
+    GHashTableIter iter;
+    gpointer key, value;
     
     if (config_cache) {
         g_hash_table_destroy(config_cache);
     }
     
     config_cache = parse_config_file(JACKD_RT_CONFIG);
+    
+    if (pending_writes) {
+        g_hash_table_iter_init(&iter, pending_writes);
+        while (g_hash_table_iter_next(&iter, &key, &value)) {
+            g_hash_table_insert(config_cache, g_strdup(key), g_strdup(value));
+        }
+    }
+}
+
+/*
+ * is_own_write()
+ * TRUE if the file on disk is still the one our last rewrite produced
+ */
+static gboolean is_own_write(void) {
+    struct stat st;
+    
+    if (!have_written_stat || stat(JACKD_RT_CONFIG, &st) != 0) {
+        return FALSE;
+    }
+    
+    return st.st_ino == written_stat.st_ino &&
+           st.st_size == written_stat.st_size &&
+           st.st_mtim.tv_sec == written_stat.st_mtim.tv_sec &&
+           st.st_mtim.tv_nsec == written_stat.st_mtim.tv_nsec;
+}
+
+/*
+ * on_config_file_changed()
+ * GFileMonitor callback: re-parse after external edits
+ */
+static void on_config_file_changed(GFileMonitor *monitor,
+                                   GFile *file,
+                                   GFile *other_file,
+                                   GFileMonitorEvent event_type,
+                                   gpointer user_data) {
+    (void)monitor;
+    (void)file;
+    (void)other_file;
+    (void)user_data;
+    
+    /* In-place edits end with CHANGES_DONE_HINT, replacements with CREATED.
+     * A deletion keeps the cached values until the file comes back. */
+    if (event_type != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT &&
+        event_type != G_FILE_MONITOR_EVENT_CREATED) {
+        return;
+    }
+    
+    if (is_own_write()) {
+        return;
+    }
+    
+    g_message("settings_sync: %s changed externally, reloading", JACKD_RT_CONFIG);
+    refresh_config_cache();
+}
+
+/*
+ * init_config_cache()
+ * Initialize configuration cache at startup and watch the file
+ */
+void init_config_cache(void) {
+    GMutex *mutex = get_config_cache_mutex();
+    GFile *file;
+    GError *error = NULL;
+    
+    g_mutex_lock(mutex);
+    if (!pending_writes) {
+        pending_writes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    }
+    load_cache_locked();
     g_mutex_unlock(mutex);
+    
+    if (config_monitor) {
+        return;
+    }
+    
+    file = g_file_new_for_path(JACKD_RT_CONFIG);
+    config_monitor = g_file_monitor_file(file, G_FILE_MONITOR_NONE, NULL, &error);
+    g_object_unref(file);
+    
+    if (!config_monitor) {
+        g_warning("settings_sync: Cannot watch %s, external edits need a restart: %s",
+                  JACKD_RT_CONFIG, error->message);
+        g_error_free(error);
+        return;
+    }
+    
+    g_signal_connect(config_monitor, "changed", G_CALLBACK(on_config_file_changed), NULL);
 }
 
 /*
@@ -146,18 +264,29 @@ void init_config_cache(void) {
 void refresh_config_cache(void) {
     GMutex *mutex = get_config_cache_mutex();
     g_mutex_lock(mutex);
-    
-    if (config_cache) {
-        g_hash_table_destroy(config_cache);
+    load_cache_locked();
+    g_mutex_unlock(mutex);
+}
+
+/*
+ * shutdown_config_cache()
+ * Write anything still queued and stop watching the file
+ */
+void shutdown_config_cache(void) {
+    if (!flush_config_cache()) {
+        g_warning("settings_sync: Unsaved settings lost: cannot write %s", JACKD_RT_CONFIG);
     }
     
-    config_cache = parse_config_file(JACKD_RT_CONFIG);
-    g_mutex_unlock(mutex);
+    if (config_monitor) {
+        g_file_monitor_cancel(config_monitor);
+        g_object_unref(config_monitor);
+        config_monitor = NULL;
+    }
 }
 
 /*
  * get_config_value()
- * Read a configuration value from /etc/default/jackd-rt
+ * Read a configuration value (from the cache, no file access)
  */
 gchar *get_config_value(const char *key) {
     if (!key || strlen(key) == 0) {
@@ -170,32 +299,16 @@ gchar *get_config_value(const char *key) {
     
     g_mutex_lock(mutex);
     
-    /* Try cache first */
-    if (config_cache) {
-        const gchar *val = g_hash_table_lookup(config_cache, key);
-        if (val) {
-            value = g_strdup(val);
-            g_mutex_unlock(mutex);
-            g_debug("settings_sync: Cache hit for key '%s' = '%s'", key, value);
-            return value;
-        }
+    if (!config_cache) {
+        load_cache_locked();
     }
     
+    value = g_strdup(g_hash_table_lookup(config_cache, key));
+    
     g_mutex_unlock(mutex);
     
-    /* Fallback to direct file parsing if not in cache */
-    GHashTable *config = parse_config_file(JACKD_RT_CONFIG);
-    if (config) {
-        const gchar *val = g_hash_table_lookup(config, key);
-        if (val) {
-            value = g_strdup(val);
-            g_debug("settings_sync: File read for key '%s' = '%s'", key, value);
-        } else {
-            g_debug("settings_sync: Key '%s' not found in configuration", key);
-        }
-        g_hash_table_destroy(config);
-    } else {
-        g_warning("settings_sync: Failed to parse configuration file for key '%s'", key);
+    if (!value) {
+        g_debug("settings_sync: Key '%s' not found in configuration", key);
     }
     
     return value;
@@ -218,16 +331,34 @@ gint get_config_int(const char *key, gint default_value) {
 }
 
 /*
- * set_config_value()
- * Write a configuration value to /etc/default/jackd-rt atomically
- * Preserves comments and other settings
+ * sync_dir()
+ * Make a rename in dir durable
  */
-gboolean set_config_value(const char *key, const char *value) {
+static void sync_dir(const char *dir) {
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    
+    if (fd < 0) return;
+    if (fsync(fd) != 0) {
+        g_warning("settings_sync: fsync(%s) failed: %s", dir, strerror(errno));
+    }
+    close(fd);
+}
+
+/*
+ * write_config_file()
+ * Rewrite /etc/default/jackd-rt with values replaced in one atomic update
+ * (single temp file, fsync, rename). Preserves comments and other settings.
+ * Caller holds config_cache_mutex.
+ */
+static gboolean write_config_file(GHashTable *values) {
     FILE *in, *out;
     char line[MAX_LINE];
     char tmpfile[] = "/etc/default/jackd-rt.tmp.XXXXXX";
     int fd;
-    gboolean key_found = FALSE;
+    GHashTable *written;
+    GHashTableIter iter;
+    gpointer key, value;
+    gboolean header_done = FALSE;
     
     /* Create temporary file */
     fd = mkstemp(tmpfile);
@@ -244,64 +375,71 @@ gboolean set_config_value(const char *key, const char *value) {
         return FALSE;
     }
     
+    /* Keys already replaced in place */
+    written = g_hash_table_new(g_str_hash, g_str_equal);
+    
     /* Open original file */
     in = fopen(JACKD_RT_CONFIG, "r");
     if (!in) {
         /* File doesn't exist, create new one */
         fprintf(out, "# /etc/default/jackd-rt - JACK configuration\n");
         fprintf(out, "# Generated by jack-bridge D-Bus service\n\n");
-        fprintf(out, "%s=%s\n", key, value);
-        fclose(out);
-        
-        if (rename(tmpfile, JACKD_RT_CONFIG) != 0) {
-            g_critical("settings_sync: Failed to rename %s: %s", tmpfile, strerror(errno));
-            unlink(tmpfile);
-            return FALSE;
-        }
-        
-        return TRUE;
-    }
-    
-    /* Copy file, replacing key if found */
-    while (fgets(line, sizeof(line), in)) {
-        char *eq = strchr(line, '=');
-        
-        /* Check if this line contains our key */
-        if (eq) {
-            char saved_eq = *eq;
-            *eq = '\0';
-            
-            /* Trim spaces from line key */
-            char *line_key = line;
-            while (*line_key == ' ' || *line_key == '\t') line_key++;
-            char *end = line_key + strlen(line_key) - 1;
-            while (end > line_key && (*end == ' ' || *end == '\t')) {
-                *end = '\0';
-                end--;
-            }
+        header_done = TRUE;
+    } else {
+        /* Copy file, replacing keys that are being set */
+        while (fgets(line, sizeof(line), in)) {
+            char *eq = strchr(line, '=');
             
-            if (strcmp(line_key, key) == 0) {
-                /* Replace this line */
-                fprintf(out, "%s=%s\n", key, value);
-                key_found = TRUE;
-                *eq = saved_eq; /* Restore for next iteration */
-                continue;
+            /* Check if this line contains one of our keys */
+            if (eq) {
+                char saved_eq = *eq;
+                *eq = '\0';
+                
+                /* Trim spaces from line key */
+                char *line_key = line;
+                while (*line_key == ' ' || *line_key == '\t') line_key++;
+                char *end = line_key + strlen(line_key) - 1;
+                while (end > line_key && (*end == ' ' || *end == '\t')) {
+                    *end = '\0';
+                    end--;
+                }
+                
+                if (g_hash_table_lookup_extended(values, line_key, &key, &value)) {
+                    /* Replace this line */
+                    fprintf(out, "%s=%s\n", (const char *)key, (const char *)value);
+                    g_hash_table_add(written, key);
+                    *eq = saved_eq; /* Restore for next iteration */
+                    continue;
+                }
+                
+                *eq = saved_eq; /* Restore */
             }
             
-            *eq = saved_eq; /* Restore */
+            /* Copy line as-is */
+            fputs(line, out);
         }
-        
-        /* Copy line as-is */
-        fputs(line, out);
+        fclose(in);
     }
     
-    /* If key wasn't found, append it */
-    if (!key_found) {
-        fprintf(out, "\n# Added by jack-bridge D-Bus service\n");
-        fprintf(out, "%s=%s\n", key, value);
+    /* Append keys that weren't found */
+    g_hash_table_iter_init(&iter, values);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        if (g_hash_table_contains(written, key)) continue;
+        if (!header_done) {
+            fprintf(out, "\n# Added by jack-bridge D-Bus service\n");
+            header_done = TRUE;
+        }
+        fprintf(out, "%s=%s\n", (const char *)key, (const char *)value);
     }
+    g_hash_table_destroy(written);
     
-    fclose(in);
+    /* Data must be on disk before the rename makes it visible */
+    if (fflush(out) != 0 || fsync(fileno(out)) != 0 || ferror(out)) {
+        g_critical("settings_sync: Failed to write %s: %s", tmpfile, strerror(errno));
+        fclose(out);
+        unlink(tmpfile);
+        return FALSE;
+    }
     fclose(out);
     
     /* Atomic rename */
@@ -311,14 +449,147 @@ gboolean set_config_value(const char *key, const char *value) {
         unlink(tmpfile);
         return FALSE;
     }
+    sync_dir(JACKD_RT_CONFIG_DIR);
     
-    
-    /* Refresh cache after successful write */
-    refresh_config_cache();
+    /* Remember what we wrote so the monitor event it causes is ignored */
+    have_written_stat = (stat(JACKD_RT_CONFIG, &written_stat) == 0);
     
     return TRUE;
 }
 
+/*
+ * queue_value()
+ * Update the cache and remember the value for the next rewrite.
+ * Caller holds config_cache_mutex.
+ */
+static void queue_value(const char *key, const char *value) {
+    if (!pending_writes) {
+        pending_writes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    }
+    if (!config_cache) {
+        load_cache_locked();
+    }
+    
+    g_hash_table_insert(pending_writes, g_strdup(key), g_strdup(value));
+    g_hash_table_insert(config_cache, g_strdup(key), g_strdup(value));
+}
+
+/*
+ * flush_config_cache()
+ * Write queued values now. On failure they stay queued for the next flush.
+ */
+gboolean flush_config_cache(void) {
+    GMutex *mutex = get_config_cache_mutex();
+    gboolean result = TRUE;
+    GSList *waiters;
+    
+    g_mutex_lock(mutex);
+    
+    if (flush_source_id > 0) {
+        g_source_remove(flush_source_id);
+        flush_source_id = 0;
+    }
+    
+    if (pending_writes && g_hash_table_size(pending_writes) > 0) {
+        result = write_config_file(pending_writes);
+        if (result) {
+            g_hash_table_remove_all(pending_writes);
+        }
+    }
+    
+    /* Everyone queued so far has their answer, success or not */
+    waiters = g_slist_reverse(write_waiters);
+    write_waiters = NULL;
+    
+    g_mutex_unlock(mutex);
+    
+    for (GSList *l = waiters; l; l = l->next) {
+        WriteWaiter *w = l->data;
+        w->done(result, w->user_data);
+    }
+    g_slist_free_full(waiters, g_free);
+    
+    return result;
+}
+
+/*
+ * flush_timeout()
+ * End of a write burst
+ */
+static gboolean flush_timeout(gpointer user_data) {
+    (void)user_data;
+    
+    flush_source_id = 0;
+    if (!flush_config_cache()) {
+        g_warning("settings_sync: Deferred write of %s failed, will retry on the next change",
+                  JACKD_RT_CONFIG);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * set_config_values()
+ * Write several configuration values to /etc/default/jackd-rt in one
+ * atomic rewrite, together with anything still queued. Written through:
+ * callers usually restart JACK right after.
+ */
+gboolean set_config_values(GHashTable *values) {
+    GMutex *mutex = get_config_cache_mutex();
+    GHashTableIter iter;
+    gpointer key, value;
+    
+    if (g_hash_table_size(values) == 0) {
+        return TRUE;
+    }
+    
+    g_mutex_lock(mutex);
+    g_hash_table_iter_init(&iter, values);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        queue_value(key, value);
+    }
+    g_mutex_unlock(mutex);
+    
+    return flush_config_cache();
+}
+
+/*
+ * set_config_value()
+ * Set a configuration value and write it (with anything queued) before
+ * returning. Returns FALSE if the file could not be written.
+ */
+gboolean set_config_value(const char *key, const char *value) {
+    GMutex *mutex = get_config_cache_mutex();
+    
+    g_mutex_lock(mutex);
+    queue_value(key, value);
+    g_mutex_unlock(mutex);
+    
+    return flush_config_cache();
+}
+
+/*
+ * set_config_value_deferred()
+ * Set a configuration value. The cache changes at once; the file is
+ * rewritten once per burst of calls, after which done (main loop) gets the
+ * outcome of that write.
+ */
+void set_config_value_deferred(const char *key, const char *value,
+                               ConfigWrittenFunc done, gpointer user_data) {
+    GMutex *mutex = get_config_cache_mutex();
+    WriteWaiter *w = g_new(WriteWaiter, 1);
+    
+    w->done = done;
+    w->user_data = user_data;
+    
+    g_mutex_lock(mutex);
+    queue_value(key, value);
+    write_waiters = g_slist_prepend(write_waiters, w);
+    if (flush_source_id == 0) {
+        flush_source_id = g_timeout_add(FLUSH_DELAY_MS, flush_timeout, NULL);
+    }
+    g_mutex_unlock(mutex);
+}
+
 /*
  * set_config_int()
  * Write an integer configuration value
@@ -11,14 +11,30 @@
 /* Configuration file parsing */
 GHashTable *parse_config_file(const char *path);
 
-/* Read operations */
+/* Read operations (in-memory cache) */
 gchar *get_config_value(const char *key);
 gint get_config_int(const char *key, gint default_value);
 
-/* Write operations (atomic) */
+/* Write operations: the cache changes at once and the file is rewritten
+ * atomically before returning; FALSE if it could not be written */
 gboolean set_config_value(const char *key, const char *value);
 gboolean set_config_int(const char *key, gint value);
 
+/* Outcome of a deferred write: TRUE once the value is on disk */
+typedef void (*ConfigWrittenFunc)(gboolean ok, gpointer user_data);
+
+/* Same, but a burst of calls shares one rewrite shortly after the first;
+ * done is called with its outcome (for D-Bus replies) */
+void set_config_value_deferred(const char *key, const char *value,
+                               ConfigWrittenFunc done, gpointer user_data);
+
+/* Write several KEY → value strings (and anything queued) in one atomic
+ * rewrite, before returning */
+gboolean set_config_values(GHashTable *values);
+
+/* Write queued values now (before anything that reads the file itself) */
+gboolean flush_config_cache(void);
+
 /* Validation functions */
 gboolean validate_sample_rate(guint rate);
 gboolean validate_period(guint period);
@@ -28,10 +44,13 @@ gboolean validate_priority(guint priority);
 /* Utility functions */
 gdouble calculate_latency_ms(guint period, guint nperiods, guint sample_rate);
 
-/* Initialize configuration cache (call once at startup) */
+/* Initialize configuration cache and watch the file (call once at startup) */
 void init_config_cache(void);
 
-/* Refresh configuration cache (call after external changes) */
+/* Refresh configuration cache (external changes are noticed automatically) */
 void refresh_config_cache(void);
 
+/* Write queued values and stop watching (service shutdown) */
+void shutdown_config_cache(void);
+
 #endif /* JACK_BRIDGE_SETTINGS_SYNC_H */
\ No newline at end of file
@@ -0,0 +1,250 @@
+/*
+ * jack_bridge_trace.c
+ * Low-overhead binary event tracing shared by the jack-bridge processes
+ *
+ * Each traced process maps a ring file of fixed 64-byte records under
+ * TRACE_DIR_FMT. A writer claims a slot with one atomic add on the header's
+ * head counter, then fills it between two stores of its seq word, so any
+ * thread (including JACK process callbacks) can trace without locks or
+ * system calls: clock_gettime(CLOCK_MONOTONIC) is served by the vDSO.
+ *
+ * Timestamps share one clock across processes, so jack-bridge-trace can
+ * merge the rings of mxeq, the D-Bus service, the connection manager and
+ * the bridges into one timeline, e.g. from an output picked in the GUI to
+ * the first audible period written to the device.
+ *
+ * The file outlives the process so a trace can be read after a crash; it is
+ * removed by the next process of the same component.
+ *
+ * With $JACK_BRIDGE_TRACE unset nothing is mapped and TRACE() costs one
+ * load and a branch.
+ *
+ * Plain C (no GLib) so every jack-bridge program can link it.
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L /* lstat(), strnlen(): mxeq builds with plain -std=c11 */
+#endif
+
+#include "jack_bridge_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define TRACE_CAPACITY 16384        /* 1 MiB of records */
+#define TRACE_SHARED_CAPACITY 1024
+
+int trace_level = TRACE_OFF;
+
+static TraceHeader *ring;
+static TraceRecord *records;
+static size_t ring_bytes;
+
+static const char *const event_names[TRACE_EV_COUNT] = {
+    [TRACE_EV_NONE] = "none",
+    [TRACE_EV_MARK] = "mark",
+    [TRACE_EV_GUI_OUTPUT] = "gui.output",
+    [TRACE_EV_ROUTE_REQUEST] = "route.request",
+    [TRACE_EV_ROUTE_CONF] = "route.conf",
+    [TRACE_EV_ROUTE_BRIDGES] = "route.bridges",
+    [TRACE_EV_ROUTE_SAVED] = "route.saved",
+    [TRACE_EV_ROUTE_DONE] = "route.done",
+    [TRACE_EV_MGR_CONFIG] = "manager.config",
+    [TRACE_EV_MGR_TARGET] = "manager.target",
+    [TRACE_EV_MGR_ROUTED] = "manager.routed",
+    [TRACE_EV_MGR_DISCONNECTED] = "manager.disconnected",
+    [TRACE_EV_MGR_PASS] = "manager.pass",
+    [TRACE_EV_DBUS_CALL] = "dbus.call",
+    [TRACE_EV_BRIDGE_OPEN] = "bridge.open",
+    [TRACE_EV_BRIDGE_AUDIO] = "bridge.audio",
+};
+
+const char *trace_event_name(unsigned int event) {
+    return event < TRACE_EV_COUNT ? event_names[event] : NULL;
+}
+
+static int env_level(void) {
+    const char *value = getenv(TRACE_ENV);
+    int level;
+
+    if (!value || !*value) return TRACE_OFF;
+    level = atoi(value);
+    if (level < TRACE_OFF) return TRACE_OFF;
+    return level > TRACE_DEBUG ? TRACE_DEBUG : level;
+}
+
+static int private_dir(const char *dir) {
+    struct stat st;
+
+    if (mkdir(dir, 0700) != 0 && errno != EEXIST) return -1;
+    if (lstat(dir, &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != getuid() ||
+        (st.st_mode & 077)) {
+        fprintf(stderr, "jack-bridge-trace: %s is not a private directory, tracing off\n", dir);
+        return -1;
+    }
+    return 0;
+}
+
+/* Ring files are mapped writable: both levels must belong to us alone */
+static int trace_dir(char *dir, size_t size) {
+    char *slash;
+    int ret;
+
+    snprintf(dir, size, TRACE_DIR_FMT, (unsigned)getuid());
+    slash = strrchr(dir, '/');
+    *slash = '\0';
+    ret = private_dir(dir);
+    *slash = '/';
+    return ret == 0 ? private_dir(dir) : -1;
+}
+
+/* Remove "<component>.<pid>" rings of processes that are gone */
+static void remove_stale(const char *dir, const char *component) {
+    size_t len = strlen(component);
+    DIR *d = opendir(dir);
+    struct dirent *e;
+
+    if (!d) return;
+    while ((e = readdir(d)) != NULL) {
+        char path[512];
+        char *end;
+        long pid;
+
+        if (strncmp(e->d_name, component, len) != 0 || e->d_name[len] != '.') continue;
+        pid = strtol(e->d_name + len + 1, &end, 10);
+        if (*end || pid <= 0 || pid == (long)getpid()) continue;
+        if (kill((pid_t)pid, 0) == 0 || errno == EPERM) continue;
+
+        snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+        unlink(path);
+    }
+    closedir(d);
+}
+
+static int map_ring(const char *path, const char *component, uint32_t capacity, uint32_t pid) {
+    size_t bytes = TRACE_HEADER_BYTES + (size_t)capacity * sizeof(TraceRecord);
+    struct stat st;
+    void *map;
+    int fd = open(path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+
+    if (fd < 0) return -1;
+    if (fstat(fd, &st) != 0 || st.st_uid != getuid() || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return -1;
+    }
+    /* Another component's layout, or a partly written shared ring: start over */
+    if ((size_t)st.st_size != bytes && (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)bytes) != 0)) {
+        close(fd);
+        return -1;
+    }
+
+    map = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+
+    ring = map;
+    records = (TraceRecord *)((char *)map + TRACE_HEADER_BYTES);
+    ring_bytes = bytes;
+
+    if (memcmp(ring->magic, TRACE_MAGIC, sizeof(ring->magic)) != 0 ||
+        ring->record_size != sizeof(TraceRecord) || ring->capacity != capacity) {
+        /* Also faults every page in now rather than in a traced thread */
+        memset(map, 0, bytes);
+        ring->record_size = sizeof(TraceRecord);
+        ring->capacity = capacity;
+        snprintf(ring->component, sizeof(ring->component), "%s", component);
+        atomic_store(&ring->head, 0);
+        /* Magic last: a reader only trusts a complete header */
+        atomic_thread_fence(memory_order_release);
+        memcpy(ring->magic, TRACE_MAGIC, sizeof(ring->magic));
+    }
+    ring->pid = pid;
+    return 0;
+}
+
+static int trace_open(const char *component, int shared, int level) {
+    char dir[256];
+    char path[512];
+    int ret;
+
+    if (ring || level <= TRACE_OFF) return ring ? 0 : -1;
+    if (trace_dir(dir, sizeof(dir)) != 0) return -1;
+
+    if (shared) {
+        snprintf(path, sizeof(path), "%s/%s", dir, component);
+        ret = map_ring(path, component, TRACE_SHARED_CAPACITY, 0);
+    } else {
+        remove_stale(dir, component);
+        snprintf(path, sizeof(path), "%s/%s.%ld", dir, component, (long)getpid());
+        ret = map_ring(path, component, TRACE_CAPACITY, (uint32_t)getpid());
+    }
+    if (ret != 0) {
+        fprintf(stderr, "jack-bridge-trace: Cannot map %s: %s, tracing off\n", path, strerror(errno));
+        return -1;
+    }
+
+    trace_level = level;
+    return 0;
+}
+
+void trace_init(const char *component) {
+    int level = env_level();
+
+    if (trace_open(component, 0, level) == 0) {
+        fprintf(stderr, "jack-bridge-trace: Tracing %s at level %d\n", component, level);
+    }
+}
+
+int trace_init_shared(const char *component) {
+    int level = env_level();
+
+    return trace_open(component, 1, level > TRACE_STAGE ? level : TRACE_STAGE);
+}
+
+void trace_shutdown(void) {
+    if (!ring) return;
+    trace_level = TRACE_OFF;
+    munmap(ring, ring_bytes);
+    ring = NULL;
+    records = NULL;
+}
+
+void trace_emit(int level, TraceEvent event, int64_t arg, const char *text) {
+    struct timespec ts;
+    uint64_t index;
+    TraceRecord *r;
+
+    if (!ring) return;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    index = atomic_fetch_add_explicit(&ring->head, 1, memory_order_relaxed);
+    r = &records[index & (ring->capacity - 1)];
+
+    /* Odd while written; readers skip the slot until it is even again */
+    atomic_store_explicit(&r->seq, 2 * index + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    r->ts_ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    r->arg = arg;
+    r->event = (uint16_t)event;
+    r->level = (uint8_t)level;
+    r->reserved = 0;
+    if (text) {
+        size_t len = strnlen(text, TRACE_TEXT_MAX - 1);
+
+        memcpy(r->text, text, len);
+        r->text[len] = '\0';
+    } else {
+        r->text[0] = '\0';
+    }
+
+    atomic_store_explicit(&r->seq, 2 * index + 2, memory_order_release);
+}
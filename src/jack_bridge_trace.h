@@ -0,0 +1,95 @@
+/*
+ * jack_bridge_trace.h
+ * Low-overhead binary event tracing shared by the jack-bridge processes
+ */
+
+#ifndef JACK_BRIDGE_TRACE_H
+#define JACK_BRIDGE_TRACE_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+/* Ring files, per user (%u = uid): <component>.<pid>, or <component> for
+ * rings shared by short-lived processes (jack-bridge-trace mark) */
+#define TRACE_DIR_FMT "/tmp/jack-bridge-%u/trace"
+#define TRACE_ENV "JACK_BRIDGE_TRACE"
+
+/* Verbosity from $JACK_BRIDGE_TRACE; each level includes those below it */
+#define TRACE_OFF 0
+#define TRACE_STAGE 1               /* Stages of an operation (output switch, routing pass) */
+#define TRACE_EVENT 2               /* Per port and per D-Bus call */
+#define TRACE_DEBUG 3
+
+typedef enum {
+    TRACE_EV_NONE = 0,
+    TRACE_EV_MARK,                  /* Free-form text (scripts, jack-bridge-trace mark) */
+    TRACE_EV_GUI_OUTPUT,            /* Output picked in mxeq; text: target */
+    TRACE_EV_ROUTE_REQUEST,         /* route_select() queued; text: target */
+    TRACE_EV_ROUTE_CONF,            /* ALSA output fragments written */
+    TRACE_EV_ROUTE_BRIDGES,         /* On-demand bridges started and stopped */
+    TRACE_EV_ROUTE_SAVED,           /* PREFERRED_OUTPUT stored: the manager takes over */
+    TRACE_EV_ROUTE_DONE,            /* Target playback_1 registered; arg: errno, 0 = ok */
+    TRACE_EV_MGR_CONFIG,            /* Config re-read; arg: 1 if routing changed */
+    TRACE_EV_MGR_TARGET,            /* Routing target changed; text: sink prefix */
+    TRACE_EV_MGR_ROUTED,            /* Source routed; text: port */
+    TRACE_EV_MGR_DISCONNECTED,      /* Source taken off another sink; text: port */
+    TRACE_EV_MGR_PASS,              /* Routing pass that routed sources; arg: count */
+    TRACE_EV_DBUS_CALL,             /* D-Bus method call; text: method */
+    TRACE_EV_BRIDGE_OPEN,           /* Bridge device opened; text: bridge */
+    TRACE_EV_BRIDGE_AUDIO,          /* First audible period after silence; text: bridge */
+    TRACE_EV_COUNT
+} TraceEvent;
+
+#define TRACE_MAGIC "JBTRACE1"
+#define TRACE_TEXT_MAX 36
+#define TRACE_HEADER_BYTES 4096
+
+/* One event, one cache line */
+typedef struct {
+    _Atomic uint64_t seq;           /* 2 * index + 2 once complete, odd while written */
+    uint64_t ts_ns;                 /* CLOCK_MONOTONIC: comparable across processes */
+    int64_t arg;
+    uint16_t event;                 /* TraceEvent */
+    uint8_t level;
+    uint8_t reserved;
+    char text[TRACE_TEXT_MAX];      /* Truncated, NUL-terminated */
+} TraceRecord;
+
+/* Start of a ring file; records follow at TRACE_HEADER_BYTES */
+typedef struct {
+    char magic[8];
+    uint32_t record_size;
+    uint32_t capacity;              /* Records, power of two */
+    uint32_t pid;                   /* Writer, 0 for shared rings */
+    char component[28];
+    _Atomic uint64_t head;          /* Records ever started */
+} TraceHeader;
+
+/* Current verbosity; TRACE_OFF unless trace_init() mapped a ring */
+extern int trace_level;
+
+/* Map this process' ring if $JACK_BRIDGE_TRACE is 1..3. Rings of the same
+ * component whose process is gone are removed first. Tracing stays off if
+ * anything fails. Call once, before other threads start. */
+void trace_init(const char *component);
+
+/* Same, but for a ring shared by several processes (level forced to at
+ * least TRACE_STAGE). Returns 0, or -1 if no ring could be mapped. */
+int trace_init_shared(const char *component);
+
+/* Unmap the ring. The file is kept for jack-bridge-trace. */
+void trace_shutdown(void);
+
+/* Append an event: lock-free, no system calls, safe from any thread */
+void trace_emit(int level, TraceEvent event, int64_t arg, const char *text);
+
+/* One load and a branch when the level is off */
+#define TRACE(level, event, arg, text) \
+    do { \
+        if (trace_level >= (level)) trace_emit((level), (event), (arg), (text)); \
+    } while (0)
+
+/* "manager.routed" etc., or NULL for unknown IDs */
+const char *trace_event_name(unsigned int event);
+
+#endif /* JACK_BRIDGE_TRACE_H */
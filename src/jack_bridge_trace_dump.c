@@ -0,0 +1,272 @@
+/*
+ * jack_bridge_trace_dump.c
+ * Reader for the jack-bridge trace rings (jack-bridge-trace)
+ *
+ * Merges the rings written by trace_emit() into one timeline, ordered by
+ * their shared monotonic timestamps, and prints each event with the time
+ * since the first one shown and since the previous one, in microseconds:
+ *
+ *   JACK_BRIDGE_TRACE=1 for mxeq, the D-Bus service, the connection manager
+ *   and jack-bridge-host, switch output once, then
+ *   jack-bridge-trace -s gui.output
+ *
+ * shows each stage from the click in mxeq to the first audible period on
+ * the new device. Rings are read while their writers run; slots being
+ * written at that moment are skipped.
+ *
+ * "jack-bridge-trace mark TEXT" appends TEXT to the shared "shell" ring, so
+ * scripts can put their own steps on the same timeline.
+ *
+ * Usage: jack-bridge-trace [-j] [-l level] [-s event] [ring_or_dir...]
+ *        jack-bridge-trace mark TEXT...
+ */
+
+#include "jack_bridge_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define DEFAULT_GLOB "/tmp/jack-bridge-*/trace/*"
+
+typedef struct {
+    TraceRecord record;
+    char source[40];                /* component.pid */
+} DumpEvent;
+
+typedef struct {
+    DumpEvent *events;
+    size_t n;
+    size_t cap;
+} DumpList;
+
+static int dump_add(DumpList *list, const TraceRecord *record, const char *source) {
+    if (list->n == list->cap) {
+        size_t cap = list->cap ? list->cap * 2 : 4096;
+        DumpEvent *grown = realloc(list->events, cap * sizeof(DumpEvent));
+
+        if (!grown) return -1;
+        list->events = grown;
+        list->cap = cap;
+    }
+    list->events[list->n].record = *record;
+    snprintf(list->events[list->n].source, sizeof(list->events[list->n].source), "%s", source);
+    list->n++;
+    return 0;
+}
+
+/* Copy every complete record of one ring file. Returns 0, or -1 if path is
+ * not a trace ring. */
+static int read_ring(const char *path, DumpList *list) {
+    const TraceHeader *header;
+    const TraceRecord *records;
+    struct stat st;
+    char source[40];
+    uint64_t head;
+    uint64_t first;
+    void *map;
+    int result = 0;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) return -1;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size < TRACE_HEADER_BYTES) {
+        close(fd);
+        return -1;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+
+    header = map;
+    records = (const TraceRecord *)((const char *)map + TRACE_HEADER_BYTES);
+    if (memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->record_size != sizeof(TraceRecord) || header->capacity == 0 ||
+        (header->capacity & (header->capacity - 1)) != 0 ||
+        (size_t)st.st_size < TRACE_HEADER_BYTES + (size_t)header->capacity * sizeof(TraceRecord)) {
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+
+    if (header->pid) {
+        snprintf(source, sizeof(source), "%.27s.%u", header->component, header->pid);
+    } else {
+        snprintf(source, sizeof(source), "%.27s", header->component);
+    }
+
+    head = atomic_load_explicit((_Atomic uint64_t *)&header->head, memory_order_acquire);
+    first = head > header->capacity ? head - header->capacity : 0;
+    for (uint64_t i = first; i < head && result == 0; i++) {
+        const TraceRecord *slot = &records[i & (header->capacity - 1)];
+        _Atomic uint64_t *seq = (_Atomic uint64_t *)&slot->seq;
+        TraceRecord copy;
+
+        /* Same index, complete, and not rewritten while copied */
+        if (atomic_load_explicit(seq, memory_order_acquire) != 2 * i + 2) continue;
+        memcpy(&copy, slot, sizeof(copy));
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(seq, memory_order_relaxed) != 2 * i + 2) continue;
+
+        copy.text[TRACE_TEXT_MAX - 1] = '\0';
+        result = dump_add(list, &copy, source);
+    }
+
+    munmap(map, (size_t)st.st_size);
+    return result == 0 ? 0 : -1;
+}
+
+static int compare_events(const void *a, const void *b) {
+    const DumpEvent *x = a;
+    const DumpEvent *y = b;
+
+    if (x->record.ts_ns != y->record.ts_ns) return x->record.ts_ns < y->record.ts_ns ? -1 : 1;
+    return strcmp(x->source, y->source);
+}
+
+static void print_json_string(const char *s) {
+    putchar('"');
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+
+        if (c == '"' || c == '\\') printf("\\%c", c);
+        else if (c < 0x20) printf("\\u%04x", c);
+        else putchar(c);
+    }
+    putchar('"');
+}
+
+static void print_event(const DumpEvent *e, uint64_t start_ns, uint64_t prev_ns, int json) {
+    const char *name = trace_event_name(e->record.event);
+    char unknown[16];
+
+    if (!name) {
+        snprintf(unknown, sizeof(unknown), "event%u", e->record.event);
+        name = unknown;
+    }
+
+    if (json) {
+        printf("{\"ts_ns\":%llu,\"t_us\":%.3f,\"source\":",
+               (unsigned long long)e->record.ts_ns, (e->record.ts_ns - start_ns) / 1000.0);
+        print_json_string(e->source);
+        printf(",\"event\":");
+        print_json_string(name);
+        printf(",\"level\":%u,\"arg\":%lld,\"text\":", e->record.level, (long long)e->record.arg);
+        print_json_string(e->record.text);
+        printf("}\n");
+    } else {
+        printf("%12.3f %+11.3f  %-22s %-21s %6lld  %s\n",
+               (e->record.ts_ns - start_ns) / 1000.0, (e->record.ts_ns - prev_ns) / 1000.0,
+               e->source, name, (long long)e->record.arg, e->record.text);
+    }
+}
+
+static int mark(int argc, char *argv[]) {
+    char text[TRACE_TEXT_MAX];
+    size_t len = 0;
+
+    text[0] = '\0';
+    for (int i = 0; i < argc && len < sizeof(text) - 1; i++) {
+        len += (size_t)snprintf(text + len, sizeof(text) - len, "%s%s", i ? " " : "", argv[i]);
+    }
+    if (trace_init_shared("shell") != 0) return 1;
+    trace_emit(TRACE_STAGE, TRACE_EV_MARK, 0, text);
+    trace_shutdown();
+    return 0;
+}
+
+static void usage(void) {
+    fprintf(stderr, "Usage: jack-bridge-trace [-j] [-l level] [-s event] [ring_or_dir...]\n"
+                    "       jack-bridge-trace mark TEXT...\n"
+                    "  Prints the merged trace: microseconds since the first event shown and since\n"
+                    "  the previous one. -s starts at the last occurrence of event (e.g. gui.output),\n"
+                    "  -l hides events above level, -j prints JSON lines.\n");
+}
+
+int main(int argc, char *argv[]) {
+    DumpList list = { NULL, 0, 0 };
+    const char *start_event = NULL;
+    int max_level = TRACE_DEBUG;
+    int json = 0;
+    size_t start = 0;
+    uint64_t prev_ns;
+    glob_t paths;
+    int opt;
+
+    if (argc > 1 && strcmp(argv[1], "mark") == 0) return mark(argc - 2, argv + 2);
+
+    while ((opt = getopt(argc, argv, "jl:s:h")) != -1) {
+        switch (opt) {
+        case 'j': json = 1; break;
+        case 'l': max_level = atoi(optarg); break;
+        case 's': start_event = optarg; break;
+        default: usage(); return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    memset(&paths, 0, sizeof(paths));
+    if (optind == argc) {
+        glob(DEFAULT_GLOB, 0, NULL, &paths);
+    } else {
+        for (int i = optind; i < argc; i++) {
+            struct stat st;
+            char pattern[4096];
+
+            if (stat(argv[i], &st) == 0 && S_ISDIR(st.st_mode)) {
+                snprintf(pattern, sizeof(pattern), "%s/*", argv[i]);
+                glob(pattern, paths.gl_pathc ? GLOB_APPEND : 0, NULL, &paths);
+            } else {
+                glob(argv[i], GLOB_NOCHECK | (paths.gl_pathc ? GLOB_APPEND : 0), NULL, &paths);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < paths.gl_pathc; i++) {
+        if (read_ring(paths.gl_pathv[i], &list) != 0 && optind < argc) {
+            fprintf(stderr, "jack-bridge-trace: %s: %s\n", paths.gl_pathv[i],
+                    errno ? strerror(errno) : "not a trace ring");
+        }
+        errno = 0;
+    }
+    globfree(&paths);
+
+    if (list.n == 0) {
+        fprintf(stderr, "jack-bridge-trace: No events (run with %s=1..3 to record them)\n", TRACE_ENV);
+        free(list.events);
+        return 1;
+    }
+    qsort(list.events, list.n, sizeof(DumpEvent), compare_events);
+
+    if (start_event) {
+        int found = 0;
+
+        for (size_t i = list.n; i > 0 && !found; i--) {
+            const char *name = trace_event_name(list.events[i - 1].record.event);
+
+            if (name && strcmp(name, start_event) == 0) {
+                start = i - 1;
+                found = 1;
+            }
+        }
+        if (!found) {
+            fprintf(stderr, "jack-bridge-trace: No %s event recorded\n", start_event);
+            free(list.events);
+            return 1;
+        }
+    }
+
+    prev_ns = list.events[start].record.ts_ns;
+    for (size_t i = start; i < list.n; i++) {
+        const DumpEvent *e = &list.events[i];
+
+        if (e->record.level > max_level) continue;
+        print_event(e, list.events[start].record.ts_ns, prev_ns, json);
+        prev_ns = e->record.ts_ns;
+    }
+
+    free(list.events);
+    return 0;
+}
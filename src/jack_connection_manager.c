@@ -3,8 +3,25 @@
  * Event-driven JACK connection manager for jack-bridge
  *
  * Uses JACK's port registration callback (zero-CPU when idle) instead of polling.
+ * JACK callbacks wake the main thread through an eventfd; the main thread blocks
+ * in poll() and never wakes on a timer.
  * Automatically routes new audio sources to user's PREFERRED_OUTPUT selection.
  * Runs as the user, reads ~/.config/jack-bridge/devices.conf
+ * Config files are watched with inotify and re-read only when they change.
+ * Sources whose target sink has no ports yet wait in a pending state and are
+ * routed as soon as the sink's ports register, so startup needs no delay.
+ * Whole routings can be saved and restored by name through a per-user UNIX
+ * control socket (used by jack-bridge-dbus, which also hands over the graph
+ * it saved before restarting the server); restored sources are left where the
+ * snapshot put them until the target output changes.
+ * FANOUT_OUTPUTS plays to several outputs at once: sources are routed to an
+ * in-process mixer (jack_bridge_fanout.c) that feeds each output with its own
+ * gain and delay.
+ * ROUTE_INSERT names a client (by default mxeq's equalizer, "mxeq_eq") that
+ * sits in front of the output while its in_1/2 and out_1/2 ports exist:
+ * sources go to its inputs and its outputs go to the target.
+ * Per-port routing decisions go to the trace ring ($JACK_BRIDGE_TRACE=2,
+ * jack_bridge_trace.c) rather than stderr, which gets one line per pass.
  */
 
 #include <stdio.h>
@@ -14,105 +31,749 @@
 #include <unistd.h>
 #include <time.h>
 #include <errno.h>
+#include <stdint.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <fcntl.h>
 #include <jack/jack.h>
+#include <jack/uuid.h>
+#include "jack_bridge_route.h"
+#include "jack_bridge_graph.h"
+#include "jack_bridge_fanout.h"
+#include "jack_bridge_trace.h"
 
-#define MAX_LINE 256
+#define MAX_LINE 512
 #define USER_CONF_PATH ".config/jack-bridge/devices.conf"
 #define SYS_CONF_PATH "/etc/jack-bridge/devices.conf"
+#define USER_CONF_DIR ".config/jack-bridge"
+#define SYS_CONF_DIR "/etc/jack-bridge"
+#define CONF_FILE_NAME "devices.conf"
+#define USER_GRAPH_DIR ".config/jack-bridge/graphs"
+#define CONTROL_TIMEOUT_MS 1000     /* A control client must send its request within this */
+#define MAX_CONTROL_CLIENTS 4       /* Requests being read at once */
+#define EVENT_QUEUE_SIZE 1024
+#define MAX_CLIENT_BATCHES 64
+#define DEFAULT_BATCH_QUIET_MS 20   /* Route a client once its ports are quiet this long */
+#define DEFAULT_BATCH_MAX_MS 100    /* ...but never hold a port back longer than this */
+#define MAX_SINK_RULES 16
+#define MAX_CHANNEL_RULES 32
+#define MAX_IGNORE_RULES 16
+#define DEFAULT_ROUTE_INSERT "mxeq_eq"
+
+/* Built-in rules, overridable from devices.conf (SINK_<NAME>=, CHANNEL_RULES=, IGNORE_PORTS=).
+ * Channel patterns match the short port name: "x" exact, "x*" prefix, "*x" suffix, "*x*" anywhere.
+ * The longest matching pattern wins, so "out_001" can never be taken for "out_0".
+ * jack-bridge-bench-latency connects its click port itself, so it is ignored. */
+#define DEFAULT_CHANNEL_RULES \
+    "out_0=1 out_000=1 out_1=1 left*=1 L*=1 *playback_1=1 " \
+    "out_2=2 out_001=2 right*=2 R*=2 *playback_2=2"
+#define DEFAULT_IGNORE_PORTS "*:capture_* *:midi_* Midi-Through:* jack_bridge_latency:*"
+
+/* Port events queued by JACK callbacks for the main thread */
+typedef enum {
+    PORT_EVENT_ADDED,
+    PORT_EVENT_REMOVED,
+    PORT_EVENT_CONNECTED
+} PortEventType;
+
+typedef struct {
+    PortEventType type;
+    jack_port_id_t a;   /* Registered/unregistered port, or connection source */
+    jack_port_id_t b;   /* Connection destination (PORT_EVENT_CONNECTED only) */
+    uint64_t when_ns;   /* CLOCK_MONOTONIC timestamp taken in the callback */
+} PortEvent;
+
+/* Port classes, computed once per port ID */
+typedef enum {
+    PORT_CLASS_UNKNOWN = 0,     /* Not classified yet */
+    PORT_CLASS_SOURCE,          /* Routable audio output */
+    PORT_CLASS_SINK,            /* Playback port of a known output device */
+    PORT_CLASS_IGNORED          /* Our own, input, capture or MIDI port */
+} PortClass;
+
+/* Output device: PREFERRED_OUTPUT name -> sink port name prefix */
+typedef struct {
+    char name[32];
+    char prefix[64];
+    size_t len;
+} SinkRule;
+
+/* Per-output fan-out trim (FANOUT_GAIN_<NAME>=dB, FANOUT_DELAY_<NAME>=ms) */
+typedef struct {
+    char name[32];
+    float gain_db;
+    float delay_ms;
+} OutputTrim;
+
+/* Literal name pattern with optional '*' at either end */
+typedef struct {
+    char text[48];
+    size_t len;
+    unsigned char any_start;    /* Leading '*' */
+    unsigned char any_end;      /* Trailing '*' */
+} NamePattern;
+
+typedef struct {
+    NamePattern pattern;        /* Matched against the short port name */
+    int channel;                /* Target playback_N */
+} ChannelRule;
+
+/* Classification rules, loaded with the config (main thread only) */
+typedef struct {
+    SinkRule sinks[MAX_SINK_RULES];
+    int n_sinks;
+    ChannelRule channels[MAX_CHANNEL_RULES];
+    int n_channels;
+    NamePattern ignore[MAX_IGNORE_RULES]; /* Matched against the full port name */
+    int n_ignore;
+    char insert[32];            /* ROUTE_INSERT client name, empty for none */
+} RuleTable;
+
+/* Port table entry, indexed by jack_port_id_t */
+typedef struct {
+    unsigned char in_use;       /* Slot holds a routable source port */
+    unsigned char cls;          /* Cached PortClass */
+    unsigned char sink;         /* SinkRule index + 1 for sink ports, else 0 */
+    unsigned char channel;      /* Channel rule result for sources (0 = both channels) */
+    unsigned char needs_route;  /* New or moved since last routed */
+    unsigned int routed_gen;    /* route_gen at the time it was last routed */
+    unsigned char batch;        /* ClientBatch index + 1 while waiting for its client, else 0 */
+    unsigned char pending;      /* Waiting for the target sink's ports to register */
+    unsigned char pinned;       /* Routed by a restored snapshot: not auto-routed */
+    unsigned char insert;       /* Output of the ROUTE_INSERT client: always goes to the target */
+} KnownPort;
+
+/* Ports of one client registered in a burst, routed together once stable */
+typedef struct {
+    int in_use;
+    int ready;                  /* Set at the start of a pass once the deadline has passed */
+    char name[64];              /* JACK client name (port name prefix before ':') */
+    uint64_t first_ns;          /* First registration in this burst */
+    uint64_t last_ns;           /* Most recent registration/connection in this burst */
+    unsigned int ports;         /* Ports added to this batch */
+    unsigned int routed;        /* Ports routed when the batch was flushed */
+} ClientBatch;
+
+/* Batch size metrics (dumped on SIGUSR1 and at shutdown) */
+typedef struct {
+    unsigned long batches;
+    unsigned long ports;
+    unsigned int max_ports;
+    unsigned long size_hist[5]; /* 1, 2, 3-4, 5-8, 9+ ports */
+    uint64_t total_wait_ns;
+} BatchStats;
 
 /* Global state */
 static jack_client_t *client = NULL;
 static volatile int keep_running = 1;
 static volatile int needs_reconnect = 0; /* Flag for deferred connection */
 static volatile int is_processing = 0; /* Lock to prevent concurrent routing */
+static int wake_fd = -1; /* eventfd signalled by JACK callbacks and signal handler */
+static volatile int needs_full_rescan = 1; /* Start with a full scan of the live graph */
+
+/* Event queue shared with JACK's notification thread (protected by event_lock) */
+static pthread_mutex_t event_lock = PTHREAD_MUTEX_INITIALIZER;
+static PortEvent event_queue[EVENT_QUEUE_SIZE];
+static unsigned int event_head = 0;
+static unsigned int event_count = 0;
+
+/* A control socket client whose request line is still arriving */
+typedef struct {
+    int in_use;
+    int fd;
+    size_t len;
+    uint64_t deadline_ns;       /* Answered with an error if the line is not complete by then */
+    char request[32 + GRAPH_NAME_MAX];
+} ControlClient;
+
+/* Port table (main thread only) */
+static KnownPort *known_ports = NULL;
+static size_t known_ports_len = 0;
+static unsigned int route_gen = 1; /* Bumped when the target sink changes */
+static int retry_pending = 0; /* A target sink port registered: retry pending sources */
+static JackGraph restored_graph = JACK_GRAPH_INIT; /* Last restored snapshot (its sources are pinned) */
+static JackGraph restore_missing = JACK_GRAPH_INIT; /* Its connections whose ports are not there yet */
+static int restore_retry = 0; /* A port registered: retry restore_missing */
+static int control_fd = -1; /* Listening control socket */
+static char control_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static ControlClient control_clients[MAX_CONTROL_CLIENTS];
+
+/* Registration batching (main thread only) */
+static ClientBatch batches[MAX_CLIENT_BATCHES];
+static int batch_quiet_ms = DEFAULT_BATCH_QUIET_MS;
+static int batch_max_ms = DEFAULT_BATCH_MAX_MS;
+static BatchStats batch_stats;
+static volatile int dump_stats = 0;
 static char preferred_output[64] = "internal";
 static char target_sink_prefix[64] = "system:playback_";
+static int target_sink = -1; /* Index into rules.sinks, -1 if PREFERRED_OUTPUT has no rule */
+static RuleTable rules;
+static char fanout_outputs[128] = ""; /* FANOUT_OUTPUTS: output names, empty for a single output */
+static OutputTrim output_trims[MAX_SINK_RULES];
+static int n_output_trims = 0;
+static int fanout_ready = 0; /* Mixer set up in our client */
+static int fanout_retry = 0; /* Connect mixer outputs whose sinks were missing */
+static int fanout_waiting = 0; /* Mixer outputs whose sink ports are missing */
+static char insert_in_prefix[64] = ""; /* "<ROUTE_INSERT>:in_", empty for none */
+static int insert_active = 0; /* The insert has all its ports: sources are routed through it */
+static int insert_check = 0; /* Its ports may have come or gone: probe again */
+
+/* Config file watches (main thread only) */
+static int inotify_fd = -1;
+static int sys_conf_wd = -1;
+static int user_conf_wd = -1;
+static int user_parent_wd = -1; /* ~/.config, while ~/.config/jack-bridge does not exist */
+
+/* Wake the main thread blocked in poll(). Async-signal-safe (single write()),
+ * so it may be called from JACK's notification thread and from signal handlers.
+ * The eventfd counter coalesces multiple wakeups into a single read. */
+static void wake_main_thread(void) {
+    uint64_t one = 1;
+    ssize_t ret;
+    
+    if (wake_fd < 0) return;
+    ret = write(wake_fd, &one, sizeof(one));
+    (void)ret; /* EAGAIN means a wakeup is already pending */
+}
+
+/* Monotonic clock in nanoseconds (safe from any thread) */
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* SIGUSR1: ask the main thread to log batching metrics */
+static void stats_signal_handler(int sig) {
+    (void)sig;
+    dump_stats = 1;
+    wake_main_thread();
+}
 
 /* Signal handler for clean shutdown */
 static void signal_handler(int sig) {
     (void)sig;
     keep_running = 0;
+    wake_main_thread();
 }
 
-/* Read PREFERRED_OUTPUT from config files */
-static void load_config(void) {
+/* Strip trailing newline and surrounding quotes from a KEY=value value (in place) */
+static char *conf_value(char *val) {
+    char *end = strchr(val, '\n');
+    if (end) *end = '\0';
+    /* Remove quotes if present */
+    if (*val == '"' || *val == '\'') val++;
+    end = val + strlen(val) - 1;
+    if (end > val && (*end == '"' || *end == '\'')) *end = '\0';
+    return val;
+}
+
+/* Compile one pattern ("x", "x*", "*x", "*x*"). Returns 0 on success. */
+static int compile_pattern(const char *text, size_t len, NamePattern *pat) {
+    memset(pat, 0, sizeof(NamePattern));
+    if (len > 0 && text[0] == '*') {
+        pat->any_start = 1;
+        text++;
+        len--;
+    }
+    if (len > 0 && text[len - 1] == '*') {
+        pat->any_end = 1;
+        len--;
+    }
+    if (len == 0 || len >= sizeof(pat->text)) return -1;
+    memcpy(pat->text, text, len);
+    pat->len = len;
+    return 0;
+}
+
+static int match_pattern(const NamePattern *pat, const char *name, size_t name_len) {
+    if (name_len < pat->len) return 0;
+    if (pat->any_start && pat->any_end) return strstr(name, pat->text) != NULL;
+    if (pat->any_start) return memcmp(name + name_len - pat->len, pat->text, pat->len) == 0;
+    if (pat->any_end) return memcmp(name, pat->text, pat->len) == 0;
+    return name_len == pat->len && memcmp(name, pat->text, pat->len) == 0;
+}
+
+/* Parse a whitespace-separated list of "pattern" or "pattern=channel" entries */
+static void parse_rule_list(const char *val, int with_channel) {
+    const char *p = val;
+    
+    if (with_channel) rules.n_channels = 0;
+    else rules.n_ignore = 0;
+    
+    while (*p) {
+        const char *start, *eq;
+        size_t len;
+        NamePattern pat;
+        
+        while (*p == ' ' || *p == '\t') p++;
+        if (!*p) break;
+        start = p;
+        while (*p && *p != ' ' && *p != '\t') p++;
+        len = (size_t)(p - start);
+        
+        if (with_channel) {
+            int channel;
+            
+            eq = memchr(start, '=', len);
+            if (!eq || (channel = atoi(eq + 1)) < 1 || channel > 255 ||
+                compile_pattern(start, (size_t)(eq - start), &pat) != 0) {
+                fprintf(stderr, "jack-connection-manager: Ignoring bad channel rule '%.*s'\n", (int)len, start);
+                continue;
+            }
+            if (rules.n_channels < MAX_CHANNEL_RULES) {
+                memcpy(&rules.channels[rules.n_channels].pattern, &pat, sizeof(pat));
+                rules.channels[rules.n_channels].channel = channel;
+                rules.n_channels++;
+            }
+        } else {
+            if (compile_pattern(start, len, &pat) != 0) {
+                fprintf(stderr, "jack-connection-manager: Ignoring bad port pattern '%.*s'\n", (int)len, start);
+                continue;
+            }
+            if (rules.n_ignore < MAX_IGNORE_RULES) memcpy(&rules.ignore[rules.n_ignore++], &pat, sizeof(pat));
+        }
+    }
+}
+
+/* Add or replace a sink rule (SINK_<NAME>=prefix, NAME matched case-insensitively) */
+static void set_sink_rule(const char *name, size_t name_len, const char *prefix) {
+    SinkRule rule;
+    int i;
+    
+    memset(&rule, 0, sizeof(rule));
+    if (name_len == 0 || name_len >= sizeof(rule.name)) return;
+    for (size_t k = 0; k < name_len; k++) {
+        char c = name[k];
+        rule.name[k] = (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+    }
+    rule.len = strlen(prefix);
+    if (rule.len == 0 || rule.len >= sizeof(rule.prefix)) return;
+    memcpy(rule.prefix, prefix, rule.len);
+    
+    for (i = 0; i < rules.n_sinks; i++) {
+        if (strcmp(rules.sinks[i].name, rule.name) == 0) break;
+    }
+    if (i == MAX_SINK_RULES) return;
+    memcpy(&rules.sinks[i], &rule, sizeof(rule));
+    if (i == rules.n_sinks) rules.n_sinks++;
+}
+
+/* Set the gain or delay trim of an output (NAME matched case-insensitively) */
+static void set_output_trim(const char *name, size_t name_len, const char *val, int is_delay) {
+    char lower[sizeof(output_trims[0].name)];
+    int i;
+    
+    if (name_len == 0 || name_len >= sizeof(lower)) return;
+    for (size_t k = 0; k < name_len; k++) {
+        char c = name[k];
+        lower[k] = (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+    }
+    lower[name_len] = '\0';
+    
+    for (i = 0; i < n_output_trims; i++) {
+        if (strcmp(output_trims[i].name, lower) == 0) break;
+    }
+    if (i == MAX_SINK_RULES) return;
+    if (i == n_output_trims) {
+        memset(&output_trims[i], 0, sizeof(OutputTrim));
+        strcpy(output_trims[i].name, lower);
+        n_output_trims++;
+    }
+    if (is_delay) output_trims[i].delay_ms = strtof(val, NULL);
+    else output_trims[i].gain_db = strtof(val, NULL);
+}
+
+/* Built-in output devices (the bridge clients spawned by jack-bridge-ports),
+ * shared with route_select() so both agree on what each target means */
+static void set_default_rules(void) {
+    memset(&rules, 0, sizeof(rules)); /* Zeroed padding keeps memcmp() change detection exact */
+    for (int i = 0; i < route_n_targets; i++) {
+        set_sink_rule(route_targets[i].name, strlen(route_targets[i].name), route_targets[i].sink_prefix);
+    }
+    parse_rule_list(DEFAULT_CHANNEL_RULES, 1);
+    parse_rule_list(DEFAULT_IGNORE_PORTS, 0);
+    strcpy(rules.insert, DEFAULT_ROUTE_INSERT);
+}
+
+/* Parse one devices.conf file; keys found here override earlier files */
+static void parse_conf_file(const char *path) {
     FILE *f;
     char line[MAX_LINE];
-    char path[512];
-    const char *home = getenv("HOME");
     
-    /* Try system config first */
-    f = fopen(SYS_CONF_PATH, "r");
-    if (f) {
-        while (fgets(line, sizeof(line), f)) {
-            if (strncmp(line, "PREFERRED_OUTPUT=", 17) == 0) {
-                char *val = line + 17;
-                char *end = strchr(val, '\n');
-                if (end) *end = '\0';
-                /* Remove quotes if present */
-                if (*val == '"' || *val == '\'') val++;
-                end = val + strlen(val) - 1;
-                if (end > val && (*end == '"' || *end == '\'')) *end = '\0';
-                strncpy(preferred_output, val, sizeof(preferred_output) - 1);
+    f = fopen(path, "r");
+    if (!f) return;
+    
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "PREFERRED_OUTPUT=", 17) == 0) {
+            snprintf(preferred_output, sizeof(preferred_output), "%s", conf_value(line + 17));
+        } else if (strncmp(line, "ROUTE_BATCH_QUIET_MS=", 21) == 0) {
+            int ms = atoi(conf_value(line + 21));
+            if (ms >= 0) batch_quiet_ms = ms;
+        } else if (strncmp(line, "ROUTE_BATCH_MAX_MS=", 19) == 0) {
+            int ms = atoi(conf_value(line + 19));
+            if (ms >= 0) batch_max_ms = ms;
+        } else if (strncmp(line, "ROUTE_INSERT=", 13) == 0) {
+            snprintf(rules.insert, sizeof(rules.insert), "%s", conf_value(line + 13));
+        } else if (strncmp(line, "FANOUT_OUTPUTS=", 15) == 0) {
+            snprintf(fanout_outputs, sizeof(fanout_outputs), "%s", conf_value(line + 15));
+        } else if (strncmp(line, "FANOUT_GAIN_", 12) == 0 && strchr(line, '=')) {
+            char *eq = strchr(line, '=');
+            set_output_trim(line + 12, (size_t)(eq - (line + 12)), conf_value(eq + 1), 0);
+        } else if (strncmp(line, "FANOUT_DELAY_", 13) == 0 && strchr(line, '=')) {
+            char *eq = strchr(line, '=');
+            set_output_trim(line + 13, (size_t)(eq - (line + 13)), conf_value(eq + 1), 1);
+        } else if (strncmp(line, "SINK_", 5) == 0 && strchr(line, '=')) {
+            char *eq = strchr(line, '=');
+            set_sink_rule(line + 5, (size_t)(eq - (line + 5)), conf_value(eq + 1));
+        } else if (strncmp(line, "CHANNEL_RULES=", 14) == 0) {
+            parse_rule_list(conf_value(line + 14), 1);
+        } else if (strncmp(line, "IGNORE_PORTS=", 13) == 0) {
+            parse_rule_list(conf_value(line + 13), 0);
+        }
+    }
+    fclose(f);
+}
+
+/* Resolve FANOUT_OUTPUTS against the sink rules. Returns the number of outputs. */
+static int resolve_fanout(FanoutSink *sinks) {
+    const char *p = fanout_outputs;
+    int n = 0;
+    
+    while (*p && n < FANOUT_MAX_SINKS) {
+        char name[32];
+        size_t len = 0;
+        int sink = -1;
+        int dup = 0;
+        
+        while (*p == ' ' || *p == '\t' || *p == ',') p++;
+        while (*p && *p != ' ' && *p != '\t' && *p != ',') {
+            if (len < sizeof(name) - 1) {
+                name[len++] = (*p >= 'A' && *p <= 'Z') ? (char)(*p - 'A' + 'a') : *p;
+            }
+            p++;
+        }
+        if (len == 0) continue;
+        name[len] = '\0';
+        
+        for (int i = 0; i < rules.n_sinks; i++) {
+            if (strcmp(rules.sinks[i].name, name) == 0) sink = i;
+        }
+        for (int i = 0; i < n; i++) {
+            if (strcmp(sinks[i].name, name) == 0) dup = 1;
+        }
+        if (sink < 0 || dup) {
+            if (sink < 0) fprintf(stderr, "jack-connection-manager: Ignoring unknown fan-out output '%s'\n", name);
+            continue;
+        }
+        
+        memset(&sinks[n], 0, sizeof(FanoutSink));
+        strcpy(sinks[n].name, name);
+        snprintf(sinks[n].prefix, sizeof(sinks[n].prefix), "%s", rules.sinks[sink].prefix);
+        for (int i = 0; i < n_output_trims; i++) {
+            if (strcmp(output_trims[i].name, name) == 0) {
+                sinks[n].gain_db = output_trims[i].gain_db;
+                sinks[n].delay_ms = output_trims[i].delay_ms;
             }
         }
-        fclose(f);
+        n++;
+    }
+    return n;
+}
+
+/* Bring the mixer in line with FANOUT_OUTPUTS. While it is on, its inputs
+ * are the target every source is routed to. */
+static void apply_fanout(void) {
+    FanoutSink sinks[FANOUT_MAX_SINKS];
+    int n;
+    const char *prefix;
+    
+    if (!fanout_ready) return;
+    n = resolve_fanout(sinks);
+    if (fanout_configure(sinks, n) != 0) {
+        fprintf(stderr, "jack-connection-manager: Fan-out unavailable, using %s only\n", preferred_output);
+        fanout_configure(NULL, 0);
+    }
+    
+    prefix = fanout_input_prefix();
+    if (prefix) {
+        snprintf(target_sink_prefix, sizeof(target_sink_prefix), "%s", prefix);
+        target_sink = -1;
+        fanout_retry = 1;
     }
+}
+
+/* Read PREFERRED_OUTPUT and batching settings from config files */
+static void load_config(void) {
+    char path[512];
+    const char *home = getenv("HOME");
+    
+    /* Start from defaults so keys removed from the files stop applying */
+    strcpy(preferred_output, "internal");
+    batch_quiet_ms = DEFAULT_BATCH_QUIET_MS;
+    batch_max_ms = DEFAULT_BATCH_MAX_MS;
+    fanout_outputs[0] = '\0';
+    n_output_trims = 0;
+    set_default_rules();
+    
+    /* Try system config first */
+    parse_conf_file(SYS_CONF_PATH);
     
     /* Try user config (overrides system) */
     if (home) {
         snprintf(path, sizeof(path), "%s/%s", home, USER_CONF_PATH);
-        f = fopen(path, "r");
-        if (f) {
-            while (fgets(line, sizeof(line), f)) {
-                if (strncmp(line, "PREFERRED_OUTPUT=", 17) == 0) {
-                    char *val = line + 17;
-                    char *end = strchr(val, '\n');
-                    if (end) *end = '\0';
-                    /* Remove quotes */
-                    if (*val == '"' || *val == '\'') val++;
-                    end = val + strlen(val) - 1;
-                    if (end > val && (*end == '"' || *end == '\'')) *end = '\0';
-                    strncpy(preferred_output, val, sizeof(preferred_output) - 1);
+        parse_conf_file(path);
+    }
+    
+    /* Set target sink based on preferred output (unknown names fall back to internal) */
+    target_sink = -1;
+    for (int i = 0; i < rules.n_sinks; i++) {
+        if (strcmp(rules.sinks[i].name, preferred_output) == 0) target_sink = i;
+    }
+    for (int i = 0; target_sink < 0 && i < rules.n_sinks; i++) {
+        if (strcmp(rules.sinks[i].name, "internal") == 0) target_sink = i;
+    }
+    snprintf(target_sink_prefix, sizeof(target_sink_prefix), "%s",
+             target_sink >= 0 ? rules.sinks[target_sink].prefix : "system:playback_");
+    if (rules.insert[0]) {
+        snprintf(insert_in_prefix, sizeof(insert_in_prefix), "%s:in_", rules.insert);
+    } else {
+        insert_in_prefix[0] = '\0';
+    }
+    
+    apply_fanout();
+}
+
+/* Watch the config directories rather than the files themselves: mxeq replaces
+ * devices.conf with rename(), which would leave a watch on the old inode. */
+static void add_config_watches(void) {
+    const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+    const char *home = getenv("HOME");
+    char dir[512];
+    
+    if (inotify_fd < 0) return;
+    
+    if (sys_conf_wd < 0) sys_conf_wd = inotify_add_watch(inotify_fd, SYS_CONF_DIR, mask);
+    
+    if (home && user_conf_wd < 0) {
+        snprintf(dir, sizeof(dir), "%s/%s", home, USER_CONF_DIR);
+        user_conf_wd = inotify_add_watch(inotify_fd, dir, mask);
+        if (user_conf_wd < 0 && user_parent_wd < 0) {
+            /* First run: wait for the user config directory to be created */
+            snprintf(dir, sizeof(dir), "%s/.config", home);
+            user_parent_wd = inotify_add_watch(inotify_fd, dir, IN_CREATE | IN_MOVED_TO);
+        } else if (user_conf_wd >= 0 && user_parent_wd >= 0) {
+            inotify_rm_watch(inotify_fd, user_parent_wd);
+            user_parent_wd = -1;
+        }
+    }
+}
+
+/* Drain pending inotify events. Returns 1 if devices.conf may have changed. */
+static int read_config_events(void) {
+    _Alignas(struct inotify_event) char buf[4096];
+    int changed = 0;
+    int rewatch = 0;
+    ssize_t len;
+    
+    while ((len = read(inotify_fd, buf, sizeof(buf))) > 0) {
+        char *p = buf;
+        
+        while (p < buf + len) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + ev->len;
+            
+            if (ev->mask & IN_IGNORED) {
+                /* Watched directory was removed */
+                if (ev->wd == sys_conf_wd) sys_conf_wd = -1;
+                if (ev->wd == user_conf_wd) user_conf_wd = -1;
+                if (ev->wd == user_parent_wd) user_parent_wd = -1;
+                rewatch = 1;
+                changed = 1;
+            } else if (ev->wd == user_parent_wd) {
+                if (ev->len && strcmp(ev->name, "jack-bridge") == 0) {
+                    rewatch = 1;
+                    changed = 1;
                 }
+            } else if (ev->len && strcmp(ev->name, CONF_FILE_NAME) == 0) {
+                changed = 1;
             }
-            fclose(f);
         }
     }
+    if (len < 0 && errno != EAGAIN && errno != EINTR) {
+        fprintf(stderr, "jack-connection-manager: inotify read failed: %s\n", strerror(errno));
+    }
     
-    /* Set target sink prefix based on preferred output */
-    if (strcmp(preferred_output, "usb") == 0) {
-        strcpy(target_sink_prefix, "usb_out:playback_");
-    } else if (strcmp(preferred_output, "hdmi") == 0) {
-        strcpy(target_sink_prefix, "hdmi_out:playback_");
-    } else if (strcmp(preferred_output, "bluetooth") == 0) {
-        strcpy(target_sink_prefix, "bluealsa:playback_");
-    } else {
-        strcpy(target_sink_prefix, "system:playback_");
+    if (rewatch) add_config_watches();
+    return changed;
+}
+
+/* Forget the last restored snapshot; its sources get routed normally again
+ * once route_gen moves on */
+static void drop_restored_graph(void) {
+    if (restored_graph.n == 0 && restore_missing.n == 0) return;
+    fprintf(stderr, "jack-connection-manager: Dropping restored routing (%zu connection(s) still missing)\n",
+            restore_missing.n);
+    graph_clear(&restored_graph);
+    graph_clear(&restore_missing);
+}
+
+/* Re-read config; a new target re-routes every known source on the next pass.
+ * Returns 1 if the target sink changed. */
+static int reload_config(void) {
+    char old_prefix[sizeof(target_sink_prefix)];
+    RuleTable old_rules;
+    
+    memcpy(&old_rules, &rules, sizeof(RuleTable));
+    strcpy(old_prefix, target_sink_prefix);
+    load_config();
+    
+    if (memcmp(&old_rules, &rules, sizeof(RuleTable)) != 0 ||
+        strcmp(old_prefix, target_sink_prefix) != 0) {
+        /* An explicit output choice overrides a restored routing */
+        drop_restored_graph();
+    }
+    
+    if (memcmp(&old_rules, &rules, sizeof(RuleTable)) != 0) {
+        /* Cached classes are stale: rebuild the table on the next pass */
+        fprintf(stderr, "jack-connection-manager: Port rules changed, reclassifying all ports\n");
+        pthread_mutex_lock(&event_lock);
+        needs_full_rescan = 1;
+        pthread_mutex_unlock(&event_lock);
+        route_gen++;
+        return 1;
+    }
+    if (strcmp(old_prefix, target_sink_prefix) == 0) return 0;
+    
+    route_gen++;
+    retry_pending = 1;
+    fprintf(stderr, "jack-connection-manager: Target changed to %s, re-routing all sources\n",
+            target_sink_prefix);
+    TRACE(TRACE_STAGE, TRACE_EV_MGR_TARGET, 0, target_sink_prefix);
+    return 1;
+}
+
+/* Sink rule matching a port name (longest prefix), or -1 if it is not a known sink */
+static int sink_of_name(const char *port_name) {
+    int best = -1;
+    
+    for (int i = 0; i < rules.n_sinks; i++) {
+        const SinkRule *r = &rules.sinks[i];
+        if (strncmp(port_name, r->prefix, r->len) == 0 &&
+            (best < 0 || r->len > rules.sinks[best].len)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+/* Channel for a source port: longest matching rule on the short name, 0 = both */
+static int channel_of_name(const char *port_name) {
+    const char *colon = strchr(port_name, ':');
+    const char *short_name = colon ? colon + 1 : port_name;
+    size_t short_len = strlen(short_name);
+    const ChannelRule *best = NULL;
+    
+    for (int i = 0; i < rules.n_channels; i++) {
+        const ChannelRule *r = &rules.channels[i];
+        if (match_pattern(&r->pattern, short_name, short_len) &&
+            (!best || r->pattern.len > best->pattern.len)) {
+            best = r;
+        }
+    }
+    return best ? best->channel : 0;
+}
+
+static int is_ignored_name(const char *port_name) {
+    size_t len = strlen(port_name);
+    
+    for (int i = 0; i < rules.n_ignore; i++) {
+        if (match_pattern(&rules.ignore[i], port_name, len)) return 1;
+    }
+    return 0;
+}
+
+/* Sink rule for a port by name or, failing that, by its aliases. Bridge host
+ * ports are named "jack_bridge:usb_out_playback_1" and aliased "usb_out:playback_1". */
+static int sink_of_port(jack_port_t *port) {
+    char alias_buf[2][320];
+    char *aliases[2] = { alias_buf[0], alias_buf[1] };
+    int sink = sink_of_name(jack_port_name(port));
+    int n;
+    
+    if (sink >= 0 || jack_port_name_size() > (int)sizeof(alias_buf[0])) return sink;
+    
+    n = jack_port_get_aliases(port, aliases);
+    for (int i = 0; i < n && sink < 0; i++) {
+        sink = sink_of_name(aliases[i]);
     }
+    return sink;
 }
 
-/* Check if port is a known sink (output device) */
-static int is_sink_port(const char *port_name) {
-    return (strstr(port_name, "system:playback_") != NULL ||
-            strstr(port_name, "usb_out:playback_") != NULL ||
-            strstr(port_name, "hdmi_out:playback_") != NULL ||
-            strstr(port_name, "bluealsa:playback_") != NULL);
+/* Sink rule for a connection peer given by name (aliases are only looked up
+ * when the name itself does not match) */
+static int sink_of_peer(const char *port_name) {
+    int sink = sink_of_name(port_name);
+    jack_port_t *port;
+    
+    if (sink >= 0) return sink;
+    port = jack_port_by_name(client, port_name);
+    return port ? sink_of_port(port) : -1;
 }
 
-/* Check if port is a capture port */
-static int is_capture_port(const char *port_name) {
-    return strstr(port_name, ":capture_") != NULL;
+/* Check if a sink port belongs to the current target */
+static int is_target_sink_port(const char *port_name) {
+    if (fanout_input_prefix()) return strncmp(port_name, target_sink_prefix, strlen(target_sink_prefix)) == 0;
+    return target_sink >= 0 && sink_of_peer(port_name) == target_sink;
 }
 
-/* Check if port is a MIDI port */
-static int is_midi_port(const char *port_name) {
-    return (strstr(port_name, ":midi_") != NULL ||
-            strstr(port_name, "Midi-Through:") != NULL);
+/* Whether a port belongs to the ROUTE_INSERT client */
+static int is_insert_port_name(const char *port_name) {
+    size_t len = strlen(rules.insert);
+    
+    return len > 0 && strncmp(port_name, rules.insert, len) == 0 && port_name[len] == ':';
 }
 
-/* Disconnect source port from ALL known sinks EXCEPT the target sink */
-static void disconnect_from_other_sinks(const char *source_port, const char *keep_prefix) {
+/* Whether the insert has both its inputs and outputs registered */
+static int probe_insert(void) {
+    char name[96];
+    
+    if (!rules.insert[0]) return 0;
+    for (int c = 1; c <= 2; c++) {
+        snprintf(name, sizeof(name), "%s:in_%d", rules.insert, c);
+        if (!jack_port_by_name(client, name)) return 0;
+        snprintf(name, sizeof(name), "%s:out_%d", rules.insert, c);
+        if (!jack_port_by_name(client, name)) return 0;
+    }
+    return 1;
+}
+
+/* Probe the insert again; when it comes or goes, every source is re-routed */
+static void update_insert(void) {
+    int active = probe_insert();
+    
+    insert_check = 0;
+    if (active == insert_active) return;
+    insert_active = active;
+    route_gen++;
+    retry_pending = 1;
+    fprintf(stderr, "jack-connection-manager: Insert %s %s, re-routing all sources\n",
+            rules.insert, active ? "available" : "gone");
+}
+
+/* Whether a source is routed through the insert rather than to the target */
+static int routes_via_insert(const KnownPort *kp) {
+    return insert_active && !kp->insert;
+}
+
+/* Disconnect source port from ALL known sinks EXCEPT keep_sink (-1: from all
+ * of them), and from the insert's inputs if drop_insert is set */
+static void disconnect_from_other_sinks(const char *source_port, int keep_sink, int drop_insert) {
     const char **connections;
     jack_port_t *port;
     int i, ret;
@@ -123,103 +784,393 @@ static void disconnect_from_other_sinks(const char *source_port, const char *kee
     connections = jack_port_get_all_connections(client, port);
     if (!connections) return;
     
-    /* Disconnect from any known sink port EXCEPT those matching keep_prefix */
+    /* Disconnect from any known sink port EXCEPT the kept one */
     for (i = 0; connections[i]; i++) {
-        if (is_sink_port(connections[i])) {
+        int sink = sink_of_peer(connections[i]);
+        /* Left over from before the insert went away */
+        int to_insert = drop_insert && insert_in_prefix[0] &&
+                        strncmp(connections[i], insert_in_prefix, strlen(insert_in_prefix)) == 0;
+        
+        if (sink >= 0 || to_insert) {
             /* Skip if this is our target sink */
-            if (keep_prefix && strstr(connections[i], keep_prefix) != NULL) {
+            if (sink >= 0 && sink == keep_sink) {
                 continue;
             }
             ret = jack_disconnect(client, source_port, connections[i]);
-            if (ret == 0) {
-                fprintf(stderr, "jack-connection-manager: Disconnected '%s' from '%s'\n",
-                        source_port, connections[i]);
-            }
+            if (ret == 0) TRACE(TRACE_EVENT, TRACE_EV_MGR_DISCONNECTED, sink, source_port);
         }
     }
     
     jack_free(connections);
 }
 
-/* Connect source port to target sink with smart channel mapping */
-static void connect_source_to_sink(const char *source_port) {
+/* Connect one source/sink pair, logging real failures */
+static void connect_logged(const char *source_port, const char *target) {
+    int ret = jack_connect(client, source_port, target);
+    if (ret != 0 && ret != EEXIST) {
+        fprintf(stderr, "jack-connection-manager: ERROR: Failed to connect %s -> %s (error %d)\n",
+                source_port, target, ret);
+    }
+}
+
+/* Connect source port to target sink, or to the insert's inputs if via_insert.
+ * channel is the cached channel rule result: N connects to playback_N only,
+ * 0 (mono or unknown) connects to playback_1 and _2.
+ * Returns 0 on success, -1 if the target ports do not exist yet (the caller
+ * parks the source until they register). */
+static int connect_source_to_sink(const char *source_port, int channel, int via_insert) {
+    const char *prefix = via_insert ? insert_in_prefix : target_sink_prefix;
     char target1[128], target2[128];
-    int ret;
     
-    snprintf(target1, sizeof(target1), "%s1", target_sink_prefix);
-    snprintf(target2, sizeof(target2), "%s2", target_sink_prefix);
+    snprintf(target1, sizeof(target1), "%s%d", prefix, channel ? channel : 1);
+    snprintf(target2, sizeof(target2), "%s2", prefix);
     
     /* Verify target ports exist before trying to connect */
-    if (!jack_port_by_name(client, target1) || !jack_port_by_name(client, target2)) {
-        fprintf(stderr, "jack-connection-manager: ERROR: Target ports %s/%s do not exist!\n",
-                target1, target2);
-        fprintf(stderr, "jack-connection-manager: Bridge ports may not be spawned yet. Skipping.\n");
-        return;
+    if (!jack_port_by_name(client, target1) || (!channel && !jack_port_by_name(client, target2))) {
+        return -1;
     }
     
-    /* STEP 1: Disconnect from all sinks EXCEPT our target */
-    disconnect_from_other_sinks(source_port, target_sink_prefix);
+    /* STEP 1: Disconnect from all sinks EXCEPT our target (all of them when
+     * going through the insert) */
+    disconnect_from_other_sinks(source_port, via_insert ? -1 : target_sink, !via_insert);
     
     /* STEP 2: Connect to target sink */
-    /* Smart channel mapping based on port name.
-     * CRITICAL: Check more specific patterns FIRST (e.g., :out_001 before :out_0)
-     * to avoid substring collision where ":out_001" matches ":out_0". */
-    
-    /* Right channel patterns - CHECK FIRST (more specific) */
-    if (strstr(source_port, ":out_2") || strstr(source_port, ":out_001") ||
-        strstr(source_port, ":right") || strstr(source_port, ":R") ||
-        strstr(source_port, "playback_2")) {
-        /* Right channel only */
-        ret = jack_connect(client, source_port, target2);
-        if (ret != 0 && ret != EEXIST) {
-            fprintf(stderr, "jack-connection-manager: ERROR: Failed to connect %s -> %s (error %d)\n",
-                    source_port, target2, ret);
-        }
-    /* Left channel patterns - CHECK SECOND (less specific :out_0 can match :out_001) */
-    } else if (strstr(source_port, ":out_1") || strstr(source_port, ":out_0") ||
-               strstr(source_port, ":out_000") || strstr(source_port, ":left") ||
-               strstr(source_port, ":L") || strstr(source_port, "playback_1")) {
-        /* Left channel only */
-        ret = jack_connect(client, source_port, target1);
-        if (ret != 0 && ret != EEXIST) {
-            fprintf(stderr, "jack-connection-manager: ERROR: Failed to connect %s -> %s (error %d)\n",
-                    source_port, target1, ret);
-        }
+    connect_logged(source_port, target1);
+    if (!channel) connect_logged(source_port, target2);
+    
+    /* No second disconnect pass: ports are routed once their client is stable, and a
+     * later auto-connect to another sink arrives as a port-connect event that
+     * re-routes just this port. */
+    return 0;
+}
+
+/* Queue a port event for the main thread. Called from JACK's notification
+ * thread; on overflow we fall back to a full rescan instead of losing events. */
+static void queue_port_event(PortEventType type, jack_port_id_t a, jack_port_id_t b) {
+    pthread_mutex_lock(&event_lock);
+    if (event_count < EVENT_QUEUE_SIZE) {
+        unsigned int slot = (event_head + event_count) % EVENT_QUEUE_SIZE;
+        event_queue[slot].type = type;
+        event_queue[slot].a = a;
+        event_queue[slot].b = b;
+        event_queue[slot].when_ns = monotonic_ns();
+        event_count++;
     } else {
-        /* Mono or unknown: connect to both */
-        ret = jack_connect(client, source_port, target1);
-        if (ret != 0 && ret != EEXIST) {
-            fprintf(stderr, "jack-connection-manager: ERROR: Failed to connect %s -> %s (error %d)\n",
-                    source_port, target1, ret);
-        }
-        ret = jack_connect(client, source_port, target2);
-        if (ret != 0 && ret != EEXIST) {
-            fprintf(stderr, "jack-connection-manager: ERROR: Failed to connect %s -> %s (error %d)\n",
-                    source_port, target2, ret);
-        }
+        needs_full_rescan = 1;
     }
+    pthread_mutex_unlock(&event_lock);
     
-    /* STEP 3: Disconnect AGAIN from OTHER sinks (ALSA plugin may have reconnected) */
-    disconnect_from_other_sinks(source_port, target_sink_prefix);
+    needs_reconnect = 1;
+    wake_main_thread();
 }
 
 /* Port registration callback - called when ports appear/disappear
  * NOTE: We CANNOT call jack_connect() from this callback (runs in JACK's notification thread).
- * Instead, set a flag and defer connection to main thread. */
+ * Instead, queue the port ID and defer routing to the main thread. */
 static void port_registration_callback(jack_port_id_t port_id, int registered, void *arg) {
     (void)arg;
-    (void)port_id;
     
-    if (!registered) return; /* Only care about new ports */
+    queue_port_event(registered ? PORT_EVENT_ADDED : PORT_EVENT_REMOVED, port_id, 0);
+}
+
+/* Port connect callback - lets us notice when something (typically the ALSA
+ * plugin) connects an already-routed source to a sink other than our target. */
+static void port_connect_callback(jack_port_id_t a, jack_port_id_t b, int connect, void *arg) {
+    (void)arg;
+    
+    if (!connect) return; /* Disconnects never move a source onto a wrong sink */
     
-    /* Signal main thread to process connections */
-    needs_reconnect = 1;
+    queue_port_event(PORT_EVENT_CONNECTED, a, b);
 }
 
-/* Process all pending connections (called from main thread, safe for jack_connect) */
-static void process_connections(void) {
+/* Look up the table entry for a port ID, growing the table as needed.
+ * JACK hands out small dense port IDs, so a direct-indexed array is enough. */
+static KnownPort *known_port_slot(jack_port_id_t id) {
+    if (id >= known_ports_len) {
+        size_t new_len = known_ports_len ? known_ports_len : 256;
+        KnownPort *grown;
+        
+        while (new_len <= id) new_len *= 2;
+        grown = realloc(known_ports, new_len * sizeof(KnownPort));
+        if (!grown) {
+            fprintf(stderr, "jack-connection-manager: Out of memory growing port table\n");
+            return NULL;
+        }
+        memset(grown + known_ports_len, 0, (new_len - known_ports_len) * sizeof(KnownPort));
+        known_ports = grown;
+        known_ports_len = new_len;
+    }
+    return &known_ports[id];
+}
+
+/* Map a port handle back to its jack_port_id_t. There is no direct API for
+ * this, but port UUIDs are generated from the port index in JACK1 and JACK2. */
+static jack_port_id_t port_id_of(jack_port_t *port) {
+    return (jack_port_id_t)jack_uuid_to_index(jack_port_uuid(port));
+}
+
+/* Check whether a source port is already connected to the current target sink,
+ * or to the insert for sources routed through it (one server round-trip; only
+ * used for ports whose routing state is unknown) */
+static int is_routed_to_target(jack_port_t *port, const KnownPort *kp) {
+    const char **connections = jack_port_get_all_connections(client, port);
+    int via_insert = routes_via_insert(kp);
+    int found = 0;
+    
+    if (connections) {
+        for (int j = 0; connections[j]; j++) {
+            if (via_insert ? strncmp(connections[j], insert_in_prefix, strlen(insert_in_prefix)) == 0
+                           : is_target_sink_port(connections[j])) {
+                found = 1;
+                break;
+            }
+        }
+        jack_free(connections);
+    }
+    return found;
+}
+
+/* Classify a port once and cache the result in its table entry */
+static KnownPort *classify_port(jack_port_id_t id, jack_port_t *port) {
+    KnownPort *kp = known_port_slot(id);
+    const char *port_name;
+    int sink;
+    
+    if (!kp || kp->cls != PORT_CLASS_UNKNOWN || !port) return kp;
+    
+    port_name = jack_port_name(port);
+    sink = sink_of_port(port);
+    if (sink >= 0) {
+        kp->cls = PORT_CLASS_SINK;
+        kp->sink = (unsigned char)(sink + 1);
+    } else if (jack_port_is_mine(client, port) || !(jack_port_flags(port) & JackPortIsOutput) ||
+               is_ignored_name(port_name)) {
+        /* Skip our own, input, capture and MIDI ports */
+        kp->cls = PORT_CLASS_IGNORED;
+    } else {
+        kp->cls = PORT_CLASS_SOURCE;
+        kp->channel = (unsigned char)channel_of_name(port_name);
+        kp->insert = (unsigned char)is_insert_port_name(port_name);
+    }
+    return kp;
+}
+
+/* Record a port in the table. Returns the entry for routable sources, NULL otherwise. */
+static KnownPort *track_port(jack_port_id_t id, jack_port_t *port) {
+    KnownPort *kp = classify_port(id, port);
+    
+    if (!kp || kp->cls != PORT_CLASS_SOURCE) return NULL;
+    kp->in_use = 1;
+    kp->routed_gen = 0;
+    kp->needs_route = 1;
+    return kp;
+}
+
+/* Leave a source where a restored snapshot put it (until route_gen changes) */
+static void pin_port(KnownPort *kp) {
+    kp->pinned = 1;
+    kp->pending = 0;
+    kp->needs_route = 0;
+    kp->routed_gen = route_gen;
+    kp->batch = 0;
+}
+
+/* Pin a source if the restored snapshot routes it. Returns 1 if pinned. */
+static int pin_if_restored(KnownPort *kp, const char *port_name) {
+    if (restored_graph.n == 0 || !graph_has_source(&restored_graph, port_name)) return 0;
+    pin_port(kp);
+    return 1;
+}
+
+/* Add a newly registered port to its client's batch, opening one if needed.
+ * Returns the batch index + 1, or 0 to route the port without batching. */
+static unsigned char batch_add_port(const char *port_name, uint64_t when_ns) {
+    const char *colon = strchr(port_name, ':');
+    size_t len = colon ? (size_t)(colon - port_name) : strlen(port_name);
+    int free_slot = -1;
+    
+    if (batch_quiet_ms == 0 && batch_max_ms == 0) return 0; /* Batching disabled */
+    if (len >= sizeof(batches[0].name)) len = sizeof(batches[0].name) - 1;
+    
+    for (int i = 0; i < MAX_CLIENT_BATCHES; i++) {
+        ClientBatch *cb = &batches[i];
+        
+        if (!cb->in_use) {
+            if (free_slot < 0) free_slot = i;
+            continue;
+        }
+        if (strncmp(cb->name, port_name, len) == 0 && cb->name[len] == '\0') {
+            cb->last_ns = when_ns;
+            cb->ports++;
+            return (unsigned char)(i + 1);
+        }
+    }
+    
+    if (free_slot < 0) return 0; /* Too many clients registering at once: no batching */
+    
+    memset(&batches[free_slot], 0, sizeof(ClientBatch));
+    batches[free_slot].in_use = 1;
+    memcpy(batches[free_slot].name, port_name, len);
+    batches[free_slot].first_ns = when_ns;
+    batches[free_slot].last_ns = when_ns;
+    batches[free_slot].ports = 1;
+    return (unsigned char)(free_slot + 1);
+}
+
+/* Deadline of a batch: quiet period after the last event, capped by the max delay */
+static uint64_t batch_deadline_ns(const ClientBatch *cb) {
+    uint64_t quiet = cb->last_ns + (uint64_t)batch_quiet_ms * 1000000ull;
+    uint64_t cap = cb->first_ns + (uint64_t)batch_max_ms * 1000000ull;
+    return quiet < cap ? quiet : cap;
+}
+
+/* poll() timeout until the earliest pending batch is due, or -1 if none is pending */
+static int next_batch_timeout_ms(void) {
+    uint64_t now = monotonic_ns();
+    uint64_t earliest = UINT64_MAX;
+    
+    for (int i = 0; i < MAX_CLIENT_BATCHES; i++) {
+        if (batches[i].in_use) {
+            uint64_t deadline = batch_deadline_ns(&batches[i]);
+            if (deadline < earliest) earliest = deadline;
+        }
+    }
+    
+    if (earliest == UINT64_MAX) return -1;
+    if (earliest <= now) return 0;
+    return (int)((earliest - now + 999999ull) / 1000000ull); /* Round up to avoid an early spin */
+}
+
+/* Record metrics for a flushed batch and release it */
+static void finish_batch(ClientBatch *cb, uint64_t now) {
+    if (cb->routed > 0) {
+        unsigned int n = cb->routed;
+        int bucket = n <= 1 ? 0 : n == 2 ? 1 : n <= 4 ? 2 : n <= 8 ? 3 : 4;
+        uint64_t waited = now - cb->first_ns;
+        
+        batch_stats.batches++;
+        batch_stats.ports += n;
+        batch_stats.size_hist[bucket]++;
+        batch_stats.total_wait_ns += waited;
+        if (n > batch_stats.max_ports) batch_stats.max_ports = n;
+        
+        fprintf(stderr, "jack-connection-manager: Routed batch for '%s': %u port(s) after %.1f ms\n",
+                cb->name, n, (double)waited / 1e6);
+    }
+    memset(cb, 0, sizeof(ClientBatch));
+}
+
+/* Log accumulated batch metrics */
+static void log_batch_stats(void) {
+    fprintf(stderr, "jack-connection-manager: Batch stats: %lu batches, %lu ports, max %u, "
+            "avg wait %.1f ms, sizes [1]=%lu [2]=%lu [3-4]=%lu [5-8]=%lu [9+]=%lu "
+            "(quiet %d ms, max %d ms)\n",
+            batch_stats.batches, batch_stats.ports, batch_stats.max_ports,
+            batch_stats.batches ? (double)batch_stats.total_wait_ns / 1e6 / batch_stats.batches : 0.0,
+            batch_stats.size_hist[0], batch_stats.size_hist[1], batch_stats.size_hist[2],
+            batch_stats.size_hist[3], batch_stats.size_hist[4],
+            batch_quiet_ms, batch_max_ms);
+}
+
+/* Rebuild the table from the live graph (startup, or after queue overflow).
+ * Sources already connected to the target are marked routed so they are left alone. */
+static void rescan_all_ports(void) {
     const char **ports;
-    int i;
+    
+    if (known_ports) memset(known_ports, 0, known_ports_len * sizeof(KnownPort));
+    memset(batches, 0, sizeof(batches));
+    update_insert();
+    
+    ports = jack_get_ports(client, NULL, NULL, JackPortIsOutput);
+    if (!ports) return;
+    
+    for (int i = 0; ports[i]; i++) {
+        jack_port_t *port = jack_port_by_name(client, ports[i]);
+        KnownPort *kp;
+        
+        if (!port) continue;
+        kp = track_port(port_id_of(port), port);
+        if (kp && pin_if_restored(kp, ports[i])) continue;
+        if (kp && is_routed_to_target(port, kp)) {
+            kp->needs_route = 0;
+            kp->routed_gen = route_gen;
+        }
+    }
+    
+    jack_free(ports);
+}
+
+/* Apply one queued event to the port table */
+static void apply_port_event(const PortEvent *ev) {
+    KnownPort *kp;
+    
+    switch (ev->type) {
+    case PORT_EVENT_ADDED: {
+        jack_port_t *port = jack_port_by_id(client, ev->a);
+        
+        kp = track_port(ev->a, port);
+        if (restore_missing.n > 0) restore_retry = 1;
+        if (port && is_insert_port_name(jack_port_name(port))) insert_check = 1;
+        if (kp) {
+            /* Sources of a restored snapshot are connected by the restore */
+            if (!pin_if_restored(kp, jack_port_name(port))) {
+                kp->batch = batch_add_port(jack_port_name(port), ev->when_ns);
+            }
+        } else if (ev->a < known_ports_len && known_ports[ev->a].cls == PORT_CLASS_SINK &&
+                   known_ports[ev->a].sink == target_sink + 1) {
+            /* Target bridge (re)appeared: sources waiting for it can be routed now */
+            retry_pending = 1;
+        } else if (fanout_waiting && ev->a < known_ports_len &&
+                   known_ports[ev->a].cls == PORT_CLASS_SINK) {
+            /* Maybe the sink of a waiting fan-out output */
+            fanout_retry = 1;
+        }
+        break;
+    }
+    case PORT_EVENT_REMOVED:
+        if (insert_active) insert_check = 1; /* The name is gone with the port */
+        if (ev->a < known_ports_len) {
+            memset(&known_ports[ev->a], 0, sizeof(KnownPort));
+        }
+        break;
+    case PORT_EVENT_CONNECTED:
+        /* Connections made by a client that is still registering (e.g. the ALSA
+         * plugin auto-connecting) mean its port set is not stable yet */
+        if (ev->a < known_ports_len && known_ports[ev->a].batch) {
+            ClientBatch *cb = &batches[known_ports[ev->a].batch - 1];
+            if (ev->when_ns > cb->last_ns) cb->last_ns = ev->when_ns;
+            break;
+        }
+        /* A routed source got connected somewhere: re-route it only if the
+         * new peer is a known sink other than our target (any sink while it
+         * goes through the insert) */
+        if (ev->a < known_ports_len && known_ports[ev->a].in_use &&
+            !known_ports[ev->a].needs_route && !known_ports[ev->a].pinned) {
+            KnownPort *peer = classify_port(ev->b, jack_port_by_id(client, ev->b));
+            
+            /* classify_port() may grow the table, so index it again */
+            kp = &known_ports[ev->a];
+            if (peer && peer->cls == PORT_CLASS_SINK &&
+                (peer->sink != target_sink + 1 || routes_via_insert(kp))) {
+                kp->needs_route = 1;
+            }
+        }
+        break;
+    }
+}
+
+/* Process pending port events (called from main thread, safe for jack_connect).
+ * Only newly added or changed sources are routed; the rest of the graph is not queried.
+ * Newly registered ports wait until their client's batch is due. */
+static void process_connections(void) {
+    PortEvent events[EVENT_QUEUE_SIZE];
+    unsigned int n_events = 0;
+    int rescan;
+    uint64_t now;
+    unsigned int routed = 0;            /* Sources routed in this pass */
+    unsigned int routed_pending = 0;    /* Pending sources routed in this pass */
+    unsigned int newly_pending = 0;     /* Sources that started waiting in this pass */
+    unsigned int waiting = 0;           /* Sources still waiting after this pass */
     
     /* Prevent concurrent execution - if already processing, skip this call */
     if (is_processing) {
@@ -228,103 +1179,546 @@ static void process_connections(void) {
     }
     is_processing = 1;
     
-    /* Reload config to catch GUI changes */
-    load_config();
+    /* Without inotify, fall back to re-reading config on every pass */
+    if (inotify_fd < 0) reload_config();
     
-    /* Get all output ports */
-    ports = jack_get_ports(client, NULL, NULL, JackPortIsOutput);
-    if (!ports) return;
+    /* Drain the event queue in one go so callbacks are never blocked for long */
+    pthread_mutex_lock(&event_lock);
+    while (event_count > 0) {
+        events[n_events++] = event_queue[event_head];
+        event_head = (event_head + 1) % EVENT_QUEUE_SIZE;
+        event_count--;
+    }
+    rescan = needs_full_rescan;
+    needs_full_rescan = 0;
+    pthread_mutex_unlock(&event_lock);
+    
+    if (rescan) {
+        rescan_all_ports();
+    } else {
+        for (unsigned int i = 0; i < n_events; i++) {
+            apply_port_event(&events[i]);
+        }
+    }
+    if (insert_check) update_insert();
     
-    for (i = 0; ports[i]; i++) {
-        const char *port_name = ports[i];
+    /* Decide which batches are due before routing so a batch is flushed as a whole */
+    now = monotonic_ns();
+    for (int i = 0; i < MAX_CLIENT_BATCHES; i++) {
+        batches[i].ready = batches[i].in_use && batch_deadline_ns(&batches[i]) <= now;
+    }
+    
+    /* Route the delta: new ports, moved ports, and everything after a target change */
+    for (size_t id = 0; id < known_ports_len; id++) {
+        KnownPort *kp = &known_ports[id];
+        jack_port_t *port;
+        const char *port_name;
         
-        /* Skip sink ports, capture ports, and MIDI ports */
-        if (is_sink_port(port_name) || is_capture_port(port_name) || is_midi_port(port_name))
+        if (!kp->in_use) continue;
+        if (kp->pending && !retry_pending) {
+            waiting++; /* No point asking again until a target sink port registers */
             continue;
+        }
+        if (!kp->needs_route && kp->routed_gen == route_gen) continue;
+        kp->pinned = 0; /* Target changed since the restore */
+        if (kp->batch) {
+            ClientBatch *cb = &batches[kp->batch - 1];
+            if (!cb->ready) continue; /* Client still registering ports */
+            cb->routed++;
+            kp->batch = 0;
+        }
         
-        /* Check if this source is already connected to our target */
-        const char **connections = jack_port_get_all_connections(client, jack_port_by_name(client, port_name));
-        int already_connected = 0;
+        port = jack_port_by_id(client, (jack_port_id_t)id);
+        if (!port) {
+            memset(kp, 0, sizeof(KnownPort));
+            continue;
+        }
+        port_name = jack_port_name(port);
         
-        if (connections) {
-            for (int j = 0; connections[j]; j++) {
-                if (strstr(connections[j], target_sink_prefix) != NULL) {
-                    already_connected = 1;
-                    break;
-                }
-            }
-            jack_free(connections);
+        if (connect_source_to_sink(port_name, kp->channel, routes_via_insert(kp)) == 0) {
+            TRACE(TRACE_EVENT, TRACE_EV_MGR_ROUTED, kp->channel, port_name);
+            routed++;
+            if (kp->pending) routed_pending++;
+            kp->needs_route = 0;
+            kp->routed_gen = route_gen;
+            kp->pending = 0;
+        } else {
+            /* Target ports missing: the entry stays dirty and waits for them */
+            if (!kp->pending) newly_pending++;
+            kp->pending = 1;
+            waiting++;
+        }
+    }
+    retry_pending = 0;
+    
+    /* Finish a restore as the ports it is waiting for register */
+    if (restore_retry && restore_missing.n > 0) {
+        size_t before = restore_missing.n;
+        size_t left = graph_restore(client, &restore_missing);
+        
+        if (left < before) {
+            fprintf(stderr, "jack-connection-manager: Restored %zu more connection(s), %zu still missing\n",
+                    before - left, left);
         }
+    }
+    restore_retry = 0;
+    
+    if (fanout_retry) {
+        int waiting_before = fanout_waiting;
         
-        if (!already_connected) {
-            fprintf(stderr, "jack-connection-manager: Routing '%s' -> %s\n",
-                    port_name, target_sink_prefix);
-            connect_source_to_sink(port_name);
+        fanout_waiting = fanout_connect_outputs();
+        if (fanout_waiting > 0 && fanout_waiting != waiting_before) {
+            fprintf(stderr, "jack-connection-manager: %d fan-out output(s) waiting for their ports\n",
+                    fanout_waiting);
         }
+        fanout_retry = 0;
+    }
+    
+    if (routed > 0) {
+        fprintf(stderr, "jack-connection-manager: Routed %u source(s) -> %s%s\n",
+                routed, target_sink_prefix, insert_active ? " (via insert)" : "");
+        TRACE(TRACE_STAGE, TRACE_EV_MGR_PASS, routed, target_sink_prefix);
+    }
+    if (routed_pending > 0) {
+        fprintf(stderr, "jack-connection-manager: %s ports available, routed %u waiting source(s)\n",
+                target_sink_prefix, routed_pending);
+    }
+    if (newly_pending > 0) {
+        fprintf(stderr, "jack-connection-manager: %s ports not registered yet, %u source(s) waiting\n",
+                target_sink_prefix, waiting);
+    }
+    
+    for (int i = 0; i < MAX_CLIENT_BATCHES; i++) {
+        if (batches[i].ready) finish_batch(&batches[i], now);
     }
     
-    jack_free(ports);
     is_processing = 0; /* Release lock */
 }
 
+/* Path of a named snapshot, creating its directory when asked.
+ * Returns 0, or -1 for an invalid name (or no $HOME). */
+static int graph_file_path(const char *name, char *path, size_t size, int create_dir) {
+    const char *home = getenv("HOME");
+    size_t len = strlen(name);
+    
+    if (!home || len == 0 || len > GRAPH_NAME_MAX) return -1;
+    for (size_t i = 0; i < len; i++) {
+        char c = name[i];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+              c == '_' || c == '-')) {
+            return -1;
+        }
+    }
+    
+    if (create_dir) {
+        snprintf(path, size, "%s/.config", home);
+        mkdir(path, 0755);
+        snprintf(path, size, "%s/%s", home, USER_CONF_DIR);
+        mkdir(path, 0755);
+        snprintf(path, size, "%s/%s", home, USER_GRAPH_DIR);
+        mkdir(path, 0755);
+    }
+    snprintf(path, size, "%s/%s/%s.graph", home, USER_GRAPH_DIR, name);
+    return 0;
+}
+
+/* Control request "save <name>": snapshot the live graph to a file */
+static void control_save(const char *name, char *reply, size_t size) {
+    JackGraph graph = JACK_GRAPH_INIT;
+    char path[512];
+    
+    if (graph_file_path(name, path, sizeof(path), 1) != 0) {
+        snprintf(reply, size, "error invalid snapshot name");
+        return;
+    }
+    if (graph_capture(client, &graph) != 0) {
+        snprintf(reply, size, "error out of memory");
+        return;
+    }
+    if (graph_save(&graph, path) != 0) {
+        fprintf(stderr, "jack-connection-manager: Failed to save %s: %s\n", path, strerror(errno));
+        snprintf(reply, size, "error %s", strerror(errno));
+    } else {
+        fprintf(stderr, "jack-connection-manager: Saved routing '%s' (%zu connections)\n", name, graph.n);
+        snprintf(reply, size, "ok %zu", graph.n);
+    }
+    graph_clear(&graph);
+}
+
+/* Diff the snapshot in path against the live graph and apply only the
+ * changes. Its sources are pinned so the connect events the restore causes
+ * are not routed back to the target; connections whose ports are missing
+ * are finished as the ports register. */
+static void restore_graph_file(const char *name, const char *path, char *reply, size_t size) {
+    GraphApplyStats stats;
+    uint64_t start = monotonic_ns();
+    
+    graph_clear(&restore_missing);
+    if (graph_load(&restored_graph, path) != 0) {
+        snprintf(reply, size, "error %s", errno == ENOENT ? "no such snapshot" : strerror(errno));
+        return;
+    }
+    if (graph_apply(client, &restored_graph, &restore_missing, &stats) != 0) {
+        graph_clear(&restored_graph);
+        graph_clear(&restore_missing);
+        snprintf(reply, size, "error out of memory");
+        return;
+    }
+    
+    /* Pins of an earlier restore no longer apply */
+    for (size_t id = 0; id < known_ports_len; id++) known_ports[id].pinned = 0;
+    for (size_t i = 0; i < restored_graph.n; i++) {
+        const char *source = restored_graph.conns[i].source;
+        jack_port_t *port;
+        jack_port_id_t id;
+        
+        /* Sorted by graph_apply(): visit each source once */
+        if (i > 0 && strcmp(source, restored_graph.conns[i - 1].source) == 0) continue;
+        port = jack_port_by_name(client, source);
+        if (!port) continue;
+        id = port_id_of(port);
+        if (id < known_ports_len && known_ports[id].in_use) pin_port(&known_ports[id]);
+    }
+    
+    fprintf(stderr, "jack-connection-manager: Restored routing '%s': %zu connected, %zu disconnected, "
+            "%zu unchanged, %zu missing (%.2f ms)\n", name, stats.connected, stats.disconnected,
+            stats.unchanged, stats.missing, (monotonic_ns() - start) / 1e6);
+    snprintf(reply, size, "ok %zu %zu %zu %zu %llu", stats.connected, stats.disconnected,
+             stats.unchanged, stats.missing, (unsigned long long)((monotonic_ns() - start) / 1000));
+}
+
+/* Control request "restore <name>": restore a saved snapshot */
+static void control_restore(const char *name, char *reply, size_t size) {
+    char path[512];
+    
+    if (graph_file_path(name, path, sizeof(path), 0) != 0) {
+        snprintf(reply, size, "error invalid snapshot name");
+        return;
+    }
+    restore_graph_file(name, path, reply, size);
+}
+
+/* Control request "restart": restore the graph jack-bridge-dbus saved before
+ * restarting the server. Applied here rather than by the service so that
+ * routing new ports and putting the old graph back cannot interleave. The
+ * file must be root's, as only the service writes it. */
+static void control_restart(char *reply, size_t size) {
+    struct stat st;
+    
+    if (lstat(GRAPH_RESTART_PATH, &st) != 0 || !S_ISREG(st.st_mode) || st.st_uid != 0) {
+        snprintf(reply, size, "error no restart snapshot");
+        return;
+    }
+    restore_graph_file("restart", GRAPH_RESTART_PATH, reply, size);
+}
+
+/* Listen on the per-user control socket. /tmp is shared, so the directory
+ * must be ours and private before the socket is trusted. Returns the fd or -1. */
+static int open_control_socket(void) {
+    struct sockaddr_un addr;
+    struct stat st;
+    char dir[64];
+    uid_t uid = getuid();
+    int fd;
+    
+    snprintf(dir, sizeof(dir), GRAPH_CONTROL_DIR_FMT, (unsigned int)uid);
+    if (mkdir(dir, 0700) != 0 && errno != EEXIST) {
+        fprintf(stderr, "jack-connection-manager: Cannot create %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+    if (lstat(dir, &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != uid || (st.st_mode & 077)) {
+        fprintf(stderr, "jack-connection-manager: %s is not a private directory, control socket disabled\n", dir);
+        return -1;
+    }
+    
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(control_path, sizeof(control_path), GRAPH_CONTROL_SOCKET_FMT, (unsigned int)uid);
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", control_path);
+    
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        fprintf(stderr, "jack-connection-manager: Cannot create control socket: %s\n", strerror(errno));
+        return -1;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    
+    unlink(control_path); /* Left behind by an earlier instance */
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 4) != 0) {
+        fprintf(stderr, "jack-connection-manager: Cannot listen on %s: %s\n", control_path, strerror(errno));
+        close(fd);
+        control_path[0] = '\0';
+        return -1;
+    }
+    return fd;
+}
+
+/* Accept a control client without waiting for its request: the line is
+ * read as it arrives, from the main loop's poll() */
+static void accept_control_client(void) {
+    ControlClient *c = NULL;
+    int fd;
+    
+    for (int i = 0; i < MAX_CONTROL_CLIENTS && !c; i++) {
+        if (!control_clients[i].in_use) c = &control_clients[i];
+    }
+    if (!c) return; /* Not polled while full; the rest wait in the backlog */
+    
+    fd = accept(control_fd, NULL, NULL);
+    if (fd < 0) return;
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    
+    c->in_use = 1;
+    c->fd = fd;
+    c->len = 0;
+    c->deadline_ns = monotonic_ns() + (uint64_t)CONTROL_TIMEOUT_MS * 1000000ull;
+}
+
+/* Send the reply line and drop the client */
+static void finish_control_client(ControlClient *c, char *reply) {
+    size_t len = strlen(reply);
+    
+    reply[len++] = '\n';
+    /* One short line always fits a fresh socket's buffer */
+    if (send(c->fd, reply, len, MSG_NOSIGNAL | MSG_DONTWAIT) < 0) {
+        fprintf(stderr, "jack-connection-manager: Control reply failed: %s\n", strerror(errno));
+    }
+    close(c->fd);
+    c->in_use = 0;
+}
+
+/* Take what a client has sent; serve its request once the line is complete:
+ * a single line in, a single line out */
+static void read_control_client(ControlClient *c) {
+    char reply[128];
+    char *nl;
+    ssize_t r = recv(c->fd, c->request + c->len, sizeof(c->request) - 1 - c->len, 0);
+    
+    if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return;
+    if (r > 0) {
+        c->len += (size_t)r;
+        c->request[c->len] = '\0';
+    }
+    nl = r > 0 ? strchr(c->request, '\n') : NULL;
+    if (!nl && r > 0 && c->len < sizeof(c->request) - 1) return; /* More to come */
+    
+    if (!nl) {
+        snprintf(reply, sizeof(reply), "error malformed request");
+    } else {
+        *nl = '\0';
+        if (strncmp(c->request, "save ", 5) == 0) {
+            control_save(c->request + 5, reply, sizeof(reply));
+        } else if (strncmp(c->request, "restore ", 8) == 0) {
+            control_restore(c->request + 8, reply, sizeof(reply));
+        } else if (strcmp(c->request, "restart") == 0) {
+            control_restart(reply, sizeof(reply));
+        } else {
+            snprintf(reply, sizeof(reply), "error unknown request");
+        }
+    }
+    finish_control_client(c, reply);
+}
+
+/* Drop clients whose request did not arrive in time. Returns the poll()
+ * timeout until the next deadline, or -1 if no client is waiting. */
+static int expire_control_clients(void) {
+    uint64_t now = monotonic_ns();
+    uint64_t earliest = UINT64_MAX;
+    char reply[128];
+    
+    for (int i = 0; i < MAX_CONTROL_CLIENTS; i++) {
+        ControlClient *c = &control_clients[i];
+        
+        if (!c->in_use) continue;
+        if (c->deadline_ns <= now) {
+            snprintf(reply, sizeof(reply), "error request timed out");
+            finish_control_client(c, reply);
+        } else if (c->deadline_ns < earliest) {
+            earliest = c->deadline_ns;
+        }
+    }
+    
+    if (earliest == UINT64_MAX) return -1;
+    return (int)((earliest - now + 999999ull) / 1000000ull);
+}
+
 /* JACK shutdown callback */
 static void jack_shutdown_callback(void *arg) {
     (void)arg;
     fprintf(stderr, "jack-connection-manager: JACK server shutdown\n");
     keep_running = 0;
+    wake_main_thread();
 }
 
 int main(void) {
     jack_status_t status;
+    struct pollfd pfds[3 + MAX_CONTROL_CLIENTS];
+    int client_idx[MAX_CONTROL_CLIENTS];
+    nfds_t nfds = 1, n_fixed;
+    int inotify_idx = -1;
+    int control_idx = -1;
+    
+    /* Create wakeup eventfd before any callback or signal handler can fire */
+    wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wake_fd < 0) {
+        fprintf(stderr, "jack-connection-manager: Failed to create eventfd: %s\n", strerror(errno));
+        return 1;
+    }
+    
+    trace_init("manager");
     
     /* Setup signal handlers */
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
+    signal(SIGUSR1, stats_signal_handler);
+    
+    /* Watch config before the first read so no change can slip in between */
+    inotify_fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (inotify_fd < 0) {
+        fprintf(stderr, "jack-connection-manager: inotify unavailable (%s), re-reading config on every pass\n",
+                strerror(errno));
+    }
+    add_config_watches();
     
     /* Load initial config */
     load_config();
-    fprintf(stderr, "jack-connection-manager: Starting (preferred output: %s)\n", preferred_output);
+    fprintf(stderr, "jack-connection-manager: Starting (preferred output: %s, batch quiet %d ms, max %d ms)\n",
+            preferred_output, batch_quiet_ms, batch_max_ms);
     
     /* Open JACK client */
     client = jack_client_open("connection_manager", JackNoStartServer, &status);
     if (!client) {
         fprintf(stderr, "jack-connection-manager: Failed to connect to JACK server\n");
+        if (inotify_fd >= 0) close(inotify_fd);
+        close(wake_fd);
         return 1;
     }
     
     /* Register callbacks */
     jack_set_port_registration_callback(client, port_registration_callback, NULL);
+    jack_set_port_connect_callback(client, port_connect_callback, NULL);
     jack_on_shutdown(client, jack_shutdown_callback, NULL);
+    fanout_ready = fanout_init(client) == 0;
     
     /* Activate client */
     if (jack_activate(client)) {
         fprintf(stderr, "jack-connection-manager: Cannot activate JACK client\n");
         jack_client_close(client);
+        if (inotify_fd >= 0) close(inotify_fd);
+        close(wake_fd);
         return 1;
     }
     
     fprintf(stderr, "jack-connection-manager: Running (event-driven, zero CPU when idle)\n");
     
+    /* The mixer's ports can only be connected once we are active */
+    apply_fanout();
+    
     /* CRITICAL: Process existing ports at startup (don't wait for new ports)
      * At boot, apps may already be connected to system:playback via ALSA defaults.
-     * We need to disconnect them and reconnect to the user's preferred output. */
-    sleep(1);  /* Brief wait for bridge ports (reduced from 2s) */
+     * We need to disconnect them and reconnect to the user's preferred output.
+     * If the bridge ports are not up yet, those sources wait for their registration. */
     fprintf(stderr, "jack-connection-manager: Processing existing connections at startup\n");
     process_connections();
     
-    /* Main loop: process connections when signaled, otherwise sleep */
-    struct timespec sleep_time = {0, 100000000}; /* 100ms = 100,000,000 nanoseconds */
+    control_fd = open_control_socket();
+    
+    /* Main loop: block until a callback, signal, config change or control
+     * request wakes us, then route */
+    pfds[0].fd = wake_fd;
+    pfds[0].events = POLLIN;
+    if (inotify_fd >= 0) {
+        inotify_idx = (int)nfds;
+        pfds[nfds].fd = inotify_fd;
+        pfds[nfds++].events = POLLIN;
+    }
+    n_fixed = nfds;
     while (keep_running) {
-        if (needs_reconnect) {
+        int config_changed = 0;
+        int batch_timeout = next_batch_timeout_ms();
+        int control_timeout = expire_control_clients();
+        int timeout = batch_timeout < 0 || (control_timeout >= 0 && control_timeout < batch_timeout)
+                      ? control_timeout : batch_timeout;
+        int ret;
+        
+        /* Control clients are polled with everything else, so a slow one
+         * never holds up routing */
+        nfds = n_fixed;
+        control_idx = -1;
+        for (int i = 0; i < MAX_CONTROL_CLIENTS; i++) {
+            client_idx[i] = -1;
+            if (control_clients[i].in_use) {
+                client_idx[i] = (int)nfds;
+                pfds[nfds].fd = control_clients[i].fd;
+                pfds[nfds++].events = POLLIN;
+            } else if (control_fd >= 0 && control_idx < 0) {
+                control_idx = (int)nfds;
+                pfds[nfds].fd = control_fd;
+                pfds[nfds++].events = POLLIN;
+            }
+        }
+        
+        ret = poll(pfds, nfds, timeout);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "jack-connection-manager: poll() failed: %s\n", strerror(errno));
+            break;
+        }
+        
+        if (pfds[0].revents & POLLIN) {
+            uint64_t count;
+            if (read(wake_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+                fprintf(stderr, "jack-connection-manager: eventfd read failed: %s\n", strerror(errno));
+            }
+        }
+        
+        /* Output switched in mxeq: re-route existing sources right away */
+        if (inotify_idx >= 0 && (pfds[inotify_idx].revents & POLLIN) && read_config_events()) {
+            config_changed = reload_config();
+            TRACE(TRACE_STAGE, TRACE_EV_MGR_CONFIG, config_changed, preferred_output);
+        }
+        
+        for (int i = 0; i < MAX_CONTROL_CLIENTS; i++) {
+            if (client_idx[i] >= 0 && pfds[client_idx[i]].revents) {
+                read_control_client(&control_clients[i]);
+            }
+        }
+        if (control_idx >= 0 && (pfds[control_idx].revents & POLLIN)) {
+            accept_control_client();
+        }
+        
+        if (dump_stats) {
+            dump_stats = 0;
+            log_batch_stats();
+        }
+        
+        /* ret == 0: a pending batch (not a control client) reached its deadline */
+        if (keep_running && (needs_reconnect || config_changed || (ret == 0 && timeout == batch_timeout))) {
             needs_reconnect = 0;
             process_connections();
         }
-        nanosleep(&sleep_time, NULL); /* 100ms sleep - responsive but low CPU */
     }
     
     /* Clean shutdown */
     fprintf(stderr, "jack-connection-manager: Shutting down\n");
+    log_batch_stats();
     jack_client_close(client);
+    fanout_shutdown();
+    for (int i = 0; i < MAX_CONTROL_CLIENTS; i++) {
+        if (control_clients[i].in_use) close(control_clients[i].fd);
+    }
+    if (control_fd >= 0) {
+        close(control_fd);
+        unlink(control_path);
+    }
+    if (inotify_fd >= 0) close(inotify_fd);
+    close(wake_fd);
+    free(known_ports);
+    graph_clear(&restored_graph);
+    graph_clear(&restore_missing);
+    trace_shutdown();
     
     return 0;
 }
\ No newline at end of file
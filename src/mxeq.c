@@ -3,19 +3,30 @@
 #include <stdio.h>
 #include <string.h>
 #include <glib/gstdio.h> // For g_mkdir_with_parents and file operations
+#include <glib-unix.h>
 #include <signal.h>
 #include <time.h>
 #include <unistd.h>
+#include <errno.h>
 #include <stdlib.h>
+#include <math.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include "mxeq_recorder.h"
+#include "mxeq_eq.h"
+#include "mxeq_meter.h"
+#include "mxeq_devices.h"
+#include "jack_bridge_route.h"
+#include "jack_bridge_trace.h"
 
 /* Forward declaration for Devices panel (Playback switching) */
 static void create_devices_panel(GtkWidget *main_box);
 
 /* Forward declarations needed by earlier callers */
 static int write_string_atomic(const char *path, const char *content);
-static gboolean bluealsa_ports_exist(void);
+static char *user_config_dir(void);
+
+typedef struct MixerWriter MixerWriter;
 
 typedef struct {
     snd_mixer_t *mixer;
@@ -24,14 +35,46 @@ typedef struct {
     GtkWidget *mute_check;
     const char *channel_name;
     gboolean is_capture;  /* TRUE if this is a capture control, FALSE for playback */
+    int index;  /* Position in the card's channel array */
+    unsigned int selem_index;  /* ALSA simple element index (for controls sharing a name) */
+    MixerWriter *writer;  /* Off-thread volume writer (USB cards), NULL to write inline */
+    gdouble pending_value;  /* Latest slider value not yet written */
+    guint tick_id;  /* Frame clock callback that flushes pending_value, 0 if none */
+    gint writes_in_flight;  /* Values handed to the writer thread but not yet applied (atomic) */
 } MixerChannel;
 
+/* Volume writer for cards with slow control transfers. It owns a second mixer
+   handle for the card, so the main loop's handle is never used off-thread. */
+struct MixerWriter {
+    int card;
+    GThread *thread;
+    GMutex lock;
+    GCond cond;
+    gboolean quit;
+    MixerChannel *channels;  /* The owning card's channels */
+    int num_channels;
+    gdouble *values;  /* Latest value per channel, valid where dirty[] is set */
+    gboolean *dirty;
+};
+
+/* One opened card: its mixer stays open (and watched) across card switches */
+typedef struct {
+    int card;
+    snd_mixer_t *mixer;  /* NULL once the card went away */
+    MixerChannel *channels;
+    int num_channels;
+    guint *watch_ids;  /* g_unix_fd_add() sources for the mixer's poll descriptors */
+    int num_watches;
+    MixerWriter *writer;
+} MixerCard;
+
 typedef struct {
     snd_mixer_t *mixer;
     MixerChannel *channels;
     int num_channels;
     int current_card;  /* Track which card we're showing (0=internal, 1=USB, etc.) */
     GtkWidget *mixer_box;  /* Reference to container for dynamic rebuild */
+    GSList *cards;  /* MixerCard cache; mixer/channels above point into the current card */
 } MixerData;
 
 /* UI globals used to keep window/expander references for compacting behavior.
@@ -39,6 +82,8 @@ typedef struct {
    main window back to a compact size when all expanders are collapsed. */
 static GtkWidget *g_main_window = NULL;
 static GtkWidget *g_eq_expander = NULL;
+static GtkWidget *g_equalizer_expander = NULL;
+static GtkWidget *g_levels_expander = NULL;
 static GtkWidget *g_bt_expander = NULL;
 static GtkWidget *g_dev_expander = NULL;
 /* Expose Bluetooth device tree to Devices (Playback) panel for MAC selection */
@@ -72,6 +117,10 @@ static void on_any_expander_toggled(GObject *object, GParamSpec *pspec, gpointer
     gboolean bt_exp = gtk_expander_get_expanded(GTK_EXPANDER(g_bt_expander));
     gboolean dev_exp = gtk_expander_get_expanded(GTK_EXPANDER(g_dev_expander));
 
+    /* The Equalizer and Levels panels count as large panels, like Recording */
+    if (g_equalizer_expander && gtk_expander_get_expanded(GTK_EXPANDER(g_equalizer_expander))) eq_exp = TRUE;
+    if (g_levels_expander && gtk_expander_get_expanded(GTK_EXPANDER(g_levels_expander))) eq_exp = TRUE;
+
     if (!eq_exp && !bt_exp && !dev_exp) {
         /* All collapsed - shrink to compact height */
         gtk_window_resize(GTK_WINDOW(g_main_window), 600, 260);
@@ -294,17 +343,140 @@ static void on_bt_discoverable_toggled(GtkSwitch *sw, gboolean state, gpointer u
         g_signal_handlers_unblock_by_func(sw, G_CALLBACK(on_bt_discoverable_toggled), NULL);
     }
 }
-static void slider_changed(GtkRange *range, MixerChannel *channel) {
-    gdouble value = gtk_range_get_value(range);
+/* Write a slider position (0..1) to a volume element */
+static void apply_channel_volume(snd_mixer_elem_t *elem, gboolean is_capture, gdouble value) {
     long min, max;
-    if (channel->is_capture) {
-        snd_mixer_selem_get_capture_volume_range(channel->elem, &min, &max);
+    if (is_capture) {
+        snd_mixer_selem_get_capture_volume_range(elem, &min, &max);
         long alsa_value = (long)(value * (max - min) + min);
-        snd_mixer_selem_set_capture_volume_all(channel->elem, alsa_value);
+        snd_mixer_selem_set_capture_volume_all(elem, alsa_value);
     } else {
-        snd_mixer_selem_get_playback_volume_range(channel->elem, &min, &max);
+        snd_mixer_selem_get_playback_volume_range(elem, &min, &max);
         long alsa_value = (long)(value * (max - min) + min);
-        snd_mixer_selem_set_playback_volume_all(channel->elem, alsa_value);
+        snd_mixer_selem_set_playback_volume_all(elem, alsa_value);
+    }
+}
+
+/* Writer thread: apply the newest value of each dirty channel until told to quit.
+   Pending values are drained before quitting so the last drag position sticks. */
+static gpointer mixer_writer_thread(gpointer user_data) {
+    MixerWriter *w = (MixerWriter *)user_data;
+    gchar *card_str = g_strdup_printf("hw:%d", w->card);
+    snd_mixer_t *m = NULL;
+    snd_mixer_elem_t **elems = g_new0(snd_mixer_elem_t *, w->num_channels);
+    snd_mixer_selem_id_t *sid;
+
+    /* Resolve the same controls on this thread's own handle, by name and index */
+    snd_mixer_selem_id_alloca(&sid);
+    if (snd_mixer_open(&m, 0) == 0 &&
+        snd_mixer_attach(m, card_str) == 0 &&
+        snd_mixer_selem_register(m, NULL, NULL) == 0 &&
+        snd_mixer_load(m) == 0) {
+        for (int i = 0; i < w->num_channels; i++) {
+            snd_mixer_selem_id_set_name(sid, w->channels[i].channel_name);
+            snd_mixer_selem_id_set_index(sid, w->channels[i].selem_index);
+            elems[i] = snd_mixer_find_selem(m, sid);
+        }
+    } else {
+        fprintf(stderr, "init_alsa_mixer: writer could not open %s, slider writes are dropped\n", card_str);
+    }
+    g_free(card_str);
+
+    g_mutex_lock(&w->lock);
+    for (;;) {
+        int i = 0;
+        while (i < w->num_channels && !w->dirty[i]) i++;
+        if (i == w->num_channels) {
+            if (w->quit) break;
+            g_cond_wait(&w->cond, &w->lock);
+            continue;
+        }
+
+        gdouble value = w->values[i];
+        w->dirty[i] = FALSE;
+        g_mutex_unlock(&w->lock);
+
+        if (elems[i]) {
+            apply_channel_volume(elems[i], w->channels[i].is_capture, value);
+        }
+        g_atomic_int_add(&w->channels[i].writes_in_flight, -1);
+
+        g_mutex_lock(&w->lock);
+    }
+    g_mutex_unlock(&w->lock);
+
+    g_free(elems);
+    if (m) snd_mixer_close(m);
+    return NULL;
+}
+
+static MixerWriter *mixer_writer_new(int card_num, MixerChannel *channels, int num_channels) {
+    MixerWriter *w = g_new0(MixerWriter, 1);
+    w->card = card_num;
+    w->channels = channels;
+    w->num_channels = num_channels;
+    w->values = g_new0(gdouble, num_channels);
+    w->dirty = g_new0(gboolean, num_channels);
+    g_mutex_init(&w->lock);
+    g_cond_init(&w->cond);
+    w->thread = g_thread_new("mxeq-mixer-writer", mixer_writer_thread, w);
+    return w;
+}
+
+/* Flush outstanding writes, then stop the thread */
+static void mixer_writer_free(MixerWriter *w) {
+    g_mutex_lock(&w->lock);
+    w->quit = TRUE;
+    g_cond_signal(&w->cond);
+    g_mutex_unlock(&w->lock);
+    g_thread_join(w->thread);
+
+    g_mutex_clear(&w->lock);
+    g_cond_clear(&w->cond);
+    g_free(w->values);
+    g_free(w->dirty);
+    g_free(w);
+}
+
+/* Hand the newest value to the writer; an older value still queued is replaced */
+static void mixer_writer_post(MixerWriter *w, MixerChannel *ch, gdouble value) {
+    g_mutex_lock(&w->lock);
+    if (!w->dirty[ch->index]) {
+        w->dirty[ch->index] = TRUE;
+        g_atomic_int_inc(&ch->writes_in_flight);
+    }
+    w->values[ch->index] = value;
+    g_cond_signal(&w->cond);
+    g_mutex_unlock(&w->lock);
+}
+
+/* Write the channel's pending slider value, inline or through its writer */
+static void flush_channel_volume(MixerChannel *channel) {
+    if (!channel->elem) return;
+    if (channel->writer) {
+        mixer_writer_post(channel->writer, channel, channel->pending_value);
+    } else {
+        apply_channel_volume(channel->elem, channel->is_capture, channel->pending_value);
+    }
+}
+
+/* Frame clock callback: at most one volume write per channel per frame */
+static gboolean on_slider_tick(GtkWidget *widget, GdkFrameClock *clock, gpointer user_data) {
+    (void)widget;
+    (void)clock;
+    MixerChannel *channel = (MixerChannel *)user_data;
+    channel->tick_id = 0;
+    flush_channel_volume(channel);
+    return G_SOURCE_REMOVE;
+}
+
+/* A drag emits value-changed far more often than the screen refreshes, so only
+   the latest value is kept and written on the next frame. */
+static void slider_changed(GtkRange *range, MixerChannel *channel) {
+    if (!channel->elem) return;
+    channel->pending_value = gtk_range_get_value(range);
+    if (channel->tick_id == 0) {
+        channel->tick_id = gtk_widget_add_tick_callback(GTK_WIDGET(range), on_slider_tick, channel, NULL);
     }
 }
 
@@ -323,24 +495,169 @@ static void on_mute_toggled(GtkToggleButton *btn, gpointer user_data) {
     }
 }
 
-static void init_alsa_mixer(MixerData *data, int card_num) {
+/* Copy the element's current volume and switch into its widgets.
+   Signal handlers are blocked so the update is not written back to ALSA. */
+static void sync_channel_widgets(MixerChannel *ch) {
+    if (!ch->elem) return;
+
+    /* Leave the slider alone while our own writes are outstanding; their
+       events would otherwise pull it back while it is being dragged */
+    if (ch->scale && ch->tick_id == 0 && g_atomic_int_get(&ch->writes_in_flight) == 0) {
+        long min = 0, max = 0, value = 0;
+        if (ch->is_capture) {
+            snd_mixer_selem_get_capture_volume_range(ch->elem, &min, &max);
+            snd_mixer_selem_get_capture_volume(ch->elem, 0, &value);
+        } else {
+            snd_mixer_selem_get_playback_volume_range(ch->elem, &min, &max);
+            snd_mixer_selem_get_playback_volume(ch->elem, 0, &value);
+        }
+        g_signal_handlers_block_by_func(ch->scale, G_CALLBACK(slider_changed), ch);
+        gtk_range_set_value(GTK_RANGE(ch->scale), max > min ? (double)(value - min) / (max - min) : 0.0);
+        g_signal_handlers_unblock_by_func(ch->scale, G_CALLBACK(slider_changed), ch);
+    }
+
+    if (ch->mute_check) {
+        int sw = ch->is_capture ? 0 : 1;
+        gboolean active;
+        if (ch->is_capture) {
+            snd_mixer_selem_get_capture_switch(ch->elem, SND_MIXER_SCHN_FRONT_LEFT, &sw);
+            active = sw ? TRUE : FALSE;
+        } else {
+            snd_mixer_selem_get_playback_switch(ch->elem, SND_MIXER_SCHN_FRONT_LEFT, &sw);
+            active = sw ? FALSE : TRUE;
+        }
+        g_signal_handlers_block_by_func(ch->mute_check, G_CALLBACK(on_mute_toggled), ch);
+        gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(ch->mute_check), active);
+        g_signal_handlers_unblock_by_func(ch->mute_check, G_CALLBACK(on_mute_toggled), ch);
+    }
+}
+
+/* Element callback, run from snd_mixer_handle_events(): refresh only the
+   widgets of the control that changed. */
+static int on_mixer_elem_event(snd_mixer_elem_t *elem, unsigned int mask) {
+    MixerChannel *ch = (MixerChannel *)snd_mixer_elem_get_callback_private(elem);
+    if (!ch) return 0;
+
+    if (mask == SND_CTL_EVENT_MASK_REMOVE) {
+        /* Control disappeared (card unplugged): keep the widgets but stop using the element */
+        ch->elem = NULL;
+        if (ch->scale) gtk_widget_set_sensitive(ch->scale, FALSE);
+        if (ch->mute_check) gtk_widget_set_sensitive(ch->mute_check, FALSE);
+        return 0;
+    }
+    if (mask & SND_CTL_EVENT_MASK_VALUE) {
+        sync_channel_widgets(ch);
+    }
+    return 0;
+}
+
+/* Stop watching a card and close its mixer. The entry stays in the cache with
+   mixer == NULL until the next card switch drops it, because the visible
+   widgets may still point at its channels. */
+static void mixer_card_close(MixerCard *card) {
+    if (card->writer) {
+        mixer_writer_free(card->writer);
+        card->writer = NULL;
+        for (int i = 0; i < card->num_channels; i++) {
+            card->channels[i].writer = NULL;
+        }
+    }
+
+    for (int i = 0; i < card->num_watches; i++) {
+        if (card->watch_ids[i] > 0) {
+            g_source_remove(card->watch_ids[i]);
+        }
+    }
+    g_free(card->watch_ids);
+    card->watch_ids = NULL;
+    card->num_watches = 0;
+
+    if (card->mixer) {
+        /* Detach callbacks first: snd_mixer_close() raises REMOVE events and
+           the widgets may already be gone */
+        for (int i = 0; i < card->num_channels; i++) {
+            if (card->channels[i].elem) {
+                snd_mixer_elem_set_callback(card->channels[i].elem, NULL);
+                card->channels[i].elem = NULL;
+            }
+        }
+        snd_mixer_close(card->mixer);
+        card->mixer = NULL;
+    }
+}
+
+static void mixer_card_free(MixerCard *card) {
+    mixer_card_close(card);
+    for (int i = 0; i < card->num_channels; i++) {
+        g_free((char *)card->channels[i].channel_name);
+    }
+    g_free(card->channels);
+    g_free(card);
+}
+
+/* Main loop watch on one of the mixer's poll descriptors */
+static gboolean on_mixer_fd_ready(gint fd, GIOCondition condition, gpointer user_data) {
+    (void)fd;
+    MixerCard *card = (MixerCard *)user_data;
+
+    int err = card->mixer ? snd_mixer_handle_events(card->mixer) : -ENODEV;
+    if (err < 0 || (condition & (G_IO_ERR | G_IO_HUP | G_IO_NVAL))) {
+        fprintf(stderr, "init_alsa_mixer: card %d went away (%s)\n",
+                card->card, err < 0 ? snd_strerror(err) : "hangup");
+        for (int i = 0; i < card->num_channels; i++) {
+            MixerChannel *ch = &card->channels[i];
+            if (ch->scale) gtk_widget_set_sensitive(ch->scale, FALSE);
+            if (ch->mute_check) gtk_widget_set_sensitive(ch->mute_check, FALSE);
+        }
+        /* Removes this source too; GLib allows that from inside its dispatch */
+        mixer_card_close(card);
+        return G_SOURCE_REMOVE;
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+/* Hook the mixer's poll descriptors into the GLib main loop */
+static void mixer_card_watch(MixerCard *card) {
+    int count = snd_mixer_poll_descriptors_count(card->mixer);
+    if (count <= 0) return;
+
+    struct pollfd *pfds = g_new0(struct pollfd, count);
+    count = snd_mixer_poll_descriptors(card->mixer, pfds, (unsigned int)count);
+    card->watch_ids = g_new0(guint, MAX(count, 1));
+    for (int i = 0; i < count; i++) {
+        GIOCondition cond = G_IO_ERR | G_IO_HUP;
+        if (pfds[i].events & POLLIN) cond |= G_IO_IN;
+        if (pfds[i].events & POLLPRI) cond |= G_IO_PRI;
+        if (pfds[i].events & POLLOUT) cond |= G_IO_OUT;
+        card->watch_ids[card->num_watches++] = g_unix_fd_add(pfds[i].fd, cond, on_mixer_fd_ready, card);
+    }
+    g_free(pfds);
+}
+
+/* TRUE if the card is driven by snd-usb-audio */
+static gboolean mixer_card_is_usb(int card_num) {
+    gchar *card_str = g_strdup_printf("hw:%d", card_num);
+    snd_ctl_t *ctl = NULL;
+    snd_ctl_card_info_t *info;
+    gboolean usb = FALSE;
+
+    snd_ctl_card_info_alloca(&info);
+    if (snd_ctl_open(&ctl, card_str, 0) == 0) {
+        if (snd_ctl_card_info(ctl, info) == 0) {
+            usb = g_strcmp0(snd_ctl_card_info_get_driver(info), "USB-Audio") == 0;
+        }
+        snd_ctl_close(ctl);
+    }
+    g_free(card_str);
+    return usb;
+}
+
+static MixerCard *open_mixer_card(int card_num) {
     /* Generic mixer initialization for specified card number.
      * Enumerates ALL simple mixer elements (no hardcoded names).
      * Works for any audio card: internal, USB, or external interfaces.
      */
     
-    /* Close existing mixer if reinitializing */
-    if (data->mixer) {
-        snd_mixer_close(data->mixer);
-        data->mixer = NULL;
-    }
-    if (data->channels) {
-        g_free(data->channels);
-        data->channels = NULL;
-    }
-    data->num_channels = 0;
-    data->current_card = card_num;
-    
     /* Build card attach string */
     gchar *card_str = g_strdup_printf("hw:%d", card_num);
     
@@ -348,25 +665,25 @@ static void init_alsa_mixer(MixerData *data, int card_num) {
     if (snd_mixer_open(&m, 0) < 0) {
         fprintf(stderr, "init_alsa_mixer: failed to open mixer for card %d\n", card_num);
         g_free(card_str);
-        return;
+        return NULL;
     }
     if (snd_mixer_attach(m, card_str) < 0) {
         fprintf(stderr, "init_alsa_mixer: failed to attach to %s\n", card_str);
         snd_mixer_close(m);
         g_free(card_str);
-        return;
+        return NULL;
     }
     if (snd_mixer_selem_register(m, NULL, NULL) < 0) {
         fprintf(stderr, "init_alsa_mixer: failed to register simple element class for %s\n", card_str);
         snd_mixer_close(m);
         g_free(card_str);
-        return;
+        return NULL;
     }
     if (snd_mixer_load(m) < 0) {
         fprintf(stderr, "init_alsa_mixer: failed to load mixer elements for %s\n", card_str);
         snd_mixer_close(m);
         g_free(card_str);
-        return;
+        return NULL;
     }
     
     fprintf(stderr, "init_alsa_mixer: successfully opened card %d (%s)\n", card_num, card_str);
@@ -383,12 +700,14 @@ static void init_alsa_mixer(MixerData *data, int card_num) {
     if (count == 0) {
         fprintf(stderr, "init_alsa_mixer: no simple mixer elements found on card %d\n", card_num);
         snd_mixer_close(m);
-        return;
+        return NULL;
     }
     
     /* Allocate channel array */
-    data->channels = g_new0(MixerChannel, count);
-    data->mixer = m;
+    MixerCard *card = g_new0(MixerCard, 1);
+    card->card = card_num;
+    card->mixer = m;
+    card->channels = g_new0(MixerChannel, count);
     
     /* Enumerate ALL simple mixer elements generically */
     int idx = 0;
@@ -435,29 +754,129 @@ static void init_alsa_mixer(MixerData *data, int card_num) {
             }
         }
         
-        data->channels[idx].elem = elem;
-        data->channels[idx].channel_name = g_strdup(name);  /* Allocate copy since elem names are transient */
-        data->channels[idx].is_capture = is_capture;
+        card->channels[idx].mixer = m;
+        card->channels[idx].index = idx;
+        card->channels[idx].selem_index = snd_mixer_selem_get_index(elem);
+        card->channels[idx].elem = elem;
+        card->channels[idx].channel_name = g_strdup(name);  /* Allocate copy since elem names are transient */
+        card->channels[idx].is_capture = is_capture;
+        /* Element events carry the channel so only its widgets are refreshed */
+        snd_mixer_elem_set_callback_private(elem, &card->channels[idx]);
+        snd_mixer_elem_set_callback(elem, on_mixer_elem_event);
         idx++;
     }
     
-    data->num_channels = idx;
+    card->num_channels = idx;
+    mixer_card_watch(card);
+    
+    /* USB control transfers can take milliseconds each; keep them off the GTK main loop */
+    if (idx > 0 && mixer_card_is_usb(card_num)) {
+        card->writer = mixer_writer_new(card_num, card->channels, idx);
+        for (int i = 0; i < idx; i++) {
+            card->channels[i].writer = card->writer;
+        }
+        fprintf(stderr, "init_alsa_mixer: card %d is USB, volume writes go through a worker thread\n", card_num);
+    }
     fprintf(stderr, "init_alsa_mixer: found %d mixer controls on card %d\n", idx, card_num);
+    return card;
+}
+
+static void init_alsa_mixer(MixerData *data, int card_num) {
+    /* Cards stay open and watched once seen, so switching back to a card does
+     * not re-enumerate it; its element values are kept current by events.
+     */
+    
+    /* The widgets of the card being left are about to be destroyed; write
+     * any slider value still waiting for its frame first */
+    for (int i = 0; i < data->num_channels; i++) {
+        if (data->channels[i].tick_id) {
+            gtk_widget_remove_tick_callback(data->channels[i].scale, data->channels[i].tick_id);
+            data->channels[i].tick_id = 0;
+            flush_channel_volume(&data->channels[i]);
+        }
+        data->channels[i].scale = NULL;
+        data->channels[i].mute_check = NULL;
+    }
+    data->mixer = NULL;
+    data->channels = NULL;
+    data->num_channels = 0;
+    data->current_card = card_num;
+    
+    /* Drop cards that went away since the last switch; a replugged card is opened afresh */
+    MixerCard *card = NULL;
+    for (GSList *l = data->cards; l != NULL; ) {
+        MixerCard *c = (MixerCard *)l->data;
+        GSList *next = l->next;
+        if (!c->mixer) {
+            data->cards = g_slist_delete_link(data->cards, l);
+            mixer_card_free(c);
+        } else if (c->card == card_num) {
+            card = c;
+        }
+        l = next;
+    }
+    
+    if (card) {
+        fprintf(stderr, "init_alsa_mixer: reusing cached mixer for card %d\n", card_num);
+    } else {
+        card = open_mixer_card(card_num);
+        if (!card) return;
+        data->cards = g_slist_prepend(data->cards, card);
+    }
+    
+    data->mixer = card->mixer;
+    data->channels = card->channels;
+    data->num_channels = card->num_channels;
 }
 
 static void cleanup_alsa(MixerData *mixer_data) {
-    if (mixer_data->mixer) {
-        snd_mixer_close(mixer_data->mixer);
-    }
-    if (mixer_data->channels) {
-        /* Free dynamically allocated channel names */
-        for (int i = 0; i < mixer_data->num_channels; i++) {
-            if (mixer_data->channels[i].channel_name) {
-                g_free((char*)mixer_data->channels[i].channel_name);
-            }
+    g_slist_free_full(mixer_data->cards, (GDestroyNotify)mixer_card_free);
+    mixer_data->cards = NULL;
+    mixer_data->mixer = NULL;
+    mixer_data->channels = NULL;
+    mixer_data->num_channels = 0;
+}
+
+/* Slider plus optional Mute (playback) or Enable (capture) checkbox for one control */
+static void add_channel_widgets(GtkWidget *mixer_box, MixerChannel *ch, int index) {
+    int col = index % 8;  // Max 8 columns per row
+    int row = index / 8;  // Automatic row wrapping
+    
+    GtkWidget *channel_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
+    gtk_grid_attach(GTK_GRID(mixer_box), channel_box, col, row, 1, 1);
+
+    GtkWidget *label = gtk_label_new(ch->channel_name);
+    gtk_widget_set_halign(label, GTK_ALIGN_CENTER);
+    gtk_box_pack_start(GTK_BOX(channel_box), label, FALSE, FALSE, 5);
+
+    ch->scale = gtk_scale_new_with_range(GTK_ORIENTATION_VERTICAL, 0, 1, 0.01);
+    gtk_range_set_inverted(GTK_RANGE(ch->scale), TRUE);
+    gtk_scale_set_draw_value(GTK_SCALE(ch->scale), TRUE);
+    gtk_scale_set_value_pos(GTK_SCALE(ch->scale), GTK_POS_BOTTOM);
+    gtk_widget_set_size_request(ch->scale, -1, 150);
+    gtk_box_pack_start(GTK_BOX(channel_box), ch->scale, TRUE, TRUE, 0);
+    g_signal_connect(ch->scale, "value-changed", G_CALLBACK(slider_changed), ch);
+
+    ch->mute_check = NULL;
+    if (ch->is_capture) {
+        /* Capture controls: expose Enable checkbox (checked=capture enabled) */
+        if (snd_mixer_selem_has_capture_switch(ch->elem)) {
+            ch->mute_check = gtk_check_button_new_with_label("Enable");
+        }
+    } else {
+        /* Playback controls: expose Mute checkbox (checked=muted) */
+        if (snd_mixer_selem_has_playback_switch(ch->elem)) {
+            ch->mute_check = gtk_check_button_new_with_label("Mute");
         }
-        g_free(mixer_data->channels);
     }
+    if (ch->mute_check) {
+        gtk_widget_set_halign(ch->mute_check, GTK_ALIGN_CENTER);
+        gtk_widget_set_margin_top(ch->mute_check, 4);
+        gtk_box_pack_start(GTK_BOX(channel_box), ch->mute_check, FALSE, FALSE, 2);
+        g_signal_connect(ch->mute_check, "toggled", G_CALLBACK(on_mute_toggled), ch);
+    }
+
+    sync_channel_widgets(ch);
 }
 
 /* Dynamic mixer rebuild: clear and repopulate mixer_box with controls from specified card */
@@ -466,6 +885,9 @@ static void rebuild_mixer_for_card(int card_num) {
     
     fprintf(stderr, "rebuild_mixer_for_card: switching to card %d\n", card_num);
     
+    /* Switch to the new card's (cached) mixer before its widgets are replaced */
+    init_alsa_mixer(g_mixer_data, card_num);
+    
     /* Clear existing mixer UI */
     GList *children = gtk_container_get_children(GTK_CONTAINER(g_mixer_data->mixer_box));
     for (GList *iter = children; iter != NULL; iter = g_list_next(iter)) {
@@ -473,9 +895,6 @@ static void rebuild_mixer_for_card(int card_num) {
     }
     g_list_free(children);
     
-    /* Reinitialize mixer for new card */
-    init_alsa_mixer(g_mixer_data, card_num);
-    
     /* Rebuild UI with new controls */
     if (g_mixer_data->num_channels == 0) {
         GtkWidget *no_mixer_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 6);
@@ -500,63 +919,7 @@ static void rebuild_mixer_for_card(int card_num) {
     
     /* Create slider for each control found (max 8 per row, auto-wrap) */
     for (int i = 0; i < g_mixer_data->num_channels; i++) {
-        int col = i % 8;  // Max 8 columns per row
-        int row = i / 8;  // Automatic row wrapping
-        
-        GtkWidget *channel_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
-        gtk_grid_attach(GTK_GRID(g_mixer_data->mixer_box), channel_box, col, row, 1, 1);
-
-        GtkWidget *label = gtk_label_new(g_mixer_data->channels[i].channel_name);
-        gtk_widget_set_halign(label, GTK_ALIGN_CENTER);
-        gtk_box_pack_start(GTK_BOX(channel_box), label, FALSE, FALSE, 5);
-
-        g_mixer_data->channels[i].scale = gtk_scale_new_with_range(GTK_ORIENTATION_VERTICAL, 0, 1, 0.01);
-        gtk_range_set_inverted(GTK_RANGE(g_mixer_data->channels[i].scale), TRUE);
-        gtk_scale_set_draw_value(GTK_SCALE(g_mixer_data->channels[i].scale), TRUE);
-        gtk_scale_set_value_pos(GTK_SCALE(g_mixer_data->channels[i].scale), GTK_POS_BOTTOM);
-        gtk_widget_set_size_request(g_mixer_data->channels[i].scale, -1, 150);
-        gtk_box_pack_start(GTK_BOX(channel_box), g_mixer_data->channels[i].scale, TRUE, TRUE, 0);
-        g_signal_connect(g_mixer_data->channels[i].scale, "value-changed", G_CALLBACK(slider_changed), &g_mixer_data->channels[i]);
-
-        long min, max, value;
-        if (g_mixer_data->channels[i].is_capture) {
-            snd_mixer_selem_get_capture_volume_range(g_mixer_data->channels[i].elem, &min, &max);
-            snd_mixer_selem_get_capture_volume(g_mixer_data->channels[i].elem, 0, &value);
-        } else {
-            snd_mixer_selem_get_playback_volume_range(g_mixer_data->channels[i].elem, &min, &max);
-            snd_mixer_selem_get_playback_volume(g_mixer_data->channels[i].elem, 0, &value);
-        }
-        gtk_range_set_value(GTK_RANGE(g_mixer_data->channels[i].scale), (double)(value - min) / (max - min));
-
-        /* Add Mute (playback) or Enable (capture) checkbox if control supports it */
-        g_mixer_data->channels[i].mute_check = NULL;
-        if (g_mixer_data->channels[i].is_capture) {
-            /* Capture controls: expose Enable checkbox (checked=capture enabled) */
-            if (snd_mixer_selem_has_capture_switch(g_mixer_data->channels[i].elem)) {
-                int sw = 0;
-                snd_mixer_selem_get_capture_switch(g_mixer_data->channels[i].elem, SND_MIXER_SCHN_FRONT_LEFT, &sw);
-                GtkWidget *enable = gtk_check_button_new_with_label("Enable");
-                gtk_widget_set_halign(enable, GTK_ALIGN_CENTER);
-                gtk_widget_set_margin_top(enable, 4);
-                gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(enable), sw ? TRUE : FALSE);
-                gtk_box_pack_start(GTK_BOX(channel_box), enable, FALSE, FALSE, 2);
-                g_signal_connect(enable, "toggled", G_CALLBACK(on_mute_toggled), &g_mixer_data->channels[i]);
-                g_mixer_data->channels[i].mute_check = enable;
-            }
-        } else {
-            /* Playback controls: expose Mute checkbox (checked=muted) */
-            if (snd_mixer_selem_has_playback_switch(g_mixer_data->channels[i].elem)) {
-                int sw = 1;
-                snd_mixer_selem_get_playback_switch(g_mixer_data->channels[i].elem, SND_MIXER_SCHN_FRONT_LEFT, &sw);
-                GtkWidget *mute = gtk_check_button_new_with_label("Mute");
-                gtk_widget_set_halign(mute, GTK_ALIGN_CENTER);
-                gtk_widget_set_margin_top(mute, 4);
-                gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(mute), sw ? FALSE : TRUE);
-                gtk_box_pack_start(GTK_BOX(channel_box), mute, FALSE, FALSE, 2);
-                g_signal_connect(mute, "toggled", G_CALLBACK(on_mute_toggled), &g_mixer_data->channels[i]);
-                g_mixer_data->channels[i].mute_check = mute;
-            }
-        }
+        add_channel_widgets(g_mixer_data->mixer_box, &g_mixer_data->channels[i], i);
     }
     
     gtk_widget_show_all(g_mixer_data->mixer_box);
@@ -564,13 +927,18 @@ static void rebuild_mixer_for_card(int card_num) {
             g_mixer_data->num_channels, card_num);
 }
  
-/* Recorder support: enhanced UX, safe child lifecycle, XDG Music path handling */
+/* Recorder support: enhanced UX, safe child lifecycle, XDG Music path handling.
+   Takes go through the JACK-native recorder (src/mxeq_recorder.c); arecord via
+   the ALSA 'jack' PCM remains the fallback when the native path cannot start. */
 
 typedef struct {
     GtkWidget *status_label;
     GtkWidget *filename_entry;
     GtkWidget *channel_combo;   /* Mono / Stereo */
     GtkWidget *rate_combo;      /* 44100 / 48000 */
+    GtkWidget *tracks_entry;    /* JACK source ports, one track each (empty = system capture) */
+    GtkWidget *layout_combo;    /* One file / File per track */
+    GtkWidget *preroll_spin;    /* Seconds kept before Record is pressed, 0 = off */
     GtkWidget *record_btn;
     GtkWidget *stop_btn;
 } RecorderUI;
@@ -625,7 +993,13 @@ static gboolean update_timer(gpointer user_data) {
     int seconds = (int)(now - record_start_time);
     int min = seconds / 60;
     int sec = seconds % 60;
-    gchar *msg = g_strdup_printf("Recording… %02d:%02d", min, sec);
+    gchar *msg;
+    guint64 frames = 0, dropped = 0;
+    recorder_get_stats(&frames, &dropped);
+    if (dropped > 0)
+        msg = g_strdup_printf("Recording… %02d:%02d (%" G_GUINT64_FORMAT " frames dropped)", min, sec, dropped);
+    else
+        msg = g_strdup_printf("Recording… %02d:%02d", min, sec);
     gtk_label_set_text(GTK_LABEL(rec_ui->status_label), msg);
     g_free(msg);
     return TRUE;
@@ -659,11 +1033,108 @@ static void on_record_child_exit(GPid pid, gint status, gpointer user_data) {
     g_idle_add(reset_ui_idle, NULL);
 }
 
-/* Start recording: builds path, spawns arecord asynchronously, adds child watch, updates UI */
+/* Track sources from the UI: the Tracks entry (space/comma separated JACK ports),
+   or system:capture_1..2 following the Mono/Stereo choice. Returns a NULL-terminated
+   vector; *custom is TRUE when the user listed ports explicitly. */
+static gchar **recorder_sources_from_ui(gboolean *custom) {
+    GPtrArray *sources = g_ptr_array_new();
+    const char *text = gtk_entry_get_text(GTK_ENTRY(rec_ui->tracks_entry));
+    gchar **tokens = g_strsplit_set(text ? text : "", " ,", -1);
+
+    for (int i = 0; tokens[i]; i++) {
+        if (tokens[i][0] != '\0' && sources->len < RECORDER_MAX_TRACKS)
+            g_ptr_array_add(sources, g_strdup(tokens[i]));
+    }
+    g_strfreev(tokens);
+
+    *custom = sources->len > 0;
+    if (!*custom) {
+        int channels = 2;
+        gchar *chan = gtk_combo_box_text_get_active_text(GTK_COMBO_BOX_TEXT(rec_ui->channel_combo));
+        if (chan && g_strcmp0(chan, "Mono") == 0) channels = 1;
+        g_free(chan);
+        for (int c = 1; c <= channels; c++)
+            g_ptr_array_add(sources, g_strdup_printf("system:capture_%d", c));
+    }
+    g_ptr_array_add(sources, NULL);
+    return (gchar **)g_ptr_array_free(sources, FALSE);
+}
+
+static double recorder_preroll_from_ui(void) {
+    return gtk_spin_button_get_value(GTK_SPIN_BUTTON(rec_ui->preroll_spin));
+}
+
+/* Arm the native recorder with the current track/pre-roll settings */
+static gboolean arm_recorder_from_ui(gboolean *custom, GError **error) {
+    gchar **sources = recorder_sources_from_ui(custom);
+    gboolean ok = recorder_arm((const char *const *)sources, (int)g_strv_length(sources),
+                               recorder_preroll_from_ui(), error);
+    g_strfreev(sources);
+    return ok;
+}
+
+/* Keep the pre-roll buffer filling while pre-roll is enabled */
+static void on_recorder_settings_changed(GtkWidget *widget, gpointer user_data) {
+    (void)widget;
+    (void)user_data;
+    if (!rec_ui || recorder_is_running() || record_pid != 0) return;
+
+    if (recorder_preroll_from_ui() > 0.0) {
+        gboolean custom;
+        GError *err = NULL;
+        if (!arm_recorder_from_ui(&custom, &err)) {
+            gchar *msg = g_strdup_printf("Pre-roll unavailable: %s", err->message);
+            gtk_label_set_text(GTK_LABEL(rec_ui->status_label), msg);
+            g_free(msg);
+            g_error_free(err);
+            return;
+        }
+        gtk_label_set_text(GTK_LABEL(rec_ui->status_label), "Idle (pre-roll armed)");
+    } else {
+        recorder_disarm();
+        gtk_label_set_text(GTK_LABEL(rec_ui->status_label), "Idle");
+    }
+}
+
+/* UI state while a take is running (either recorder path) */
+static void recording_ui_started(void) {
+    gtk_widget_set_sensitive(rec_ui->record_btn, FALSE);
+    gtk_widget_set_sensitive(rec_ui->stop_btn, TRUE);
+    gtk_label_set_text(GTK_LABEL(rec_ui->status_label), "Recording… 00:00");
+
+    record_start_time = time(NULL);
+    record_timer_id = g_timeout_add_seconds(1, update_timer, NULL);
+}
+
+/* Native recorder finished: file is finalized, report errors/drops in the panel */
+static void on_native_record_done(const char *error_message, guint64 frames, guint64 dropped, gpointer user_data) {
+    (void)user_data;
+    if (record_timer_id) {
+        g_source_remove(record_timer_id);
+        record_timer_id = 0;
+    }
+    g_print("Recording finished: %" G_GUINT64_FORMAT " frames, %" G_GUINT64_FORMAT " dropped%s%s\n",
+            frames, dropped, error_message ? ", error: " : "", error_message ? error_message : "");
+
+    reset_ui_idle(NULL);
+    if (rec_ui && recorder_preroll_from_ui() > 0.0 && recorder_is_armed())
+        gtk_label_set_text(GTK_LABEL(rec_ui->status_label), "Idle (pre-roll armed)");
+    else
+        recorder_disarm();
+    if (rec_ui && (error_message || dropped > 0)) {
+        gchar *msg = error_message
+            ? g_strdup_printf("Recording stopped: %s", error_message)
+            : g_strdup_printf("Saved (%" G_GUINT64_FORMAT " frames dropped)", dropped);
+        gtk_label_set_text(GTK_LABEL(rec_ui->status_label), msg);
+        g_free(msg);
+    }
+}
+
+/* Start recording: builds path, starts the native recorder (or spawns arecord), updates UI */
 static void start_recording(GtkWidget *button, gpointer user_data) {
     (void)button;
     (void)user_data;
-    if (record_pid != 0) {
+    if (record_pid != 0 || recorder_is_running()) {
         /* Already recording */
         return;
     }
@@ -713,6 +1184,35 @@ static void start_recording(GtkWidget *button, gpointer user_data) {
      * Cannot use 'plughw:0' (jackd has exclusive hw access) or 'default' (playback only). */
     const char *input_dev = "jack";
 
+    gboolean custom_tracks = FALSE;
+    RecorderLayout layout = gtk_combo_box_get_active(GTK_COMBO_BOX(rec_ui->layout_combo)) == 1
+        ? RECORDER_LAYOUT_SPLIT : RECORDER_LAYOUT_INTERLEAVED;
+    GError *rec_err = NULL;
+    if (arm_recorder_from_ui(&custom_tracks, &rec_err) &&
+        recorder_start(full_path, layout, rate, on_native_record_done, NULL, &rec_err)) {
+        g_print("Recording started (JACK native) -> %s\n", full_path);
+        g_free(full_path);
+        recording_ui_started();
+        return;
+    }
+    if (recorder_preroll_from_ui() <= 0.0)
+        recorder_disarm();
+
+    /* arecord only covers the plain Mono/Stereo capture case */
+    if (custom_tracks || recorder_preroll_from_ui() > 0.0) {
+        GtkWidget *dialog = gtk_message_dialog_new(NULL, GTK_DIALOG_MODAL,
+            GTK_MESSAGE_ERROR, GTK_BUTTONS_OK, "Failed to start recording.\n\nError: %s",
+            rec_err ? rec_err->message : "unknown");
+        gtk_dialog_run(GTK_DIALOG(dialog));
+        gtk_widget_destroy(dialog);
+        if (rec_err) g_error_free(rec_err);
+        g_free(full_path);
+        return;
+    }
+    g_print("Native recorder unavailable (%s); falling back to arecord\n",
+            rec_err ? rec_err->message : "unknown");
+    if (rec_err) g_error_free(rec_err);
+
     /* Build argv for arecord */
     gchar *channels_s = g_strdup_printf("%d", channels);
     gchar *rate_s = g_strdup_printf("%d", rate);
@@ -772,21 +1272,26 @@ static void start_recording(GtkWidget *button, gpointer user_data) {
     g_free(full_path);
 
     /* UI updates */
-    gtk_widget_set_sensitive(rec_ui->record_btn, FALSE);
-    gtk_widget_set_sensitive(rec_ui->stop_btn, TRUE);
-    gtk_label_set_text(GTK_LABEL(rec_ui->status_label), "Recording… 00:00");
-
-    record_start_time = time(NULL);
-    record_timer_id = g_timeout_add_seconds(1, update_timer, NULL);
+    recording_ui_started();
 
     /* Add child watch to reap and update UI when process exits */
     g_child_watch_add(record_pid, on_record_child_exit, NULL);
 }
 
-/* Stop recording: send SIGINT to arecord (if running) and rely on child-watch to finalize */
+/* Stop recording: native takes flush and call back; arecord gets SIGINT and the child-watch finalizes */
 static void stop_recording(GtkWidget *button, gpointer user_data) {
     (void)button;
     (void)user_data;
+    if (recorder_is_running()) {
+        if (record_timer_id) {
+            g_source_remove(record_timer_id);
+            record_timer_id = 0;
+        }
+        gtk_widget_set_sensitive(rec_ui->stop_btn, FALSE);
+        gtk_label_set_text(GTK_LABEL(rec_ui->status_label), "Finishing…");
+        recorder_stop();
+        return;
+    }
     if (record_pid == 0) return;
     g_print("Stopping recording (PID %d)\n", record_pid);
     if (kill(record_pid, SIGINT) != 0) {
@@ -835,6 +1340,32 @@ static void create_recorder_ui(GtkWidget *main_box) {
     gtk_combo_box_set_active(GTK_COMBO_BOX(rec_ui->rate_combo), 1); // 48000 default
     gtk_box_pack_start(GTK_BOX(rec_box), rec_ui->rate_combo, FALSE, FALSE, 5);
 
+    /* Second row: multi-track sources, file layout and pre-roll */
+    GtkWidget *track_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 5);
+    gtk_box_pack_start(GTK_BOX(rec_vbox), track_box, FALSE, FALSE, 0);
+
+    gtk_box_pack_start(GTK_BOX(track_box), gtk_label_new("Tracks:"), FALSE, FALSE, 5);
+    rec_ui->tracks_entry = gtk_entry_new();
+    gtk_entry_set_placeholder_text(GTK_ENTRY(rec_ui->tracks_entry), "system:capture_1 system:capture_2 (default)");
+    gtk_widget_set_tooltip_text(rec_ui->tracks_entry,
+        "JACK ports to record, one track each (up to 8), e.g. system:capture_1 mxeq:out_1 bluealsa_in:capture_1");
+    gtk_box_pack_start(GTK_BOX(track_box), rec_ui->tracks_entry, TRUE, TRUE, 5);
+
+    rec_ui->layout_combo = gtk_combo_box_text_new();
+    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(rec_ui->layout_combo), "One file");
+    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(rec_ui->layout_combo), "File per track");
+    gtk_combo_box_set_active(GTK_COMBO_BOX(rec_ui->layout_combo), 0);
+    gtk_box_pack_start(GTK_BOX(track_box), rec_ui->layout_combo, FALSE, FALSE, 5);
+
+    gtk_box_pack_start(GTK_BOX(track_box), gtk_label_new("Pre-roll (s):"), FALSE, FALSE, 5);
+    rec_ui->preroll_spin = gtk_spin_button_new_with_range(0, 30, 1);
+    gtk_widget_set_tooltip_text(rec_ui->preroll_spin, "Keep this many seconds buffered so takes start in the past (0 = off)");
+    gtk_box_pack_start(GTK_BOX(track_box), rec_ui->preroll_spin, FALSE, FALSE, 5);
+
+    g_signal_connect(rec_ui->preroll_spin, "value-changed", G_CALLBACK(on_recorder_settings_changed), NULL);
+    g_signal_connect(rec_ui->tracks_entry, "activate", G_CALLBACK(on_recorder_settings_changed), NULL);
+    g_signal_connect(rec_ui->channel_combo, "changed", G_CALLBACK(on_recorder_settings_changed), NULL);
+
     /* Buttons */
     rec_ui->record_btn = gtk_button_new_with_label("Record");
     rec_ui->stop_btn = gtk_button_new_with_label("Stop");
@@ -848,6 +1379,408 @@ static void create_recorder_ui(GtkWidget *main_box) {
     g_signal_connect(rec_ui->stop_btn, "clicked", G_CALLBACK(stop_recording), NULL);
 }
 
+/* ---------------- Equalizer panel ----------------
+   Drives the native EQ JACK client (src/mxeq_eq.c). While it is enabled the
+   connection manager routes every source through it. Gains are handed to the
+   JACK thread at most once per frame; settings persist in
+   ~/.config/jack-bridge/mxeq-eq.conf. */
+
+typedef struct {
+    GtkWidget *enable_check;
+    GtkWidget *scales[EQ_BANDS];
+    GtkWidget *status_label;
+    double gains[EQ_BANDS];
+    guint tick_id;              /* Pending gain update for the JACK thread */
+    guint save_id;              /* Pending settings write */
+} EqualizerUI;
+
+static EqualizerUI *eq_ui = NULL;
+
+static char *eq_settings_path(void) {
+    return g_build_filename(g_get_home_dir(), ".config", "jack-bridge", "mxeq-eq.conf", NULL);
+}
+
+static void load_eq_settings(gboolean *enabled) {
+    GKeyFile *kf = g_key_file_new();
+    char *path = eq_settings_path();
+    gsize n = 0;
+
+    *enabled = FALSE;
+    if (g_key_file_load_from_file(kf, path, G_KEY_FILE_NONE, NULL)) {
+        double *gains = g_key_file_get_double_list(kf, "eq", "gains", &n, NULL);
+
+        *enabled = g_key_file_get_boolean(kf, "eq", "enabled", NULL);
+        for (gsize b = 0; gains && b < n && b < EQ_BANDS; b++) eq_ui->gains[b] = gains[b];
+        g_free(gains);
+    }
+    g_free(path);
+    g_key_file_free(kf);
+}
+
+static gboolean save_eq_settings(gpointer user_data) {
+    GKeyFile *kf = g_key_file_new();
+    char *dir = user_config_dir();
+    char *path = eq_settings_path();
+    GError *error = NULL;
+
+    (void)user_data;
+    eq_ui->save_id = 0;
+    g_key_file_set_boolean(kf, "eq", "enabled",
+                           gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(eq_ui->enable_check)));
+    g_key_file_set_double_list(kf, "eq", "gains", eq_ui->gains, EQ_BANDS);
+    g_mkdir_with_parents(dir, 0755);
+    if (!g_key_file_save_to_file(kf, path, &error)) {
+        g_warning("mxeq: cannot save EQ settings: %s", error->message);
+        g_error_free(error);
+    }
+    g_free(path);
+    g_free(dir);
+    g_key_file_free(kf);
+    return G_SOURCE_REMOVE;
+}
+
+/* Settings are written once a drag has settled */
+static void queue_eq_save(void) {
+    if (eq_ui->save_id) g_source_remove(eq_ui->save_id);
+    eq_ui->save_id = g_timeout_add(500, save_eq_settings, NULL);
+}
+
+/* Frame clock callback: publish the latest gains, or retry next frame if the
+   JACK thread has not picked up the previous ones yet */
+static gboolean on_eq_tick(GtkWidget *widget, GdkFrameClock *clock, gpointer user_data) {
+    (void)widget;
+    (void)clock;
+    (void)user_data;
+    if (!eq_set_gains(eq_ui->gains)) return G_SOURCE_CONTINUE;
+    eq_ui->tick_id = 0;
+    return G_SOURCE_REMOVE;
+}
+
+static void on_eq_scale_changed(GtkRange *range, gpointer user_data) {
+    int band = GPOINTER_TO_INT(user_data);
+
+    eq_ui->gains[band] = gtk_range_get_value(range);
+    if (eq_ui->tick_id == 0) {
+        eq_ui->tick_id = gtk_widget_add_tick_callback(GTK_WIDGET(range), on_eq_tick, NULL, NULL);
+    }
+    queue_eq_save();
+}
+
+static void update_eq_status(void) {
+    gboolean enabled = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(eq_ui->enable_check));
+    char text[64];
+
+    if (!enabled) {
+        snprintf(text, sizeof(text), "Off");
+    } else if (!eq_is_running()) {
+        snprintf(text, sizeof(text), "Waiting for JACK");
+    } else {
+        snprintf(text, sizeof(text), "DSP %.2f%%", eq_get_dsp_load());
+    }
+    gtk_label_set_text(GTK_LABEL(eq_ui->status_label), text);
+}
+
+/* Once a second: show the EQ's DSP share, and bring the client back after a
+   JACK restart */
+static gboolean eq_status_timer(gpointer user_data) {
+    (void)user_data;
+    if (gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(eq_ui->enable_check)) && !eq_is_running()) {
+        eq_start(eq_ui->gains, NULL);
+    }
+    update_eq_status();
+    return G_SOURCE_CONTINUE;
+}
+
+static void on_eq_enable_toggled(GtkToggleButton *btn, gpointer user_data) {
+    (void)user_data;
+    if (gtk_toggle_button_get_active(btn)) {
+        GError *error = NULL;
+
+        if (!eq_start(eq_ui->gains, &error)) {
+            g_printerr("EQ: %s\n", error->message);
+            g_error_free(error);
+        }
+    } else {
+        eq_stop();
+    }
+    update_eq_status();
+    queue_eq_save();
+}
+
+static void on_eq_flat_clicked(GtkButton *b, gpointer user_data) {
+    (void)b;
+    (void)user_data;
+    for (int i = 0; i < EQ_BANDS; i++) gtk_range_set_value(GTK_RANGE(eq_ui->scales[i]), 0.0);
+}
+
+static void create_equalizer_panel(GtkWidget *main_box) {
+    gboolean enabled;
+
+    eq_ui = g_new0(EqualizerUI, 1);
+    load_eq_settings(&enabled);
+
+    GtkWidget *expander = gtk_expander_new("Equalizer");
+    gtk_expander_set_expanded(GTK_EXPANDER(expander), FALSE);
+    gtk_box_pack_start(GTK_BOX(main_box), expander, FALSE, FALSE, 0);
+
+    /* keep a reference for the expander toggle handler */
+    g_equalizer_expander = expander;
+    g_signal_connect(G_OBJECT(expander), "notify::expanded", G_CALLBACK(on_any_expander_toggled), NULL);
+
+    GtkWidget *vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
+    gtk_container_add(GTK_CONTAINER(expander), vbox);
+
+    GtkWidget *top_row = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
+    gtk_box_pack_start(GTK_BOX(vbox), top_row, FALSE, FALSE, 0);
+
+    eq_ui->enable_check = gtk_check_button_new_with_label("Enable EQ");
+    gtk_widget_set_tooltip_text(eq_ui->enable_check,
+        "Insert the equalizer between all applications and the selected output");
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(eq_ui->enable_check), enabled);
+    gtk_box_pack_start(GTK_BOX(top_row), eq_ui->enable_check, FALSE, FALSE, 0);
+
+    GtkWidget *flat_btn = gtk_button_new_with_label("Flat");
+    gtk_box_pack_start(GTK_BOX(top_row), flat_btn, FALSE, FALSE, 0);
+
+    eq_ui->status_label = gtk_label_new("Off");
+    gtk_box_pack_end(GTK_BOX(top_row), eq_ui->status_label, FALSE, FALSE, 0);
+
+    GtkWidget *grid = gtk_grid_new();
+    gtk_grid_set_column_homogeneous(GTK_GRID(grid), TRUE);
+    gtk_grid_set_column_spacing(GTK_GRID(grid), 2);
+    gtk_box_pack_start(GTK_BOX(vbox), grid, FALSE, FALSE, 0);
+
+    for (int b = 0; b < EQ_BANDS; b++) {
+        char label[16];
+        double f = eq_band_freqs[b];
+
+        eq_ui->scales[b] = gtk_scale_new_with_range(GTK_ORIENTATION_VERTICAL,
+                                                    -EQ_MAX_GAIN_DB, EQ_MAX_GAIN_DB, 0.5);
+        gtk_range_set_inverted(GTK_RANGE(eq_ui->scales[b]), TRUE); /* Boost at the top */
+        gtk_range_set_value(GTK_RANGE(eq_ui->scales[b]), eq_ui->gains[b]);
+        gtk_scale_add_mark(GTK_SCALE(eq_ui->scales[b]), 0.0, GTK_POS_LEFT, NULL);
+        gtk_widget_set_size_request(eq_ui->scales[b], -1, 140);
+        g_signal_connect(eq_ui->scales[b], "value-changed", G_CALLBACK(on_eq_scale_changed), GINT_TO_POINTER(b));
+        gtk_grid_attach(GTK_GRID(grid), eq_ui->scales[b], b, 0, 1, 1);
+
+        if (f >= 1000.0) snprintf(label, sizeof(label), "%gk", f / 1000.0);
+        else snprintf(label, sizeof(label), "%g", f);
+        gtk_grid_attach(GTK_GRID(grid), gtk_label_new(label), b, 1, 1, 1);
+    }
+
+    g_signal_connect(eq_ui->enable_check, "toggled", G_CALLBACK(on_eq_enable_toggled), NULL);
+    g_signal_connect(flat_btn, "clicked", G_CALLBACK(on_eq_flat_clicked), NULL);
+    g_timeout_add_seconds(1, eq_status_timer, NULL);
+
+    if (enabled) eq_start(eq_ui->gains, NULL);
+    update_eq_status();
+}
+
+/* ---------------- Levels panel ----------------
+   Peak/RMS meters for every output and physical capture client, from the tap
+   client in src/mxeq_meter.c. The tap only runs while the panel is open and
+   the bars are updated from the frame clock, so nothing polls in between. */
+
+#define LEVEL_FLOOR_DB -60.0
+#define LEVEL_FALL_PER_SEC 0.66         /* Bar fraction per second (about 40 dB/s) */
+#define LEVEL_PEAK_HOLD_US (1500 * 1000)
+
+typedef struct {
+    GtkWidget *bars[METER_CHANNELS];
+    GtkWidget *peak_label;
+    double shown[METER_CHANNELS];       /* Displayed RMS fraction, falls back smoothly */
+    double peak_db;                     /* Held peak */
+    gint64 peak_time;
+} LevelRow;
+
+typedef struct {
+    GtkWidget *grid;
+    GtkWidget *status_label;
+    LevelRow rows[METER_MAX];
+    int n_rows;
+    guint tick_id;
+    guint retry_id;
+    gint64 last_frame;
+} LevelsUI;
+
+static LevelsUI *levels_ui = NULL;
+
+static double level_to_db(float linear) {
+    double db = linear > 0.0f ? 20.0 * log10(linear) : LEVEL_FLOOR_DB;
+
+    return db < LEVEL_FLOOR_DB ? LEVEL_FLOOR_DB : db;
+}
+
+/* Bar fraction: LEVEL_FLOOR_DB .. 0 dBFS */
+static double level_fraction(float linear) {
+    double db = level_to_db(linear);
+
+    if (db > 0.0) db = 0.0;
+    return 1.0 - db / LEVEL_FLOOR_DB;
+}
+
+static GtkWidget *new_level_bar(void) {
+    GtkWidget *bar = gtk_level_bar_new_for_interval(0.0, 1.0);
+
+    gtk_level_bar_remove_offset_value(GTK_LEVEL_BAR(bar), GTK_LEVEL_BAR_OFFSET_LOW);
+    gtk_level_bar_add_offset_value(GTK_LEVEL_BAR(bar), GTK_LEVEL_BAR_OFFSET_HIGH, 0.9); /* -6 dBFS */
+    gtk_level_bar_add_offset_value(GTK_LEVEL_BAR(bar), "clip", 1.0);
+    gtk_widget_set_hexpand(bar, TRUE);
+    gtk_widget_set_size_request(bar, -1, 8);
+    return bar;
+}
+
+/* (Re)build one row per meter; the set changes when JACK restarts */
+static void build_level_rows(const MeterLevel *levels, int n) {
+    GList *children = gtk_container_get_children(GTK_CONTAINER(levels_ui->grid));
+
+    for (GList *l = children; l; l = l->next) gtk_widget_destroy(GTK_WIDGET(l->data));
+    g_list_free(children);
+
+    memset(levels_ui->rows, 0, sizeof(levels_ui->rows));
+    for (int m = 0; m < n; m++) {
+        LevelRow *row = &levels_ui->rows[m];
+        GtkWidget *bars = gtk_box_new(GTK_ORIENTATION_VERTICAL, 2);
+        char *text = levels[m].capture ? g_strdup_printf("Capture: %s", levels[m].name)
+                                       : g_strdup(levels[m].name);
+        GtkWidget *label;
+
+        if (!levels[m].capture && text[0]) text[0] = g_ascii_toupper(text[0]);
+        label = gtk_label_new(text);
+        g_free(text);
+        gtk_widget_set_halign(label, GTK_ALIGN_START);
+        gtk_grid_attach(GTK_GRID(levels_ui->grid), label, 0, m, 1, 1);
+
+        for (int c = 0; c < METER_CHANNELS; c++) {
+            row->bars[c] = new_level_bar();
+            gtk_box_pack_start(GTK_BOX(bars), row->bars[c], FALSE, FALSE, 0);
+        }
+        gtk_widget_set_valign(bars, GTK_ALIGN_CENTER);
+        gtk_grid_attach(GTK_GRID(levels_ui->grid), bars, 1, m, 1, 1);
+
+        row->peak_label = gtk_label_new("-inf");
+        gtk_label_set_width_chars(GTK_LABEL(row->peak_label), 6);
+        gtk_label_set_xalign(GTK_LABEL(row->peak_label), 1.0);
+        gtk_grid_attach(GTK_GRID(levels_ui->grid), row->peak_label, 2, m, 1, 1);
+        row->peak_db = LEVEL_FLOOR_DB;
+    }
+    levels_ui->n_rows = n;
+    gtk_widget_show_all(levels_ui->grid);
+}
+
+/* Frame clock callback: one read of all meters per frame */
+static gboolean on_levels_tick(GtkWidget *widget, GdkFrameClock *clock, gpointer user_data) {
+    MeterLevel levels[METER_MAX];
+    gint64 now = gdk_frame_clock_get_frame_time(clock);
+    double fall;
+    int n;
+
+    (void)widget;
+    (void)user_data;
+    n = meter_read(levels, METER_MAX);
+    if (n == 0) return G_SOURCE_CONTINUE;
+
+    fall = levels_ui->last_frame ? LEVEL_FALL_PER_SEC * (double)(now - levels_ui->last_frame) / 1e6 : 1.0;
+    levels_ui->last_frame = now;
+    if (n != levels_ui->n_rows) build_level_rows(levels, n);
+
+    for (int m = 0; m < n; m++) {
+        LevelRow *row = &levels_ui->rows[m];
+        float peak = 0.0f;
+        double peak_db;
+
+        for (int c = 0; c < METER_CHANNELS; c++) {
+            double target = level_fraction(levels[m].rms[c]);
+
+            row->shown[c] = MAX(target, row->shown[c] - fall);
+            gtk_level_bar_set_value(GTK_LEVEL_BAR(row->bars[c]), row->shown[c]);
+            if (levels[m].peak[c] > peak) peak = levels[m].peak[c];
+        }
+
+        peak_db = level_to_db(peak);
+        if (peak_db >= row->peak_db || now - row->peak_time > LEVEL_PEAK_HOLD_US) {
+            char text[16];
+
+            row->peak_db = peak_db;
+            row->peak_time = now;
+            if (peak_db <= LEVEL_FLOOR_DB) snprintf(text, sizeof(text), "-inf");
+            else snprintf(text, sizeof(text), "%.1f", peak_db);
+            gtk_label_set_text(GTK_LABEL(row->peak_label), text);
+        }
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+/* Once a second while the panel is open: bring the tap back after a JACK restart */
+static gboolean levels_retry_timer(gpointer user_data) {
+    (void)user_data;
+    if (!meter_is_running()) {
+        if (meter_start(NULL)) {
+            levels_ui->n_rows = 0; /* The meter set may have changed */
+            gtk_label_set_text(GTK_LABEL(levels_ui->status_label), "");
+        } else {
+            gtk_label_set_text(GTK_LABEL(levels_ui->status_label), "Waiting for JACK");
+        }
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static void on_levels_expanded(GObject *object, GParamSpec *pspec, gpointer user_data) {
+    (void)pspec;
+    (void)user_data;
+    if (gtk_expander_get_expanded(GTK_EXPANDER(object))) {
+        GError *error = NULL;
+
+        if (meter_start(&error)) {
+            gtk_label_set_text(GTK_LABEL(levels_ui->status_label), "");
+        } else {
+            gtk_label_set_text(GTK_LABEL(levels_ui->status_label), error->message);
+            g_error_free(error);
+        }
+        levels_ui->n_rows = 0;
+        levels_ui->last_frame = 0;
+        if (!levels_ui->tick_id) {
+            levels_ui->tick_id = gtk_widget_add_tick_callback(levels_ui->grid, on_levels_tick, NULL, NULL);
+        }
+        if (!levels_ui->retry_id) levels_ui->retry_id = g_timeout_add_seconds(1, levels_retry_timer, NULL);
+    } else {
+        if (levels_ui->tick_id) {
+            gtk_widget_remove_tick_callback(levels_ui->grid, levels_ui->tick_id);
+            levels_ui->tick_id = 0;
+        }
+        if (levels_ui->retry_id) {
+            g_source_remove(levels_ui->retry_id);
+            levels_ui->retry_id = 0;
+        }
+        meter_stop();
+    }
+}
+
+static void create_levels_panel(GtkWidget *main_box) {
+    levels_ui = g_new0(LevelsUI, 1);
+
+    GtkWidget *expander = gtk_expander_new("Levels");
+    gtk_expander_set_expanded(GTK_EXPANDER(expander), FALSE);
+    gtk_box_pack_start(GTK_BOX(main_box), expander, FALSE, FALSE, 0);
+
+    /* keep a reference for the expander toggle handler */
+    g_levels_expander = expander;
+    g_signal_connect(G_OBJECT(expander), "notify::expanded", G_CALLBACK(on_any_expander_toggled), NULL);
+    g_signal_connect(G_OBJECT(expander), "notify::expanded", G_CALLBACK(on_levels_expanded), NULL);
+
+    GtkWidget *vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 4);
+    gtk_container_add(GTK_CONTAINER(expander), vbox);
+
+    levels_ui->status_label = gtk_label_new("");
+    gtk_widget_set_halign(levels_ui->status_label, GTK_ALIGN_START);
+    gtk_box_pack_start(GTK_BOX(vbox), levels_ui->status_label, FALSE, FALSE, 0);
+
+    levels_ui->grid = gtk_grid_new();
+    gtk_grid_set_column_spacing(GTK_GRID(levels_ui->grid), 8);
+    gtk_grid_set_row_spacing(GTK_GRID(levels_ui->grid), 4);
+    gtk_box_pack_start(GTK_BOX(vbox), levels_ui->grid, FALSE, FALSE, 0);
+}
+
 /* Build Bluetooth panel once and bind to GUI BT helpers */
 static void on_bt_selection_changed(GtkTreeSelection *sel, gpointer user_data) {
     (void)user_data;
@@ -1017,6 +1950,7 @@ int main(int argc, char *argv[]) {
     extern void gui_bt_shutdown(void);
 
     gtk_init(&argc, &argv);
+    trace_init("mxeq");
 
     /* Initialize Bluetooth GUI helpers (register BlueZ agent, obtain system bus).
        Failures are non-fatal for systems without Bluetooth but will be logged. */
@@ -1044,6 +1978,10 @@ int main(int argc, char *argv[]) {
         "  border-color: #333333;"
         "  box-shadow: none;"
         "  border-radius: 4px;"
+        "}"
+        "levelbar block.clip {"
+        "  background-color: #cc3333;"
+        "  border-color: #cc3333;"
         "}",
         -1, NULL);
     gtk_style_context_add_provider_for_screen(
@@ -1109,64 +2047,7 @@ int main(int argc, char *argv[]) {
         gtk_box_pack_start(GTK_BOX(no_mixer_box), no_mixer_label, TRUE, TRUE, 8);
     } else {
         for (int i = 0; i < mixer_data.num_channels; i++) {
-            int col = i % 8;  // Max 8 columns per row
-            int row = i / 8;  // Automatic row wrapping
-            
-            GtkWidget *channel_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
-            gtk_grid_attach(GTK_GRID(mixer_box), channel_box, col, row, 1, 1);
-
-            GtkWidget *label = gtk_label_new(mixer_data.channels[i].channel_name);
-            gtk_widget_set_halign(label, GTK_ALIGN_CENTER);
-            gtk_box_pack_start(GTK_BOX(channel_box), label, FALSE, FALSE, 5);
-
-            mixer_data.channels[i].scale = gtk_scale_new_with_range(GTK_ORIENTATION_VERTICAL, 0, 1, 0.01);
-            gtk_range_set_inverted(GTK_RANGE(mixer_data.channels[i].scale), TRUE);
-            gtk_scale_set_draw_value(GTK_SCALE(mixer_data.channels[i].scale), TRUE);
-            gtk_scale_set_value_pos(GTK_SCALE(mixer_data.channels[i].scale), GTK_POS_BOTTOM);
-            gtk_widget_set_size_request(mixer_data.channels[i].scale, -1, 150);
-            gtk_box_pack_start(GTK_BOX(channel_box), mixer_data.channels[i].scale, TRUE, TRUE, 0);
-            g_signal_connect(mixer_data.channels[i].scale, "value-changed", G_CALLBACK(slider_changed), &mixer_data.channels[i]);
-
-            long min, max, value;
-            if (mixer_data.channels[i].is_capture) {
-                snd_mixer_selem_get_capture_volume_range(mixer_data.channels[i].elem, &min, &max);
-                snd_mixer_selem_get_capture_volume(mixer_data.channels[i].elem, 0, &value);
-            } else {
-                snd_mixer_selem_get_playback_volume_range(mixer_data.channels[i].elem, &min, &max);
-                snd_mixer_selem_get_playback_volume(mixer_data.channels[i].elem, 0, &value);
-            }
-            gtk_range_set_value(GTK_RANGE(mixer_data.channels[i].scale), (double)(value - min) / (max - min));
-
-            /* Optional per-channel Mute (playback) or Enable (capture) checkbox */
-            mixer_data.channels[i].mute_check = NULL;
-            if (mixer_data.channels[i].is_capture) {
-                /* Capture controls: expose Enable checkbox (checked=capture enabled) */
-                if (snd_mixer_selem_has_capture_switch(mixer_data.channels[i].elem)) {
-                    int sw = 0;
-                    snd_mixer_selem_get_capture_switch(mixer_data.channels[i].elem, SND_MIXER_SCHN_FRONT_LEFT, &sw);
-                    GtkWidget *enable = gtk_check_button_new_with_label("Enable");
-                    gtk_widget_set_halign(enable, GTK_ALIGN_CENTER);
-                    gtk_widget_set_margin_top(enable, 4);
-                    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(enable), sw ? TRUE : FALSE);
-                    gtk_box_pack_start(GTK_BOX(channel_box), enable, FALSE, FALSE, 2);
-                    g_signal_connect(enable, "toggled", G_CALLBACK(on_mute_toggled), &mixer_data.channels[i]);
-                    mixer_data.channels[i].mute_check = enable;
-                }
-            } else {
-                /* Playback controls: expose Mute checkbox (checked=muted) */
-                if (snd_mixer_selem_has_playback_switch(mixer_data.channels[i].elem)) {
-                    int sw = 1;
-                    snd_mixer_selem_get_playback_switch(mixer_data.channels[i].elem, SND_MIXER_SCHN_FRONT_LEFT, &sw);
-                    GtkWidget *mute = gtk_check_button_new_with_label("Mute");
-                    gtk_widget_set_halign(mute, GTK_ALIGN_CENTER);
-                    gtk_widget_set_margin_top(mute, 4);
-                    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(mute), sw ? FALSE : TRUE);
-                    gtk_box_pack_start(GTK_BOX(channel_box), mute, FALSE, FALSE, 2);
-                    g_signal_connect(mute, "toggled", G_CALLBACK(on_mute_toggled), &mixer_data.channels[i]);
-                    mixer_data.channels[i].mute_check = mute;
-                }
-            }
-            /* Removed padding label so the mute button sits directly under the slider */
+            add_channel_widgets(mixer_box, &mixer_data.channels[i], i);
         }
     }
 
@@ -1188,6 +2069,12 @@ int main(int argc, char *argv[]) {
     // Recorder UI inside Recording expander
     create_recorder_ui(eq_content_vbox);
 
+    /* Equalizer panel (native JACK EQ, collapsible) */
+    create_equalizer_panel(main_box);
+
+    /* Levels panel (output and capture meters, collapsible) */
+    create_levels_panel(main_box);
+
     /* Bluetooth panel (collapsible) */
     create_bt_panel(main_box);
  
@@ -1203,6 +2090,10 @@ int main(int argc, char *argv[]) {
     extern void gui_bt_shutdown(void);
     gui_bt_unregister_discovery_listeners();
     gui_bt_shutdown();
+    devices_shutdown();
+    eq_stop();
+    meter_stop();
+    trace_shutdown();
 
     cleanup_alsa(&mixer_data);
     return 0;
@@ -1233,63 +2124,28 @@ static const char *CURRENT_INPUT_PATH = "/etc/asound.conf.d/current_input.conf";
 static const char *JB_BEGIN = "# BEGIN jack-bridge";
 static const char *JB_END   = "# END jack-bridge";
 
-/* Simple helper to scan a text file for a substring (case-sensitive) */
-static gboolean file_contains_substr(const char *path, const char *needle) {
-    if (!path || !needle) return FALSE;
-    FILE *f = fopen(path, "r");
-    if (!f) return FALSE;
-    char buf[512];
-    gboolean found = FALSE;
-    while (fgets(buf, sizeof(buf), f)) {
-        if (strstr(buf, needle) != NULL) { found = TRUE; break; }
-    }
-    fclose(f);
-    return found;
-}
-
-/* Detect USB card number (returns -1 if no USB found) */
+/* Detect USB card number (returns -1 if no USB found).
+   Presence comes from the cached inventory (mxeq_devices.c), never from a spawn. */
 static int get_usb_card_number(void) {
-    FILE *f = fopen("/proc/asound/cards", "r");
-    if (!f) return -1;
-    char line[512];
-    int card = -1;
-    while (fgets(line, sizeof(line), f)) {
-        /* Look for "card N: ... [USB" or "card N: USB" */
-        if (strstr(line, "USB")) {
-            /* Extract card number from "card N:" prefix */
-            if (sscanf(line, " %d", &card) == 1) {
-                fclose(f);
-                return card;
-            }
-        }
-    }
-    fclose(f);
-    return -1;
+    return devices_get()->usb_card;
 }
 
 static gboolean is_usb_present(void) {
     return (get_usb_card_number() >= 0);
 }
 static gboolean is_hdmi_present(void) {
-    if (file_contains_substr("/proc/asound/cards", "HDMI")) return TRUE;
-    /* Fallback: check aplay -l for HDMI devices (e.g. on HDA Intel cards) */
-    gchar *out = NULL;
-    if (g_spawn_command_line_sync("aplay -l", &out, NULL, NULL, NULL)) {
-        if (out && strstr(out, "HDMI")) {
-            g_free(out);
-            return TRUE;
-        }
-        g_free(out);
-    }
-    return FALSE;
+    return devices_get()->hdmi;
 }
 static gboolean is_bt_present(void) {
-    if (g_file_test("/usr/bin/bluealsa", G_FILE_TEST_IS_REGULAR) ||
-        g_file_test("/usr/sbin/bluealsa", G_FILE_TEST_IS_REGULAR)) return TRUE;
-    int status = 0;
-    gboolean ok = g_spawn_command_line_sync("pidof bluealsad", NULL, NULL, &status, NULL);
-    if (ok && WIFEXITED(status) && WEXITSTATUS(status) == 0) return TRUE;
-    return FALSE;
+    return devices_get()->bluealsa;
+}
+
+/* Inventory change: follow hotplug in the Devices panel radio sensitivity */
+static void on_devices_changed(const DeviceInventory *inventory, gpointer user_data) {
+    (void)user_data;
+    if (g_rb_usb) gtk_widget_set_sensitive(g_rb_usb, inventory->usb_card >= 0);
+    if (g_rb_hdmi) gtk_widget_set_sensitive(g_rb_hdmi, inventory->hdmi);
+    if (g_rb_bt) gtk_widget_set_sensitive(g_rb_bt, inventory->bluealsa);
 }
 
 /* System default reader: parse /etc/asound.conf.d/current_input.conf */
@@ -1532,11 +2388,11 @@ void ensure_user_asoundrc_bootstrap(void) {
 
 
 /* ---- Devices panel (Internal / USB / HDMI / Bluetooth) ----
- * Provides runtime JACK routing without restarting jackd by invoking:
- *   /usr/local/lib/jack-bridge/jack-route-select {internal|usb|hdmi|bluetooth}
- * The helper persists selection into /etc/jack-bridge/devices.conf
+ * Provides runtime JACK routing without restarting jackd through route_select()
+ * (jack_bridge_route.c), which runs on its own thread and reports back once
+ * the output's ports exist. The selection is persisted in
+ * ~/.config/jack-bridge/devices.conf, where jack-connection-manager picks it up.
  */
-static const char *ROUTE_HELPER = "/usr/local/lib/jack-bridge/jack-route-select";
 static const char *DEVCONF_PATH = "/etc/jack-bridge/devices.conf"; /* system-wide default (user override checked in loader) */
 
 static gchar *load_preferred_output(void) {
@@ -1580,26 +2436,87 @@ static gchar *load_preferred_output(void) {
     return g_strdup("internal");
 }
 
-static gboolean route_to_target_async_with_arg(const char *target, const char *opt_arg) {
+static void on_device_radio_toggled(GtkToggleButton *tb, gpointer user_data);
+static gboolean sync_devices_panel_to_bluetooth_idle(gpointer user_data);
+
+typedef struct {
+    gchar *target;
+    gchar *mac;  /* Bluetooth device, NULL otherwise */
+    gboolean sync_radio;  /* Started outside the Devices panel: select its radio on success */
+    gint error;
+    gchar *message;
+} RouteRequest;
+
+/* Put the Devices panel back on Internal after a failed Bluetooth selection.
+ * Only the Bluetooth handler is blocked, so Internal routes itself. */
+static void revert_bt_radio_to_internal(void) {
+    if (!g_rb_bt || !GTK_IS_TOGGLE_BUTTON(g_rb_bt)) return;
+    g_signal_handlers_block_by_func(g_rb_bt, G_CALLBACK(on_device_radio_toggled), NULL);
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(g_rb_bt), FALSE);
+    if (g_rb_internal) gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(g_rb_internal), TRUE);
+    g_signal_handlers_unblock_by_func(g_rb_bt, G_CALLBACK(on_device_radio_toggled), NULL);
+}
+
+/* Main loop: report a finished selection. Only Bluetooth reports to the user;
+ * the other outputs keep their ports registered through jack-bridge-ports. */
+static gboolean route_done_idle(gpointer user_data) {
+    RouteRequest *req = (RouteRequest *)user_data;
+    gboolean is_bt = g_strcmp0(req->target, "bluetooth") == 0;
+    GtkWindow *parent = g_rb_bt ? get_parent_window_from_widget(g_rb_bt) : NULL;
+
+    if (req->error != 0 && !is_bt) {
+        g_warning("routing to %s: %s", req->target, req->message);
+    } else if (req->error != 0) {
+        GtkWidget *d = gtk_message_dialog_new(parent, GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK,
+                                              "Failed to set Bluetooth output.\n\nError: %s\n\nPossible causes:\n• Device disconnected\n• BlueALSA daemon not running\n• No A2DP transport available\n\nCheck /tmp/jack-route-select-bluealsa.log",
+                                              req->message);
+        gtk_dialog_run(GTK_DIALOG(d));
+        gtk_widget_destroy(d);
+        /* Unless the user has already picked another output meanwhile */
+        if (!req->sync_radio && g_rb_bt && gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(g_rb_bt))) revert_bt_radio_to_internal();
+    } else if (is_bt) {
+        if (req->sync_radio) sync_devices_panel_to_bluetooth_idle(NULL);
+        GtkWidget *d = gtk_message_dialog_new(parent, GTK_DIALOG_DESTROY_WITH_PARENT,
+                                              GTK_MESSAGE_INFO, GTK_BUTTONS_OK,
+                                              "Bluetooth output ready!\n\nDevice: %s\nPorts: bluealsa:playback_1/2\n\nAudio will play through Bluetooth.",
+                                              req->mac ? req->mac : "");
+        gtk_dialog_run(GTK_DIALOG(d));
+        gtk_widget_destroy(d);
+    }
+
+    g_free(req->target);
+    g_free(req->mac);
+    g_free(req->message);
+    g_free(req);
+    return G_SOURCE_REMOVE;
+}
+
+/* Routing thread: hand the result to the main loop */
+static void on_route_done(int error, const char *message, void *user_data) {
+    RouteRequest *req = (RouteRequest *)user_data;
+    req->error = error;
+    req->message = g_strdup(message ? message : "routing failed");
+    g_idle_add(route_done_idle, req);
+}
+
+/* Start routing to target; returns FALSE if the request could not be queued */
+static gboolean route_to_target(const char *target, const char *mac, gboolean sync_radio) {
     if (!target || !*target) return FALSE;
-    if (!file_exists_readable(ROUTE_HELPER)) {
-        g_warning("route helper missing: %s", ROUTE_HELPER);
+    TRACE(TRACE_STAGE, TRACE_EV_GUI_OUTPUT, 0, target);
+    RouteRequest *req = g_new0(RouteRequest, 1);
+    req->target = g_strdup(target);
+    req->mac = g_strdup(mac);
+    req->sync_radio = sync_radio;
+    if (route_select(target, mac, NULL, on_route_done, req) != 0) {
+        int err = errno;
+        g_warning("cannot route to %s: %s", target, g_strerror(err));
+        g_free(req->target);
+        g_free(req->mac);
+        g_free(req);
+        errno = err;  /* Callers report it */
         return FALSE;
     }
-    gchar *cmd = NULL;
-    if (opt_arg && *opt_arg) cmd = g_strdup_printf("%s %s %s", ROUTE_HELPER, target, opt_arg);
-    else cmd = g_strdup_printf("%s %s", ROUTE_HELPER, target);
-    GError *err = NULL;
-    gboolean ok = g_spawn_command_line_async(cmd, &err);
-    if (!ok) {
-        g_warning("failed to invoke %s: %s", cmd, err ? err->message : "unknown");
-        if (err) g_error_free(err);
-    }
-    g_free(cmd);
-    return ok;
-}
-static gboolean route_to_target_async(const char *target) {
-    return route_to_target_async_with_arg(target, NULL);
+    return TRUE;
 }
 
 typedef struct {
@@ -1620,18 +2537,18 @@ static void on_device_radio_toggled(GtkToggleButton *tb, gpointer user_data) {
     gchar *mac = NULL;
 
     if (g_strcmp0(label, "Internal") == 0) {
-        ok = route_to_target_async("internal");
+        ok = route_to_target("internal", NULL, FALSE);
         /* Switch mixer to show internal card (hw:0) controls */
         rebuild_mixer_for_card(0);
     } else if (g_strcmp0(label, "USB") == 0) {
-        ok = route_to_target_async("usb");
+        ok = route_to_target("usb", NULL, FALSE);
         /* Switch mixer to show USB card controls */
         int usb_card = get_usb_card_number();
         if (usb_card >= 0) {
             rebuild_mixer_for_card(usb_card);
         }
     } else if (g_strcmp0(label, "HDMI") == 0) {
-        ok = route_to_target_async("hdmi");
+        ok = route_to_target("hdmi", NULL, FALSE);
         /* HDMI uses internal card for capture, so show internal mixer */
         rebuild_mixer_for_card(0);
     } else if (g_strcmp0(label, "Bluetooth") == 0) {
@@ -1652,60 +2569,13 @@ static void on_device_radio_toggled(GtkToggleButton *tb, gpointer user_data) {
             gtk_dialog_run(GTK_DIALOG(d));
             gtk_widget_destroy(d);
             /* Revert radio to previous selection (don't leave Bluetooth selected if it failed) */
-            g_signal_handlers_block_by_func(tb, G_CALLBACK(on_device_radio_toggled), NULL);
-            gtk_toggle_button_set_active(tb, FALSE);
-            if (g_rb_internal) gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(g_rb_internal), TRUE);
-            g_signal_handlers_unblock_by_func(tb, G_CALLBACK(on_device_radio_toggled), NULL);
+            revert_bt_radio_to_internal();
             return;
         }
         
-        /* Call helper SYNCHRONOUSLY so we can verify result */
-        gchar *cmd = g_strdup_printf("%s bluetooth %s", ROUTE_HELPER, mac);
-        gint status = 0;
-        GError *err = NULL;
-        ok = g_spawn_command_line_sync(cmd, NULL, NULL, &status, &err);
-        g_free(cmd);
-        
-        if (!ok || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
-            GtkWidget *d = gtk_message_dialog_new(parent, GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK,
-                                                  "Failed to set Bluetooth output.\n\nError: %s\n\nCheck that device is connected and BlueALSA daemon is running.",
-                                                  err ? err->message : "routing helper failed");
-            gtk_dialog_run(GTK_DIALOG(d));
-            gtk_widget_destroy(d);
-            if (err) g_error_free(err);
-            /* Revert radio to Internal */
-            g_signal_handlers_block_by_func(tb, G_CALLBACK(on_device_radio_toggled), NULL);
-            gtk_toggle_button_set_active(tb, FALSE);
-            if (g_rb_internal) gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(g_rb_internal), TRUE);
-            g_signal_handlers_unblock_by_func(tb, G_CALLBACK(on_device_radio_toggled), NULL);
-            g_free(mac);
-            return;
-        }
-        
-        /* Give ports time to spawn */
-        g_usleep(1000000); /* 1 second */
-        
-        /* Verify ports exist */
-        if (!bluealsa_ports_exist()) {
-            GtkWidget *d = gtk_message_dialog_new(parent, GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK,
-                                                  "Bluetooth ports failed to spawn.\n\nPossible causes:\n• Device disconnected\n• BlueALSA daemon not running\n• No A2DP transport available\n\nCheck /tmp/jack-route-select.log");
-            gtk_dialog_run(GTK_DIALOG(d));
-            gtk_widget_destroy(d);
-            /* Revert radio to Internal */
-            g_signal_handlers_block_by_func(tb, G_CALLBACK(on_device_radio_toggled), NULL);
-            gtk_toggle_button_set_active(tb, FALSE);
-            if (g_rb_internal) gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(g_rb_internal), TRUE);
-            g_signal_handlers_unblock_by_func(tb, G_CALLBACK(on_device_radio_toggled), NULL);
-            g_free(mac);
-            return;
-        }
-        
-        /* Success! Show confirmation */
-        GtkWidget *d = gtk_message_dialog_new(parent, GTK_DIALOG_DESTROY_WITH_PARENT,
-                                              GTK_MESSAGE_INFO, GTK_BUTTONS_OK,
-                                              "Bluetooth output ready!\n\nDevice: %s\nPorts: bluealsa:playback_1/2\n\nAudio will play through Bluetooth.", mac);
-        gtk_dialog_run(GTK_DIALOG(d));
-        gtk_widget_destroy(d);
+        /* Result (success dialog or revert to Internal) arrives in route_done_idle() */
+        ok = route_to_target("bluetooth", mac, FALSE);
+        if (!ok) revert_bt_radio_to_internal();
         g_free(mac);
         return;
     } else {
@@ -1714,14 +2584,17 @@ static void on_device_radio_toggled(GtkToggleButton *tb, gpointer user_data) {
 
     if (!ok) {
         GtkWidget *d = gtk_message_dialog_new(parent, GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK,
-                                              "Routing helper is missing or failed.\nExpected at: %s\nRun: sudo ./contrib/install.sh",
-                                              ROUTE_HELPER);
+                                              "Failed to start output routing: %s",
+                                              g_strerror(errno));
         gtk_dialog_run(GTK_DIALOG(d));
         gtk_widget_destroy(d);
     }
 }
 
 static void create_devices_panel(GtkWidget *main_box) {
+    /* Snapshot presence once; hotplug updates arrive through on_devices_changed() */
+    devices_init(on_devices_changed, NULL);
+
     GtkWidget *dev_expander = gtk_expander_new("Devices");
     gtk_expander_set_expanded(GTK_EXPANDER(dev_expander), FALSE);
     gtk_box_pack_start(GTK_BOX(main_box), dev_expander, FALSE, FALSE, 0);
@@ -1870,25 +2743,6 @@ static gboolean sync_devices_panel_to_bluetooth_idle(gpointer user_data) {
     return G_SOURCE_REMOVE;
 }
 
-/* Helper: check if bluealsa JACK ports exist (returns TRUE if found) */
-static gboolean bluealsa_ports_exist(void) {
-    gchar *out = NULL;
-    gint status = 0;
-    
-    if (!g_spawn_command_line_sync("jack_lsp", &out, NULL, &status, NULL)) {
-        return FALSE;
-    }
-    
-    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
-        if (out) g_free(out);
-        return FALSE;
-    }
-    
-    gboolean found = (out && (strstr(out, "bluealsa:playback_1") != NULL));
-    if (out) g_free(out);
-    return found;
-}
-
 /* Button handler: set selected Bluetooth device as current OUTPUT (routes playback) */
 static void on_bt_set_output_clicked(GtkButton *b, gpointer user_data) {
     (void)user_data;
@@ -1926,64 +2780,13 @@ static void on_bt_set_output_clicked(GtkButton *b, gpointer user_data) {
         return;
     }
 
-    GtkWindow *parent = get_parent_window_from_widget(btnw);
-    
-    /* Call routing helper SYNCHRONOUSLY so we can verify result */
-    if (!file_exists_readable(ROUTE_HELPER)) {
-        GtkWidget *d = gtk_message_dialog_new(parent, GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK,
-                                              "Routing helper missing: %s\nRun: sudo ./contrib/install.sh", ROUTE_HELPER);
-        gtk_dialog_run(GTK_DIALOG(d));
-        gtk_widget_destroy(d);
-        g_free(mac);
-        return;
-    }
-    
-    gchar *cmd = g_strdup_printf("%s bluetooth %s", ROUTE_HELPER, mac);
-    gchar *stdout_data = NULL;
-    gchar *stderr_data = NULL;
-    gint exit_status = 0;
-    GError *err = NULL;
-    
-    gboolean spawn_ok = g_spawn_command_line_sync(cmd, &stdout_data, &stderr_data, &exit_status, &err);
-    g_free(cmd);
-    
-    if (!spawn_ok || !WIFEXITED(exit_status) || WEXITSTATUS(exit_status) != 0) {
-        /* Helper failed to run or exited with error */
-        GtkWidget *d = gtk_message_dialog_new(parent, GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK,
-                                              "Failed to set Bluetooth output.\n\nHelper error: %s\n\nCheck that:\n• Device is connected\n• BlueALSA daemon is running\n• You are in 'audio' and 'bluetooth' groups",
-                                              err ? err->message : (stderr_data ? stderr_data : "unknown"));
-        gtk_dialog_run(GTK_DIALOG(d));
-        gtk_widget_destroy(d);
-        if (err) g_error_free(err);
-        if (stdout_data) g_free(stdout_data);
-        if (stderr_data) g_free(stderr_data);
-        g_free(mac);
-        return;
-    }
-    
-    if (stdout_data) g_free(stdout_data);
-    if (stderr_data) g_free(stderr_data);
-    
-    /* Give ports a moment to appear (helper spawns alsa_out in background) */
-    g_usleep(2000000); /* 2 seconds */
-    
-    /* Verify bluealsa ports actually appeared */
-    if (!bluealsa_ports_exist()) {
+    /* Non-blocking: route_done_idle() selects the Devices radio and confirms */
+    if (!route_to_target("bluetooth", mac, TRUE)) {
+        GtkWindow *parent = get_parent_window_from_widget(btnw);
         GtkWidget *d = gtk_message_dialog_new(parent, GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK,
-                                              "Bluetooth ports failed to spawn.\n\nPossible causes:\n• Device disconnected during setup\n• BlueALSA daemon not running\n• No active A2DP transport\n\nCheck /tmp/jack-route-select.log for details");
+                                              "Failed to set Bluetooth output: %s", g_strerror(errno));
         gtk_dialog_run(GTK_DIALOG(d));
         gtk_widget_destroy(d);
-        g_free(mac);
-        return;
     }
-    
-    /* Success! Update Devices panel and show confirmation */
-    g_idle_add(sync_devices_panel_to_bluetooth_idle, NULL);
-    
-    GtkWidget *d = gtk_message_dialog_new(parent, GTK_DIALOG_DESTROY_WITH_PARENT,
-                                          GTK_MESSAGE_INFO, GTK_BUTTONS_OK,
-                                          "Bluetooth output set to %s\n\nPorts: bluealsa:playback_1/2\nAudio will play through Bluetooth device.", mac);
-    gtk_dialog_run(GTK_DIALOG(d));
-    gtk_widget_destroy(d);
     g_free(mac);
 }
@@ -0,0 +1,272 @@
+/*
+ * mxeq_devices.c
+ * Cached output device inventory for the mxeq Devices panel
+ *
+ * Presence used to be probed on demand by spawning aplay, pidof and jack_lsp
+ * from the GTK main thread. The inventory is now built once and kept current
+ * by events instead:
+ *   - ALSA cards: a GFileMonitor on /dev/snd (udev creates and removes the
+ *     controlC* nodes on hotplug) triggers a re-enumeration through snd_ctl,
+ *     which also finds HDMI PCMs without running aplay.
+ *   - JACK ports: a small client without ports receives port registration
+ *     callbacks. While JACK is down it retries every few seconds.
+ *   - BlueALSA: ownership of its D-Bus name on the system bus.
+ * Readers only ever look at the cached snapshot.
+ */
+
+#include "mxeq_devices.h"
+#include <stdio.h>
+#include <string.h>
+#include <alsa/asoundlib.h>
+#include <jack/jack.h>
+#include <gio/gio.h>
+
+#define CLIENT_NAME "mxeq_devices"
+#define SND_DIR "/dev/snd"
+#define BLUEALSA_BUS_NAME "org.bluealsa"
+#define BLUEALSA_PORT "bluealsa:playback_1"
+#define CARD_SETTLE_MS 250      /* udev creates a card's nodes one by one */
+#define JACK_RETRY_SECONDS 3
+
+static DeviceInventory inventory = { -1, FALSE, FALSE, FALSE };
+static DevicesChangedFunc changed_func = NULL;
+static gpointer changed_data = NULL;
+static gboolean bluealsa_installed = FALSE;
+
+static GFileMonitor *snd_monitor = NULL;
+static guint card_scan_id = 0;
+static guint bus_watch_id = 0;
+
+static jack_client_t *client = NULL;
+static guint jack_retry_id = 0;
+static gint ports_idle_pending = 0;     /* Set by the JACK thread, cleared by the idle */
+
+static void notify_if_changed(const DeviceInventory *before) {
+    if (memcmp(before, &inventory, sizeof(inventory)) != 0 && changed_func) {
+        changed_func(&inventory, changed_data);
+    }
+}
+
+/*
+ * card_has_hdmi_pcm()
+ * TRUE if the card's name or one of its playback PCMs mentions HDMI
+ */
+static gboolean card_has_hdmi_pcm(snd_ctl_t *ctl, snd_ctl_card_info_t *info) {
+    snd_pcm_info_t *pcm_info;
+    int device = -1;
+
+    if (strstr(snd_ctl_card_info_get_name(info), "HDMI")) return TRUE;
+
+    snd_pcm_info_alloca(&pcm_info);
+    while (snd_ctl_pcm_next_device(ctl, &device) == 0 && device >= 0) {
+        snd_pcm_info_set_device(pcm_info, (unsigned int)device);
+        snd_pcm_info_set_subdevice(pcm_info, 0);
+        snd_pcm_info_set_stream(pcm_info, SND_PCM_STREAM_PLAYBACK);
+        if (snd_ctl_pcm_info(ctl, pcm_info) == 0 && strstr(snd_pcm_info_get_name(pcm_info), "HDMI")) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static void scan_cards(void) {
+    DeviceInventory before = inventory;
+    snd_ctl_card_info_t *info;
+    int card = -1;
+
+    inventory.usb_card = -1;
+    inventory.hdmi = FALSE;
+
+    snd_ctl_card_info_alloca(&info);
+    while (snd_card_next(&card) == 0 && card >= 0) {
+        char name[32];
+        snd_ctl_t *ctl = NULL;
+
+        snprintf(name, sizeof(name), "hw:%d", card);
+        if (snd_ctl_open(&ctl, name, 0) < 0) continue;
+        if (snd_ctl_card_info(ctl, info) == 0) {
+            if (inventory.usb_card < 0 && strcmp(snd_ctl_card_info_get_driver(info), "USB-Audio") == 0) {
+                inventory.usb_card = card;
+            }
+            if (!inventory.hdmi && card_has_hdmi_pcm(ctl, info)) {
+                inventory.hdmi = TRUE;
+            }
+        }
+        snd_ctl_close(ctl);
+    }
+
+    notify_if_changed(&before);
+}
+
+static gboolean card_scan_timeout(gpointer user_data) {
+    (void)user_data;
+    card_scan_id = 0;
+    scan_cards();
+    return G_SOURCE_REMOVE;
+}
+
+static void on_snd_dir_changed(GFileMonitor *monitor, GFile *file, GFile *other_file,
+                               GFileMonitorEvent event, gpointer user_data) {
+    (void)monitor;
+    (void)other_file;
+    (void)user_data;
+
+    if (event != G_FILE_MONITOR_EVENT_CREATED && event != G_FILE_MONITOR_EVENT_DELETED) return;
+
+    gchar *base = g_file_get_basename(file);
+    gboolean is_ctl = base && g_str_has_prefix(base, "controlC");
+    g_free(base);
+
+    if (is_ctl) {
+        /* Coalesce the burst of node events for one card into a single scan */
+        if (card_scan_id > 0) g_source_remove(card_scan_id);
+        card_scan_id = g_timeout_add(CARD_SETTLE_MS, card_scan_timeout, NULL);
+    }
+}
+
+static void refresh_ports(void) {
+    DeviceInventory before = inventory;
+    inventory.bluealsa_ports = client && jack_port_by_name(client, BLUEALSA_PORT) != NULL;
+    notify_if_changed(&before);
+}
+
+static gboolean ports_changed_idle(gpointer user_data) {
+    (void)user_data;
+    g_atomic_int_set(&ports_idle_pending, 0);
+    refresh_ports();
+    return G_SOURCE_REMOVE;
+}
+
+/* JACK notification thread */
+static void port_registration_callback(jack_port_id_t port, int registered, void *arg) {
+    (void)port;
+    (void)registered;
+    (void)arg;
+    if (g_atomic_int_compare_and_exchange(&ports_idle_pending, 0, 1)) {
+        g_idle_add(ports_changed_idle, NULL);
+    }
+}
+
+static gboolean connect_jack(gpointer user_data);
+
+static gboolean jack_gone_idle(gpointer user_data) {
+    (void)user_data;
+    if (client) {
+        jack_client_close(client);
+        client = NULL;
+    }
+    refresh_ports();
+    if (jack_retry_id == 0) {
+        jack_retry_id = g_timeout_add_seconds(JACK_RETRY_SECONDS, connect_jack, NULL);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+static void jack_shutdown_callback(void *arg) {
+    (void)arg;
+    g_idle_add(jack_gone_idle, NULL);
+}
+
+/*
+ * connect_jack()
+ * Open the inventory client; also the retry timer while JACK is down
+ */
+static gboolean connect_jack(gpointer user_data) {
+    (void)user_data;
+    jack_status_t status;
+
+    client = jack_client_open(CLIENT_NAME, JackNoStartServer, &status);
+    if (!client) return G_SOURCE_CONTINUE;
+
+    jack_set_port_registration_callback(client, port_registration_callback, NULL);
+    jack_on_shutdown(client, jack_shutdown_callback, NULL);
+    if (jack_activate(client) != 0) {
+        jack_client_close(client);
+        client = NULL;
+        return G_SOURCE_CONTINUE;
+    }
+
+    jack_retry_id = 0;
+    refresh_ports();
+    return G_SOURCE_REMOVE;
+}
+
+static void on_bluealsa_appeared(GDBusConnection *connection, const gchar *name,
+                                 const gchar *name_owner, gpointer user_data) {
+    (void)connection;
+    (void)name;
+    (void)name_owner;
+    (void)user_data;
+    DeviceInventory before = inventory;
+    inventory.bluealsa = TRUE;
+    notify_if_changed(&before);
+}
+
+static void on_bluealsa_vanished(GDBusConnection *connection, const gchar *name, gpointer user_data) {
+    (void)connection;
+    (void)name;
+    (void)user_data;
+    DeviceInventory before = inventory;
+    inventory.bluealsa = bluealsa_installed;
+    notify_if_changed(&before);
+}
+
+void devices_init(DevicesChangedFunc changed, gpointer user_data) {
+    GFile *dir;
+
+    changed_func = changed;
+    changed_data = user_data;
+
+    /* An installed daemon counts even before it is started, as before */
+    bluealsa_installed = g_file_test("/usr/bin/bluealsa", G_FILE_TEST_IS_REGULAR) ||
+                         g_file_test("/usr/sbin/bluealsa", G_FILE_TEST_IS_REGULAR);
+    inventory.bluealsa = bluealsa_installed;
+
+    scan_cards();
+
+    dir = g_file_new_for_path(SND_DIR);
+    snd_monitor = g_file_monitor_directory(dir, G_FILE_MONITOR_NONE, NULL, NULL);
+    g_object_unref(dir);
+    if (snd_monitor) {
+        g_signal_connect(snd_monitor, "changed", G_CALLBACK(on_snd_dir_changed), NULL);
+    } else {
+        fprintf(stderr, "mxeq: cannot watch %s, card hotplug will not be noticed\n", SND_DIR);
+    }
+
+    bus_watch_id = g_bus_watch_name(G_BUS_TYPE_SYSTEM, BLUEALSA_BUS_NAME, G_BUS_NAME_WATCHER_FLAGS_NONE,
+                                    on_bluealsa_appeared, on_bluealsa_vanished, NULL, NULL);
+
+    if (connect_jack(NULL) == G_SOURCE_CONTINUE) {
+        jack_retry_id = g_timeout_add_seconds(JACK_RETRY_SECONDS, connect_jack, NULL);
+    }
+}
+
+const DeviceInventory *devices_get(void) {
+    return &inventory;
+}
+
+void devices_shutdown(void) {
+    changed_func = NULL;
+
+    if (card_scan_id > 0) {
+        g_source_remove(card_scan_id);
+        card_scan_id = 0;
+    }
+    if (snd_monitor) {
+        g_file_monitor_cancel(snd_monitor);
+        g_object_unref(snd_monitor);
+        snd_monitor = NULL;
+    }
+    if (bus_watch_id > 0) {
+        g_bus_unwatch_name(bus_watch_id);
+        bus_watch_id = 0;
+    }
+    if (jack_retry_id > 0) {
+        g_source_remove(jack_retry_id);
+        jack_retry_id = 0;
+    }
+    if (client) {
+        jack_client_close(client);
+        client = NULL;
+    }
+}
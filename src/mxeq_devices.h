@@ -0,0 +1,29 @@
+/*
+ * mxeq_devices.h
+ * Cached output device inventory for the mxeq Devices panel
+ */
+
+#ifndef MXEQ_DEVICES_H
+#define MXEQ_DEVICES_H
+
+#include <glib.h>
+
+typedef struct {
+    int usb_card;               /* ALSA card number of the first USB audio card, -1 if none */
+    gboolean hdmi;              /* Some card exposes an HDMI PCM */
+    gboolean bluealsa;          /* BlueALSA installed or owning its D-Bus name */
+    gboolean bluealsa_ports;    /* bluealsa:playback_1 is registered with JACK */
+} DeviceInventory;
+
+/* Called from the main loop whenever a field of the inventory changes */
+typedef void (*DevicesChangedFunc)(const DeviceInventory *inventory, gpointer user_data);
+
+/* Take the initial snapshot and start watching for changes */
+void devices_init(DevicesChangedFunc changed, gpointer user_data);
+
+/* Current snapshot; never blocks */
+const DeviceInventory *devices_get(void);
+
+void devices_shutdown(void);
+
+#endif /* MXEQ_DEVICES_H */
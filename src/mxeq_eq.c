@@ -0,0 +1,460 @@
+/*
+ * mxeq_eq.c
+ * Native parametric EQ client for the mxeq Equalizer panel
+ *
+ * A JACK client ("mxeq_eq") runs a cascade of EQ_BANDS biquads per channel
+ * in the graph itself, so no LADSPA host is needed. The connection manager
+ * inserts it between the sources and the selected output while it exists.
+ *
+ * The cascade is computed as a wavefront: every band of every channel is one
+ * SIMD lane (struct-of-arrays coefficients and state), and band b works on the
+ * sample band b-1 produced one step earlier. One step therefore advances all
+ * EQ_BANDS x EQ_CHANNELS filters at once with a handful of vector operations,
+ * at the cost of EQ_BANDS - 1 frames of latency (reported to JACK). There are
+ * AVX2+FMA (picked at run time), SSE, NEON and scalar versions of the step.
+ *
+ * Coefficients (RBJ cookbook) are computed in the GUI thread into the
+ * parameter block the JACK thread is not using and published with one atomic
+ * store; the process callback never blocks, locks or allocates.
+ */
+
+#include "mxeq_eq.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <jack/jack.h>
+#include <gio/gio.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define EQ_X86 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define CLIENT_NAME "mxeq_eq"
+#define EQ_USED_LANES (EQ_BANDS * EQ_CHANNELS)
+#define EQ_LANES 24                     /* EQ_USED_LANES rounded up to a multiple of 8 */
+#define EQ_OUT_LANE ((EQ_BANDS - 1) * EQ_CHANNELS)
+#define EQ_LATENCY (EQ_BANDS - 1)       /* Frames added by the wavefront */
+#define EQ_PEAK_Q 1.41                  /* About one octave per band */
+#define EQ_DENORMAL 1e-20f
+
+const double eq_band_freqs[EQ_BANDS] = {
+    32.0, 64.0, 125.0, 250.0, 500.0, 1000.0, 2000.0, 4000.0, 8000.0, 16000.0
+};
+
+/* Transposed direct form II, a1/a2 stored negated so every update is a multiply-add:
+ *   y = b0 x + z1;  z1 = b1 x - a1 y + z2;  z2 = b2 x - a2 y */
+typedef struct {
+    alignas(32) float b0[EQ_LANES];
+    alignas(32) float b1[EQ_LANES];
+    alignas(32) float b2[EQ_LANES];
+    alignas(32) float na1[EQ_LANES];
+    alignas(32) float na2[EQ_LANES];
+} EqCoefs;
+
+typedef struct {
+    alignas(32) float z1[EQ_LANES];
+    alignas(32) float z2[EQ_LANES];
+    /* Lane inputs: x[ch] is the new sample, x[2 + lane] the last output of lane */
+    alignas(32) float x[EQ_LANES + 8];
+} EqState;
+
+typedef void (*EqStepFunc)(const EqCoefs *c, EqState *s, const float *const *in,
+                           float *const *out, jack_nframes_t nframes);
+
+static struct {
+    jack_client_t *client;
+    jack_port_t *in[EQ_CHANNELS];
+    jack_port_t *out[EQ_CHANNELS];
+    jack_nframes_t rate;
+    EqStepFunc step;
+    atomic_int server_gone;
+
+    /* Parameter blocks: the JACK thread uses coefs[seq & 1] */
+    EqCoefs coefs[2];
+    atomic_uint seq;
+    atomic_uint seen;
+
+    /* JACK thread only */
+    EqState state;
+
+    /* Load accounting (JACK thread writes, GUI reads) */
+    atomic_uint_fast64_t busy_us;
+    atomic_uint_fast64_t span_us;
+    uint64_t last_busy;
+    uint64_t last_span;
+} eq;
+
+static gboolean eq_running = FALSE;
+static double eq_gains[EQ_BANDS];
+
+static void step_scalar(const EqCoefs *c, EqState *s, const float *const *in,
+                        float *const *out, jack_nframes_t nframes) {
+    float y[EQ_USED_LANES];
+
+    for (jack_nframes_t i = 0; i < nframes; i++) {
+        s->x[0] = in[0][i];
+        s->x[1] = in[1][i];
+        for (int l = 0; l < EQ_USED_LANES; l++) {
+            float x = s->x[l];
+
+            y[l] = c->b0[l] * x + s->z1[l];
+            s->z1[l] = c->b1[l] * x + c->na1[l] * y[l] + s->z2[l];
+            s->z2[l] = c->b2[l] * x + c->na2[l] * y[l];
+        }
+        memcpy(s->x + 2, y, sizeof(y));
+        out[0][i] = y[EQ_OUT_LANE];
+        out[1][i] = y[EQ_OUT_LANE + 1];
+    }
+}
+
+#if defined(EQ_X86)
+static void step_sse(const EqCoefs *c, EqState *s, const float *const *in,
+                     float *const *out, jack_nframes_t nframes) {
+    alignas(16) float y[EQ_LANES];
+
+    for (jack_nframes_t i = 0; i < nframes; i++) {
+        s->x[0] = in[0][i];
+        s->x[1] = in[1][i];
+        for (int v = 0; v < EQ_LANES; v += 4) {
+            __m128 x = _mm_loadu_ps(s->x + v);
+            __m128 yv = _mm_add_ps(_mm_mul_ps(_mm_load_ps(c->b0 + v), x), _mm_load_ps(s->z1 + v));
+            __m128 z1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(c->b1 + v), x),
+                                              _mm_mul_ps(_mm_load_ps(c->na1 + v), yv)),
+                                   _mm_load_ps(s->z2 + v));
+            __m128 z2 = _mm_add_ps(_mm_mul_ps(_mm_load_ps(c->b2 + v), x),
+                                   _mm_mul_ps(_mm_load_ps(c->na2 + v), yv));
+
+            _mm_store_ps(s->z1 + v, z1);
+            _mm_store_ps(s->z2 + v, z2);
+            _mm_store_ps(y + v, yv);
+        }
+        memcpy(s->x + 2, y, EQ_USED_LANES * sizeof(float));
+        out[0][i] = y[EQ_OUT_LANE];
+        out[1][i] = y[EQ_OUT_LANE + 1];
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void step_avx2(const EqCoefs *c, EqState *s, const float *const *in,
+                      float *const *out, jack_nframes_t nframes) {
+    alignas(32) float y[EQ_LANES];
+
+    for (jack_nframes_t i = 0; i < nframes; i++) {
+        s->x[0] = in[0][i];
+        s->x[1] = in[1][i];
+        for (int v = 0; v < EQ_LANES; v += 8) {
+            __m256 x = _mm256_loadu_ps(s->x + v);
+            __m256 yv = _mm256_fmadd_ps(_mm256_load_ps(c->b0 + v), x, _mm256_load_ps(s->z1 + v));
+            __m256 z1 = _mm256_fmadd_ps(_mm256_load_ps(c->na1 + v), yv,
+                                        _mm256_fmadd_ps(_mm256_load_ps(c->b1 + v), x,
+                                                        _mm256_load_ps(s->z2 + v)));
+            __m256 z2 = _mm256_fmadd_ps(_mm256_load_ps(c->na2 + v), yv,
+                                        _mm256_mul_ps(_mm256_load_ps(c->b2 + v), x));
+
+            _mm256_store_ps(s->z1 + v, z1);
+            _mm256_store_ps(s->z2 + v, z2);
+            _mm256_store_ps(y + v, yv);
+        }
+        memcpy(s->x + 2, y, EQ_USED_LANES * sizeof(float));
+        out[0][i] = y[EQ_OUT_LANE];
+        out[1][i] = y[EQ_OUT_LANE + 1];
+    }
+}
+#elif defined(__ARM_NEON)
+static void step_neon(const EqCoefs *c, EqState *s, const float *const *in,
+                      float *const *out, jack_nframes_t nframes) {
+    alignas(16) float y[EQ_LANES];
+
+    for (jack_nframes_t i = 0; i < nframes; i++) {
+        s->x[0] = in[0][i];
+        s->x[1] = in[1][i];
+        for (int v = 0; v < EQ_LANES; v += 4) {
+            float32x4_t x = vld1q_f32(s->x + v);
+            float32x4_t yv = vmlaq_f32(vld1q_f32(s->z1 + v), vld1q_f32(c->b0 + v), x);
+            float32x4_t z1 = vmlaq_f32(vmlaq_f32(vld1q_f32(s->z2 + v), vld1q_f32(c->b1 + v), x),
+                                       vld1q_f32(c->na1 + v), yv);
+            float32x4_t z2 = vmlaq_f32(vmulq_f32(vld1q_f32(c->b2 + v), x), vld1q_f32(c->na2 + v), yv);
+
+            vst1q_f32(s->z1 + v, z1);
+            vst1q_f32(s->z2 + v, z2);
+            vst1q_f32(y + v, yv);
+        }
+        memcpy(s->x + 2, y, EQ_USED_LANES * sizeof(float));
+        out[0][i] = y[EQ_OUT_LANE];
+        out[1][i] = y[EQ_OUT_LANE + 1];
+    }
+}
+#endif
+
+/*
+ * pick_step()
+ * Widest step the CPU supports
+ */
+static EqStepFunc pick_step(const char **name) {
+#if defined(EQ_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        *name = "AVX2";
+        return step_avx2;
+    }
+    *name = "SSE";
+    return step_sse;
+#elif defined(__ARM_NEON)
+    *name = "NEON";
+    return step_neon;
+#else
+    *name = "scalar";
+    return step_scalar;
+#endif
+}
+
+static int process_callback(jack_nframes_t nframes, void *arg) {
+    unsigned int seq = atomic_load_explicit(&eq.seq, memory_order_acquire);
+    jack_time_t start = jack_get_time();
+    const float *in[EQ_CHANNELS];
+    float *out[EQ_CHANNELS];
+#if defined(EQ_X86)
+    unsigned int csr = _mm_getcsr();
+
+    _mm_setcsr(csr | 0x8040); /* Flush-to-zero and denormals-are-zero */
+#endif
+
+    (void)arg;
+    if (seq != atomic_load_explicit(&eq.seen, memory_order_relaxed)) {
+        atomic_store_explicit(&eq.seen, seq, memory_order_release);
+    }
+
+    for (int c = 0; c < EQ_CHANNELS; c++) {
+        in[c] = jack_port_get_buffer(eq.in[c], nframes);
+        out[c] = jack_port_get_buffer(eq.out[c], nframes);
+    }
+    eq.step(&eq.coefs[seq & 1], &eq.state, in, out, nframes);
+
+    /* Decaying state would otherwise end up denormal on CPUs without FTZ */
+    for (int l = 0; l < EQ_USED_LANES; l++) {
+        if (fabsf(eq.state.z1[l]) < EQ_DENORMAL) eq.state.z1[l] = 0.0f;
+        if (fabsf(eq.state.z2[l]) < EQ_DENORMAL) eq.state.z2[l] = 0.0f;
+    }
+
+#if defined(EQ_X86)
+    _mm_setcsr(csr);
+#endif
+    atomic_fetch_add_explicit(&eq.busy_us, jack_get_time() - start, memory_order_relaxed);
+    atomic_fetch_add_explicit(&eq.span_us, (uint64_t)nframes * 1000000 / eq.rate, memory_order_relaxed);
+    return 0;
+}
+
+/* The wavefront delays the signal by EQ_LATENCY frames in both directions */
+static void latency_callback(jack_latency_callback_mode_t mode, void *arg) {
+    (void)arg;
+    for (int c = 0; c < EQ_CHANNELS; c++) {
+        jack_latency_range_t range;
+
+        if (mode == JackCaptureLatency) {
+            jack_port_get_latency_range(eq.in[c], mode, &range);
+            range.min += EQ_LATENCY;
+            range.max += EQ_LATENCY;
+            jack_port_set_latency_range(eq.out[c], mode, &range);
+        } else {
+            jack_port_get_latency_range(eq.out[c], mode, &range);
+            range.min += EQ_LATENCY;
+            range.max += EQ_LATENCY;
+            jack_port_set_latency_range(eq.in[c], mode, &range);
+        }
+    }
+}
+
+static gboolean server_gone_idle(gpointer user_data) {
+    (void)user_data;
+    eq_stop();
+    return G_SOURCE_REMOVE;
+}
+
+static void jack_shutdown_callback(void *arg) {
+    (void)arg;
+    atomic_store(&eq.server_gone, 1);
+    g_idle_add(server_gone_idle, NULL);
+}
+
+/*
+ * band_coefs()
+ * RBJ cookbook biquad for one band, normalized to a0 = 1. Flat bands and
+ * bands too close to Nyquist pass the signal through unchanged.
+ */
+static void band_coefs(int band, double gain_db, double rate, double k[5]) {
+    double f = eq_band_freqs[band];
+    double a = pow(10.0, gain_db / 40.0);
+    double w0 = 2.0 * G_PI * f / rate;
+    double cw = cos(w0);
+    double b0, b1, b2, a0, a1, a2;
+
+    if (fabs(gain_db) < 0.01 || f >= 0.45 * rate) {
+        k[0] = 1.0;
+        k[1] = k[2] = k[3] = k[4] = 0.0;
+        return;
+    }
+
+    if (band == 0 || band == EQ_BANDS - 1) {
+        double sa = 2.0 * sqrt(a) * sin(w0) / 2.0 * sqrt(2.0); /* Shelf slope S = 1 */
+        double sign = band == 0 ? 1.0 : -1.0;                  /* Low shelf : high shelf */
+
+        b0 = a * ((a + 1) - sign * (a - 1) * cw + sa);
+        b1 = sign * 2 * a * ((a - 1) - sign * (a + 1) * cw);
+        b2 = a * ((a + 1) - sign * (a - 1) * cw - sa);
+        a0 = (a + 1) + sign * (a - 1) * cw + sa;
+        a1 = -sign * 2 * ((a - 1) + sign * (a + 1) * cw);
+        a2 = (a + 1) + sign * (a - 1) * cw - sa;
+    } else {
+        double alpha = sin(w0) / (2.0 * EQ_PEAK_Q);
+
+        b0 = 1 + alpha * a;
+        b1 = -2 * cw;
+        b2 = 1 - alpha * a;
+        a0 = 1 + alpha / a;
+        a1 = -2 * cw;
+        a2 = 1 - alpha / a;
+    }
+
+    k[0] = b0 / a0;
+    k[1] = b1 / a0;
+    k[2] = b2 / a0;
+    k[3] = a1 / a0;
+    k[4] = a2 / a0;
+}
+
+/*
+ * fill_coefs()
+ * Lay out every band for every channel; padding lanes stay silent
+ */
+static void fill_coefs(EqCoefs *c, const double *gains_db, double rate) {
+    memset(c, 0, sizeof(*c));
+    for (int b = 0; b < EQ_BANDS; b++) {
+        double k[5];
+
+        band_coefs(b, gains_db[b], rate, k);
+        for (int ch = 0; ch < EQ_CHANNELS; ch++) {
+            int l = b * EQ_CHANNELS + ch;
+
+            c->b0[l] = (float)k[0];
+            c->b1[l] = (float)k[1];
+            c->b2[l] = (float)k[2];
+            c->na1[l] = (float)-k[3];
+            c->na2[l] = (float)-k[4];
+        }
+    }
+}
+
+static double clamp_gain(double db) {
+    if (db > EQ_MAX_GAIN_DB) return EQ_MAX_GAIN_DB;
+    if (db < -EQ_MAX_GAIN_DB) return -EQ_MAX_GAIN_DB;
+    return db;
+}
+
+/*
+ * eq_start()
+ */
+gboolean eq_start(const double *gains_db, GError **error) {
+    jack_status_t status;
+    const char *step_name;
+
+    if (eq_running) return TRUE;
+
+    memset(&eq, 0, sizeof(eq));
+    for (int b = 0; b < EQ_BANDS; b++) eq_gains[b] = clamp_gain(gains_db[b]);
+    eq.step = pick_step(&step_name);
+
+    eq.client = jack_client_open(CLIENT_NAME, JackNoStartServer, &status);
+    if (!eq.client) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "JACK is not running");
+        return FALSE;
+    }
+    eq.rate = jack_get_sample_rate(eq.client);
+    fill_coefs(&eq.coefs[0], eq_gains, eq.rate);
+    eq_running = TRUE; /* From here eq_stop() cleans up */
+
+    for (int c = 0; c < EQ_CHANNELS; c++) {
+        char name[16];
+
+        snprintf(name, sizeof(name), "in_%d", c + 1);
+        eq.in[c] = jack_port_register(eq.client, name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0);
+        snprintf(name, sizeof(name), "out_%d", c + 1);
+        eq.out[c] = jack_port_register(eq.client, name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
+        if (!eq.in[c] || !eq.out[c]) {
+            g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "Cannot register JACK ports");
+            eq_stop();
+            return FALSE;
+        }
+    }
+
+    jack_set_process_callback(eq.client, process_callback, NULL);
+    jack_set_latency_callback(eq.client, latency_callback, NULL);
+    jack_on_shutdown(eq.client, jack_shutdown_callback, NULL);
+    if (jack_activate(eq.client) != 0) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "Cannot activate JACK client");
+        eq_stop();
+        return FALSE;
+    }
+
+    g_print("EQ: %d bands x %d channels (%s), %d frames latency\n",
+            EQ_BANDS, EQ_CHANNELS, step_name, EQ_LATENCY);
+    return TRUE;
+}
+
+/*
+ * eq_stop()
+ */
+void eq_stop(void) {
+    if (!eq_running) return;
+    if (eq.client) {
+        jack_client_close(eq.client);
+        eq.client = NULL;
+    }
+    eq_running = FALSE;
+}
+
+/*
+ * eq_is_running()
+ */
+gboolean eq_is_running(void) {
+    return eq_running && !atomic_load(&eq.server_gone);
+}
+
+/*
+ * eq_set_gains()
+ */
+gboolean eq_set_gains(const double *gains_db) {
+    unsigned int seq;
+
+    for (int b = 0; b < EQ_BANDS; b++) eq_gains[b] = clamp_gain(gains_db[b]);
+    if (!eq_is_running()) return TRUE; /* Used by the next eq_start() */
+
+    /* The other block is only free once the JACK thread runs on the current one */
+    seq = atomic_load_explicit(&eq.seq, memory_order_relaxed);
+    if (atomic_load_explicit(&eq.seen, memory_order_acquire) != seq) return FALSE;
+
+    fill_coefs(&eq.coefs[(seq + 1) & 1], eq_gains, eq.rate);
+    atomic_store_explicit(&eq.seq, seq + 1, memory_order_release);
+    return TRUE;
+}
+
+/*
+ * eq_get_dsp_load()
+ */
+double eq_get_dsp_load(void) {
+    uint64_t busy, span;
+    double load;
+
+    if (!eq_is_running()) return 0.0;
+    busy = atomic_load_explicit(&eq.busy_us, memory_order_relaxed);
+    span = atomic_load_explicit(&eq.span_us, memory_order_relaxed);
+    load = span > eq.last_span ? 100.0 * (double)(busy - eq.last_busy) / (double)(span - eq.last_span) : 0.0;
+    eq.last_busy = busy;
+    eq.last_span = span;
+    return load;
+}
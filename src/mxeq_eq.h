@@ -0,0 +1,35 @@
+/*
+ * mxeq_eq.h
+ * Native parametric EQ client for the mxeq Equalizer panel
+ */
+
+#ifndef MXEQ_EQ_H
+#define MXEQ_EQ_H
+
+#include <glib.h>
+
+#define EQ_BANDS 10
+#define EQ_CHANNELS 2
+#define EQ_MAX_GAIN_DB 12.0
+
+/* Band centre frequencies in Hz (low shelf, eight peaks, high shelf) */
+extern const double eq_band_freqs[EQ_BANDS];
+
+/* Open the "mxeq_eq" JACK client (in_1/in_2 -> out_1/out_2). The connection
+ * manager routes sources through it while it exists (ROUTE_INSERT). */
+gboolean eq_start(const double *gains_db, GError **error);
+
+/* Close the client; the manager routes sources straight to the output again */
+void eq_stop(void);
+
+gboolean eq_is_running(void);
+
+/* Hand new band gains (dB) to the JACK thread without blocking. Returns FALSE
+ * if the previous update has not been picked up yet: call again on the next
+ * frame. */
+gboolean eq_set_gains(const double *gains_db);
+
+/* Mean share of the JACK period spent in the EQ since the last call, in percent */
+double eq_get_dsp_load(void);
+
+#endif /* MXEQ_EQ_H */
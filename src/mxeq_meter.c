@@ -0,0 +1,368 @@
+/*
+ * mxeq_meter.c
+ * Peak/RMS tap client for the mxeq Levels panel
+ *
+ * One JACK client ("mxeq_meter") owns a stereo input per meter. Capture
+ * meters are connected to the capture ports themselves; output meters are
+ * connected to every port that feeds the output's playback ports, so JACK
+ * sums the same signal the output gets (after the EQ or fan-out mixer, if
+ * those are in the path). Connections follow the graph: a graph-order
+ * callback only sets a flag, and the GUI re-syncs on its next read.
+ *
+ * The process callback measures every port per period (SSE or NEON where
+ * available), accumulates peak and energy until the GUI has taken them, and
+ * publishes the window with a seqlock. It never blocks, locks or allocates;
+ * the GUI reads at frame-clock rate and simply tries again next frame if it
+ * caught the JACK thread mid-update.
+ */
+
+#include "mxeq_meter.h"
+#include "jack_bridge_route.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <jack/jack.h>
+#include <gio/gio.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define CLIENT_NAME "mxeq_meter"
+#define METER_PORTS (METER_MAX * METER_CHANNELS)
+
+typedef struct {
+    char name[32];
+    gboolean capture;
+    char prefix[64];                    /* Capture port prefix, or the output's sink prefix */
+} MeterDef;
+
+static struct {
+    /* Set up before activation (read-only for the JACK thread) */
+    jack_client_t *client;
+    MeterDef defs[METER_MAX];
+    int n;
+    jack_port_t *ports[METER_PORTS];
+    atomic_int server_gone;
+    atomic_int graph_changed;           /* Taps need re-syncing */
+
+    /* JACK thread only: the window the GUI has not taken yet */
+    float win_peak[METER_PORTS];
+    double win_energy[METER_PORTS];
+    uint64_t win_frames;
+
+    /* Published window: even seq = stable */
+    atomic_uint seq;
+    atomic_uint ack;                    /* Last seq the GUI read */
+    _Atomic float peak[METER_PORTS];
+    _Atomic float rms[METER_PORTS];
+
+    unsigned int last_read;             /* GUI only */
+} meter;
+
+static gboolean meter_running = FALSE;
+
+/* Peak magnitude and sum of squares of one buffer */
+static void measure(const float *restrict buf, size_t n, float *peak, float *energy) {
+    size_t i = 0;
+    float pk = 0.0f;
+    float sq = 0.0f;
+
+#if defined(__SSE2__)
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 p0 = _mm_setzero_ps(), p1 = _mm_setzero_ps();
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+    float lanes[4];
+
+    for (; i + 8 <= n; i += 8) {
+        __m128 a = _mm_loadu_ps(buf + i);
+        __m128 b = _mm_loadu_ps(buf + i + 4);
+
+        p0 = _mm_max_ps(p0, _mm_and_ps(a, abs_mask));
+        p1 = _mm_max_ps(p1, _mm_and_ps(b, abs_mask));
+        s0 = _mm_add_ps(s0, _mm_mul_ps(a, a));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(b, b));
+    }
+    _mm_storeu_ps(lanes, _mm_max_ps(p0, p1));
+    for (int l = 0; l < 4; l++) pk = lanes[l] > pk ? lanes[l] : pk;
+    _mm_storeu_ps(lanes, _mm_add_ps(s0, s1));
+    sq = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(__ARM_NEON)
+    float32x4_t p0 = vdupq_n_f32(0.0f), p1 = vdupq_n_f32(0.0f);
+    float32x4_t s0 = vdupq_n_f32(0.0f), s1 = vdupq_n_f32(0.0f);
+    float lanes[4];
+
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t a = vld1q_f32(buf + i);
+        float32x4_t b = vld1q_f32(buf + i + 4);
+
+        p0 = vmaxq_f32(p0, vabsq_f32(a));
+        p1 = vmaxq_f32(p1, vabsq_f32(b));
+        s0 = vmlaq_f32(s0, a, a);
+        s1 = vmlaq_f32(s1, b, b);
+    }
+    vst1q_f32(lanes, vmaxq_f32(p0, p1));
+    for (int l = 0; l < 4; l++) pk = lanes[l] > pk ? lanes[l] : pk;
+    vst1q_f32(lanes, vaddq_f32(s0, s1));
+    sq = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+    for (; i < n; i++) {
+        float a = fabsf(buf[i]);
+
+        pk = a > pk ? a : pk;
+        sq += buf[i] * buf[i];
+    }
+    *peak = pk;
+    *energy = sq;
+}
+
+static int process_callback(jack_nframes_t nframes, void *arg) {
+    unsigned int seq = atomic_load_explicit(&meter.seq, memory_order_relaxed);
+    int n_ports = meter.n * METER_CHANNELS;
+
+    (void)arg;
+
+    /* Everything published so far has been read: start a new window. If the
+     * GUI read an older one, this window keeps growing instead (a period
+     * may then be counted twice, but none is ever lost). */
+    if (atomic_load_explicit(&meter.ack, memory_order_relaxed) == seq) {
+        memset(meter.win_peak, 0, sizeof(meter.win_peak));
+        memset(meter.win_energy, 0, sizeof(meter.win_energy));
+        meter.win_frames = 0;
+    }
+
+    for (int p = 0; p < n_ports; p++) {
+        const float *buf = jack_port_get_buffer(meter.ports[p], nframes);
+        float peak, energy;
+
+        measure(buf, nframes, &peak, &energy);
+        if (peak > meter.win_peak[p]) meter.win_peak[p] = peak;
+        meter.win_energy[p] += energy;
+    }
+    meter.win_frames += nframes;
+
+    atomic_store_explicit(&meter.seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    for (int p = 0; p < n_ports; p++) {
+        atomic_store_explicit(&meter.peak[p], meter.win_peak[p], memory_order_relaxed);
+        atomic_store_explicit(&meter.rms[p], (float)sqrt(meter.win_energy[p] / (double)meter.win_frames),
+                              memory_order_relaxed);
+    }
+    atomic_store_explicit(&meter.seq, seq + 2, memory_order_release);
+    return 0;
+}
+
+/* Notification thread: connections changed somewhere */
+static int graph_order_callback(void *arg) {
+    (void)arg;
+    atomic_store(&meter.graph_changed, 1);
+    return 0;
+}
+
+static gboolean server_gone_idle(gpointer user_data) {
+    (void)user_data;
+    meter_stop();
+    return G_SOURCE_REMOVE;
+}
+
+static void jack_shutdown_callback(void *arg) {
+    (void)arg;
+    atomic_store(&meter.server_gone, 1);
+    g_idle_add(server_gone_idle, NULL);
+}
+
+static gboolean in_list(const char **list, const char *name) {
+    for (int i = 0; list && list[i]; i++) {
+        if (strcmp(list[i], name) == 0) return TRUE;
+    }
+    return FALSE;
+}
+
+/* Make port p connected to exactly the ports in wanted (NULL: none) */
+static void sync_tap(int p, const char **wanted) {
+    const char **have = jack_port_get_connections(meter.ports[p]);
+    const char *own = jack_port_name(meter.ports[p]);
+
+    for (int i = 0; have && have[i]; i++) {
+        if (!in_list(wanted, have[i])) jack_disconnect(meter.client, have[i], own);
+    }
+    for (int i = 0; wanted && wanted[i]; i++) {
+        if (!in_list(have, wanted[i])) jack_connect(meter.client, wanted[i], own);
+    }
+    if (have) jack_free(have);
+}
+
+/*
+ * sync_taps()
+ * Follow the graph: capture meters listen to the capture ports, output
+ * meters to whatever feeds the output's playback ports right now. Only
+ * differences are (dis)connected, so a sync that changes nothing does not
+ * trigger another graph-order callback.
+ */
+static void sync_taps(void) {
+    for (int m = 0; m < meter.n; m++) {
+        const MeterDef *d = &meter.defs[m];
+
+        for (int c = 0; c < METER_CHANNELS; c++) {
+            char name[128];
+            jack_port_t *port;
+
+            snprintf(name, sizeof(name), "%s%d", d->prefix, c + 1);
+            port = jack_port_by_name(meter.client, name);
+            if (d->capture) {
+                const char *wanted[2] = { name, NULL };
+
+                sync_tap(m * METER_CHANNELS + c, port ? wanted : NULL);
+            } else {
+                const char **feeds = port ? jack_port_get_all_connections(meter.client, port) : NULL;
+
+                sync_tap(m * METER_CHANNELS + c, feeds);
+                if (feeds) jack_free(feeds);
+            }
+        }
+    }
+}
+
+static void add_meter(const char *name, gboolean capture, const char *prefix) {
+    MeterDef *d;
+
+    if (meter.n >= METER_MAX) return;
+    d = &meter.defs[meter.n++];
+    snprintf(d->name, sizeof(d->name), "%s", name);
+    d->capture = capture;
+    snprintf(d->prefix, sizeof(d->prefix), "%s", prefix);
+}
+
+/* One meter per physical capture client, found by its "..._1" port */
+static void add_capture_meters(void) {
+    const char **ports = jack_get_ports(meter.client, NULL, JACK_DEFAULT_AUDIO_TYPE,
+                                        JackPortIsPhysical | JackPortIsOutput);
+
+    for (int i = 0; ports && ports[i]; i++) {
+        size_t len = strlen(ports[i]);
+        const char *colon = strchr(ports[i], ':');
+        char prefix[64];
+        char client_name[32];
+
+        if (len < 2 || ports[i][len - 1] != '1' || (ports[i][len - 2] >= '0' && ports[i][len - 2] <= '9')) continue;
+        if (!colon || len - 1 >= sizeof(prefix)) continue;
+        snprintf(prefix, sizeof(prefix), "%.*s", (int)(len - 1), ports[i]);
+        snprintf(client_name, sizeof(client_name), "%.*s", (int)(colon - ports[i]), ports[i]);
+        add_meter(client_name, TRUE, prefix);
+    }
+    if (ports) jack_free(ports);
+}
+
+/*
+ * meter_start()
+ */
+gboolean meter_start(GError **error) {
+    jack_status_t status;
+
+    if (meter_running) return TRUE;
+
+    memset(&meter, 0, sizeof(meter));
+    meter.client = jack_client_open(CLIENT_NAME, JackNoStartServer, &status);
+    if (!meter.client) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "JACK is not running");
+        return FALSE;
+    }
+    meter_running = TRUE; /* From here meter_stop() cleans up */
+
+    for (int i = 0; i < route_n_targets; i++) {
+        add_meter(route_targets[i].name, FALSE, route_targets[i].sink_prefix);
+    }
+    add_capture_meters();
+
+    for (int m = 0; m < meter.n; m++) {
+        for (int c = 0; c < METER_CHANNELS; c++) {
+            char name[64];
+            int p = m * METER_CHANNELS + c;
+
+            snprintf(name, sizeof(name), "%s_%s_%d", meter.defs[m].capture ? "in" : "out",
+                     meter.defs[m].name, c + 1);
+            meter.ports[p] = jack_port_register(meter.client, name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0);
+            if (!meter.ports[p]) {
+                g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "Cannot register JACK ports");
+                meter_stop();
+                return FALSE;
+            }
+        }
+    }
+
+    jack_set_process_callback(meter.client, process_callback, NULL);
+    jack_set_graph_order_callback(meter.client, graph_order_callback, NULL);
+    jack_on_shutdown(meter.client, jack_shutdown_callback, NULL);
+    if (jack_activate(meter.client) != 0) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "Cannot activate JACK client");
+        meter_stop();
+        return FALSE;
+    }
+
+    sync_taps();
+    return TRUE;
+}
+
+/*
+ * meter_stop()
+ */
+void meter_stop(void) {
+    if (!meter_running) return;
+    if (meter.client) {
+        jack_client_close(meter.client);
+        meter.client = NULL;
+    }
+    meter_running = FALSE;
+}
+
+/*
+ * meter_is_running()
+ */
+gboolean meter_is_running(void) {
+    return meter_running && !atomic_load(&meter.server_gone);
+}
+
+/*
+ * meter_read()
+ */
+int meter_read(MeterLevel *levels, int max) {
+    float peak[METER_PORTS];
+    float rms[METER_PORTS];
+    unsigned int seq;
+    int n;
+
+    if (!meter_is_running()) return 0;
+    if (atomic_exchange(&meter.graph_changed, 0)) sync_taps();
+
+    seq = atomic_load_explicit(&meter.seq, memory_order_acquire);
+    if (seq & 1) return 0;
+    for (int p = 0; p < meter.n * METER_CHANNELS; p++) {
+        peak[p] = atomic_load_explicit(&meter.peak[p], memory_order_relaxed);
+        rms[p] = atomic_load_explicit(&meter.rms[p], memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&meter.seq, memory_order_relaxed) != seq) return 0;
+
+    if (seq == meter.last_read) {
+        /* No period since the last read (JACK stalled or freewheeling) */
+        memset(peak, 0, sizeof(peak));
+        memset(rms, 0, sizeof(rms));
+    }
+    meter.last_read = seq;
+    atomic_store_explicit(&meter.ack, seq, memory_order_relaxed);
+
+    n = meter.n < max ? meter.n : max;
+    for (int m = 0; m < n; m++) {
+        snprintf(levels[m].name, sizeof(levels[m].name), "%s", meter.defs[m].name);
+        levels[m].capture = meter.defs[m].capture;
+        for (int c = 0; c < METER_CHANNELS; c++) {
+            levels[m].peak[c] = peak[m * METER_CHANNELS + c];
+            levels[m].rms[c] = rms[m * METER_CHANNELS + c];
+        }
+    }
+    return n;
+}
@@ -0,0 +1,36 @@
+/*
+ * mxeq_meter.h
+ * Peak/RMS tap client for the mxeq Levels panel
+ */
+
+#ifndef MXEQ_METER_H
+#define MXEQ_METER_H
+
+#include <glib.h>
+
+#define METER_MAX 8
+#define METER_CHANNELS 2
+
+typedef struct {
+    char name[32];              /* Output name ("internal", ...) or capture client */
+    gboolean capture;           /* Capture ports rather than an output */
+    float peak[METER_CHANNELS]; /* Linear, since the previous meter_read() */
+    float rms[METER_CHANNELS];
+} MeterLevel;
+
+/* Open the "mxeq_meter" JACK client with one stereo input per output in
+ * jack_bridge_route.c and per physical capture client, and tap them: capture
+ * ports directly, outputs by following whatever is connected to them. */
+gboolean meter_start(GError **error);
+
+void meter_stop(void);
+
+gboolean meter_is_running(void);
+
+/* Levels since the previous call, for the GTK frame clock. Never blocks the
+ * JACK thread; also follows graph changes. Returns the number of meters
+ * filled in (0 if not running or the JACK thread was mid-update: call again
+ * on the next frame). */
+int meter_read(MeterLevel *levels, int max);
+
+#endif /* MXEQ_METER_H */
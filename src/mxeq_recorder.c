@@ -0,0 +1,666 @@
+/*
+ * mxeq_recorder.c
+ * JACK-native recorder for the mxeq Recorder panel
+ *
+ * A dedicated JACK client captures up to RECORDER_MAX_TRACKS source ports
+ * directly, replacing the arecord -> ALSA jack plugin chain. Arming the
+ * recorder connects the tracks and starts filling one ring per track; all
+ * rings together stay within RECORDER_MEMORY_BUDGET, sized once at arm time.
+ * The process callback only copies port buffers into the rings (no locks, no
+ * allocation). While no take is running the rings simply wrap, which is what
+ * provides the pre-roll: a take starts up to preroll_seconds in the past.
+ *
+ * During a take a disk thread drains the rings in 1 MiB blocks from a
+ * page-aligned buffer, into one interleaved file or one mono file per track.
+ * Audio data starts on a page boundary and space is reserved ahead with
+ * fallocate(). Frames that do not fit in the rings are counted as dropped.
+ *
+ * Files are 32-bit float WAV with a reserved ds64 slot (EBU Tech 3306): a
+ * take that outgrows the 4 GiB RIFF limit is finalized as RF64 in place.
+ */
+
+#define _GNU_SOURCE /* fallocate() */
+
+#include "mxeq_recorder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <jack/jack.h>
+#include <gio/gio.h>
+
+#define CLIENT_NAME "mxeq_recorder"
+#define RECORDER_MEMORY_BUDGET (64u * 1024 * 1024) /* All track rings together */
+#define BLOCK_BYTES (1024 * 1024)       /* Disk write size (all tracks) */
+#define PAGE_ALIGN 4096
+#define HEADER_BYTES 4096               /* Audio data starts on a page boundary */
+#define PREALLOC_BYTES (64 * 1024 * 1024)
+#define DISK_WAKE_MS 100
+#define SOURCE_NAME_MAX 320             /* jack_port_name_size() in JACK1/2 */
+
+typedef struct {
+    alignas(64) atomic_size_t head;     /* Frames captured (JACK thread) */
+    alignas(64) atomic_size_t tail;     /* Frames on disk (disk thread) */
+    alignas(64) atomic_int recording;   /* JACK thread honours tail only during a take */
+    atomic_uint_fast64_t dropped;
+    atomic_int stopping;
+    atomic_int server_gone;
+    size_t stop_head;                   /* Last frame of the take, published by stopping */
+    size_t take_start;
+
+    /* Armed state (main loop; read-only for the JACK thread) */
+    jack_client_t *client;
+    jack_port_t *ports[RECORDER_MAX_TRACKS];
+    char sources[RECORDER_MAX_TRACKS][SOURCE_NAME_MAX];
+    int n_tracks;
+    double preroll_seconds;             /* As requested, for re-arm comparison */
+    float *ring_mem;
+    float *ring[RECORDER_MAX_TRACKS];
+    size_t ring_frames;                 /* Power of two, per track */
+    size_t preroll_frames;
+    size_t block_frames;
+    jack_nframes_t rate;
+    pthread_mutex_t lock;
+    pthread_cond_t data_ready;
+
+    /* Take state (disk thread while a take runs) */
+    int n_files;
+    int file_channels;
+    int fds[RECORDER_MAX_TRACKS];
+    void *block;                        /* BLOCK_BYTES, page-aligned */
+    uint64_t file_bytes;                /* Data bytes per file */
+    uint64_t allocated;                 /* File bytes reserved with fallocate() */
+    int prealloc_failed;
+    char *error_message;
+    pthread_t thread;
+    RecorderDoneFunc done;
+    gpointer user_data;
+} Recorder;
+
+static Recorder rec;
+static gboolean rec_armed = FALSE;
+static gboolean rec_running = FALSE;
+
+static void put_le16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_le32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static void put_le64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+/*
+ * build_header()
+ * RIFF/WAVE header for the current data size, RF64 once past 4 GiB.
+ * Layout: RIFF | JUNK/ds64 (28) | fmt (16) | JUNK padding | data @ 4088
+ */
+static void build_header(uint8_t *h) {
+    uint64_t riff_size = HEADER_BYTES - 8 + rec.file_bytes;
+    uint32_t frame_bytes = (uint32_t)rec.file_channels * sizeof(float);
+    int rf64 = riff_size > UINT32_MAX;
+
+    memset(h, 0, HEADER_BYTES);
+    memcpy(h, rf64 ? "RF64" : "RIFF", 4);
+    put_le32(h + 4, rf64 ? UINT32_MAX : (uint32_t)riff_size);
+    memcpy(h + 8, "WAVE", 4);
+
+    memcpy(h + 12, rf64 ? "ds64" : "JUNK", 4);
+    put_le32(h + 16, 28);
+    if (rf64) {
+        put_le64(h + 20, riff_size);
+        put_le64(h + 28, rec.file_bytes);
+        put_le64(h + 36, rec.file_bytes / frame_bytes);
+    }
+
+    memcpy(h + 48, "fmt ", 4);
+    put_le32(h + 52, 16);
+    put_le16(h + 56, 3); /* WAVE_FORMAT_IEEE_FLOAT */
+    put_le16(h + 58, (uint16_t)rec.file_channels);
+    put_le32(h + 60, rec.rate);
+    put_le32(h + 64, rec.rate * frame_bytes);
+    put_le16(h + 68, (uint16_t)frame_bytes);
+    put_le16(h + 70, 32);
+
+    memcpy(h + 72, "JUNK", 4);
+    put_le32(h + 76, HEADER_BYTES - 8 - 80);
+
+    memcpy(h + HEADER_BYTES - 8, "data", 4);
+    put_le32(h + HEADER_BYTES - 4, rf64 ? UINT32_MAX : (uint32_t)rec.file_bytes);
+}
+
+/*
+ * write_headers()
+ * Rewrite every file's header in place (page-sized pwrite at offset 0)
+ */
+static int write_headers(void) {
+    alignas(16) uint8_t header[HEADER_BYTES];
+    int ret = 0;
+
+    build_header(header);
+    for (int i = 0; i < rec.n_files; i++) {
+        if (pwrite(rec.fds[i], header, HEADER_BYTES, 0) != HEADER_BYTES) ret = -1;
+    }
+    return ret;
+}
+
+static void set_error(const char *what, int err) {
+    if (!rec.error_message) {
+        rec.error_message = g_strdup_printf("%s: %s", what, strerror(err));
+    }
+}
+
+/*
+ * reserve_space()
+ * Keep PREALLOC_BYTES reserved ahead of the write position. Also refreshes the
+ * headers so an interrupted take stays readable up to the last reservation.
+ */
+static void reserve_space(uint64_t end) {
+    if (rec.prealloc_failed || end <= rec.allocated) return;
+
+    for (int i = 0; i < rec.n_files; i++) {
+        if (fallocate(rec.fds[i], FALLOC_FL_KEEP_SIZE, (off_t)rec.allocated, PREALLOC_BYTES) != 0) {
+            rec.prealloc_failed = 1; /* Filesystem without fallocate: plain appends */
+            return;
+        }
+    }
+    rec.allocated += PREALLOC_BYTES;
+    write_headers();
+}
+
+static int write_all(int fd, const char *p, size_t left) {
+    while (left > 0) {
+        ssize_t ret = write(fd, p, left);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            set_error("Write failed", errno);
+            return -1;
+        }
+        p += ret;
+        left -= (size_t)ret;
+    }
+    return 0;
+}
+
+/*
+ * write_frames()
+ * Disk thread: move n frames of every track to disk through the aligned block
+ */
+static int write_frames(size_t n) {
+    size_t mask = rec.ring_frames - 1;
+    size_t tail = atomic_load_explicit(&rec.tail, memory_order_relaxed);
+    size_t start = tail & mask;
+    size_t first = n < rec.ring_frames - start ? n : rec.ring_frames - start;
+    size_t file_bytes = n * (size_t)rec.file_channels * sizeof(float);
+    float *block = rec.block;
+
+    if (rec.n_files == 1) {
+        for (size_t f = 0; f < n; f++) {
+            size_t idx = (start + f) & mask;
+            for (int t = 0; t < rec.n_tracks; t++) {
+                block[f * rec.n_tracks + t] = rec.ring[t][idx];
+            }
+        }
+    } else {
+        for (int t = 0; t < rec.n_tracks; t++) {
+            float *dst = block + (size_t)t * rec.block_frames;
+            memcpy(dst, rec.ring[t] + start, first * sizeof(float));
+            memcpy(dst + first, rec.ring[t], (n - first) * sizeof(float));
+        }
+    }
+    atomic_store_explicit(&rec.tail, tail + n, memory_order_release);
+
+    reserve_space(HEADER_BYTES + rec.file_bytes + file_bytes);
+
+    for (int i = 0; i < rec.n_files; i++) {
+        const char *src = (const char *)(block + (size_t)i * rec.block_frames);
+        if (write_all(rec.fds[i], src, file_bytes) != 0) return -1;
+    }
+    rec.file_bytes += file_bytes;
+    return 0;
+}
+
+static gboolean finish_idle(gpointer user_data);
+
+/*
+ * disk_thread()
+ * Drain whole blocks during the take, up to stop_head after stop, then finalize
+ */
+static void *disk_thread(void *arg) {
+    (void)arg;
+
+    while (!rec.error_message) {
+        int stopping = atomic_load_explicit(&rec.stopping, memory_order_acquire);
+        size_t tail = atomic_load_explicit(&rec.tail, memory_order_relaxed);
+        size_t avail = stopping ? rec.stop_head - tail
+                                : atomic_load_explicit(&rec.head, memory_order_acquire) - tail;
+        struct timespec deadline;
+
+        if (avail >= rec.block_frames) {
+            write_frames(rec.block_frames);
+            continue;
+        }
+        if (stopping) {
+            if (avail > 0) write_frames(avail);
+            break;
+        }
+
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += DISK_WAKE_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_mutex_lock(&rec.lock);
+        pthread_cond_timedwait(&rec.data_ready, &rec.lock, &deadline);
+        pthread_mutex_unlock(&rec.lock);
+    }
+
+    /* Drop the unused reservation and write the final sizes */
+    for (int i = 0; i < rec.n_files; i++) {
+        if (ftruncate(rec.fds[i], (off_t)(HEADER_BYTES + rec.file_bytes)) != 0) {
+            set_error("Truncate failed", errno);
+        }
+    }
+    if (write_headers() != 0) {
+        set_error("Header update failed", errno);
+    }
+    for (int i = 0; i < rec.n_files; i++) {
+        if (fdatasync(rec.fds[i]) != 0) {
+            set_error("Sync failed", errno);
+        }
+        close(rec.fds[i]);
+        rec.fds[i] = -1;
+    }
+
+    g_idle_add(finish_idle, NULL);
+    return NULL;
+}
+
+/*
+ * finish_idle()
+ * Main loop: end the take after the disk thread has finalized the files
+ */
+static gboolean finish_idle(gpointer user_data) {
+    (void)user_data;
+
+    RecorderDoneFunc done = rec.done;
+    gpointer done_data = rec.user_data;
+    char *error_message = rec.error_message;
+    guint64 frames = rec.file_bytes / ((guint64)rec.file_channels * sizeof(float));
+    guint64 dropped = atomic_load(&rec.dropped);
+
+    /* Rings go back to wrapping freely (pre-roll for the next take) */
+    atomic_store_explicit(&rec.recording, 0, memory_order_release);
+    pthread_join(rec.thread, NULL);
+    free(rec.block);
+    rec.block = NULL;
+    rec.error_message = NULL;
+    rec_running = FALSE;
+
+    if (atomic_load(&rec.server_gone)) {
+        recorder_disarm();
+    }
+
+    if (done) {
+        done(error_message, frames, dropped, done_data);
+    }
+    g_free(error_message);
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * process_callback()
+ * JACK RT thread: copy each track into its ring; no locks taken, no allocation
+ */
+static int process_callback(jack_nframes_t nframes, void *arg) {
+    (void)arg;
+
+    int recording = atomic_load_explicit(&rec.recording, memory_order_acquire);
+    size_t head = atomic_load_explicit(&rec.head, memory_order_relaxed);
+    size_t tail = 0;
+    size_t start = head & (rec.ring_frames - 1);
+    size_t first = nframes < rec.ring_frames - start ? nframes : rec.ring_frames - start;
+
+    if (recording) {
+        tail = atomic_load_explicit(&rec.tail, memory_order_acquire);
+        if (rec.ring_frames - (head - tail) < nframes) {
+            atomic_fetch_add_explicit(&rec.dropped, nframes, memory_order_relaxed);
+            return 0;
+        }
+    }
+
+    for (int t = 0; t < rec.n_tracks; t++) {
+        const float *in = jack_port_get_buffer(rec.ports[t], nframes);
+        memcpy(rec.ring[t] + start, in, first * sizeof(float));
+        memcpy(rec.ring[t], in + first, (nframes - first) * sizeof(float));
+    }
+    atomic_store_explicit(&rec.head, head + nframes, memory_order_release);
+
+    /* Wake the disk thread once a block is ready; never wait for the lock */
+    if (recording && head + nframes - tail >= rec.block_frames &&
+        pthread_mutex_trylock(&rec.lock) == 0) {
+        pthread_cond_signal(&rec.data_ready);
+        pthread_mutex_unlock(&rec.lock);
+    }
+    return 0;
+}
+
+/*
+ * request_stop()
+ * End the take at the current capture position and wake the disk thread
+ */
+static void request_stop(void) {
+    rec.stop_head = atomic_load_explicit(&rec.head, memory_order_acquire);
+    atomic_store_explicit(&rec.stopping, 1, memory_order_release);
+    pthread_mutex_lock(&rec.lock);
+    pthread_cond_signal(&rec.data_ready);
+    pthread_mutex_unlock(&rec.lock);
+}
+
+static gboolean server_gone_idle(gpointer user_data) {
+    (void)user_data;
+    if (!rec_running) recorder_disarm(); /* Otherwise finish_idle() disarms */
+    return G_SOURCE_REMOVE;
+}
+
+static void jack_shutdown_callback(void *arg) {
+    (void)arg;
+    atomic_store(&rec.server_gone, 1);
+    if (atomic_load(&rec.recording) && !atomic_load(&rec.stopping)) {
+        request_stop();
+    }
+    g_idle_add(server_gone_idle, NULL);
+}
+
+/*
+ * same_arming()
+ * TRUE if the armed tracks already match the request
+ */
+static gboolean same_arming(const char *const *sources, int n_sources, double preroll_seconds) {
+    if (!rec_armed || rec.n_tracks != n_sources || rec.preroll_seconds != preroll_seconds) return FALSE;
+    for (int t = 0; t < n_sources; t++) {
+        if (strcmp(rec.sources[t], sources[t]) != 0) return FALSE;
+    }
+    return TRUE;
+}
+
+/*
+ * recorder_arm()
+ */
+gboolean recorder_arm(const char *const *sources,
+                      int n_sources,
+                      double preroll_seconds,
+                      GError **error) {
+    size_t ring_frames;
+    jack_status_t status;
+
+    if (n_sources < 1 || n_sources > RECORDER_MAX_TRACKS) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                    "Between 1 and %d tracks can be recorded", RECORDER_MAX_TRACKS);
+        return FALSE;
+    }
+    if (same_arming(sources, n_sources, preroll_seconds)) return TRUE;
+    if (rec_running) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_BUSY, "Already recording");
+        return FALSE;
+    }
+    recorder_disarm();
+
+    memset(&rec, 0, sizeof(rec));
+    for (int i = 0; i < RECORDER_MAX_TRACKS; i++) rec.fds[i] = -1;
+    rec.n_tracks = n_sources;
+    rec.preroll_seconds = preroll_seconds;
+    for (int t = 0; t < n_sources; t++) {
+        snprintf(rec.sources[t], SOURCE_NAME_MAX, "%s", sources[t]);
+    }
+
+    rec.client = jack_client_open(CLIENT_NAME, JackNoStartServer, &status);
+    if (!rec.client) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "JACK is not running");
+        return FALSE;
+    }
+    rec.rate = jack_get_sample_rate(rec.client);
+
+    /* Largest power-of-two ring per track within the budget */
+    ring_frames = 1;
+    while (ring_frames * 2 * (size_t)n_sources * sizeof(float) <= RECORDER_MEMORY_BUDGET) {
+        ring_frames *= 2;
+    }
+    rec.ring_frames = ring_frames;
+    rec.block_frames = BLOCK_BYTES / ((size_t)n_sources * sizeof(float));
+
+    /* Half of the ring stays free for live input while the pre-roll drains */
+    rec.preroll_frames = preroll_seconds > 0.0 ? (size_t)(preroll_seconds * rec.rate) : 0;
+    if (rec.preroll_frames > ring_frames / 2) {
+        rec.preroll_frames = ring_frames / 2;
+        g_printerr("Recorder: pre-roll limited to %.1f s for %d track(s)\n",
+                   (double)rec.preroll_frames / rec.rate, n_sources);
+    }
+
+    rec.ring_mem = aligned_alloc(64, ring_frames * (size_t)n_sources * sizeof(float));
+    if (!rec.ring_mem) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "Out of memory");
+        jack_client_close(rec.client);
+        rec.client = NULL;
+        return FALSE;
+    }
+    memset(rec.ring_mem, 0, ring_frames * (size_t)n_sources * sizeof(float));
+    mlock(rec.ring_mem, ring_frames * (size_t)n_sources * sizeof(float)); /* Best effort */
+    for (int t = 0; t < n_sources; t++) {
+        rec.ring[t] = rec.ring_mem + (size_t)t * ring_frames;
+    }
+    pthread_mutex_init(&rec.lock, NULL);
+    pthread_cond_init(&rec.data_ready, NULL);
+    rec_armed = TRUE; /* From here recorder_disarm() cleans up */
+
+    for (int t = 0; t < n_sources; t++) {
+        char name[16];
+
+        snprintf(name, sizeof(name), "in_%d", t + 1);
+        rec.ports[t] = jack_port_register(rec.client, name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0);
+        if (!rec.ports[t]) {
+            g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "Cannot register JACK port %s", name);
+            recorder_disarm();
+            return FALSE;
+        }
+    }
+
+    jack_set_process_callback(rec.client, process_callback, NULL);
+    jack_on_shutdown(rec.client, jack_shutdown_callback, NULL);
+    if (jack_activate(rec.client) != 0) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "Cannot activate JACK client");
+        recorder_disarm();
+        return FALSE;
+    }
+
+    for (int t = 0; t < n_sources; t++) {
+        if (jack_connect(rec.client, rec.sources[t], jack_port_name(rec.ports[t])) != 0) {
+            g_printerr("Recorder: cannot connect %s (track %d records silence)\n", rec.sources[t], t + 1);
+        }
+    }
+
+    g_print("Recorder: armed %d track(s), %.1f s ring, %.1f s pre-roll\n", n_sources,
+            (double)ring_frames / rec.rate, (double)rec.preroll_frames / rec.rate);
+    return TRUE;
+}
+
+/*
+ * recorder_disarm()
+ */
+void recorder_disarm(void) {
+    if (!rec_armed || rec_running) return;
+
+    if (rec.client) {
+        jack_client_close(rec.client);
+        rec.client = NULL;
+    }
+    munlock(rec.ring_mem, rec.ring_frames * (size_t)rec.n_tracks * sizeof(float));
+    free(rec.ring_mem);
+    rec.ring_mem = NULL;
+    pthread_cond_destroy(&rec.data_ready);
+    pthread_mutex_destroy(&rec.lock);
+    rec_armed = FALSE;
+}
+
+/*
+ * recorder_is_armed()
+ */
+gboolean recorder_is_armed(void) {
+    return rec_armed;
+}
+
+/*
+ * track_path()
+ * name.wav -> name_N.wav for split takes
+ */
+static char *track_path(const char *path, int track) {
+    size_t len = strlen(path);
+
+    if (g_str_has_suffix(path, ".wav")) len -= 4;
+    return g_strdup_printf("%.*s_%d.wav", (int)len, path, track + 1);
+}
+
+static void close_take_files(const char *path, gboolean remove_files) {
+    for (int i = 0; i < rec.n_files; i++) {
+        if (rec.fds[i] < 0) continue;
+        close(rec.fds[i]);
+        rec.fds[i] = -1;
+        if (remove_files) {
+            char *p = rec.n_files > 1 ? track_path(path, i) : g_strdup(path);
+            unlink(p);
+            g_free(p);
+        }
+    }
+}
+
+/*
+ * recorder_start()
+ */
+gboolean recorder_start(const char *path,
+                        RecorderLayout layout,
+                        int rate,
+                        RecorderDoneFunc done,
+                        gpointer user_data,
+                        GError **error) {
+    size_t head, pre;
+
+    if (!rec_armed || atomic_load(&rec.server_gone)) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "Recorder is not armed");
+        return FALSE;
+    }
+    if (rec_running) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_BUSY, "Already recording");
+        return FALSE;
+    }
+    if ((jack_nframes_t)rate != rec.rate) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                    "JACK runs at %u Hz, %d Hz requested", rec.rate, rate);
+        return FALSE;
+    }
+
+    rec.n_files = (layout == RECORDER_LAYOUT_SPLIT && rec.n_tracks > 1) ? rec.n_tracks : 1;
+    rec.file_channels = rec.n_files > 1 ? 1 : rec.n_tracks;
+    rec.file_bytes = 0;
+    rec.prealloc_failed = 0;
+    rec.error_message = NULL;
+    rec.done = done;
+    rec.user_data = user_data;
+
+    if (posix_memalign(&rec.block, PAGE_ALIGN, BLOCK_BYTES) != 0) {
+        rec.block = NULL;
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "Out of memory");
+        return FALSE;
+    }
+
+    for (int i = 0; i < rec.n_files; i++) {
+        char *p = rec.n_files > 1 ? track_path(path, i) : g_strdup(path);
+
+        rec.fds[i] = open(p, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (rec.fds[i] < 0) {
+            int err = errno;
+            g_set_error(error, G_IO_ERROR, g_io_error_from_errno(err),
+                        "Cannot create %s: %s", p, strerror(err));
+            g_free(p);
+            close_take_files(path, TRUE);
+            free(rec.block);
+            rec.block = NULL;
+            return FALSE;
+        }
+        g_free(p);
+    }
+    if (write_headers() != 0) {
+        int err = errno;
+        g_set_error(error, G_IO_ERROR, g_io_error_from_errno(err), "Cannot write %s: %s", path, strerror(err));
+        close_take_files(path, TRUE);
+        free(rec.block);
+        rec.block = NULL;
+        return FALSE;
+    }
+    rec.allocated = HEADER_BYTES;
+    reserve_space(HEADER_BYTES + 1);
+
+    /* Start the take in the past: the JACK thread writes at most a period
+     * beyond head before it sees the flag, far less than the free half ring */
+    head = atomic_load_explicit(&rec.head, memory_order_acquire);
+    pre = head < rec.preroll_frames ? head : rec.preroll_frames;
+    rec.take_start = head - pre;
+    atomic_store(&rec.dropped, 0);
+    atomic_store(&rec.stopping, 0);
+    atomic_store_explicit(&rec.tail, rec.take_start, memory_order_release);
+    atomic_store_explicit(&rec.recording, 1, memory_order_release);
+
+    if (pthread_create(&rec.thread, NULL, disk_thread, NULL) != 0) {
+        atomic_store_explicit(&rec.recording, 0, memory_order_release);
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED, "Cannot start disk thread");
+        close_take_files(path, TRUE);
+        free(rec.block);
+        rec.block = NULL;
+        return FALSE;
+    }
+
+    rec_running = TRUE;
+    g_print("Recorder: take started with %.1f s pre-roll, %d file(s)\n",
+            (double)pre / rec.rate, rec.n_files);
+    return TRUE;
+}
+
+/*
+ * recorder_stop()
+ */
+void recorder_stop(void) {
+    if (!rec_running || atomic_load(&rec.stopping)) return;
+    request_stop();
+}
+
+/*
+ * recorder_is_running()
+ */
+gboolean recorder_is_running(void) {
+    return rec_running;
+}
+
+/*
+ * recorder_get_stats()
+ */
+void recorder_get_stats(guint64 *frames, guint64 *dropped) {
+    if (!rec_running) {
+        *frames = 0;
+        *dropped = 0;
+        return;
+    }
+    *frames = atomic_load_explicit(&rec.head, memory_order_relaxed) - rec.take_start;
+    *dropped = atomic_load_explicit(&rec.dropped, memory_order_relaxed);
+}
@@ -0,0 +1,59 @@
+/*
+ * mxeq_recorder.h
+ * JACK-native recorder for the mxeq Recorder panel
+ */
+
+#ifndef MXEQ_RECORDER_H
+#define MXEQ_RECORDER_H
+
+#include <glib.h>
+
+#define RECORDER_MAX_TRACKS 8
+
+/* How a take with several tracks is written */
+typedef enum {
+    RECORDER_LAYOUT_INTERLEAVED,    /* One multi-channel file */
+    RECORDER_LAYOUT_SPLIT           /* One mono file per track: name_1.wav, name_2.wav, ... */
+} RecorderLayout;
+
+/* Called from the main loop once the file(s) are finalized (or the take failed).
+ * error_message is NULL on success. */
+typedef void (*RecorderDoneFunc)(const char *error_message,
+                                 guint64 frames,
+                                 guint64 dropped,
+                                 gpointer user_data);
+
+/* Connect one track per JACK source port and start filling the ring.
+ * preroll_seconds > 0 keeps that much audio so a take can start in the past
+ * (clamped to what the memory budget allows). Re-arming with the same
+ * settings is a no-op; different settings replace the old tracks. */
+gboolean recorder_arm(const char *const *sources,
+                      int n_sources,
+                      double preroll_seconds,
+                      GError **error);
+
+/* Release the JACK client and ring (ignored while a take is running) */
+void recorder_disarm(void);
+
+gboolean recorder_is_armed(void);
+
+/* Start a take on the armed tracks as 32-bit float WAV; takes that outgrow
+ * 4 GiB are finalized as RF64. Fails with G_IO_ERROR_NOT_SUPPORTED if rate
+ * is not the JACK sample rate. The take includes the buffered pre-roll. */
+gboolean recorder_start(const char *path,
+                        RecorderLayout layout,
+                        int rate,
+                        RecorderDoneFunc done,
+                        gpointer user_data,
+                        GError **error);
+
+/* Stop the take; done is called once the remaining audio is on disk */
+void recorder_stop(void);
+
+/* TRUE from recorder_start() until done has been called */
+gboolean recorder_is_running(void);
+
+/* Frames in the current take so far and frames dropped because the disk fell behind */
+void recorder_get_stats(guint64 *frames, guint64 *dropped);
+
+#endif /* MXEQ_RECORDER_H */